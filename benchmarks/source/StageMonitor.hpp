@@ -0,0 +1,259 @@
+#ifndef STAGEMONITOR_HPP
+#define STAGEMONITOR_HPP
+
+#include "blub/core/globals.hpp"
+#include "blub/core/string.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/math.hpp"
+#include "blub/procedural/voxel/simple/base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <sys/resource.h>
+#endif
+
+
+/**
+ * @brief getProcessCpuSeconds returns the cpu-time used by all threads of the process so far.
+ */
+inline double getProcessCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER kernel100ns, user100ns;
+    kernel100ns.LowPart = kernel.dwLowDateTime;
+    kernel100ns.HighPart = kernel.dwHighDateTime;
+    user100ns.LowPart = user.dwLowDateTime;
+    user100ns.HighPart = user.dwHighDateTime;
+    return (double)(kernel100ns.QuadPart + user100ns.QuadPart) * 1e-7;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+/**
+ * @brief getPeakResidentSetKiB returns the maximum resident set size of the process so far.
+ */
+inline blub::uint64 getPeakResidentSetKiB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#   ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes
+#   else
+    return usage.ru_maxrss;
+#   endif
+#endif
+}
+
+
+/**
+ * @brief The StageMonitor class measures how long it takes until the stages of the pipeline (container, accessor, surface, renderer)
+ * are done with an operation, for example an edit or a camera movement.
+ * A stage reports by simple::base::signalEditDone() of its level of details, or by stageDone(). The latency of a stage is the time from begin()
+ * to its last report before the pipeline got idle. Stages that didn't report get no sample.
+ */
+class StageMonitor
+{
+public:
+    typedef std::chrono::steady_clock t_clock;
+    typedef blub::vector<double> t_samples;
+
+    /**
+     * @brief The stage struct contains the latencies of one stage in milliseconds.
+     * latencies are the times to the last report of an operation, firstLatencies the times to the first one.
+     */
+    struct stage
+    {
+        blub::string name;
+        t_samples latencies;
+        t_samples firstLatencies;
+        t_clock::time_point firstDone;
+        t_clock::time_point lastDone;
+        blub::uint64 numDone;
+    };
+
+    StageMonitor()
+    {
+        ;
+    }
+
+    /**
+     * @brief addStage adds a stage that reports itself by calling stageDone(). Add the stages in order of the pipeline and before calling begin().
+     * @param name Name used by the report.
+     * @return The index of the stage.
+     */
+    blub::int32 addStage(const blub::string& name)
+    {
+        m_stages.push_back(stage());
+        m_stages.back().name = name;
+        m_stages.back().numDone = 0;
+        m_numDoneAtBegin.push_back(0);
+        return m_stages.size() - 1;
+    }
+    /**
+     * @brief addStage adds a stage that reports itself by simple::base::signalEditDone().
+     * @param name Name used by the report.
+     * @param lods All level of details of the stage.
+     * @return The index of the stage.
+     */
+    template <class lodListType>
+    blub::int32 addStage(const blub::string& name, const lodListType& lods)
+    {
+        const blub::int32 index(addStage(name));
+        for (const auto& lod : lods)
+        {
+            lod->signalEditDone()->connect([this, index] {stageDone(index);});
+        }
+        return index;
+    }
+
+    /**
+     * @brief stageDone reports that a stage did some work. Thread-safe.
+     * @param index Returned by addStage().
+     */
+    void stageDone(const blub::int32& index)
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        stage &work(m_stages[index]);
+        work.lastDone = t_clock::now();
+        if (work.numDone == m_numDoneAtBegin[index])
+        {
+            work.firstDone = work.lastDone;
+        }
+        ++work.numDone;
+    }
+
+    /**
+     * @brief begin marks the begin of an operation. Call right before the operation.
+     */
+    void begin()
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_begin = t_clock::now();
+        m_numDoneAtBegin.clear();
+        for (const stage& work : m_stages)
+        {
+            m_numDoneAtBegin.push_back(work.numDone);
+        }
+    }
+
+    /**
+     * @brief waitForIdle blocks until the pipeline is idle and adds a latency sample for every stage that reported since begin().
+     * The pipeline counts as idle if no stage reported and the process used less cpu than a tenth of a thread for two intervals in a row.
+     * @return Wall-time from begin() to the last report of all stages, in seconds.
+     */
+    double waitForIdle()
+    {
+        const std::chrono::milliseconds interval(25);
+        blub::int32 quiet(0);
+        blub::uint64 numDone(getNumDone());
+        double cpu(getProcessCpuSeconds());
+        while (quiet < 2)
+        {
+            std::this_thread::sleep_for(interval);
+            const blub::uint64 numDoneNow(getNumDone());
+            const double cpuNow(getProcessCpuSeconds());
+            if (numDoneNow == numDone && cpuNow - cpu < 0.1 * 0.025)
+            {
+                ++quiet;
+            }
+            else
+            {
+                quiet = 0;
+            }
+            numDone = numDoneNow;
+            cpu = cpuNow;
+        }
+
+        std::lock_guard<std::mutex> locker(m_mutex);
+        t_clock::time_point end(m_begin);
+        for (std::size_t index = 0; index < m_stages.size(); ++index)
+        {
+            stage &work(m_stages[index]);
+            if (work.numDone == m_numDoneAtBegin[index])
+            {
+                continue;
+            }
+            work.latencies.push_back(std::chrono::duration<double, std::milli>(work.lastDone - m_begin).count());
+            work.firstLatencies.push_back(std::chrono::duration<double, std::milli>(work.firstDone - m_begin).count());
+            end = std::max(end, work.lastDone);
+        }
+        return std::chrono::duration<double>(end - m_begin).count();
+    }
+
+    /**
+     * @brief reset removes all samples.
+     */
+    void reset()
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        for (stage& work : m_stages)
+        {
+            work.latencies.clear();
+            work.firstLatencies.clear();
+        }
+    }
+
+    /**
+     * @brief getStages returns the stages and their samples. Call while idle.
+     */
+    const blub::vector<stage>& getStages() const
+    {
+        return m_stages;
+    }
+
+    /**
+     * @brief calculatePercentile returns the nearest-rank percentile.
+     * @param samples Gets sorted.
+     * @param percentile 0. to 100.
+     * @return 0. if samples is empty.
+     */
+    static double calculatePercentile(t_samples& samples, const double& percentile)
+    {
+        if (samples.empty())
+        {
+            return 0.;
+        }
+        std::sort(samples.begin(), samples.end());
+        const double rank(std::ceil(percentile / 100. * (double)samples.size()));
+        const std::size_t index(blub::math::clamp<double>(rank, 1., (double)samples.size()) - 1);
+        return samples[index];
+    }
+
+protected:
+    blub::uint64 getNumDone()
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        blub::uint64 result(0);
+        for (const stage& work : m_stages)
+        {
+            result += work.numDone;
+        }
+        return result;
+    }
+
+    std::mutex m_mutex;
+    blub::vector<stage> m_stages;
+    t_clock::time_point m_begin;
+    blub::vector<blub::uint64> m_numDoneAtBegin;
+
+};
+
+#endif // STAGEMONITOR_HPP
@@ -0,0 +1,74 @@
+#ifndef STUBTILE_HPP
+#define STUBTILE_HPP
+
+#include "blub/core/globals.hpp"
+#include "blub/core/sharedPointer.hpp"
+#include "blub/math/axisAlignedBox.hpp"
+#include "blub/procedural/voxel/tile/renderer.hpp"
+#include "blub/procedural/voxel/tile/surface.hpp"
+
+#include <functional>
+
+
+/**
+ * @brief The StubTile class replaces the render-engine tile (see OgreTile in the examples) for headless runs.
+ * It uploads nothing, it reports every change the renderer makes to it.
+ */
+template <typename configType = blub::procedural::voxel::config>
+class StubTile : public blub::procedural::voxel::tile::renderer<configType>
+{
+public:
+    typedef configType t_config;
+    typedef blub::sharedPointer<StubTile<t_config> > pointer;
+    typedef blub::procedural::voxel::tile::renderer<t_config> t_base;
+    typedef std::function<void (const blub::uint64& numTriangles)> t_callbackChanged;
+
+    /**
+     * @brief create creates an instance.
+     * @param changed Gets called by every setTileData() with the number of triangles it would upload,
+     * and with 0 by every change of the visibility. Gets called by multiple threads.
+     * @return Never nullptr.
+     */
+    static pointer create(const t_callbackChanged& changed)
+    {
+        return pointer(new StubTile(changed));
+    }
+
+    void setTileData(typename t_base::t_tileDataPtr convertToRenderAble, const blub::axisAlignedBox &/*aabb*/)
+    {
+        blub::uint64 numIndices(convertToRenderAble->getIndices().size());
+        for (blub::int32 indLod = 0; indLod < 6; ++indLod)
+        {
+            numIndices += convertToRenderAble->getIndicesLod(indLod).size();
+        }
+        m_changed(numIndices / 3);
+    }
+
+    void setVisible(const bool& vis) override
+    {
+        t_base::setVisible(vis);
+        m_changed(0);
+    }
+    void setCulled(const bool& culled) override
+    {
+        t_base::setCulled(culled);
+        m_changed(0);
+    }
+    void setVisibleLod(const blub::uint16& indLod, const bool& vis) override
+    {
+        t_base::setVisibleLod(indLod, vis);
+        m_changed(0);
+    }
+
+protected:
+    StubTile(const t_callbackChanged& changed)
+        : m_changed(changed)
+    {
+        ;
+    }
+
+    t_callbackChanged m_changed;
+
+};
+
+#endif // STUBTILE_HPP
@@ -0,0 +1,2444 @@
+#include "blub/async/dispatcher.hpp"
+#include "blub/core/metrics.hpp"
+#include "blub/core/trace.hpp"
+#include "blub/log/system.hpp"
+#include "blub/math/quaternion.hpp"
+#include "blub/math/ray.hpp"
+#include "blub/math/sphere.hpp"
+#include "blub/sync/identifier.hpp"
+#include "blub/procedural/voxel/config.hpp"
+#include "blub/procedural/voxel/edit/axisAlignedBox.hpp"
+#include "blub/procedural/voxel/edit/box.hpp"
+#include "blub/procedural/voxel/edit/composite.hpp"
+#include "blub/procedural/voxel/edit/mesh.hpp"
+#include "blub/procedural/voxel/edit/noise.hpp"
+#include "blub/procedural/voxel/edit/sphere.hpp"
+#include "blub/procedural/voxel/simple/accessor.hpp"
+#include "blub/procedural/voxel/simple/container/inMemory.hpp"
+#include "blub/procedural/voxel/simple/renderer.hpp"
+#include "blub/procedural/voxel/simple/surface.hpp"
+#include "blub/procedural/voxel/terrain/accessor.hpp"
+#include "blub/procedural/voxel/terrain/surface.hpp"
+#include "blub/procedural/voxel/terrain/renderer.hpp"
+#include "blub/procedural/voxel/tile/container.hpp"
+#include "blub/procedural/voxel/tile/renderer.hpp"
+#include "blub/procedural/voxel/tile/surface.hpp"
+#include "blub/procedural/voxel/vertexCache.hpp"
+
+#include "StageMonitor.hpp"
+#include "StubTile.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+
+/**
+ * Headless benchmark of the whole voxel pipeline: container, accessor, surface and renderer with 3 level of details.
+ * Instead of a render-engine the renderer creates StubTiles, so no window or gpu is needed.
+ * Runs the scenarios
+ * - generate: creates a world using simplex noise.
+ * - edit: bursts of sphere- and box-edits, added and cut, near the camera.
+ * - flythrough: moves the camera through the world, the renderer syncs the tiles to it.
+ * - dig: cuts 200 small spheres one after another along a tunnel, checks the accessor-tiles against the container afterwards.
+ * - remesh: toggles single voxel and small spheres one after another, recalculates the changed surface-tiles partially and completely.
+ * - sustained: cuts spheres every 5 and every 1 ms without waiting for the pipeline, reports the tile-jobs that got skipped because their tile changed again.
+ * - concurrent: cuts spheres every 5, 1 and 0.3 ms and moves the camera along with them, without waiting for the pipeline, reports the edits per second.
+ * - raycast: casts batches of random rays against the voxel of the container and against the triangles of the surface with the finest lod,
+ *   sweeps spheres along them and queries the closest surface-point to their origins.
+ * - sample: interpolates density and gradient at batches of random positions, batched by the container and naive by getVoxel() per voxel.
+ * - vertexcache: reorders copies of the surface-tiles of the finest lod for the vertex-cache and splits them into meshlets,
+ *   reports the average cache miss ratio before and after.
+ * - decimate: simplifies copies of the surface-tiles of all lods, reports the triangles before and after. Run it without --decimate.
+ * - normals: calculates the surface-tiles of all lods again with every tile::surface::normalCalculation, reports their time and vertex memory.
+ * - editrow: calculates sphere-, axisAlignedBox- and noise-edits into single tiles, row by row and voxel by voxel, on one thread.
+ * - noise: calculates noise-edits with one and four octaves, ridged and domain warped, into single tiles on one thread.
+ * - mesh: voxelises a sphere of about 100k triangles into single tiles on one thread.
+ * - composite: applies 1000 sphere- and box-primitives to an empty container, by one editVoxel() per primitive and by one composite-edit.
+ * - pyramid: rebuilds the accessor-tiles of lod 2 and 3 of a noise-world, sampled with stride and read from a downsampled pyramid.
+ * - lazylod: generates a world and moves a camera over it, once with transvoxel-sides calculated eager and once on demand of the renderer.
+ * - priority: generates a world with the tiles in hash order, nearest to the camera first and released in parts, reports the time to the first visible tile.
+ * - bricks: generates a flat noise-world with the container only, with the accessor and with accessor and surface, reports the cpu-time of each
+ *   and how many voxel-bricks are homogeneous and so get skipped.
+ * - cave: digs tunnels into solid ground and moves the camera through one, with and without cave-culling, reports the tiles in range and the ones shown.
+ * and writes per-stage latency percentiles, tiles/s, triangles/s and the peak resident set size as json.
+ *
+ * Usage: bench [--threads n] [--size halfExtent] [--output file.json] [--metrics file.json] [--trace file.json] [--bvh] [--vertexcache] [--meshlets] [--decimate error] [scenario ...]
+ * Without scenarios all get run, in the order above. Edit, flythrough, dig, remesh, sustained, concurrent, raycast, sample, vertexcache, decimate and normals run on the world of generate,
+ * editrow, noise and mesh on their own tiles, composite and pyramid on their own containers, lazylod, priority, bricks and cave on their own pipelines.
+ * Writes the json to bench.json if no output file is set. The log goes to bench.log and, by the global logger of blub::log, to stdout.
+ * --metrics enables metrics::registry::getGlobal() and dumps it after the run.
+ * --trace enables trace::tracer::getGlobal() and flushes it after the run, open the file in Perfetto. Needs a build with BLUB_TRACE.
+ * --bvh lets the surface-tiles build their bounding volume hierarchy, see simple::surface::setCalculateBvh(). Its build-time is in the metrics.
+ * Build with -DBENCH_VOXELS_PER_TILE=n to change the tile-size, default 20.
+ * --vertexcache and --meshlets let the surface-tiles optimize for the vertex-cache and build meshlets, see simple::surface::setOptimizeVertexCache()
+ *   and simple::surface::setCalculateMeshlets(). Their times are in the metrics.
+ * --decimate lets the surface-tiles of all but the finest lod simplify themselves with an error in voxel of their lod, see simple::surface::setDecimation().
+ *   The scenario decimate uses the same error, default 0.5.
+ */
+
+
+using namespace blub::procedural;
+using namespace blub;
+
+
+// build with for example -DBENCH_VOXELS_PER_TILE=64 to measure larger tiles, their index-lists switch to 32 bit if needed
+#ifndef BENCH_VOXELS_PER_TILE
+#define BENCH_VOXELS_PER_TILE 20
+#endif
+
+
+struct config : public voxel::config
+{
+    static const int32 voxelsPerTile = BENCH_VOXELS_PER_TILE;
+
+    typedef container<config> t_container;
+    typedef accessor<config> t_accessor;
+    typedef surface<config> t_surface;
+    template <typename configType>
+    struct renderer : public voxel::config::renderer<configType>
+    {
+        typedef StubTile<configType> t_tile;
+    };
+    typedef renderer<config> t_renderer;
+};
+
+typedef config t_config;
+typedef voxel::simple::container::inMemory<t_config> t_voxelContainer;
+typedef voxel::terrain::accessor<t_config> t_voxelAccessor;
+typedef voxel::terrain::renderer<t_config> t_voxelRenderer;
+typedef voxel::terrain::surface<t_config> t_voxelSurface;
+typedef voxel::edit::axisAlignedBox<t_config> t_editAxisAlignedBox;
+typedef voxel::edit::box<t_config> t_editBox;
+typedef voxel::edit::composite<t_config> t_editComposite;
+typedef voxel::edit::mesh<t_config> t_editMesh;
+typedef voxel::edit::noise<t_config> t_editNoise;
+typedef voxel::edit::sphere<t_config> t_editSphere;
+typedef StubTile<t_config> t_renderTile;
+
+
+/**
+ * @brief The pipeline struct contains the whole voxel pipeline and the measurement around it.
+ */
+struct pipeline
+{
+    pipeline(async::dispatcher &worker, const int32& numLod)
+        : container(worker)
+        , accessor(worker, container, numLod)
+        , surface(worker, accessor)
+        , renderer(worker, surface, createRadien(numLod))
+        , numTriangles(0)
+        , numTilesCalculated(0)
+    {
+        monitor.addStage("container", vector<t_voxelContainer*>(1, &container));
+        monitor.addStage("accessor", accessor.getLodList());
+        monitor.addStage("surface", surface.getLodList());
+        // the renderer doesn't signal, its tiles report
+        const int32 rendererStage(monitor.addStage("renderer"));
+        const t_renderTile::t_callbackChanged tileChanged = [this, rendererStage] (const uint64& numTrianglesSet)
+        {
+            numTriangles += numTrianglesSet;
+            monitor.stageDone(rendererStage);
+        };
+        renderer.setCreateTileCallback([tileChanged] {return t_renderTile::create(tileChanged);});
+        for (const auto& lod : surface.getLodList())
+        {
+            t_voxelSurface::t_lod* toCount(lod.get());
+            toCount->signalEditDone()->connect([this, toCount] {numTilesCalculated += toCount->getTilesThatGotEdited().size();});
+        }
+    }
+
+    static t_voxelRenderer::t_syncRadiusList createRadien(const int32& numLod)
+    {
+        t_voxelRenderer::t_syncRadiusList result(numLod);
+        for (int32 lod = 0; lod < numLod; ++lod)
+        {
+            result[lod] = t_config::voxelsPerTile*4.*(real)(1 << lod);
+        }
+        return result;
+    }
+
+    /**
+     * @brief getNumTilesCalculated returns the number of surface-tiles calculated so far. Call while idle.
+     */
+    uint64 getNumTilesCalculated() const
+    {
+        return numTilesCalculated;
+    }
+
+    t_voxelContainer container;
+    t_voxelAccessor accessor;
+    t_voxelSurface surface;
+    t_voxelRenderer renderer;
+
+    std::atomic<uint64> numTriangles;
+    std::atomic<uint64> numTilesCalculated;
+    StageMonitor monitor;
+};
+
+
+/**
+ * @brief The scenarioResult struct contains the measurement of one scenario.
+ */
+struct scenarioResult
+{
+    string name;
+    int32 numOperations;
+    double seconds;
+    uint64 numTiles;
+    uint64 numTriangles;
+    vector<StageMonitor::stage> stages;
+    uint64 peakResidentSetKiB;
+    // scenario specific numbers
+    vector<std::pair<string, double> > values;
+};
+
+
+/**
+ * @brief The scenario class measures the operations run between its construction and finish().
+ */
+class scenario
+{
+public:
+    scenario(pipeline& toMeasure, const string& name)
+        : m_pipeline(toMeasure)
+        , m_numTilesBegin(toMeasure.getNumTilesCalculated())
+        , m_numTrianglesBegin(toMeasure.numTriangles)
+    {
+        m_result.name = name;
+        m_result.numOperations = 0;
+        m_result.seconds = 0.;
+        m_pipeline.monitor.reset();
+    }
+
+    /**
+     * @brief run calls operation and waits until the pipeline got idle afterwards.
+     */
+    template <typename operationType>
+    void run(const operationType& operation)
+    {
+        m_pipeline.monitor.begin();
+        operation();
+        m_result.seconds += m_pipeline.monitor.waitForIdle();
+        ++m_result.numOperations;
+    }
+
+    scenarioResult finish()
+    {
+        m_result.numTiles = m_pipeline.getNumTilesCalculated() - m_numTilesBegin;
+        m_result.numTriangles = m_pipeline.numTriangles - m_numTrianglesBegin;
+        m_result.stages = m_pipeline.monitor.getStages();
+        m_result.peakResidentSetKiB = getPeakResidentSetKiB();
+        return m_result;
+    }
+
+protected:
+    pipeline& m_pipeline;
+    uint64 m_numTilesBegin;
+    uint64 m_numTrianglesBegin;
+    scenarioResult m_result;
+};
+
+
+scenarioResult runGenerate(pipeline& toRun, const real& halfExtent)
+{
+    scenario result(toRun, "generate");
+    result.run([&]
+    {
+        const axisAlignedBox extent(vector3(-halfExtent), vector3(halfExtent));
+        toRun.container.editVoxel(t_editNoise::create(extent, vector3(0.025)));
+    });
+    return result.finish();
+}
+
+scenarioResult runEdit(pipeline& toRun, const real& halfExtent)
+{
+    const int32 numBursts(20);
+    const int32 editsPerBurst(8);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<real> distribution(-1., 1.);
+    const real range(math::min<real>(halfExtent, t_config::voxelsPerTile*2.));
+
+    scenario result(toRun, "edit");
+    for (int32 burst = 0; burst < numBursts; ++burst)
+    {
+        result.run([&]
+        {
+            for (int32 edit = 0; edit < editsPerBurst; ++edit)
+            {
+                const vector3 position(distribution(random)*range, distribution(random)*range, distribution(random)*range);
+                const real size(6. + distribution(random)*2.);
+                if (edit % 2 == 0)
+                {
+                    t_editSphere::pointer toEdit(t_editSphere::create(sphere(vector3(), size)));
+                    toEdit->setCut(edit % 4 == 0);
+                    toRun.container.editVoxel(toEdit, transform(position));
+                }
+                else
+                {
+                    const quaternion rotation(distribution(random), distribution(random), distribution(random), distribution(random) + 2.);
+                    t_editBox::pointer toEdit(t_editBox::create(vector3(size*0.7), rotation));
+                    toEdit->setCut(edit % 4 == 1);
+                    toRun.container.editVoxel(toEdit, transform(position));
+                }
+            }
+        });
+    }
+    return result.finish();
+}
+
+scenarioResult runFlythrough(pipeline& toRun, sharedPointer<sync::identifier> camera, const real& halfExtent)
+{
+    const int32 numSteps(60);
+
+    scenario result(toRun, "flythrough");
+    for (int32 step = 0; step <= numSteps; ++step)
+    {
+        const real along((real)step / (real)numSteps * 2. - 1.);
+        const vector3 position(along*halfExtent, math::sin(along*math::pi)*halfExtent*0.25, along*halfExtent*0.5);
+        result.run([&]
+        {
+            toRun.renderer.updateCamera(camera, position);
+        });
+    }
+    toRun.renderer.updateCamera(camera, vector3());
+    toRun.monitor.waitForIdle();
+    return result.finish();
+}
+
+/**
+ * @brief runDig cuts 200 spheres of radius 3 one after another along a winding tunnel and waits for each, like a player digging.
+ * Operations are the cuts, the stages contain the latency of each.
+ * Afterwards every voxel of the accessor-tiles along the tunnel get compared against the container, the values contain the number that differ per lod.
+ */
+scenarioResult runDig(pipeline& toRun, const real& halfExtent)
+{
+    const int32 numCuts(200);
+    const real radius(3.);
+    const real length(halfExtent*0.8);
+    auto calculatePosition = [&] (const int32& cut)
+    {
+        const real along((real)cut / (real)numCuts);
+        return vector3(-length + along*2.*length, math::sin(along*20.)*5., math::cos(along*20.)*10.);
+    };
+
+    scenario result(toRun, "dig");
+    for (int32 cut = 0; cut < numCuts; ++cut)
+    {
+        result.run([&]
+        {
+            t_editSphere::pointer toEdit(t_editSphere::create(sphere(vector3(), radius)));
+            toEdit->setCut(true);
+            toRun.container.editVoxel(toEdit, transform(calculatePosition(cut)));
+        });
+    }
+    scenarioResult finished(result.finish());
+
+    const vector3 reach(radius + 2.);
+    const axisAlignedBox tunnel(vector3(-length, -5., -10.) - reach, vector3(length, 5., 10.) + reach);
+    toRun.container.lockForRead();
+    for (uint32 indLod = 0; indLod < toRun.accessor.getLodList().size(); ++indLod)
+    {
+        t_voxelAccessor::t_simple& accessorLod(*toRun.accessor.getLod(indLod));
+        typedef t_voxelAccessor::t_simple::t_tile t_tile;
+        const int32 voxelSkip(1 << indLod);
+        const real tileSize(t_tile::voxelLength*voxelSkip);
+        const vector3int32 start((int32)std::floor(tunnel.getMinimum().x / tileSize), (int32)std::floor(tunnel.getMinimum().y / tileSize), (int32)std::floor(tunnel.getMinimum().z / tileSize));
+        const vector3int32 end((int32)std::floor(tunnel.getMaximum().x / tileSize), (int32)std::floor(tunnel.getMaximum().y / tileSize), (int32)std::floor(tunnel.getMaximum().z / tileSize));
+        uint64 numDifferent(0);
+        accessorLod.lockForRead();
+        for (int32 x = start.x; x <= end.x; ++x)
+        {
+            for (int32 y = start.y; y <= end.y; ++y)
+            {
+                for (int32 z = start.z; z <= end.z; ++z)
+                {
+                    const vector3int32 id(x, y, z);
+                    const t_voxelAccessor::t_simple::t_tilePtr found(accessorLod.getTile(id));
+                    if (found.get() == nullptr)
+                    {
+                        continue;
+                    }
+                    for (int32 voxelX = -1; voxelX < t_tile::voxelLengthWithNormalCorrection-1; ++voxelX)
+                    {
+                        for (int32 voxelY = -1; voxelY < t_tile::voxelLengthWithNormalCorrection-1; ++voxelY)
+                        {
+                            for (int32 voxelZ = -1; voxelZ < t_tile::voxelLengthWithNormalCorrection-1; ++voxelZ)
+                            {
+                                const vector3int32 pos(voxelX, voxelY, voxelZ);
+                                const vector3int32 posContainer((id*t_tile::voxelLength + pos)*voxelSkip);
+                                if (found->getVoxel(pos).getInterpolation() != toRun.container.getVoxel(posContainer).getInterpolation())
+                                {
+                                    ++numDifferent;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        accessorLod.unlockRead();
+        finished.values.push_back(std::make_pair("lod" + std::to_string(indLod) + "StaleVoxel", (double)numDifferent));
+    }
+    toRun.container.unlockRead();
+    return finished;
+}
+
+/**
+ * @brief runRemesh toggles 50 single voxel and then 50 spheres of radius 3 at random positions one after another: cuts if the center is solid, else adds.
+ * Operations are the edits, the pipeline-stages contain the latency of each.
+ * Before every edit the surface-tiles near it get copied, afterwards each copy of a changed tile gets recalculated by tile::surface::recalculateSurface()
+ * and a new tile by tile::surface::calculateSurface(). The additional stages contain their latency per tile, per kind of edit and lod.
+ */
+scenarioResult runRemesh(pipeline& toRun, const real& halfExtent)
+{
+    typedef std::chrono::steady_clock t_clock;
+    typedef t_voxelSurface::t_lod::t_tile t_tile;
+    typedef t_voxelSurface::t_lod::t_tilePtr t_tilePtr;
+    typedef t_voxelAccessor::t_simple::t_tilePtr t_accessorTilePtr;
+    const int32 numEditsPerKind(50);
+    const real radius(3.);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<real> distribution(-1., 1.);
+    const real range(math::min<real>(halfExtent, t_config::voxelsPerTile*2.));
+    const uint32 numLod(toRun.surface.getLodList().size());
+
+    // per kind of edit and lod
+    vector<StageMonitor::stage> partial;
+    vector<StageMonitor::stage> full;
+    for (const string& kind : {string("voxel"), string("sphere")})
+    {
+        for (uint32 indLod = 0; indLod < numLod; ++indLod)
+        {
+            StageMonitor::stage toAdd;
+            toAdd.numDone = 0;
+            toAdd.name = "lod" + std::to_string(indLod) + (kind == "voxel" ? "Voxel" : "Sphere") + "Partial";
+            partial.push_back(toAdd);
+            toAdd.name = "lod" + std::to_string(indLod) + (kind == "voxel" ? "Voxel" : "Sphere") + "Full";
+            full.push_back(toAdd);
+        }
+    }
+
+    struct before
+    {
+        vector3int32 id;
+        t_accessorTilePtr accessorTile;
+        t_tilePtr surfaceTile;
+    };
+
+    scenario result(toRun, "remesh");
+    for (int32 indKind = 0; indKind < 2; ++indKind)
+    {
+        for (int32 indEdit = 0; indEdit < numEditsPerKind; ++indEdit)
+        {
+            const vector3 position(vector3(distribution(random)*range, distribution(random)*range, distribution(random)*range).getFloor());
+            toRun.container.lockForRead();
+            const bool cut(toRun.container.getVoxel(vector3int32(position)).getInterpolation() >= 0);
+            toRun.container.unlockRead();
+            voxel::edit::base<t_config>::pointer toEdit;
+            if (indKind == 0)
+            {
+                toEdit = t_editAxisAlignedBox::create(axisAlignedBox(position - vector3(0.1), position + vector3(0.1)));
+            }
+            else
+            {
+                toEdit = t_editSphere::create(sphere(position, radius));
+            }
+            toEdit->setCut(cut);
+
+            // two cells around the voxel get triangulated again
+            const axisAlignedBox aabb(toEdit->getAxisAlignedBoundingBox(transform()));
+            const vector3 reach(3.);
+            vector<vector<before> > tilesBefore(numLod);
+            for (uint32 indLod = 0; indLod < numLod; ++indLod)
+            {
+                t_voxelSurface::t_lod& surfaceLod(*toRun.surface.getLod(indLod));
+                const real tileSize(t_config::voxelsPerTile*surfaceLod.getVoxelSize());
+                const vector3 start(((aabb.getMinimum() - reach) / tileSize).getFloor());
+                const vector3 end(((aabb.getMaximum() + reach) / tileSize).getFloor());
+                surfaceLod.lockForRead();
+                for (int32 x = start.x; x <= end.x; ++x)
+                {
+                    for (int32 y = start.y; y <= end.y; ++y)
+                    {
+                        for (int32 z = start.z; z <= end.z; ++z)
+                        {
+                            before toAdd;
+                            toAdd.id = vector3int32(x, y, z);
+                            toAdd.accessorTile = toRun.accessor.getLod(indLod)->getTile(toAdd.id);
+                            const t_tilePtr found(surfaceLod.getTile(toAdd.id));
+                            if (toAdd.accessorTile.get() == nullptr || found.get() == nullptr)
+                            {
+                                continue;
+                            }
+                            toAdd.surfaceTile = t_tile::createCopy(found);
+                            tilesBefore[indLod].push_back(toAdd);
+                        }
+                    }
+                }
+                surfaceLod.unlockRead();
+            }
+
+            result.run([&]
+            {
+                toRun.container.editVoxel(toEdit);
+            });
+
+            for (uint32 indLod = 0; indLod < numLod; ++indLod)
+            {
+                t_voxelSurface::t_lod& surfaceLod(*toRun.surface.getLod(indLod));
+                StageMonitor::stage& partialLod(partial[indKind*numLod + indLod]);
+                StageMonitor::stage& fullLod(full[indKind*numLod + indLod]);
+                for (const before& work : tilesBefore[indLod])
+                {
+                    const t_accessorTilePtr accessorTile(toRun.accessor.getLod(indLod)->getTile(work.id));
+                    // unchanged tiles stay the same instance
+                    if (accessorTile.get() == nullptr || accessorTile == work.accessorTile || !accessorTile->getEditedVoxelBoundingBox().isValid())
+                    {
+                        continue;
+                    }
+                    const t_clock::time_point begin(t_clock::now());
+                    work.surfaceTile->recalculateSurface(accessorTile, accessorTile->getEditedVoxelBoundingBox(), surfaceLod.getVoxelSize(), surfaceLod.getNormalCalculation(), indLod);
+                    const t_clock::time_point between(t_clock::now());
+                    t_tilePtr fresh(t_tile::create());
+                    fresh->calculateSurface(accessorTile, surfaceLod.getVoxelSize(), surfaceLod.getNormalCalculation(), indLod);
+                    const t_clock::time_point end(t_clock::now());
+                    partialLod.latencies.push_back(std::chrono::duration<double, std::milli>(between - begin).count());
+                    fullLod.latencies.push_back(std::chrono::duration<double, std::milli>(end - between).count());
+                    ++partialLod.numDone;
+                    ++fullLod.numDone;
+                }
+            }
+        }
+    }
+
+    scenarioResult finished(result.finish());
+    for (std::size_t index = 0; index < partial.size(); ++index)
+    {
+        finished.stages.push_back(partial[index]);
+        finished.stages.push_back(full[index]);
+    }
+    return finished;
+}
+
+/**
+ * @brief countJobs sums simple::base::getNumJobs() and simple::base::getNumJobsCancelled() over all lods. Call while the pipeline is idle.
+ */
+template <typename lodListType>
+void countJobs(const lodListType& lods, uint64& jobsResult, uint64& cancelledResult)
+{
+    jobsResult = 0;
+    cancelledResult = 0;
+    for (const auto& lod : lods)
+    {
+        jobsResult += lod->getNumJobs();
+        cancelledResult += lod->getNumJobsCancelled();
+    }
+}
+
+/**
+ * @brief runSustained cuts 200 spheres of radius 6 along a line, one every 5 ms and then one every 1 ms, without waiting for the pipeline in between.
+ * Operations are the two series, the stages contain the latency from the first cut until the pipeline got idle.
+ * The values contain per series the cpu-seconds and the tile-jobs of the accessor and the surface, dispatched and skipped because their tile changed again.
+ * See simple::base::getNumJobsCancelled().
+ */
+scenarioResult runSustained(pipeline& toRun, const real& halfExtent)
+{
+    const int32 numCuts(200);
+    const real radius(6.);
+    const real length(halfExtent*0.8);
+
+    scenario result(toRun, "sustained");
+    vector<std::pair<string, double> > values;
+    for (const int32 intervalMs : {5, 1})
+    {
+        const string prefix("every" + std::to_string(intervalMs) + "ms");
+        uint64 accessorJobsBegin, accessorCancelledBegin, surfaceJobsBegin, surfaceCancelledBegin;
+        countJobs(toRun.accessor.getLodList(), accessorJobsBegin, accessorCancelledBegin);
+        countJobs(toRun.surface.getLodList(), surfaceJobsBegin, surfaceCancelledBegin);
+        const double cpuBegin(getProcessCpuSeconds());
+        result.run([&]
+        {
+            for (int32 cut = 0; cut < numCuts; ++cut)
+            {
+                const real along((real)cut / (real)numCuts);
+                // each series digs its own tunnel
+                const vector3 position(-length + along*2.*length, math::sin(along*30.)*5. - 5., math::cos(along*30.)*10. + (intervalMs == 5 ? -20. : 20.));
+                t_editSphere::pointer toEdit(t_editSphere::create(sphere(vector3(), radius)));
+                toEdit->setCut(true);
+                toRun.container.editVoxel(toEdit, transform(position));
+                std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            }
+        });
+        uint64 accessorJobs, accessorCancelled, surfaceJobs, surfaceCancelled;
+        countJobs(toRun.accessor.getLodList(), accessorJobs, accessorCancelled);
+        countJobs(toRun.surface.getLodList(), surfaceJobs, surfaceCancelled);
+        values.push_back(std::make_pair(prefix + "CpuSeconds", getProcessCpuSeconds() - cpuBegin));
+        values.push_back(std::make_pair(prefix + "AccessorJobs", (double)(accessorJobs - accessorJobsBegin)));
+        values.push_back(std::make_pair(prefix + "AccessorJobsCancelled", (double)(accessorCancelled - accessorCancelledBegin)));
+        values.push_back(std::make_pair(prefix + "SurfaceJobs", (double)(surfaceJobs - surfaceJobsBegin)));
+        values.push_back(std::make_pair(prefix + "SurfaceJobsCancelled", (double)(surfaceCancelled - surfaceCancelledBegin)));
+    }
+    scenarioResult finished(result.finish());
+    finished.values = values;
+    return finished;
+}
+
+/**
+ * @brief runConcurrent cuts 200 spheres of radius 6 along a line and moves the camera along, one cut every 5, 1 and 0.3 ms, without waiting for the pipeline in between.
+ * So edits, camera movement and the stages of the pipeline overlap. Operations are the three series, the stages contain the latency from the first cut until the pipeline got idle.
+ * The values contain per series the edits per second until idle, the cpu-seconds and the tile-jobs of the accessor and the surface.
+ */
+scenarioResult runConcurrent(pipeline& toRun, sharedPointer<sync::identifier> camera, const real& halfExtent)
+{
+    const int32 numCuts(200);
+    const real radius(6.);
+    const real length(halfExtent*0.8);
+
+    scenario result(toRun, "concurrent");
+    vector<std::pair<string, double> > values;
+    const std::pair<string, int32> series[] = {
+        std::make_pair(string("every5ms"), 5000),
+        std::make_pair(string("every1ms"), 1000),
+        std::make_pair(string("every300us"), 300)
+    };
+    for (int32 indSeries = 0; indSeries < 3; ++indSeries)
+    {
+        const string& prefix(series[indSeries].first);
+        // each series digs its own tunnel
+        const real offsetY(-halfExtent*0.5 + (real)indSeries*halfExtent*0.5);
+        uint64 accessorJobsBegin, accessorCancelledBegin, surfaceJobsBegin, surfaceCancelledBegin;
+        countJobs(toRun.accessor.getLodList(), accessorJobsBegin, accessorCancelledBegin);
+        countJobs(toRun.surface.getLodList(), surfaceJobsBegin, surfaceCancelledBegin);
+        const double cpuBegin(getProcessCpuSeconds());
+        const std::chrono::steady_clock::time_point begin(std::chrono::steady_clock::now());
+        result.run([&]
+        {
+            for (int32 cut = 0; cut < numCuts; ++cut)
+            {
+                const real along((real)cut / (real)numCuts);
+                const vector3 position(-length + along*2.*length, math::sin(along*30.)*5. + offsetY, math::cos(along*30.)*10.);
+                t_editSphere::pointer toEdit(t_editSphere::create(sphere(vector3(), radius)));
+                toEdit->setCut(true);
+                toRun.container.editVoxel(toEdit, transform(position));
+                toRun.renderer.updateCamera(camera, vector3(position.x, offsetY, 0.));
+                std::this_thread::sleep_for(std::chrono::microseconds(series[indSeries].second));
+            }
+        });
+        const double seconds(std::chrono::duration<double>(toRun.monitor.getStages().back().lastDone - begin).count());
+        uint64 accessorJobs, accessorCancelled, surfaceJobs, surfaceCancelled;
+        countJobs(toRun.accessor.getLodList(), accessorJobs, accessorCancelled);
+        countJobs(toRun.surface.getLodList(), surfaceJobs, surfaceCancelled);
+        values.push_back(std::make_pair(prefix + "EditsPerSecond", (double)numCuts / math::max<double>(seconds, 1e-9)));
+        values.push_back(std::make_pair(prefix + "CpuSeconds", getProcessCpuSeconds() - cpuBegin));
+        values.push_back(std::make_pair(prefix + "AccessorJobs", (double)(accessorJobs - accessorJobsBegin)));
+        values.push_back(std::make_pair(prefix + "SurfaceJobs", (double)(surfaceJobs - surfaceJobsBegin)));
+    }
+    toRun.renderer.updateCamera(camera, vector3());
+    toRun.monitor.waitForIdle();
+    scenarioResult finished(result.finish());
+    finished.values = values;
+    return finished;
+}
+
+/**
+ * @brief runRaycast casts batches of rays from random positions in random directions. Operations are rays,
+ * the stages contain the latency of a batch: container and surface raycasts, sphere-sweeps along the rays and closest-point queries at their origins.
+ * The sweeps and closest-point queries always use the bounding volume hierarchy, without --bvh it gets built for the tiles of the finest lod after the raycasts.
+ * Doesn't change the world, so the pipeline stays idle.
+ */
+scenarioResult runRaycast(pipeline& toRun, const real& halfExtent)
+{
+    typedef std::chrono::steady_clock t_clock;
+    const int32 numBatches(32);
+    const int32 raysPerBatch(1024);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<real> distribution(-1., 1.);
+
+    vector<vector<ray> > batches(numBatches);
+    for (vector<ray>& batch : batches)
+    {
+        batch.reserve(raysPerBatch);
+        for (int32 index = 0; index < raysPerBatch; ++index)
+        {
+            const vector3 origin(distribution(random)*halfExtent, distribution(random)*halfExtent, distribution(random)*halfExtent);
+            vector3 direction(distribution(random), distribution(random), distribution(random));
+            if (direction.length() < 1e-3)
+            {
+                direction = vector3(0., -1., 0.);
+            }
+            batch.push_back(ray(origin, direction.normalisedCopy()));
+        }
+    }
+    const real maxDistance(halfExtent*2.);
+    const real sweepRadius(1.);
+    const real closestMaxDistance(t_config::voxelsPerTile*0.5);
+
+    scenarioResult result;
+    result.name = "raycast";
+    result.numOperations = numBatches*raysPerBatch;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+    StageMonitor::stage container;
+    container.name = "container";
+    container.numDone = 0;
+    StageMonitor::stage surface;
+    surface.name = "surface";
+    surface.numDone = 0;
+    StageMonitor::stage sweep;
+    sweep.name = "sweep";
+    sweep.numDone = 0;
+    StageMonitor::stage closest;
+    closest.name = "closest";
+    closest.numDone = 0;
+
+    vector<voxel::raycastHit> hits;
+    toRun.container.lockForRead();
+    for (const vector<ray>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        toRun.container.raycast(batch, maxDistance, hits);
+        const t_clock::time_point end(t_clock::now());
+        container.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++container.numDone;
+    }
+    toRun.container.unlockRead();
+
+    t_voxelSurface::t_lod& surfaceLod(*toRun.surface.getLod(0));
+    surfaceLod.lockForRead();
+    for (const vector<ray>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        for (const ray& work : batch)
+        {
+            surfaceLod.raycast(work, maxDistance);
+        }
+        const t_clock::time_point end(t_clock::now());
+        surface.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++surface.numDone;
+    }
+    if (!surfaceLod.getCalculateBvh())
+    {
+        // testing all triangles takes minutes for the sweeps. The hierarchy leaves the geometry as it is, so it gets built into the tiles in place
+        // the tiles next to the extent get a surface too, by the voxel of their normal-correction
+        const int32 tileExtent((int32)std::ceil(halfExtent / (real)t_config::voxelsPerTile) + 1);
+        for (int32 x = -tileExtent; x < tileExtent; ++x)
+        {
+            for (int32 y = -tileExtent; y < tileExtent; ++y)
+            {
+                for (int32 z = -tileExtent; z < tileExtent; ++z)
+                {
+                    const t_voxelSurface::t_lod::t_tilePtr found(surfaceLod.getTile(vector3int32(x, y, z)));
+                    if (found.get() != nullptr)
+                    {
+                        found->calculateBvh();
+                    }
+                }
+            }
+        }
+    }
+    for (const vector<ray>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        for (const ray& work : batch)
+        {
+            surfaceLod.sweepSphere(work, sweepRadius, maxDistance);
+        }
+        const t_clock::time_point end(t_clock::now());
+        sweep.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++sweep.numDone;
+    }
+    for (const vector<ray>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        for (const ray& work : batch)
+        {
+            surfaceLod.calculateClosestPoint(work.getOrigin(), closestMaxDistance);
+        }
+        const t_clock::time_point end(t_clock::now());
+        closest.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++closest.numDone;
+    }
+    surfaceLod.unlockRead();
+
+    result.stages.push_back(container);
+    result.stages.push_back(surface);
+    result.stages.push_back(sweep);
+    result.stages.push_back(closest);
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief sampleDensityNaive interpolates like simple::container::base::sampleDensity(), but reads each of the 32 voxel needed by getVoxel().
+ */
+voxel::densitySample sampleDensityNaive(const t_voxelContainer& container, const vector3& position)
+{
+    const vector3int32 cell((int32)std::floor(position.x), (int32)std::floor(position.y), (int32)std::floor(position.z));
+    const vector3 inCell(position - vector3(cell));
+    auto getDensity = [&] (const int32& x, const int32& y, const int32& z)
+    {
+        return (real)container.getVoxel(cell + vector3int32(x, y, z)).getInterpolation();
+    };
+    voxel::densitySample result;
+    for (int32 x = 0; x < 2; ++x)
+    {
+        for (int32 y = 0; y < 2; ++y)
+        {
+            for (int32 z = 0; z < 2; ++z)
+            {
+                const real weight((x == 0 ? 1. - inCell.x : inCell.x)*(y == 0 ? 1. - inCell.y : inCell.y)*(z == 0 ? 1. - inCell.z : inCell.z));
+                result.density += weight*getDensity(x, y, z);
+                result.gradient += weight*vector3(getDensity(x + 1, y, z) - getDensity(x - 1, y, z),
+                                                  getDensity(x, y + 1, z) - getDensity(x, y - 1, z),
+                                                  getDensity(x, y, z + 1) - getDensity(x, y, z - 1))*0.5;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief runSample interpolates density and gradient at batches of random positions. Operations are positions,
+ * the stages contain the latency of a batch of 16384: batched by simple::container::base::sampleDensity() and naive by sampleDensityNaive().
+ * Doesn't change the world, so the pipeline stays idle.
+ */
+scenarioResult runSample(pipeline& toRun, const real& halfExtent)
+{
+    typedef std::chrono::steady_clock t_clock;
+    const int32 numBatches(32);
+    const int32 positionsPerBatch(16384);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<real> distribution(-1., 1.);
+
+    vector<vector<vector3> > batches(numBatches);
+    for (vector<vector3>& batch : batches)
+    {
+        batch.reserve(positionsPerBatch);
+        for (int32 index = 0; index < positionsPerBatch; ++index)
+        {
+            batch.push_back(vector3(distribution(random), distribution(random), distribution(random))*halfExtent);
+        }
+    }
+
+    scenarioResult result;
+    result.name = "sample";
+    result.numOperations = numBatches*positionsPerBatch;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+    StageMonitor::stage batched;
+    batched.name = "batched";
+    batched.numDone = 0;
+    StageMonitor::stage naive;
+    naive.name = "naive";
+    naive.numDone = 0;
+
+    vector<voxel::densitySample> samples;
+    toRun.container.lockForRead();
+    for (const vector<vector3>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        toRun.container.sampleDensity(batch, samples);
+        const t_clock::time_point end(t_clock::now());
+        batched.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++batched.numDone;
+    }
+    for (const vector<vector3>& batch : batches)
+    {
+        const t_clock::time_point begin(t_clock::now());
+        for (std::size_t index = 0; index < batch.size(); ++index)
+        {
+            samples[index] = sampleDensityNaive(toRun.container, batch[index]);
+        }
+        const t_clock::time_point end(t_clock::now());
+        naive.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        result.seconds += std::chrono::duration<double>(end - begin).count();
+        ++naive.numDone;
+    }
+    toRun.container.unlockRead();
+
+    result.stages.push_back(batched);
+    result.stages.push_back(naive);
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runVertexCache reorders compacted copies of the surface-tiles of the finest lod, so the world stays untouched. Operations are tiles,
+ * the stages contain the latency per tile of tile::surface::optimizeVertexCache() and of tile::surface::calculateMeshlets().
+ * The values contain the average cache miss ratio of a simulated first in first out cache with 16 and 32 entries, before and after, and the meshlet-sizes.
+ */
+scenarioResult runVertexCache(pipeline& toRun, const real& halfExtent)
+{
+    typedef std::chrono::steady_clock t_clock;
+    typedef t_voxelSurface::t_lod::t_tile t_tile;
+
+    scenarioResult result;
+    result.name = "vertexcache";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+    StageMonitor::stage optimize;
+    optimize.name = "optimize";
+    optimize.numDone = 0;
+    StageMonitor::stage meshlets;
+    meshlets.name = "meshlets";
+    meshlets.numDone = 0;
+
+    voxel::vertexCache simulation;
+    double missesBefore[2] = {0., 0.};
+    double missesAfter[2] = {0., 0.};
+    const uint32 cacheSizes[2] = {16, 32};
+    uint64 numMeshlets(0);
+    uint64 numMeshletVertices(0);
+
+    t_voxelSurface::t_lod& surfaceLod(*toRun.surface.getLod(0));
+    surfaceLod.lockForRead();
+    const int32 tileExtent((int32)std::ceil(halfExtent / (real)t_config::voxelsPerTile));
+    for (int32 x = -tileExtent; x < tileExtent; ++x)
+    {
+        for (int32 y = -tileExtent; y < tileExtent; ++y)
+        {
+            for (int32 z = -tileExtent; z < tileExtent; ++z)
+            {
+                const t_voxelSurface::t_lod::t_tilePtr found(surfaceLod.getTile(vector3int32(x, y, z)));
+                if (found.get() == nullptr || found->getIndices().size() < 3)
+                {
+                    continue;
+                }
+                // without the degenerated triangles of unused slab-parts, so before and after contain the same triangles
+                t_voxelSurface::t_lod::t_tilePtr work(t_tile::createCopy(found));
+                work->compact();
+                const uint32 numIndices(work->getIndices().size());
+                for (int32 ind = 0; ind < 2; ++ind)
+                {
+                    missesBefore[ind] += simulation.calculateAcmr(work->getIndices(), cacheSizes[ind])*(double)(numIndices / 3);
+                }
+
+                const t_clock::time_point begin(t_clock::now());
+                work->optimizeVertexCache();
+                const t_clock::time_point between(t_clock::now());
+                work->calculateMeshlets();
+                const t_clock::time_point end(t_clock::now());
+                optimize.latencies.push_back(std::chrono::duration<double, std::milli>(between - begin).count());
+                meshlets.latencies.push_back(std::chrono::duration<double, std::milli>(end - between).count());
+                result.seconds += std::chrono::duration<double>(end - begin).count();
+                ++optimize.numDone;
+                ++meshlets.numDone;
+
+                for (int32 ind = 0; ind < 2; ++ind)
+                {
+                    missesAfter[ind] += simulation.calculateAcmr(work->getIndices(), cacheSizes[ind])*(double)(numIndices / 3);
+                }
+                numMeshlets += work->getMeshlets().getMeshlets().size();
+                numMeshletVertices += work->getMeshlets().getVertices().size();
+                ++result.numOperations;
+                ++result.numTiles;
+                result.numTriangles += numIndices / 3;
+            }
+        }
+    }
+    surfaceLod.unlockRead();
+
+    const double numTriangles(math::max<double>((double)result.numTriangles, 1.));
+    result.values.push_back(std::make_pair(string("acmrFifo16Before"), missesBefore[0] / numTriangles));
+    result.values.push_back(std::make_pair(string("acmrFifo16After"), missesAfter[0] / numTriangles));
+    result.values.push_back(std::make_pair(string("acmrFifo32Before"), missesBefore[1] / numTriangles));
+    result.values.push_back(std::make_pair(string("acmrFifo32After"), missesAfter[1] / numTriangles));
+    result.values.push_back(std::make_pair(string("meshlets"), (double)numMeshlets));
+    result.values.push_back(std::make_pair(string("trianglesPerMeshlet"), (double)result.numTriangles / math::max<double>((double)numMeshlets, 1.)));
+    result.values.push_back(std::make_pair(string("verticesPerMeshlet"), (double)numMeshletVertices / math::max<double>((double)numMeshlets, 1.)));
+    result.stages.push_back(optimize);
+    result.stages.push_back(meshlets);
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runDecimate simplifies copies of the surface-tiles of all lods, so the world stays untouched. Operations are tiles,
+ * the stages contain per lod the latency per tile of tile::surface::decimate().
+ * The values contain per lod the triangles before and after and the reduction in percent.
+ * @param maxError In voxel of each lod.
+ */
+scenarioResult runDecimate(pipeline& toRun, const real& halfExtent, const real& maxError)
+{
+    typedef std::chrono::steady_clock t_clock;
+    typedef t_voxelSurface::t_lod::t_tile t_tile;
+
+    scenarioResult result;
+    result.name = "decimate";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    for (uint32 indLod = 0; indLod < toRun.surface.getLodList().size(); ++indLod)
+    {
+        t_voxelSurface::t_lod& surfaceLod(*toRun.surface.getLod(indLod));
+        StageMonitor::stage decimate;
+        decimate.name = "lod" + std::to_string(indLod);
+        decimate.numDone = 0;
+        uint64 numTrianglesBefore(0);
+        uint64 numTrianglesAfter(0);
+
+        surfaceLod.lockForRead();
+        const real tileSize(t_config::voxelsPerTile*surfaceLod.getVoxelSize());
+        const int32 tileExtent((int32)std::ceil(halfExtent / tileSize));
+        for (int32 x = -tileExtent; x < tileExtent; ++x)
+        {
+            for (int32 y = -tileExtent; y < tileExtent; ++y)
+            {
+                for (int32 z = -tileExtent; z < tileExtent; ++z)
+                {
+                    const t_voxelSurface::t_lod::t_tilePtr found(surfaceLod.getTile(vector3int32(x, y, z)));
+                    if (found.get() == nullptr || found->getIndices().size() < 3)
+                    {
+                        continue;
+                    }
+                    // without the degenerated triangles of unused slab-parts, so before and after count the same way
+                    t_voxelSurface::t_lod::t_tilePtr work(t_tile::createCopy(found));
+                    work->compact();
+                    numTrianglesBefore += work->getIndices().size() / 3;
+
+                    const t_clock::time_point begin(t_clock::now());
+                    work->decimate(maxError*surfaceLod.getVoxelSize());
+                    const t_clock::time_point end(t_clock::now());
+                    decimate.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+                    result.seconds += std::chrono::duration<double>(end - begin).count();
+                    ++decimate.numDone;
+
+                    numTrianglesAfter += work->getIndices().size() / 3;
+                    ++result.numOperations;
+                    ++result.numTiles;
+                    result.numTriangles += work->getIndices().size() / 3;
+                }
+            }
+        }
+        surfaceLod.unlockRead();
+
+        const string prefix("lod" + std::to_string(indLod));
+        result.values.push_back(std::make_pair(prefix + "TrianglesBefore", (double)numTrianglesBefore));
+        result.values.push_back(std::make_pair(prefix + "TrianglesAfter", (double)numTrianglesAfter));
+        result.values.push_back(std::make_pair(prefix + "Reduction", 100.*(1. - (double)numTrianglesAfter / math::max<double>((double)numTrianglesBefore, 1.))));
+        result.stages.push_back(decimate);
+    }
+    result.values.push_back(std::make_pair(string("maxErrorVoxel"), (double)maxError));
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runNormals calculates new surface-tiles from the accessor-tiles of all lods, once per tile::surface::normalCalculation, so the world stays untouched.
+ * Operations are tiles, the stages contain per lod and mode the latency per tile of tile::surface::calculateSurface().
+ * The values contain per lod and mode the average vertices and KiB of vertices and indices per tile, and the KiB of voxel per accessor-tile, which is the same in all modes.
+ */
+scenarioResult runNormals(pipeline& toRun, const real& halfExtent)
+{
+    typedef std::chrono::steady_clock t_clock;
+    typedef t_voxelSurface::t_lod::t_tile t_tile;
+    typedef t_tile::normalCalculation t_normalCalculation;
+    typedef t_voxelAccessor::t_simple::t_tile t_accessorTile;
+    const std::pair<string, t_normalCalculation> modes[] = {
+        std::make_pair(string("Face"), t_normalCalculation::face),
+        std::make_pair(string("FaceWithCorrection"), t_normalCalculation::faceWithCorrection),
+        std::make_pair(string("Gradient"), t_normalCalculation::gradient)
+    };
+
+    scenarioResult result;
+    result.name = "normals";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    for (uint32 indLod = 0; indLod < toRun.accessor.getLodList().size(); ++indLod)
+    {
+        t_voxelAccessor::t_simple& accessorLod(*toRun.accessor.getLod(indLod));
+        const real voxelSize(toRun.surface.getLod(indLod)->getVoxelSize());
+        vector<t_voxelAccessor::t_simple::t_tilePtr> accessorTiles;
+        const int32 tileExtent((int32)std::ceil(halfExtent / (t_voxelAccessor::t_simple::t_tile::voxelLength*(1 << indLod))));
+        for (int32 x = -tileExtent; x < tileExtent; ++x)
+        {
+            for (int32 y = -tileExtent; y < tileExtent; ++y)
+            {
+                for (int32 z = -tileExtent; z < tileExtent; ++z)
+                {
+                    const t_voxelAccessor::t_simple::t_tilePtr found(accessorLod.getTile(vector3int32(x, y, z)));
+                    if (found.get() != nullptr)
+                    {
+                        accessorTiles.push_back(found);
+                    }
+                }
+            }
+        }
+
+        const string prefix("lod" + std::to_string(indLod));
+        for (const std::pair<string, t_normalCalculation>& mode : modes)
+        {
+            StageMonitor::stage calculate;
+            calculate.name = prefix + mode.first;
+            calculate.numDone = 0;
+            uint64 numVertices(0);
+            uint64 numBytes(0);
+            for (const t_voxelAccessor::t_simple::t_tilePtr& work : accessorTiles)
+            {
+                t_voxelSurface::t_lod::t_tilePtr calculated(t_tile::create());
+                const t_clock::time_point begin(t_clock::now());
+                calculated->calculateSurface(work, voxelSize, mode.second, indLod);
+                const t_clock::time_point end(t_clock::now());
+                calculate.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+                result.seconds += std::chrono::duration<double>(end - begin).count();
+                ++calculate.numDone;
+
+                numVertices += calculated->getVertices().size();
+                numBytes += calculated->getVertices().size()*sizeof(t_tile::t_vertices::value_type) +
+                            calculated->getIndices().size()*calculated->getIndices().getBytesPerIndex();
+                ++result.numOperations;
+                ++result.numTiles;
+                result.numTriangles += calculated->getIndices().size() / 3;
+            }
+            const double numTiles(math::max<double>((double)accessorTiles.size(), 1.));
+            result.values.push_back(std::make_pair(prefix + mode.first + "Vertices", (double)numVertices / numTiles));
+            result.values.push_back(std::make_pair(prefix + mode.first + "KiB", (double)numBytes / numTiles / 1024.));
+            result.stages.push_back(calculate);
+        }
+    }
+    result.values.push_back(std::make_pair(string("accessorVoxelKiB"), (double)(t_accessorTile::voxelCount*sizeof(t_accessorTile::t_voxel)) / 1024.));
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+
+/**
+ * @brief The perVoxel class calculates an edit the way edit::base did before calculateVoxelRow():
+ * tests every voxel of the tile against the bounding box and calls calculateOneVoxel() for each one inside.
+ * Only for edits whose calculateOneVoxel() doesn't call calculateVoxelRow() itself.
+ */
+template <typename editType>
+class perVoxel : public editType
+{
+public:
+    typedef sharedPointer<perVoxel> pointer;
+    typedef typename editType::t_voxelContainerTile t_voxelContainerTile;
+    typedef typename editType::t_voxel t_voxel;
+
+    template <typename ... argumentTypes>
+    static pointer create(const argumentTypes& ... arguments)
+    {
+        return pointer(new perVoxel(arguments...));
+    }
+
+    void calculateVoxel(t_voxelContainerTile* voxelContainer,
+                        const vector3int32& voxelContainerOffset,
+                        const transform &trans) const override
+    {
+        const blub::axisAlignedBox aabb(this->getAxisAlignedBoundingBox(trans));
+        const vector3int32 posContainerAbsolut(voxelContainerOffset*t_config::voxelsPerTile);
+        for (int32 indX = 0; indX < t_config::voxelsPerTile; ++indX)
+        {
+            for (int32 indY = 0; indY < t_config::voxelsPerTile; ++indY)
+            {
+                for (int32 indZ = 0; indZ < t_config::voxelsPerTile; ++indZ)
+                {
+                    const vector3int32 posVoxel(indX, indY, indZ);
+                    vector3 posAbsolut(posContainerAbsolut + posVoxel);
+                    if (!aabb.contains(posAbsolut))
+                    {
+                        continue;
+                    }
+                    posAbsolut -= trans.position;
+                    posAbsolut /= trans.scale;
+
+                    t_voxel voxelResult;
+                    if (this->calculateOneVoxel(posAbsolut, &voxelResult))
+                    {
+                        voxelContainer->setVoxelIfInterpolationHigher(posVoxel, voxelResult);
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    template <typename ... argumentTypes>
+    perVoxel(const argumentTypes& ... arguments)
+        : editType(arguments...)
+    {
+    }
+};
+
+
+/**
+ * @brief calculateEditTiles calculates toCalculate into one reused tile for each of the 4^3 tiles around the origin, three times.
+ * @param name Name of the returned stage, it contains the latency per tile.
+ * @param hashResult Gets set to a hash over all calculated voxel, for comparing the results of different paths.
+ * @param secondsResult Gets increased by the calculation time.
+ */
+template <typename editPointerType>
+StageMonitor::stage calculateEditTiles(const string& name, const editPointerType& toCalculate, const transform& trans, uint64& hashResult, double& secondsResult)
+{
+    typedef std::chrono::steady_clock t_clock;
+    typedef t_config::t_container::t_tile t_tile;
+    const int32 numRepeats(3);
+    const int32 range(2);
+
+    StageMonitor::stage result;
+    result.name = name;
+    result.numDone = 0;
+    hashResult = 0;
+
+    t_tile::pointer work(t_tile::create());
+    for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        for (int32 x = -range; x < range; ++x)
+        {
+            for (int32 y = -range; y < range; ++y)
+            {
+                for (int32 z = -range; z < range; ++z)
+                {
+                    work->startEdit();
+                    work->setEmpty();
+                    const t_clock::time_point begin(t_clock::now());
+                    toCalculate->calculateVoxel(work.get(), vector3int32(x, y, z), trans);
+                    const t_clock::time_point end(t_clock::now());
+                    work->endEdit();
+                    result.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+                    secondsResult += std::chrono::duration<double>(end - begin).count();
+                    ++result.numDone;
+
+                    if (repeat == 0)
+                    {
+                        for (int32 index = 0; index < t_tile::voxelCount; ++index)
+                        {
+                            hashResult = hashResult*31 + (uint64)(int64)work->getVoxel(index).getInterpolation();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief runEditRow calculates edits into single tiles on the calling thread, without a container. Operations are tiles,
+ * the stages contain the latency per tile row by row by calculateVoxelRow() and voxel by voxel by perVoxel, the path before calculateVoxelRow().
+ * The values contain per edit the speedup of the total time and if both paths calculated the same voxel.
+ * axisAlignedBox and noise only run row by row: axisAlignedBox can't be derived and the calculateOneVoxel() of noise calculates a row of one.
+ */
+scenarioResult runEditRow()
+{
+    scenarioResult result;
+    result.name = "editrow";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    auto compare = [&] (const string& name, const StageMonitor::stage& row, const uint64& hashRow, const StageMonitor::stage& voxel, const uint64& hashVoxel)
+    {
+        const double msRow(std::accumulate(row.latencies.cbegin(), row.latencies.cend(), 0.));
+        const double msVoxel(std::accumulate(voxel.latencies.cbegin(), voxel.latencies.cend(), 0.));
+        result.values.push_back(std::make_pair(name + "Speedup", msVoxel / math::max<double>(msRow, 1e-9)));
+        result.values.push_back(std::make_pair(name + "Identical", hashRow == hashVoxel ? 1. : 0.));
+        result.stages.push_back(row);
+        result.stages.push_back(voxel);
+    };
+    uint64 hashRow(0);
+    uint64 hashVoxel(0);
+    double seconds(0.);
+    {
+        const sphere desc(vector3(), 30.);
+        const StageMonitor::stage row(calculateEditTiles("sphereRow", t_editSphere::create(desc), transform(), hashRow, seconds));
+        const StageMonitor::stage voxel(calculateEditTiles("sphereVoxel", perVoxel<t_editSphere>::create(desc), transform(), hashVoxel, seconds));
+        compare("sphere", row, hashRow, voxel, hashVoxel);
+    }
+    {
+        const sphere desc(vector3(), 2.);
+        const transform trans(vector3(3., 1., -2.), quaternion(), vector3(12.));
+        const StageMonitor::stage row(calculateEditTiles("sphereScaledRow", t_editSphere::create(desc), trans, hashRow, seconds));
+        const StageMonitor::stage voxel(calculateEditTiles("sphereScaledVoxel", perVoxel<t_editSphere>::create(desc), trans, hashVoxel, seconds));
+        compare("sphereScaled", row, hashRow, voxel, hashVoxel);
+    }
+    result.stages.push_back(calculateEditTiles("axisAlignedBoxRow", t_editAxisAlignedBox::create(axisAlignedBox(vector3(-25.), vector3(27.))), transform(vector3(0.5)), hashRow, seconds));
+    result.stages.push_back(calculateEditTiles("noiseRow", t_editNoise::create(axisAlignedBox(vector3(-100.), vector3(100.)), vector3(0.025)), transform(), hashRow, seconds));
+
+    for (const StageMonitor::stage& work : result.stages)
+    {
+        result.numOperations += work.numDone;
+    }
+    result.seconds = seconds;
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+
+/**
+ * @brief runNoise calculates noise-edits with the parameters of the noise example into single tiles on the calling thread, without a container.
+ * Operations are tiles, the stages contain the latency per tile of one octave, four octaves, four ridged octaves and four octaves with domain warp.
+ * The values contain the million voxel per second of each.
+ */
+scenarioResult runNoise()
+{
+    typedef t_editNoise::fractal t_fractal;
+
+    scenarioResult result;
+    result.name = "noise";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    const axisAlignedBox extent(vector3(-100.), vector3(100.));
+    const vector3 scale(0.025);
+    const std::pair<string, t_fractal> toCalculate[] = {
+        std::make_pair(string("octave1"), t_fractal()),
+        std::make_pair(string("octave4"), t_fractal(4)),
+        std::make_pair(string("octave4Ridged"), t_fractal(4, 2., 0.5, true)),
+        std::make_pair(string("octave4Warp"), t_fractal(4, 2., 0.5, false, 0.5))
+    };
+    const double voxelsPerTile(t_config::voxelsPerTile*t_config::voxelsPerTile*t_config::voxelsPerTile);
+    for (const std::pair<string, t_fractal>& work : toCalculate)
+    {
+        uint64 hash(0);
+        double seconds(0.);
+        const t_editNoise::pointer edit(t_editNoise::create(extent, scale, 0, t_editNoise::t_callbackInterpolation(), work.second));
+        const StageMonitor::stage calculated(calculateEditTiles(work.first, edit, transform(), hash, seconds));
+        result.values.push_back(std::make_pair(work.first + "MegaVoxelPerSecond", (double)calculated.numDone*voxelsPerTile / math::max<double>(seconds, 1e-9) / 1e6));
+        result.stages.push_back(calculated);
+        result.numOperations += calculated.numDone;
+        result.seconds += seconds;
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+
+/**
+ * @brief createSphereMesh triangulates a sphere by segments rings and segments slices. Slightly off the origin, so no ray hits a vertex exactly.
+ */
+t_editMesh::t_triangles createSphereMesh(const int32& segments, const real& radius)
+{
+    auto position = [&] (const int32& ring, const int32& slice)
+    {
+        const real theta(math::pi*(real)ring / (real)segments);
+        const real phi(2.*math::pi*(real)slice / (real)segments);
+        return vector3(radius*std::sin(theta)*std::cos(phi) + 0.3, radius*std::cos(theta) + 0.2, radius*std::sin(theta)*std::sin(phi) + 0.1);
+    };
+    t_editMesh::t_triangles result;
+    for (int32 ring = 0; ring < segments; ++ring)
+    {
+        for (int32 slice = 0; slice < segments; ++slice)
+        {
+            if (ring > 0)
+            {
+                result.push_back(triangleVector3(position(ring, slice), position(ring + 1, slice), position(ring, slice + 1)));
+            }
+            if (ring < segments - 1)
+            {
+                result.push_back(triangleVector3(position(ring + 1, slice), position(ring + 1, slice + 1), position(ring, slice + 1)));
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief runMesh voxelises a sphere-mesh of 99904 triangles and radius 30 into single tiles on the calling thread, without a container.
+ * Operations are tiles, the stage contains the latency per tile.
+ * The values contain the number of triangles and of filled voxel, compared to the volume of the ideal sphere.
+ */
+scenarioResult runMesh()
+{
+    typedef t_config::t_container::t_tile t_tile;
+    const real radius(30.);
+
+    scenarioResult result;
+    result.name = "mesh";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    const t_editMesh::t_triangles triangles(createSphereMesh(224, radius));
+    const t_editMesh::pointer created(t_editMesh::create());
+    created->addTriangles(triangles);
+    // mesh overrides calculateVoxel() protected
+    const voxel::edit::base<t_config>::pointer edit(created);
+
+    uint64 hash(0);
+    const StageMonitor::stage calculated(calculateEditTiles("voxelise", edit, transform(), hash, result.seconds));
+    result.stages.push_back(calculated);
+    result.numOperations = calculated.numDone;
+
+    uint64 numFilled(0);
+    t_tile::pointer work(t_tile::create());
+    const int32 range(2);
+    for (int32 x = -range; x < range; ++x)
+    {
+        for (int32 y = -range; y < range; ++y)
+        {
+            for (int32 z = -range; z < range; ++z)
+            {
+                work->startEdit();
+                work->setEmpty();
+                edit->calculateVoxel(work.get(), vector3int32(x, y, z), transform());
+                work->endEdit();
+                for (int32 index = 0; index < t_tile::voxelCount; ++index)
+                {
+                    numFilled += work->getVoxel(index).isMin() ? 0 : 1;
+                }
+            }
+        }
+    }
+    result.values.push_back(std::make_pair(string("triangles"), (double)triangles.size()));
+    result.values.push_back(std::make_pair(string("filledVoxel"), (double)numFilled));
+    result.values.push_back(std::make_pair(string("idealSphereVoxel"), 4./3.*math::pi*radius*radius*radius));
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+
+/**
+ * @brief createPrimitives creates 1000 spheres and axisAlignedBoxes with a radius of 2 to 5 in a region of 160^3 voxel, every fifth one subtracts.
+ * Creates new edits on every call, so editVoxel() can set their cut.
+ */
+t_editComposite::t_primitives createPrimitives()
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<real> distribution(-1., 1.);
+
+    t_editComposite::t_primitives result;
+    for (int32 index = 0; index < 1000; ++index)
+    {
+        const vector3 position(distribution(random)*80., distribution(random)*80., distribution(random)*80.);
+        const real radius(3.5 + distribution(random)*1.5);
+        const t_editComposite::operation op(index % 5 == 4 ? t_editComposite::operation::subtract : t_editComposite::operation::unite);
+        if (index % 2 == 0)
+        {
+            result.push_back(t_editComposite::primitive(t_editSphere::create(sphere(vector3(), radius)), transform(position), op));
+        }
+        else
+        {
+            result.push_back(t_editComposite::primitive(t_editAxisAlignedBox::create(axisAlignedBox(vector3(-radius), vector3(radius))), transform(position), op));
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief runComposite applies the primitives of createPrimitives() to new, empty containers without accessor, once by one editVoxel() per primitive
+ * and once by one composite. Operations are the runs, the stages contain the latency of each run.
+ * The values contain the number of tiles visited by each and if both resulted in the same voxel.
+ */
+scenarioResult runComposite(async::dispatcher& worker)
+{
+    const int32 numRepeats(5);
+
+    scenarioResult result;
+    result.name = "composite";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+    StageMonitor::stage single;
+    single.name = "single";
+    single.numDone = 0;
+    StageMonitor::stage combined;
+    combined.name = "composite";
+    combined.numDone = 0;
+
+    const int32 hashExtent(100);
+    auto calculateHash = [&] (t_voxelContainer& toHash)
+    {
+        uint64 hash(0);
+        toHash.lockForRead();
+        for (int32 x = -hashExtent; x < hashExtent; ++x)
+        {
+            for (int32 y = -hashExtent; y < hashExtent; y += 3)
+            {
+                for (int32 z = -hashExtent; z < hashExtent; ++z)
+                {
+                    hash = hash*31 + (uint64)(int64)toHash.getVoxel(vector3int32(x, y, z)).getInterpolation();
+                }
+            }
+        }
+        toHash.unlockRead();
+        return hash;
+    };
+
+    uint64 hashSingle(0);
+    uint64 hashComposite(0);
+    for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        for (int32 mode = 0; mode < 2; ++mode)
+        {
+            const t_editComposite::t_primitives primitives(createPrimitives());
+            t_voxelContainer container(worker);
+            StageMonitor monitor;
+            monitor.addStage("container", vector<t_voxelContainer*>(1, &container));
+            monitor.begin();
+            if (mode == 0)
+            {
+                for (const t_editComposite::primitive& work : primitives)
+                {
+                    work.edit->setCut(work.op == t_editComposite::operation::subtract);
+                    container.editVoxel(work.edit, work.trans);
+                }
+            }
+            else
+            {
+                container.editVoxel(t_editComposite::create(primitives));
+            }
+            const double seconds(monitor.waitForIdle());
+            (mode == 0 ? single : combined).latencies.push_back(seconds*1000.);
+            ++(mode == 0 ? single : combined).numDone;
+            result.seconds += seconds;
+            ++result.numOperations;
+            if (repeat == 0)
+            {
+                (mode == 0 ? hashSingle : hashComposite) = calculateHash(container);
+            }
+        }
+    }
+
+    uint64 numTilesSingle(0);
+    // vector3int32::operator<() compares all components, no strict weak ordering
+    std::set<std::tuple<int32, int32, int32> > tilesComposite;
+    for (const t_editComposite::primitive& work : createPrimitives())
+    {
+        const axisAlignedBox aabb(work.edit->getAxisAlignedBoundingBox(work.trans));
+        const vector3int32 start(t_voxelContainer::calculateVoxelPosToTileId(vector3int32(aabb.getMinimum())));
+        const vector3int32 end(t_voxelContainer::calculateVoxelPosToTileId(vector3int32(aabb.getMaximum())));
+        for (int32 x = start.x; x <= end.x; ++x)
+        {
+            for (int32 y = start.y; y <= end.y; ++y)
+            {
+                for (int32 z = start.z; z <= end.z; ++z)
+                {
+                    ++numTilesSingle;
+                    tilesComposite.insert(std::make_tuple(x, y, z));
+                }
+            }
+        }
+    }
+    result.values.push_back(std::make_pair(string("tileVisitsSingle"), (double)numTilesSingle));
+    result.values.push_back(std::make_pair(string("tileVisitsComposite"), (double)tilesComposite.size()));
+    result.values.push_back(std::make_pair(string("identical"), hashSingle == hashComposite ? 1. : 0.));
+    result.stages.push_back(single);
+    result.stages.push_back(combined);
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+
+/**
+ * @brief The rebuildAccessor class gathers all its tiles again on the calling thread, for measuring the gather without the dispatching around it.
+ */
+class rebuildAccessor : public t_voxelAccessor::t_simple
+{
+public:
+    typedef t_voxelAccessor::t_simple t_base;
+
+    rebuildAccessor(async::dispatcher &worker, t_simpleContainerVoxel &voxels, const int32& lod)
+        : t_base(worker, voxels, lod)
+    {
+    }
+    rebuildAccessor(async::dispatcher &worker, t_simpleContainerVoxel &voxels, t_simpleContainerVoxel &voxelsLod, const int32& lod)
+        : t_base(worker, voxels, voxelsLod, lod)
+    {
+    }
+
+    /**
+     * @brief rebuild gathers the voxel and the lod-voxel of all sides of every tile into a new tile, numRepeats times. Call while the pipeline is idle.
+     * @param name Name of the returned stage, it contains the latency per tile.
+     * @param hashResult Gets set to a hash over all gathered voxel, independent of the order of the tiles.
+     * @param secondsResult Gets increased by the gather time.
+     */
+    StageMonitor::stage rebuild(const string& name, const int32& numRepeats, uint64& hashResult, double& secondsResult)
+    {
+        typedef std::chrono::steady_clock t_clock;
+
+        StageMonitor::stage result;
+        result.name = name;
+        result.numDone = 0;
+        hashResult = 0;
+
+        const axisAlignedBoxInt32 toGather(vector3int32(-1), vector3int32(t_tile::voxelLength+1));
+        t_tileHolderCache lastUsedTilesLod;
+        lockVoxelsForRead();
+        for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            for (const auto& work : m_tiles)
+            {
+                const t_clock::time_point begin(t_clock::now());
+                t_tilePtr workTile(createTile());
+                workTile->setCalculateLod(true);
+                gatherVoxel(work.first, workTile, toGather);
+                calculateAccessorLod(work.first, workTile, toGather, lastUsedTilesLod);
+                const t_clock::time_point end(t_clock::now());
+                result.latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+                secondsResult += std::chrono::duration<double>(end - begin).count();
+                ++result.numDone;
+
+                if (repeat == 0)
+                {
+                    uint64 hash(((uint64)(uint32)work.first.x*73856093) ^ ((uint64)(uint32)work.first.y*19349663) ^ ((uint64)(uint32)work.first.z*83492791));
+                    for (const t_voxel& voxel : workTile->getVoxelArray())
+                    {
+                        hash = hash*31 + (uint64)(int64)voxel.getInterpolation();
+                    }
+                    for (int32 lod = 0; lod < 6; ++lod)
+                    {
+                        for (const t_voxel& voxel : *workTile->getVoxelArrayLod(lod))
+                        {
+                            hash = hash*31 + (uint64)(int64)voxel.getInterpolation();
+                        }
+                    }
+                    hashResult += hash;
+                }
+            }
+        }
+        unlockVoxelsRead();
+        return result;
+    }
+};
+
+
+/**
+ * @brief runPyramid generates the world of generate again into a new container, with accessors of lod 2 and 3 that sample it with stride 4 and 8
+ * and accessors of lod 2 and 3 that read a simple::container::downsampled pyramid with the point filter.
+ * Operations are tiles, the stages contain the latency of the generation until each got done and per accessor the latency per tile of rebuild().
+ * The values contain the number of tiles per lod and if both accessors of a lod gathered the same voxel.
+ */
+scenarioResult runPyramid(async::dispatcher& worker, const real& halfExtent)
+{
+    typedef t_voxelAccessor::t_downsampled t_downsampled;
+    const int32 numRepeats(3);
+
+    scenarioResult result;
+    result.name = "pyramid";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    t_voxelContainer container(worker);
+    t_downsampled level1(worker, container);
+    t_downsampled level2(worker, level1);
+    t_downsampled level3(worker, level2);
+    rebuildAccessor strided2(worker, container, 2);
+    rebuildAccessor strided3(worker, container, 3);
+    rebuildAccessor pyramid2(worker, level2, level1, 2);
+    rebuildAccessor pyramid3(worker, level3, level2, 3);
+
+    StageMonitor monitor;
+    monitor.addStage("container", vector<t_voxelContainer*>(1, &container));
+    monitor.addStage("downsampled", vector<t_downsampled*>({&level1, &level2, &level3}));
+    monitor.addStage("stridedAccessor", vector<rebuildAccessor*>({&strided2, &strided3}));
+    monitor.addStage("pyramidAccessor", vector<rebuildAccessor*>({&pyramid2, &pyramid3}));
+    monitor.begin();
+    const axisAlignedBox extent(vector3(-halfExtent), vector3(halfExtent));
+    container.editVoxel(t_editNoise::create(extent, vector3(0.025)));
+    monitor.waitForIdle();
+    result.stages = monitor.getStages();
+
+    rebuildAccessor* const toCompare[][2] = {{&strided2, &pyramid2}, {&strided3, &pyramid3}};
+    for (int32 indLod = 0; indLod < 2; ++indLod)
+    {
+        const string prefix("lod" + std::to_string(indLod + 2));
+        uint64 hashStrided(0);
+        uint64 hashPyramid(0);
+        const StageMonitor::stage strided(toCompare[indLod][0]->rebuild(prefix + "Strided", numRepeats, hashStrided, result.seconds));
+        const StageMonitor::stage pyramid(toCompare[indLod][1]->rebuild(prefix + "Pyramid", numRepeats, hashPyramid, result.seconds));
+        result.values.push_back(std::make_pair(prefix + "Tiles", (double)(strided.numDone / numRepeats)));
+        result.values.push_back(std::make_pair(prefix + "Identical", hashStrided == hashPyramid && strided.numDone == pyramid.numDone ? 1. : 0.));
+        result.stages.push_back(strided);
+        result.stages.push_back(pyramid);
+        result.numOperations += strided.numDone + pyramid.numDone;
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runLazyLod builds two new pipelines. The accessors of the first one cache the lod-voxel of all sides of a tile on creation,
+ * the ones of the second one only after the renderer requested a side, see simple::accessor::setCalculateLodOnDemand().
+ * Each generates the world of generate and moves its camera in 30 steps along the x-axis.
+ * Operations are the generation and the camera steps, the stages contain the latency of each per pipeline.
+ * The values contain per pipeline the cpu-seconds of both and afterwards the number of calculated transvoxel-sides,
+ * their triangles and the KiB of cached lod-voxel of all lods but the finest.
+ */
+scenarioResult runLazyLod(async::dispatcher& worker, const int32& numLod, const real& halfExtent)
+{
+    typedef t_voxelSurface::t_lod::t_tilePtr t_surfaceTilePtr;
+    typedef t_voxelAccessor::t_simple::t_tilePtr t_accessorTilePtr;
+    typedef t_voxelAccessor::t_simple::t_tile t_accessorTile;
+    const int32 numSteps(30);
+
+    scenarioResult result;
+    result.name = "lazylod";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    for (const bool onDemand : {false, true})
+    {
+        const string prefix(onDemand ? "lazy" : "eager");
+        StageMonitor::stage build;
+        build.name = prefix + "Generate";
+        build.numDone = 0;
+        StageMonitor::stage camera;
+        camera.name = prefix + "Camera";
+        camera.numDone = 0;
+
+        pipeline terrain(worker, numLod);
+        for (uint32 indLod = 0; indLod < terrain.accessor.getLodList().size(); ++indLod)
+        {
+            terrain.accessor.getLod(indLod)->setCalculateLodOnDemand(onDemand);
+        }
+        sharedPointer<sync::identifier> cameraId(sync::identifier::create());
+        terrain.renderer.addCamera(cameraId, vector3(-halfExtent*0.75, 0., 0.));
+        terrain.monitor.waitForIdle();
+
+        const double cpuBegin(getProcessCpuSeconds());
+        terrain.monitor.begin();
+        terrain.container.editVoxel(t_editNoise::create(axisAlignedBox(vector3(-halfExtent), vector3(halfExtent)), vector3(0.025)));
+        const double secondsBuild(terrain.monitor.waitForIdle());
+        build.latencies.push_back(secondsBuild*1000.);
+        ++build.numDone;
+        const double cpuBuild(getProcessCpuSeconds());
+        for (int32 step = 0; step <= numSteps; ++step)
+        {
+            const real along((real)step / (real)numSteps * 1.5 - 0.75);
+            terrain.monitor.begin();
+            terrain.renderer.updateCamera(cameraId, vector3(along*halfExtent, 0., math::sin(along*math::pi)*halfExtent*0.25));
+            const double seconds(terrain.monitor.waitForIdle());
+            camera.latencies.push_back(seconds*1000.);
+            ++camera.numDone;
+            result.seconds += seconds;
+        }
+        const double cpuCamera(getProcessCpuSeconds());
+        result.seconds += secondsBuild;
+        result.numOperations += build.numDone + camera.numDone;
+        result.numTiles += terrain.getNumTilesCalculated();
+        result.numTriangles += terrain.numTriangles;
+
+        uint64 numSides(0);
+        uint64 numSideTriangles(0);
+        uint64 numLodVoxelBytes(0);
+        for (uint32 indLod = 1; indLod < terrain.surface.getLodList().size(); ++indLod)
+        {
+            t_voxelSurface::t_lod& surfaceLod(*terrain.surface.getLod(indLod));
+            t_voxelAccessor::t_simple& accessorLod(*terrain.accessor.getLod(indLod));
+            const int32 tileExtent((int32)std::ceil(halfExtent / (t_voxelAccessor::t_simple::t_tile::voxelLength*(1 << indLod))));
+            surfaceLod.lockForRead();
+            for (int32 x = -tileExtent; x < tileExtent; ++x)
+            {
+                for (int32 y = -tileExtent; y < tileExtent; ++y)
+                {
+                    for (int32 z = -tileExtent; z < tileExtent; ++z)
+                    {
+                        const vector3int32 id(x, y, z);
+                        const t_surfaceTilePtr surfaceTile(surfaceLod.getTile(id));
+                        const t_accessorTilePtr accessorTile(accessorLod.getTile(id));
+                        for (uint16 side = 0; side < 6; ++side)
+                        {
+                            if (surfaceTile.get() != nullptr && surfaceTile->isIndicesLodCalculated(side))
+                            {
+                                ++numSides;
+                                numSideTriangles += surfaceTile->getIndicesLod(side).size() / 3;
+                            }
+                            if (accessorTile.get() != nullptr && accessorTile->getVoxelArrayLod(side) != nullptr)
+                            {
+                                numLodVoxelBytes += accessorTile->getVoxelArrayLod(side)->size()*sizeof(t_accessorTile::t_voxel);
+                            }
+                        }
+                    }
+                }
+            }
+            surfaceLod.unlockRead();
+        }
+        result.values.push_back(std::make_pair(prefix + "GenerateCpuSeconds", cpuBuild - cpuBegin));
+        result.values.push_back(std::make_pair(prefix + "CameraCpuSeconds", cpuCamera - cpuBuild));
+        result.values.push_back(std::make_pair(prefix + "TransvoxelSides", (double)numSides));
+        result.values.push_back(std::make_pair(prefix + "TransvoxelTriangles", (double)numSideTriangles));
+        result.values.push_back(std::make_pair(prefix + "LodVoxelKiB", (double)numLodVoxelBytes / 1024.));
+        result.stages.push_back(build);
+        result.stages.push_back(camera);
+
+        terrain.renderer.removeCamera(cameraId);
+        terrain.monitor.waitForIdle();
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runPriority builds new pipelines with a camera off the center and generates the world of generate in each, three times per kind of dispatching:
+ * - hash: without priority positions, the tile jobs get posted in hash-map order.
+ * - priority: the tile jobs nearest to the camera get posted first, see simple::base::setPriorityPositions().
+ * - release8 and release32: additionally the tiles get reported in parts, the first one with 8 or 32 tiles, see terrain::base::setIncrementalRelease().
+ * Operations are the generations, the stages contain per kind the latency until the renderer set the first tile and until it set the last one.
+ * The values contain the cpu-seconds per kind.
+ */
+scenarioResult runPriority(async::dispatcher& worker, const int32& numLod, const real& halfExtent)
+{
+    const int32 numRepeats(3);
+    const std::pair<string, int32> kinds[] = {
+        std::make_pair(string("hash"), -1),
+        std::make_pair(string("priority"), 0),
+        std::make_pair(string("release8"), 8),
+        std::make_pair(string("release32"), 32)
+    };
+
+    scenarioResult result;
+    result.name = "priority";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    for (const std::pair<string, int32>& kind : kinds)
+    {
+        StageMonitor::stage first;
+        first.name = kind.first + "FirstVisible";
+        first.numDone = 0;
+        StageMonitor::stage complete;
+        complete.name = kind.first + "Complete";
+        complete.numDone = 0;
+        double cpuSeconds(0.);
+
+        for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            pipeline terrain(worker, numLod);
+            if (kind.second > 0)
+            {
+                terrain.accessor.setIncrementalRelease(kind.second);
+                terrain.surface.setIncrementalRelease(kind.second);
+            }
+            sharedPointer<sync::identifier> camera(sync::identifier::create());
+            terrain.renderer.addCamera(camera, vector3(halfExtent*0.5, 0., halfExtent*0.5));
+            terrain.monitor.waitForIdle();
+            if (kind.second < 0)
+            {
+                // the surface forwards them to its accessor
+                for (const auto& lod : terrain.surface.getLodList())
+                {
+                    lod->setPriorityPositions(t_voxelSurface::t_lod::t_positionList());
+                }
+            }
+            terrain.monitor.reset();
+
+            const double cpuBegin(getProcessCpuSeconds());
+            terrain.monitor.begin();
+            terrain.container.editVoxel(t_editNoise::create(axisAlignedBox(vector3(-halfExtent), vector3(halfExtent)), vector3(0.025)));
+            result.seconds += terrain.monitor.waitForIdle();
+            cpuSeconds += getProcessCpuSeconds() - cpuBegin;
+
+            const StageMonitor::stage& renderer(terrain.monitor.getStages().back());
+            if (!renderer.latencies.empty())
+            {
+                first.latencies.push_back(renderer.firstLatencies.back());
+                complete.latencies.push_back(renderer.latencies.back());
+                ++first.numDone;
+                ++complete.numDone;
+            }
+            ++result.numOperations;
+            result.numTiles += terrain.getNumTilesCalculated();
+            result.numTriangles += terrain.numTriangles;
+
+            terrain.renderer.removeCamera(camera);
+            terrain.monitor.waitForIdle();
+        }
+        result.values.push_back(std::make_pair(kind.first + "CpuSeconds", cpuSeconds / (double)numRepeats));
+        result.stages.push_back(first);
+        result.stages.push_back(complete);
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runBricks generates a noise-world of 3.2 x 1 x 3.2 halfExtent voxel plus a sphere, numRepeats times each into a new container alone,
+ * a container with accessor and a container with accessor and surface. Homogeneous bricks of 4^3 voxel get skipped by the accessor and the surface.
+ * Operations are the generations, the stages contain their latency per pipeline.
+ * The values contain the median cpu-seconds per pipeline and the number of all and of homogeneous bricks of the container-tiles and of the accessor-tiles of lod 0.
+ */
+scenarioResult runBricks(async::dispatcher& worker, const int32& numLod, const real& halfExtent)
+{
+    typedef t_voxelContainer::t_tile t_containerTile;
+    typedef t_voxelAccessor::t_simple::t_tile t_accessorTile;
+    typedef t_voxelAccessor::t_simple::t_tilePtr t_accessorTilePtr;
+    const int32 numRepeats(3);
+    const axisAlignedBox extent(vector3(-halfExtent*1.6, -halfExtent*0.6, -halfExtent*1.6), vector3(halfExtent*1.6, halfExtent*0.4, halfExtent*1.6));
+
+    scenarioResult result;
+    result.name = "bricks";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    const string names[] = {"container", "accessor", "surface"};
+    for (int32 numStages = 1; numStages <= 3; ++numStages)
+    {
+        StageMonitor::stage build;
+        build.name = names[numStages-1] + "Generate";
+        build.numDone = 0;
+        StageMonitor::t_samples cpuSeconds;
+
+        for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            t_voxelContainer container(worker);
+            std::unique_ptr<t_voxelAccessor> accessor;
+            std::unique_ptr<t_voxelSurface> surface;
+            StageMonitor monitor;
+            monitor.addStage("container", vector<t_voxelContainer*>(1, &container));
+            if (numStages >= 2)
+            {
+                accessor.reset(new t_voxelAccessor(worker, container, numLod));
+                monitor.addStage("accessor", accessor->getLodList());
+            }
+            if (numStages >= 3)
+            {
+                surface.reset(new t_voxelSurface(worker, *accessor));
+                monitor.addStage("surface", surface->getLodList());
+            }
+
+            const double cpuBegin(getProcessCpuSeconds());
+            monitor.begin();
+            container.editVoxel(t_editNoise::create(extent, vector3(0.02)));
+            container.editVoxel(t_editSphere::create(sphere(vector3(5.), 30.)));
+            const double seconds(monitor.waitForIdle());
+            cpuSeconds.push_back(getProcessCpuSeconds() - cpuBegin);
+            build.latencies.push_back(seconds*1000.);
+            ++build.numDone;
+            result.seconds += seconds;
+            ++result.numOperations;
+
+            if (surface)
+            {
+                for (const auto& lod : surface->getLodList())
+                {
+                    result.numTiles += lod->getNumJobs() - lod->getNumJobsCancelled();
+                }
+            }
+            if (numStages < 3 || repeat > 0)
+            {
+                continue;
+            }
+            uint64 numContainerBricks(0);
+            uint64 numContainerBricksHomogeneous(0);
+            container.lockForRead();
+            const axisAlignedBoxInt32& bounds(container.getTilesMap().getBounds());
+            for (int32 x = bounds.getMinimum().x; x < bounds.getMaximum().x; ++x)
+            {
+                for (int32 y = bounds.getMinimum().y; y < bounds.getMaximum().y; ++y)
+                {
+                    for (int32 z = bounds.getMinimum().z; z < bounds.getMaximum().z; ++z)
+                    {
+                        const t_voxelContainer::t_utilsTile& tile(container.getTilesMap().getValue(vector3int32(x, y, z)));
+                        numContainerBricks += t_containerTile::brickCount;
+                        if (tile.data.isNull())
+                        {
+                            // empty or full, no voxel at all
+                            numContainerBricksHomogeneous += t_containerTile::brickCount;
+                            continue;
+                        }
+                        for (int32 bx = 0; bx < t_containerTile::brickLengthPerTile; ++bx)
+                        {
+                            for (int32 by = 0; by < t_containerTile::brickLengthPerTile; ++by)
+                            {
+                                for (int32 bz = 0; bz < t_containerTile::brickLengthPerTile; ++bz)
+                                {
+                                    const vector3int32 brick(bx, by, bz);
+                                    if (tile.data->isBrickEmpty(brick) || tile.data->isBrickFull(brick))
+                                    {
+                                        ++numContainerBricksHomogeneous;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            container.unlockRead();
+
+            uint64 numAccessorBricks(0);
+            uint64 numAccessorBricksHomogeneous(0);
+            t_voxelAccessor::t_simple& accessorLod(*accessor->getLod(0));
+            const vector3int32 tileMinimum((extent.getMinimum() / accessorLod.getTileSize()).getFloor() - vector3(1.));
+            const vector3int32 tileMaximum((extent.getMaximum() / accessorLod.getTileSize()).getFloor() + vector3(2.));
+            for (int32 x = tileMinimum.x; x < tileMaximum.x; ++x)
+            {
+                for (int32 y = tileMinimum.y; y < tileMaximum.y; ++y)
+                {
+                    for (int32 z = tileMinimum.z; z < tileMaximum.z; ++z)
+                    {
+                        const t_accessorTilePtr tile(accessorLod.getTile(vector3int32(x, y, z)));
+                        if (tile.isNull())
+                        {
+                            continue;
+                        }
+                        for (int32 bx = 0; bx < t_accessorTile::brickLengthPerTile; ++bx)
+                        {
+                            for (int32 by = 0; by < t_accessorTile::brickLengthPerTile; ++by)
+                            {
+                                for (int32 bz = 0; bz < t_accessorTile::brickLengthPerTile; ++bz)
+                                {
+                                    const vector3int32 brick(bx, by, bz);
+                                    ++numAccessorBricks;
+                                    if (tile->isBrickEmpty(brick) || tile->isBrickFull(brick))
+                                    {
+                                        ++numAccessorBricksHomogeneous;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            result.values.push_back(std::make_pair(string("containerBricks"), (double)numContainerBricks));
+            result.values.push_back(std::make_pair(string("containerBricksHomogeneous"), (double)numContainerBricksHomogeneous));
+            result.values.push_back(std::make_pair(string("accessorBricks"), (double)numAccessorBricks));
+            result.values.push_back(std::make_pair(string("accessorBricksHomogeneous"), (double)numAccessorBricksHomogeneous));
+        }
+        result.values.push_back(std::make_pair(names[numStages-1] + "CpuSeconds", StageMonitor::calculatePercentile(cpuSeconds, 50.)));
+        result.stages.push_back(build);
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+/**
+ * @brief runCave fills everything below y = 0 in two new pipelines and cuts 6 tunnels into it by random walks of 70 spheres each,
+ * the first pipeline with cave-culling, the second without, see simple::renderer::setCaveCulling().
+ * Afterwards it moves the camera in 30 steps along the first tunnel.
+ * Operations are the generations and the camera steps, the stages contain the latency of each per pipeline.
+ * The values contain per pipeline the cpu-seconds of both and the average number of tiles in range and of the ones not culled per camera step.
+ */
+scenarioResult runCave(async::dispatcher& worker, const int32& numLod, const real& halfExtent)
+{
+    const int32 numTunnels(6);
+    const int32 numSpheresPerTunnel(70);
+    const int32 numSteps(30);
+
+    scenarioResult result;
+    result.name = "cave";
+    result.numOperations = 0;
+    result.seconds = 0.;
+    result.numTiles = 0;
+    result.numTriangles = 0;
+
+    for (const bool culling : {true, false})
+    {
+        const string prefix(culling ? "culled" : "unculled");
+        StageMonitor::stage build;
+        build.name = prefix + "Generate";
+        build.numDone = 0;
+        StageMonitor::stage camera;
+        camera.name = prefix + "Camera";
+        camera.numDone = 0;
+
+        pipeline terrain(worker, numLod);
+        terrain.renderer.setCaveCulling(culling);
+        std::mt19937 random(7);
+        std::uniform_real_distribution<real> distribution(-1., 1.);
+        vector<vector3> path;
+
+        const double cpuBegin(getProcessCpuSeconds());
+        terrain.monitor.begin();
+        terrain.container.editVoxel(t_editAxisAlignedBox::create(axisAlignedBox(vector3(-halfExtent*2.), vector3(halfExtent*2., 0., halfExtent*2.))));
+        for (int32 tunnel = 0; tunnel < numTunnels; ++tunnel)
+        {
+            vector3 position(distribution(random)*halfExtent*0.75, -halfExtent*0.6 + distribution(random)*halfExtent*0.15, distribution(random)*halfExtent*0.75);
+            vector3 direction(distribution(random), distribution(random)*0.2, distribution(random));
+            direction.normalise();
+            for (int32 ind = 0; ind < numSpheresPerTunnel; ++ind)
+            {
+                t_editSphere::pointer toEdit(t_editSphere::create(sphere(position, 7.)));
+                toEdit->setCut(true);
+                terrain.container.editVoxel(toEdit);
+                if (tunnel == 0)
+                {
+                    path.push_back(position);
+                }
+                direction = direction + vector3(distribution(random)*0.3, distribution(random)*0.1, distribution(random)*0.3);
+                direction.normalise();
+                position = position + direction*5.;
+                position.y = math::clamp<real>(position.y, -halfExtent*1.5, -halfExtent*0.3);
+            }
+        }
+        sharedPointer<sync::identifier> cameraId(sync::identifier::create());
+        terrain.renderer.addCamera(cameraId, path[0]);
+        const double secondsBuild(terrain.monitor.waitForIdle());
+        build.latencies.push_back(secondsBuild*1000.);
+        ++build.numDone;
+        const double cpuBuild(getProcessCpuSeconds());
+
+        uint64 numInRange(0);
+        uint64 numShown(0);
+        double cpuCamera(0.);
+        for (int32 step = 0; step < numSteps; ++step)
+        {
+            const double cpuStep(getProcessCpuSeconds());
+            terrain.monitor.begin();
+            terrain.renderer.updateCamera(cameraId, path[(step*path.size())/numSteps]);
+            const double seconds(terrain.monitor.waitForIdle());
+            cpuCamera += getProcessCpuSeconds() - cpuStep;
+            camera.latencies.push_back(seconds*1000.);
+            ++camera.numDone;
+            result.seconds += seconds;
+
+            for (const auto& lod : terrain.renderer.getLodList())
+            {
+                lod->lockForRead();
+                for (const auto& work : lod->getTileMap())
+                {
+                    if (!work.second->getVisible())
+                    {
+                        continue;
+                    }
+                    ++numInRange;
+                    if (!work.second->getCulled())
+                    {
+                        ++numShown;
+                    }
+                }
+                lod->unlockRead();
+            }
+        }
+        result.seconds += secondsBuild;
+        result.numOperations += build.numDone + camera.numDone;
+        result.numTiles += terrain.getNumTilesCalculated();
+        result.numTriangles += terrain.numTriangles;
+
+        result.values.push_back(std::make_pair(prefix + "GenerateCpuSeconds", cpuBuild - cpuBegin));
+        result.values.push_back(std::make_pair(prefix + "CameraCpuSeconds", cpuCamera));
+        result.values.push_back(std::make_pair(prefix + "TilesInRange", (double)numInRange / (double)numSteps));
+        result.values.push_back(std::make_pair(prefix + "TilesShown", (double)numShown / (double)numSteps));
+        result.stages.push_back(build);
+        result.stages.push_back(camera);
+
+        terrain.renderer.removeCamera(cameraId);
+        terrain.monitor.waitForIdle();
+    }
+    result.peakResidentSetKiB = getPeakResidentSetKiB();
+    return result;
+}
+
+string toJson(const scenarioResult& result)
+{
+    std::ostringstream stream;
+    stream.precision(6);
+    stream << std::fixed;
+    stream << "    {\n"
+           << "      \"name\": \"" << result.name << "\",\n"
+           << "      \"operations\": " << result.numOperations << ",\n"
+           << "      \"seconds\": " << result.seconds << ",\n"
+           << "      \"tiles\": " << result.numTiles << ",\n"
+           << "      \"tilesPerSecond\": " << (result.seconds > 0. ? (double)result.numTiles / result.seconds : 0.) << ",\n"
+           << "      \"triangles\": " << result.numTriangles << ",\n"
+           << "      \"trianglesPerSecond\": " << (result.seconds > 0. ? (double)result.numTriangles / result.seconds : 0.) << ",\n"
+           << "      \"peakResidentSetKiB\": " << result.peakResidentSetKiB << ",\n";
+    if (!result.values.empty())
+    {
+        stream << "      \"values\": {";
+        for (std::size_t ind = 0; ind < result.values.size(); ++ind)
+        {
+            stream << (ind == 0 ? "" : ", ") << "\"" << result.values[ind].first << "\": " << result.values[ind].second;
+        }
+        stream << "},\n";
+    }
+    stream << "      \"latencyMs\": {";
+    bool first(true);
+    for (StageMonitor::stage work : result.stages)
+    {
+        stream << (first ? "\n" : ",\n");
+        first = false;
+        stream << "        \"" << work.name << "\": {"
+               << "\"samples\": " << work.latencies.size()
+               << ", \"p50\": " << StageMonitor::calculatePercentile(work.latencies, 50.)
+               << ", \"p90\": " << StageMonitor::calculatePercentile(work.latencies, 90.)
+               << ", \"p99\": " << StageMonitor::calculatePercentile(work.latencies, 99.)
+               << ", \"max\": " << StageMonitor::calculatePercentile(work.latencies, 100.)
+               << "}";
+    }
+    stream << "\n      }\n"
+           << "    }";
+    return stream.str();
+}
+
+
+int main(int argc, char* argv[])
+{
+    uint16 numThreads(std::thread::hardware_concurrency());
+    real halfExtent(100.);
+    // not stdout, the global logger of blub::log writes to the console
+    string outputFile("bench.json");
+    string metricsFile;
+    string traceFile;
+    bool calculateBvh(false);
+    bool optimizeVertexCache(false);
+    bool calculateMeshlets(false);
+    real decimation(0.);
+    vector<string> toRun;
+    for (int32 ind = 1; ind < argc; ++ind)
+    {
+        const bool hasValue(ind + 1 < argc);
+        if (std::strcmp(argv[ind], "--threads") == 0 && hasValue)
+        {
+            numThreads = std::atoi(argv[++ind]);
+        }
+        else if (std::strcmp(argv[ind], "--size") == 0 && hasValue)
+        {
+            halfExtent = std::atof(argv[++ind]);
+        }
+        else if (std::strcmp(argv[ind], "--output") == 0 && hasValue)
+        {
+            outputFile = argv[++ind];
+        }
+        else if (std::strcmp(argv[ind], "--metrics") == 0 && hasValue)
+        {
+            metricsFile = argv[++ind];
+        }
+        else if (std::strcmp(argv[ind], "--trace") == 0 && hasValue)
+        {
+            traceFile = argv[++ind];
+        }
+        else if (std::strcmp(argv[ind], "--bvh") == 0)
+        {
+            calculateBvh = true;
+        }
+        else if (std::strcmp(argv[ind], "--vertexcache") == 0)
+        {
+            optimizeVertexCache = true;
+        }
+        else if (std::strcmp(argv[ind], "--meshlets") == 0)
+        {
+            calculateMeshlets = true;
+        }
+        else if (std::strcmp(argv[ind], "--decimate") == 0 && hasValue)
+        {
+            decimation = std::atof(argv[++ind]);
+        }
+        else if (std::strcmp(argv[ind], "generate") == 0 || std::strcmp(argv[ind], "edit") == 0 || std::strcmp(argv[ind], "flythrough") == 0 ||
+                 std::strcmp(argv[ind], "dig") == 0 || std::strcmp(argv[ind], "remesh") == 0 ||
+                 std::strcmp(argv[ind], "sustained") == 0 || std::strcmp(argv[ind], "concurrent") == 0 ||
+                 std::strcmp(argv[ind], "raycast") == 0 || std::strcmp(argv[ind], "sample") == 0 ||
+                 std::strcmp(argv[ind], "vertexcache") == 0 || std::strcmp(argv[ind], "decimate") == 0 ||
+                 std::strcmp(argv[ind], "normals") == 0 || std::strcmp(argv[ind], "editrow") == 0 ||
+                 std::strcmp(argv[ind], "noise") == 0 || std::strcmp(argv[ind], "mesh") == 0 ||
+                 std::strcmp(argv[ind], "composite") == 0 || std::strcmp(argv[ind], "pyramid") == 0 ||
+                 std::strcmp(argv[ind], "lazylod") == 0 || std::strcmp(argv[ind], "priority") == 0 ||
+                 std::strcmp(argv[ind], "bricks") == 0 || std::strcmp(argv[ind], "cave") == 0)
+        {
+            toRun.push_back(argv[ind]);
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--threads n] [--size halfExtent] [--output file.json] [--metrics file.json] [--trace file.json] [--bvh] [--vertexcache] [--meshlets] [--decimate error] [generate] [edit] [flythrough] [dig] [remesh] [sustained] [concurrent] [raycast] [sample] [vertexcache] [decimate] [normals] [editrow] [noise] [mesh] [composite] [pyramid] [lazylod] [priority] [bricks] [cave]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (toRun.empty())
+    {
+        toRun = {"generate", "edit", "flythrough", "dig", "remesh", "sustained", "concurrent", "raycast", "sample", "vertexcache", "decimate", "normals", "editrow", "noise", "mesh", "composite", "pyramid", "lazylod", "priority", "bricks", "cave"};
+    }
+    numThreads = math::max<uint16>(numThreads, 1);
+
+    blub::log::system::addFileAsynchronous("bench.log");
+    metrics::registry::getGlobal().setEnabled(!metricsFile.empty());
+    trace::tracer::getGlobal().setEnabled(!traceFile.empty());
+    BLUB_TRACE_THREAD_NAME("main");
+
+    const int32 numLod(3);
+    vector<scenarioResult> results;
+    {
+        async::dispatcher worker(numThreads, false, "bench");
+        worker.start();
+        {
+            pipeline terrain(worker, numLod);
+            for (uint32 indLod = 0; indLod < terrain.surface.getLodList().size(); ++indLod)
+            {
+                t_voxelSurface::t_lod* lod(terrain.surface.getLod(indLod));
+                lod->setCalculateBvh(calculateBvh);
+                lod->setOptimizeVertexCache(optimizeVertexCache);
+                lod->setCalculateMeshlets(calculateMeshlets);
+                // the finest lod is near the camera, keep it exact
+                if (indLod > 0)
+                {
+                    lod->setDecimation(decimation*lod->getVoxelSize());
+                }
+            }
+            sharedPointer<sync::identifier> camera(sync::identifier::create());
+            terrain.renderer.addCamera(camera, vector3());
+            terrain.monitor.waitForIdle();
+
+            // edit and flythrough need a world
+            const bool reportGenerate(std::find(toRun.cbegin(), toRun.cend(), string("generate")) != toRun.cend());
+            const scenarioResult generated(runGenerate(terrain, halfExtent));
+            if (reportGenerate)
+            {
+                results.push_back(generated);
+            }
+            for (const string& name : toRun)
+            {
+                if (name == "edit")
+                {
+                    results.push_back(runEdit(terrain, halfExtent));
+                }
+                if (name == "flythrough")
+                {
+                    results.push_back(runFlythrough(terrain, camera, halfExtent));
+                }
+                if (name == "dig")
+                {
+                    results.push_back(runDig(terrain, halfExtent));
+                }
+                if (name == "remesh")
+                {
+                    results.push_back(runRemesh(terrain, halfExtent));
+                }
+                if (name == "sustained")
+                {
+                    results.push_back(runSustained(terrain, halfExtent));
+                }
+                if (name == "concurrent")
+                {
+                    results.push_back(runConcurrent(terrain, camera, halfExtent));
+                }
+                if (name == "normals")
+                {
+                    results.push_back(runNormals(terrain, halfExtent));
+                }
+                if (name == "editrow")
+                {
+                    results.push_back(runEditRow());
+                }
+                if (name == "noise")
+                {
+                    results.push_back(runNoise());
+                }
+                if (name == "mesh")
+                {
+                    results.push_back(runMesh());
+                }
+                if (name == "composite")
+                {
+                    results.push_back(runComposite(worker));
+                }
+                if (name == "pyramid")
+                {
+                    results.push_back(runPyramid(worker, halfExtent));
+                }
+                if (name == "lazylod")
+                {
+                    results.push_back(runLazyLod(worker, numLod, halfExtent));
+                }
+                if (name == "priority")
+                {
+                    results.push_back(runPriority(worker, numLod, halfExtent));
+                }
+                if (name == "bricks")
+                {
+                    results.push_back(runBricks(worker, numLod, halfExtent));
+                }
+                if (name == "cave")
+                {
+                    results.push_back(runCave(worker, numLod, halfExtent));
+                }
+
+                if (name == "raycast")
+                {
+                    results.push_back(runRaycast(terrain, halfExtent));
+                }
+                if (name == "sample")
+                {
+                    results.push_back(runSample(terrain, halfExtent));
+                }
+                if (name == "vertexcache")
+                {
+                    results.push_back(runVertexCache(terrain, halfExtent));
+                }
+                if (name == "decimate")
+                {
+                    results.push_back(runDecimate(terrain, halfExtent, decimation > 0. ? decimation : (real)0.5));
+                }
+            }
+
+            terrain.renderer.removeCamera(camera);
+            terrain.monitor.waitForIdle();
+        }
+        worker.stop();
+        worker.join();
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"voxelterrain\",\n"
+         << "  \"threads\": " << numThreads << ",\n"
+         << "  \"voxelsPerTile\": " << t_config::voxelsPerTile << ",\n"
+         << "  \"lods\": " << numLod << ",\n"
+         << "  \"bvh\": " << (calculateBvh ? "true" : "false") << ",\n"
+         << "  \"vertexCache\": " << (optimizeVertexCache ? "true" : "false") << ",\n"
+         << "  \"meshlets\": " << (calculateMeshlets ? "true" : "false") << ",\n"
+         << "  \"decimation\": " << decimation << ",\n"
+         << "  \"halfExtent\": " << halfExtent << ",\n"
+         << "  \"peakResidentSetKiB\": " << getPeakResidentSetKiB() << ",\n"
+         << "  \"scenarios\": [";
+    for (std::size_t ind = 0; ind < results.size(); ++ind)
+    {
+        json << (ind == 0 ? "\n" : ",\n") << toJson(results[ind]);
+    }
+    json << "\n  ]\n"
+         << "}\n";
+
+    if (!metricsFile.empty() && !metrics::registry::getGlobal().dump(metricsFile, metrics::registry::format::json))
+    {
+        std::cerr << "could not write " << metricsFile << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!traceFile.empty() && !trace::tracer::getGlobal().flush(traceFile))
+    {
+        std::cerr << "could not write " << traceFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream file(outputFile);
+    file << json.str();
+    if (!file)
+    {
+        std::cerr << "could not write " << outputFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
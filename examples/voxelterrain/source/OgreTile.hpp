@@ -30,6 +30,7 @@ blub::uint32 g_meshId = 0;
 /**
  * @brief The OgreTile class converts the resulting vertices and indices of the voxel-terrain to the Ogre Hardwarebuffer.
  * The class handles setVisible() when a tile gets cutted because it's too near or too far or a cracks has to get closed.
+ * A tile hidden by cave-culling (setCulled()) doesn't get shown either.
  * The results of the transvoxel-algorithm for closing the cracks between the lod-tiles get set to submeshes.
  * Every tile contains a Ogre::Mesh, a Ogre::Entity and a Ogre::SceneNode.
  * For more information on how to use ogre3d see http://www.ogre3d.org/docs/manual/ and http://www.ogre3d.org/docs/api/1.9/ .
@@ -68,6 +69,7 @@ public:
     void setTileData(typename t_base::t_tileDataPtr convertToRenderAble, const blub::axisAlignedBox &aabb);
 
     void setVisible(const bool& vis) override;
+    void setCulled(const bool& culled) override;
     void setVisibleLod(const blub::uint16& indLod, const bool& vis) override;
 
 protected:
@@ -186,7 +188,14 @@ template <typename configType>
 void OgreTile<configType>::setVisible(const bool &vis)
 {
     t_base::setVisible(vis);
-    m_graphicDispatcher.dispatch(boost::bind(&OgreTile::setVisibleGraphic, getSharedThisPtr(), vis));
+    m_graphicDispatcher.dispatch(boost::bind(&OgreTile::setVisibleGraphic, getSharedThisPtr(), vis && !t_base::getCulled()));
+}
+
+template <typename configType>
+void OgreTile<configType>::setCulled(const bool &culled)
+{
+    t_base::setCulled(culled);
+    m_graphicDispatcher.dispatch(boost::bind(&OgreTile::setVisibleGraphic, getSharedThisPtr(), t_base::getVisible() && !culled));
 }
 
 template <typename configType>
@@ -238,7 +247,7 @@ void OgreTile<configType>::setTileDataGraphic(blub::sharedPointer<t_voxelSurface
 
     {
         const t_vertices vertices(convertToRenderAble->getVertices());
-        const typename t_base::t_tileData::t_indices indices(convertToRenderAble->getIndices());
+        const typename t_base::t_tileData::t_indices& indices(convertToRenderAble->getIndices());
 
         BASSERT(vertices.size() >= 3);
         BASSERT(indices.size() >= 3);
@@ -333,41 +342,23 @@ void OgreTile<configType>::setTileDataGraphic(blub::sharedPointer<t_voxelSurface
         }
         for (uint32 indSubMesh = 0; indSubMesh < numIterations; ++indSubMesh)
         {
-            uint16 numIndices;
-            if (indSubMesh == 0)
+            const typename t_base::t_tileData::t_indices& indicesWork(indSubMesh == 0 ? indices : convertToRenderAble->getIndicesLod(indSubMesh-1));
+            if (indicesWork.empty())
             {
-                BASSERT(indices.size() < 65536);
-                numIndices = indices.size();
-            }
-            else
-            {
-                const typename t_base::t_tileData::t_indices& indicesLod(convertToRenderAble->getIndicesLod(indSubMesh-1));
-                BASSERT(indicesLod.size() < 65536);
-                if (indicesLod.empty())
-                {
-                    continue;
-                }
-                BASSERT(indicesLod.size() % 3 == 0);
-                numIndices = indicesLod.size();
+                continue;
             }
+            BASSERT(indicesWork.size() % 3 == 0);
+            const uint32 numIndices(indicesWork.size());
 
+            // tiles with more than 65536 vertices have 32 bit indices
+            const bool bits32(indicesWork.getWidth() == procedural::voxel::indexBuffer::width::bits32);
             Ogre::HardwareIndexBufferSharedPtr indexBuffer = Ogre::HardwareBufferManager::getSingleton().
                     createIndexBuffer(
-                        Ogre::HardwareIndexBuffer::IT_16BIT,
+                        bits32 ? Ogre::HardwareIndexBuffer::IT_32BIT : Ogre::HardwareIndexBuffer::IT_16BIT,
                         numIndices,
                         Ogre::HardwareBuffer::HBU_STATIC);
-            uint16* toWriteTo(static_cast<uint16*>(indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD)));
-            {
-                if (indSubMesh == 0)
-                {
-                    memcpy(toWriteTo, indices.data(), sizeof(uint16) * numIndices);
-                }
-                else
-                {
-                    const typename t_base::t_tileData::t_indices& indicesLod(convertToRenderAble->getIndicesLod(indSubMesh-1));
-                    memcpy(toWriteTo, indicesLod.data(), sizeof(uint16) * numIndices);
-                }
-            }
+            void* toWriteTo(indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+            memcpy(toWriteTo, indicesWork.getData(), indicesWork.getBytesPerIndex() * numIndices);
             indexBuffer->unlock();
 
             Ogre::SubMesh* sub = meshWork->getSubMesh(indexSubMesh);
@@ -1,6 +1,7 @@
 #include "dispatcher.hpp"
 
 #include "blub/async/mutex.hpp"
+#include "blub/core/trace.hpp"
 
 #include <boost/asio/io_service.hpp>
 #include <boost/thread.hpp>
@@ -80,12 +81,12 @@ void dispatcher::stop()
 
 void dispatcher::dispatch(const dispatcher::t_toCallFunction &handler)
 {
-    m_service->dispatch(handler);
+    m_service->dispatch(BLUB_TRACE_WRAP(handler, "job", "dispatcher"));
 }
 
 void dispatcher::post(const dispatcher::t_toCallFunction &handler)
 {
-    m_service->post(handler);
+    m_service->post(BLUB_TRACE_WRAP(handler, "job", "dispatcher"));
 }
 
 void dispatcher::waitForQueueDone()
@@ -114,18 +115,18 @@ void dispatcher::runThread(const int32& indThread)
 
 void dispatcher::nameThread(const int32& indThread)
 {
-#ifdef BLUB_LINUX
     blub::string threadName(m_threadName);
     if (m_numThreads > 1)
     {
         threadName += "_" + string::number(indThread);
     }
-    if (m_threadName != "")
+    if (m_threadName == "")
     {
-        prctl(PR_SET_NAME, threadName.data(), 0, 0, 0);
+        return;
     }
-#else
-    (void)indThread;
+    BLUB_TRACE_THREAD_NAME(threadName);
+#ifdef BLUB_LINUX
+    prctl(PR_SET_NAME, threadName.data(), 0, 0, 0);
 #endif
 }
 
@@ -30,6 +30,10 @@ public:
     {
         t_base::lock_shared();
     }
+    bool tryLockForRead()
+    {
+        return t_base::try_lock_shared();
+    }
     void unlockRead()
     {
         t_base::unlock_shared();
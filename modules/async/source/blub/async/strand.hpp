@@ -3,6 +3,7 @@
 
 #include "blub/async/predecl.hpp"
 #include "blub/core/globals.hpp"
+#include "blub/core/trace.hpp"
 
 #include <boost/asio/strand.hpp>
 
@@ -21,13 +22,13 @@ public:
     template<typename CompletionHandler>
     void dispatch(CompletionHandler handler)
     {
-        m_service.dispatch(handler);
+        m_service.dispatch(BLUB_TRACE_WRAP(handler, "handler", "strand"));
     }
 
     template<typename CompletionHandler>
     void post(CompletionHandler handler)
     {
-        m_service.post(handler);
+        m_service.post(BLUB_TRACE_WRAP(handler, "handler", "strand"));
     }
 
     bool isRunningInThisThread() const
@@ -0,0 +1,295 @@
+#include "metrics.hpp"
+
+#include "blub/core/string.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+
+using namespace blub::metrics;
+using namespace blub;
+
+
+namespace
+{
+
+const real percentiles[] = {50., 90., 99., 99.9};
+
+string escapeJson(const string& toEscape)
+{
+    string result;
+    for (const char& work : toEscape)
+    {
+        if (work == '"' || work == '\\')
+        {
+            result += '\\';
+        }
+        result += work;
+    }
+    return result;
+}
+
+string escapePrometheusHelp(const string& toEscape)
+{
+    string result;
+    for (const char& work : toEscape)
+    {
+        if (work == '\n')
+        {
+            result += "\\n";
+            continue;
+        }
+        if (work == '\\')
+        {
+            result += '\\';
+        }
+        result += work;
+    }
+    return result;
+}
+
+template <class metricType>
+metricType& getOrCreate(vector<std::unique_ptr<metricType> >& metrics, const string& name, const string& help, const std::atomic<bool>& enabled)
+{
+    for (const std::unique_ptr<metricType>& work : metrics)
+    {
+        if (work->getName() == name)
+        {
+            return *work;
+        }
+    }
+    metrics.emplace_back(new metricType(name, help, enabled));
+    return *metrics.back();
+}
+
+}
+
+
+uint32 blub::metrics::createShardIndex()
+{
+    static std::atomic<uint32> next(0);
+    return next.fetch_add(1, std::memory_order_relaxed) % counter::numShards;
+}
+
+
+uint64 snapshot::distribution::getValueAtPercentile(const real& percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    const uint64 rank(std::max<uint64>(1, static_cast<uint64>(percentile / 100. * static_cast<real>(count) + 0.5)));
+    uint64 numValues(0);
+    for (uint32 index = 0; index < buckets.size(); ++index)
+    {
+        numValues += buckets[index];
+        if (numValues >= rank)
+        {
+            return std::min(histogram::calculateBucketHighest(index), maximum);
+        }
+    }
+    return maximum;
+}
+
+real snapshot::distribution::getMean() const
+{
+    if (count == 0)
+    {
+        return 0.;
+    }
+    return static_cast<real>(sum) / static_cast<real>(count);
+}
+
+string snapshot::toJson() const
+{
+    std::ostringstream result;
+    result << "{\n  \"counters\": {";
+    for (std::size_t index = 0; index < counters.size(); ++index)
+    {
+        result << (index == 0 ? "\n" : ",\n") << "    \"" << escapeJson(counters[index].name) << "\": " << counters[index].value_;
+    }
+    result << "\n  },\n  \"gauges\": {";
+    for (std::size_t index = 0; index < gauges.size(); ++index)
+    {
+        result << (index == 0 ? "\n" : ",\n") << "    \"" << escapeJson(gauges[index].name) << "\": " << gauges[index].value_;
+    }
+    result << "\n  },\n  \"histograms\": {";
+    for (std::size_t index = 0; index < histograms.size(); ++index)
+    {
+        const distribution& work(histograms[index]);
+        result << (index == 0 ? "\n" : ",\n") << "    \"" << escapeJson(work.name) << "\": {"
+               << "\"count\": " << work.count
+               << ", \"sum\": " << work.sum
+               << ", \"min\": " << (work.count == 0 ? 0 : work.minimum)
+               << ", \"max\": " << work.maximum
+               << ", \"mean\": " << work.getMean();
+        for (const real& percentile : percentiles)
+        {
+            result << ", \"p" << percentile << "\": " << work.getValueAtPercentile(percentile);
+        }
+        result << "}";
+    }
+    result << "\n  }\n}\n";
+    return result.str();
+}
+
+string snapshot::toPrometheus() const
+{
+    std::ostringstream result;
+    for (const value& work : counters)
+    {
+        result << "# HELP " << work.name << " " << escapePrometheusHelp(work.help) << "\n"
+               << "# TYPE " << work.name << " counter\n"
+               << work.name << " " << work.value_ << "\n";
+    }
+    for (const value& work : gauges)
+    {
+        result << "# HELP " << work.name << " " << escapePrometheusHelp(work.help) << "\n"
+               << "# TYPE " << work.name << " gauge\n"
+               << work.name << " " << work.value_ << "\n";
+    }
+    for (const distribution& work : histograms)
+    {
+        result << "# HELP " << work.name << " " << escapePrometheusHelp(work.help) << "\n"
+               << "# TYPE " << work.name << " summary\n";
+        for (const real& percentile : percentiles)
+        {
+            result << work.name << "{quantile=\"" << percentile / 100. << "\"} " << work.getValueAtPercentile(percentile) << "\n";
+        }
+        result << work.name << "_sum " << work.sum << "\n"
+               << work.name << "_count " << work.count << "\n";
+    }
+    return result.str();
+}
+
+
+registry::registry()
+    : m_enabled(false)
+    , m_dumpStop(false)
+{
+    ;
+}
+
+registry::~registry()
+{
+    stopDumping();
+}
+
+registry &registry::getGlobal()
+{
+    static registry result;
+    return result;
+}
+
+void registry::setEnabled(const bool &enabled)
+{
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool registry::isEnabled() const
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+counter &registry::getCounter(const string &name, const string &help)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return getOrCreate(m_counters, name, help, m_enabled);
+}
+
+gauge &registry::getGauge(const string &name, const string &help)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return getOrCreate(m_gauges, name, help, m_enabled);
+}
+
+histogram &registry::getHistogram(const string &name, const string &help)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return getOrCreate(m_histograms, name, help, m_enabled);
+}
+
+snapshot registry::getSnapshot() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+
+    snapshot result;
+    for (const std::unique_ptr<counter>& work : m_counters)
+    {
+        result.counters.push_back({work->getName(), work->getHelp(), static_cast<int64>(work->getValue())});
+    }
+    for (const std::unique_ptr<gauge>& work : m_gauges)
+    {
+        result.gauges.push_back({work->getName(), work->getHelp(), work->getValue()});
+    }
+    for (const std::unique_ptr<histogram>& work : m_histograms)
+    {
+        snapshot::distribution toAdd;
+        toAdd.name = work->getName();
+        toAdd.help = work->getHelp();
+        toAdd.count = 0;
+        toAdd.buckets.resize(histogram::bucketCount);
+        for (uint32 index = 0; index < histogram::bucketCount; ++index)
+        {
+            toAdd.buckets[index] = work->getBucket(index);
+            toAdd.count += toAdd.buckets[index];
+        }
+        toAdd.sum = work->getSum();
+        toAdd.minimum = work->getMinimum();
+        toAdd.maximum = work->getMaximum();
+        result.histograms.push_back(toAdd);
+    }
+    return result;
+}
+
+bool registry::dump(const string &fileName, const format &form) const
+{
+    const snapshot toDump(getSnapshot());
+    const string fileNameTemporary(fileName + ".tmp");
+    {
+        std::ofstream file(fileNameTemporary.c_str(), std::ios::out | std::ios::trunc);
+        file << (form == format::json ? toDump.toJson() : toDump.toPrometheus());
+        if (!file)
+        {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename doesn't replace on windows
+    std::remove(fileName.c_str());
+#endif
+    return std::rename(fileNameTemporary.c_str(), fileName.c_str()) == 0;
+}
+
+void registry::startDumping(const string &fileName, const format &form, const std::chrono::milliseconds &interval)
+{
+    stopDumping();
+
+    m_dumpStop = false;
+    m_dumpThread = std::thread([this, fileName, form, interval]
+    {
+        std::unique_lock<std::mutex> locker(m_dumpMutex);
+        while (!m_dumpStop)
+        {
+            m_dumpCondition.wait_for(locker, interval, [this] {return m_dumpStop;});
+            dump(fileName, form);
+        }
+    });
+}
+
+void registry::stopDumping()
+{
+    if (!m_dumpThread.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(m_dumpMutex);
+        m_dumpStop = true;
+    }
+    m_dumpCondition.notify_all();
+    m_dumpThread.join();
+}
+
@@ -0,0 +1,480 @@
+#ifndef BLUB_CORE_METRICS_HPP
+#define BLUB_CORE_METRICS_HPP
+
+#include "blub/core/globals.hpp"
+#include "blub/core/noncopyable.hpp"
+#include "blub/core/string.hpp"
+#include "blub/core/vector.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+namespace blub
+{
+namespace metrics
+{
+
+
+/**
+ * @brief createShardIndex assigns shards round robin. Use getShardIndex().
+ */
+uint32 createShardIndex();
+/**
+ * @brief getShardIndex returns the shard of the calling thread. Gets assigned on the first call of a thread.
+ * @return 0 to counter::numShards-1
+ */
+inline uint32 getShardIndex()
+{
+    static thread_local const uint32 result(createShardIndex());
+    return result;
+}
+
+
+/**
+ * @brief The metric class is the base of all metrics. A metric records only while its registry is enabled.
+ * Create metrics by registry::getCounter(), registry::getGauge() and registry::getHistogram().
+ */
+class metric : public noncopyable
+{
+public:
+    metric(const string& name, const string& help, const std::atomic<bool>& enabled)
+        : m_name(name)
+        , m_help(help)
+        , m_enabled(enabled)
+    {
+        ;
+    }
+
+    const string& getName() const
+    {
+        return m_name;
+    }
+    const string& getHelp() const
+    {
+        return m_help;
+    }
+    /**
+     * @brief isEnabled returns if the registry of the metric is enabled. A relaxed atomic load.
+     * @return
+     */
+    bool isEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+protected:
+    const string m_name;
+    const string m_help;
+    const std::atomic<bool>& m_enabled;
+
+};
+
+
+/**
+ * @brief The counter class counts monotonic. Every thread adds to its own shard, so threads don't contend for a cache-line.
+ */
+class counter : public metric
+{
+public:
+    static const uint32 numShards = 16;
+
+    counter(const string& name, const string& help, const std::atomic<bool>& enabled)
+        : metric(name, help, enabled)
+    {
+        for (shard& work : m_shards)
+        {
+            work.value = 0;
+        }
+    }
+
+    /**
+     * @brief add adds to the counter, if enabled. Thread-safe.
+     * @param value
+     */
+    void add(const uint64& value = 1)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        m_shards[getShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    /**
+     * @brief getValue returns the sum of all shards. Thread-safe.
+     * @return
+     */
+    uint64 getValue() const
+    {
+        uint64 result(0);
+        for (const shard& work : m_shards)
+        {
+            result += work.value.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+protected:
+    struct shard
+    {
+        std::atomic<uint64> value;
+        char padding[64 - sizeof(std::atomic<uint64>)];
+    };
+    shard m_shards[numShards];
+
+};
+
+
+/**
+ * @brief The gauge class contains a value that goes up and down, for example the length of a queue.
+ */
+class gauge : public metric
+{
+public:
+    gauge(const string& name, const string& help, const std::atomic<bool>& enabled)
+        : metric(name, help, enabled)
+        , m_value(0)
+    {
+        ;
+    }
+
+    /**
+     * @brief add adds to the value, if enabled. Thread-safe.
+     * @param value May be negative.
+     */
+    void add(const int64& value)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        m_value.fetch_add(value, std::memory_order_relaxed);
+    }
+    /**
+     * @brief set sets the value, if enabled. Thread-safe.
+     * @param value
+     */
+    void set(const int64& value)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        m_value.store(value, std::memory_order_relaxed);
+    }
+    int64 getValue() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+protected:
+    std::atomic<int64> m_value;
+
+};
+
+
+/**
+ * @brief The histogram class records the distribution of values, HDR-style: log-linear buckets.
+ * Values below subBucketCount get an own bucket, above every power of two gets split into subBucketCount buckets.
+ * So a bucket is at most 1/subBucketCount (about 3%) of its value wide, for the whole uint64 range, in 15 KiB.
+ */
+class histogram : public metric
+{
+public:
+    static const uint32 subBucketBits = 5;
+    static const uint32 subBucketCount = 1 << subBucketBits;
+    static const uint32 bucketCount = (64 - subBucketBits + 1) * subBucketCount;
+
+    histogram(const string& name, const string& help, const std::atomic<bool>& enabled)
+        : metric(name, help, enabled)
+        , m_sum(0)
+        , m_min(std::numeric_limits<uint64>::max())
+        , m_max(0)
+    {
+        for (std::atomic<uint64>& work : m_buckets)
+        {
+            work = 0;
+        }
+    }
+
+    /**
+     * @brief record adds a value, if enabled. Thread-safe and lock-free.
+     * @param value
+     */
+    void record(const uint64& value)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        m_buckets[calculateBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        uint64 current(m_min.load(std::memory_order_relaxed));
+        while (value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+            ;
+        }
+        current = m_max.load(std::memory_order_relaxed);
+        while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+            ;
+        }
+    }
+
+    /**
+     * @brief getBucket returns the number of values recorded in a bucket.
+     * @param index 0 to bucketCount-1
+     * @return
+     */
+    uint64 getBucket(const uint32& index) const
+    {
+        return m_buckets[index].load(std::memory_order_relaxed);
+    }
+    uint64 getSum() const
+    {
+        return m_sum.load(std::memory_order_relaxed);
+    }
+    uint64 getMinimum() const
+    {
+        return m_min.load(std::memory_order_relaxed);
+    }
+    uint64 getMaximum() const
+    {
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief calculateBucketIndex returns the bucket a value gets recorded in.
+     * @param value
+     * @return 0 to bucketCount-1
+     */
+    static uint32 calculateBucketIndex(const uint64& value)
+    {
+        if (value < subBucketCount)
+        {
+            return static_cast<uint32>(value);
+        }
+#if defined(__GNUC__)
+        const uint32 highestBit(63 - __builtin_clzll(value));
+#else
+        uint32 highestBit(63);
+        while ((value >> highestBit) == 0)
+        {
+            --highestBit;
+        }
+#endif
+        const uint32 shift(highestBit - subBucketBits);
+        return (shift + 1) * subBucketCount + static_cast<uint32>(value >> shift) - subBucketCount;
+    }
+    /**
+     * @brief calculateBucketHighest returns the highest value that gets recorded in a bucket.
+     * @param index 0 to bucketCount-1
+     * @return
+     */
+    static uint64 calculateBucketHighest(const uint32& index)
+    {
+        if (index < subBucketCount)
+        {
+            return index;
+        }
+        const uint32 shift(index / subBucketCount - 1);
+        const uint64 lowest(static_cast<uint64>(subBucketCount + index % subBucketCount) << shift);
+        return lowest + ((static_cast<uint64>(1) << shift) - 1);
+    }
+
+protected:
+    std::atomic<uint64> m_buckets[bucketCount];
+    std::atomic<uint64> m_sum;
+    std::atomic<uint64> m_min;
+    std::atomic<uint64> m_max;
+
+};
+
+
+/**
+ * @brief The scopedTimer class records the microseconds of its lifetime to a histogram.
+ * Doesn't read the clock if the histogram isn't enabled at construction.
+ */
+class scopedTimer : public noncopyable
+{
+public:
+    typedef std::chrono::steady_clock t_clock;
+
+    scopedTimer(histogram& toRecord)
+        : m_histogram(toRecord)
+        , m_enabled(toRecord.isEnabled())
+    {
+        if (m_enabled)
+        {
+            m_start = t_clock::now();
+        }
+    }
+    ~scopedTimer()
+    {
+        if (m_enabled)
+        {
+            m_histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(t_clock::now() - m_start).count());
+        }
+    }
+
+protected:
+    histogram& m_histogram;
+    const bool m_enabled;
+    t_clock::time_point m_start;
+
+};
+
+
+/**
+ * @brief The snapshot class contains the values of all metrics of a registry at one point in time.
+ */
+class snapshot
+{
+public:
+    struct value
+    {
+        string name;
+        string help;
+        int64 value_;
+    };
+    struct distribution
+    {
+        string name;
+        string help;
+        uint64 count;
+        uint64 sum;
+        uint64 minimum;
+        uint64 maximum;
+        // number of values per bucket, see histogram::calculateBucketIndex()
+        vector<uint64> buckets;
+
+        /**
+         * @brief getValueAtPercentile returns the highest value of the bucket that contains the percentile.
+         * @param percentile 0. to 100.
+         * @return 0 if no value got recorded.
+         */
+        uint64 getValueAtPercentile(const real& percentile) const;
+        real getMean() const;
+    };
+
+    vector<value> counters;
+    vector<value> gauges;
+    vector<distribution> histograms;
+
+    /**
+     * @brief toJson returns all metrics as json object. Histograms contain count, sum, min, max, mean and percentiles.
+     * @return
+     */
+    string toJson() const;
+    /**
+     * @brief toPrometheus returns all metrics in the prometheus text format. Histograms get written as summaries.
+     * @return
+     */
+    string toPrometheus() const;
+};
+
+
+/**
+ * @brief The registry class owns metrics by name. Metrics record only while their registry is enabled,
+ * disabled a metric costs a relaxed atomic load and a branch. The procedural and sync classes record to getGlobal().
+ * Snapshots can get taken at any time; dumps get written to a file periodically by startDumping().
+ */
+class registry : public noncopyable
+{
+public:
+    enum class format
+    {
+        json,
+        prometheus
+    };
+
+    /**
+     * @brief registry constructor. Disabled.
+     */
+    registry();
+    /**
+     * @brief ~registry stops dumping. Metrics returned by the registry get invalid.
+     */
+    ~registry();
+
+    /**
+     * @brief getGlobal returns the registry the classes of blub record to. Disabled by default.
+     * @return
+     */
+    static registry& getGlobal();
+
+    /**
+     * @brief setEnabled enables or disables recording of all metrics of the registry. Thread-safe.
+     * @param enabled
+     */
+    void setEnabled(const bool& enabled);
+    bool isEnabled() const;
+
+    /**
+     * @brief getCounter returns the counter with the name, creates it on the first call. Thread-safe.
+     * Keep the reference, the lookup locks.
+     * @param name Prometheus style, for example blub_voxel_surface_tiles_total
+     * @param help Description.
+     * @return Valid as long as the registry.
+     */
+    counter& getCounter(const string& name, const string& help = "");
+    /**
+     * @brief getGauge same as getCounter() for gauges.
+     */
+    gauge& getGauge(const string& name, const string& help = "");
+    /**
+     * @brief getHistogram same as getCounter() for histograms.
+     */
+    histogram& getHistogram(const string& name, const string& help = "");
+
+    /**
+     * @brief getSnapshot returns the current values of all metrics. Thread-safe.
+     * Values recorded while taking it may be only partially contained.
+     * @return
+     */
+    snapshot getSnapshot() const;
+
+    /**
+     * @brief dump writes a snapshot to a file. Writes to fileName.tmp first and renames it, so readers never see a partial file.
+     * @param fileName
+     * @param form
+     * @return false if the file couldn't get written.
+     */
+    bool dump(const string& fileName, const format& form) const;
+    /**
+     * @brief startDumping dumps periodically by an own thread, until stopDumping() or destruction. Replaces a running dump.
+     * @param fileName See dump().
+     * @param form
+     * @param interval
+     */
+    void startDumping(const string& fileName, const format& form, const std::chrono::milliseconds& interval);
+    /**
+     * @brief stopDumping stops the thread started by startDumping() and writes a last dump.
+     */
+    void stopDumping();
+
+protected:
+    std::atomic<bool> m_enabled;
+
+    mutable std::mutex m_mutex;
+    vector<std::unique_ptr<counter> > m_counters;
+    vector<std::unique_ptr<gauge> > m_gauges;
+    vector<std::unique_ptr<histogram> > m_histograms;
+
+    std::mutex m_dumpMutex;
+    std::condition_variable m_dumpCondition;
+    std::thread m_dumpThread;
+    bool m_dumpStop;
+
+};
+
+
+}
+}
+
+#endif // BLUB_CORE_METRICS_HPP
@@ -0,0 +1,186 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+
+using namespace blub::trace;
+using namespace blub;
+
+
+namespace
+{
+
+string escapeJson(const string& toEscape)
+{
+    string result;
+    for (const char& work : toEscape)
+    {
+        if (work == '"' || work == '\\')
+        {
+            result += '\\';
+        }
+        result += work;
+    }
+    return result;
+}
+
+// microseconds with nanosecond precision, the unit of the trace-event format
+void writeMicroseconds(std::ostringstream& stream, const int64& nanoseconds)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%lld.%03lld", static_cast<long long>(nanoseconds / 1000), static_cast<long long>(nanoseconds % 1000));
+    stream << buffer;
+}
+
+}
+
+
+ring::ring(const uint32 &threadId)
+    : m_threadId(threadId)
+    , m_events(capacity)
+    , m_head(0)
+    , m_tail(0)
+{
+    ;
+}
+
+uint64 ring::take(vector<event> &result)
+{
+    const uint64 head(m_head.load(std::memory_order_acquire));
+    uint64 begin(m_tail);
+    if (head - begin > capacity)
+    {
+        begin = head - capacity;
+    }
+    const std::size_t sizeBefore(result.size());
+    for (uint64 index = begin; index < head; ++index)
+    {
+        result.push_back(m_events[index & (capacity - 1)]);
+    }
+    // the thread may have overwritten the oldest ones while copying, including the slot of headAfter it may be writing to right now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64 headAfter(m_head.load(std::memory_order_relaxed));
+    uint64 numOverwritten(0);
+    if (headAfter + 1 - begin > capacity)
+    {
+        numOverwritten = std::min<uint64>(headAfter + 1 - begin - capacity, head - begin);
+        result.erase(result.begin() + sizeBefore, result.begin() + sizeBefore + numOverwritten);
+    }
+    const uint64 numDropped(begin - m_tail + numOverwritten);
+    m_tail = head;
+    return numDropped;
+}
+
+string ring::getThreadName() const
+{
+    std::lock_guard<std::mutex> locker(m_nameMutex);
+    return m_threadName;
+}
+
+void ring::setThreadName(const string &name)
+{
+    std::lock_guard<std::mutex> locker(m_nameMutex);
+    m_threadName = name;
+}
+
+
+tracer::tracer()
+    : m_enabled(false)
+    , m_start(t_clock::now())
+    , m_numDropped(0)
+{
+    ;
+}
+
+tracer &tracer::getGlobal()
+{
+    static tracer result;
+    return result;
+}
+
+void tracer::setThreadName(const string &name)
+{
+    getRing().setThreadName(name);
+}
+
+string tracer::flushToJson()
+{
+    std::ostringstream result;
+    result << "{\"traceEvents\":[\n";
+    result << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"blub\"}}";
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    vector<event> events;
+    for (const std::unique_ptr<ring>& work : m_rings)
+    {
+        const uint32 threadId(work->getThreadId());
+        string threadName(work->getThreadName());
+        if (threadName.empty())
+        {
+            threadName = "thread " + string::number(threadId);
+        }
+        result << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId
+               << ",\"args\":{\"name\":\"" << escapeJson(threadName) << "\"}}";
+
+        events.clear();
+        m_numDropped += work->take(events);
+        for (const event& toWrite : events)
+        {
+            result << ",\n{\"name\":\"" << toWrite.name << "\",\"cat\":\"" << toWrite.category
+                   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId << ",\"ts\":";
+            writeMicroseconds(result, toWrite.begin);
+            result << ",\"dur\":";
+            writeMicroseconds(result, toWrite.duration);
+            if (toWrite.hasTile || toWrite.lod >= 0)
+            {
+                result << ",\"args\":{";
+                if (toWrite.hasTile)
+                {
+                    result << "\"tile\":\"" << toWrite.tile[0] << "," << toWrite.tile[1] << "," << toWrite.tile[2] << "\"";
+                }
+                if (toWrite.lod >= 0)
+                {
+                    result << (toWrite.hasTile ? "," : "") << "\"lod\":" << toWrite.lod;
+                }
+                result << "}";
+            }
+            result << "}";
+        }
+    }
+    result << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":" << m_numDropped << "}}\n";
+    return result.str();
+}
+
+bool tracer::flush(const string &fileName)
+{
+    const string fileNameTemporary(fileName + ".tmp");
+    {
+        std::ofstream file(fileNameTemporary.c_str(), std::ios::out | std::ios::trunc);
+        file << flushToJson();
+        if (!file)
+        {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename doesn't replace on windows
+    std::remove(fileName.c_str());
+#endif
+    return std::rename(fileNameTemporary.c_str(), fileName.c_str()) == 0;
+}
+
+uint64 tracer::getNumDropped() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_numDropped;
+}
+
+ring &tracer::createRing()
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_rings.emplace_back(new ring(m_rings.size() + 1));
+    return *m_rings.back();
+}
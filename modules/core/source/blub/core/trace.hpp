@@ -0,0 +1,284 @@
+#ifndef BLUB_CORE_TRACE_HPP
+#define BLUB_CORE_TRACE_HPP
+
+#include "blub/core/globals.hpp"
+#include "blub/core/noncopyable.hpp"
+#include "blub/core/string.hpp"
+#include "blub/core/vector.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+
+namespace blub
+{
+namespace trace
+{
+
+
+/**
+ * @brief The event struct is one timed section of a thread. Names and categories have to be string literals, they get stored as pointers.
+ */
+struct event
+{
+    const char* name;
+    const char* category;
+    // nanoseconds since the tracer got created
+    int64 begin;
+    int64 duration;
+    int32 tile[3];
+    int32 lod;
+    bool hasTile;
+};
+
+
+/**
+ * @brief The ring class buffers the events of one thread. The thread writes without locking or waiting, when full it overwrites the oldest events.
+ * A reader copies the events and drops the ones the thread overwrote meanwhile.
+ */
+class ring : public noncopyable
+{
+public:
+    static const uint32 capacity = 1 << 15;
+
+    ring(const uint32& threadId);
+
+    /**
+     * @brief push adds an event. Call only by the thread of the ring.
+     * @param toPush
+     */
+    void push(const event& toPush)
+    {
+        const uint64 index(m_head.load(std::memory_order_relaxed));
+        m_events[index & (capacity - 1)] = toPush;
+        m_head.store(index + 1, std::memory_order_release);
+    }
+    /**
+     * @brief take appends the events pushed since the last call. Call by one reader at a time.
+     * @param result
+     * @return The number of events that got overwritten before they got read.
+     */
+    uint64 take(vector<event>& result);
+
+    uint32 getThreadId() const
+    {
+        return m_threadId;
+    }
+    string getThreadName() const;
+    void setThreadName(const string& name);
+
+protected:
+    const uint32 m_threadId;
+    vector<event> m_events;
+    std::atomic<uint64> m_head;
+    uint64 m_tail;
+
+    mutable std::mutex m_nameMutex;
+    string m_threadName;
+
+};
+
+
+/**
+ * @brief The tracer class records events of all threads and writes them in the chrome trace-event format,
+ * which can get viewed by Perfetto (ui.perfetto.dev) or chrome://tracing.
+ * Every thread records to an own ring, created on its first event. The rings outlive their threads, so events of ended threads get written too.
+ * Disabled by default. The macros BLUB_TRACE_SCOPE(), BLUB_TRACE_SCOPE_TILE() and BLUB_TRACE_THREAD_NAME() expand to nothing
+ * if BLUB_TRACE is not defined (cmake option BLUB_TRACE), so the traced classes don't pay anything by default.
+ */
+class tracer : public noncopyable
+{
+public:
+    typedef std::chrono::steady_clock t_clock;
+
+    /**
+     * @brief getGlobal returns the only tracer.
+     * @return
+     */
+    static tracer& getGlobal();
+
+    /**
+     * @brief setEnabled enables or disables recording of events. Thread-safe.
+     * @param enabled
+     */
+    void setEnabled(const bool& enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    bool isEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief getTime returns the nanoseconds since the tracer got created.
+     * @return
+     */
+    int64 getTime() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t_clock::now() - m_start).count();
+    }
+
+    /**
+     * @brief record adds an event to the ring of the calling thread. Lock-free, except for the first event of a thread.
+     * @param toRecord
+     */
+    void record(const event& toRecord)
+    {
+        getRing().push(toRecord);
+    }
+    /**
+     * @brief setThreadName names the calling thread in the written trace.
+     * @param name
+     */
+    void setThreadName(const string& name);
+
+    /**
+     * @brief flushToJson takes the events of all threads recorded since the last flush and returns them as chrome trace-event json.
+     * Threads may record meanwhile, events they overwrite while getting read get dropped. Thread-safe.
+     * @return
+     */
+    string flushToJson();
+    /**
+     * @brief flush same as flushToJson(), but writes to fileName.tmp and renames it to fileName.
+     * @param fileName
+     * @return false if the file couldn't get written.
+     */
+    bool flush(const string& fileName);
+
+    /**
+     * @brief getNumDropped returns the number of events overwritten before they got flushed, summed over all flushes.
+     * @return
+     */
+    uint64 getNumDropped() const;
+
+protected:
+    tracer();
+
+    ring& getRing()
+    {
+        static thread_local ring* result(nullptr);
+        if (result == nullptr)
+        {
+            result = &createRing();
+        }
+        return *result;
+    }
+    ring& createRing();
+
+    std::atomic<bool> m_enabled;
+    const t_clock::time_point m_start;
+
+    mutable std::mutex m_mutex;
+    vector<std::unique_ptr<ring> > m_rings;
+    uint64 m_numDropped;
+
+};
+
+
+/**
+ * @brief The scope class records an event of its lifetime. Doesn't read the clock if the tracer isn't enabled at construction.
+ * Use the macros BLUB_TRACE_SCOPE() and BLUB_TRACE_SCOPE_TILE().
+ */
+class scope : public noncopyable
+{
+public:
+    scope(const char* name, const char* category)
+        : m_tracer(tracer::getGlobal())
+        , m_enabled(m_tracer.isEnabled())
+    {
+        if (m_enabled)
+        {
+            m_event.name = name;
+            m_event.category = category;
+            m_event.lod = -1;
+            m_event.hasTile = false;
+            m_event.begin = m_tracer.getTime();
+        }
+    }
+    scope(const char* name, const char* category, const int32& tileX, const int32& tileY, const int32& tileZ, const int32& lod)
+        : m_tracer(tracer::getGlobal())
+        , m_enabled(m_tracer.isEnabled())
+    {
+        if (m_enabled)
+        {
+            m_event.name = name;
+            m_event.category = category;
+            m_event.tile[0] = tileX;
+            m_event.tile[1] = tileY;
+            m_event.tile[2] = tileZ;
+            m_event.lod = lod;
+            m_event.hasTile = true;
+            m_event.begin = m_tracer.getTime();
+        }
+    }
+    ~scope()
+    {
+        if (m_enabled)
+        {
+            m_event.duration = m_tracer.getTime() - m_event.begin;
+            m_tracer.record(m_event);
+        }
+    }
+
+protected:
+    tracer& m_tracer;
+    const bool m_enabled;
+    event m_event;
+
+};
+
+
+/**
+ * @brief The wrapped struct calls a handler inside of a scope. Returned by wrap().
+ */
+template <typename handlerType>
+struct wrapped
+{
+    handlerType handler;
+    const char* name;
+    const char* category;
+
+    void operator()()
+    {
+        scope traced(name, category);
+        handler();
+    }
+};
+
+/**
+ * @brief wrap returns a handler that records an event for every call of the handler. Use the macro BLUB_TRACE_WRAP().
+ * @param handler Gets copied.
+ * @param name String literal.
+ * @param category String literal.
+ * @return
+ */
+template <typename handlerType>
+wrapped<handlerType> wrap(const handlerType& handler, const char* name, const char* category)
+{
+    return wrapped<handlerType>{handler, name, category};
+}
+
+
+}
+}
+
+
+#ifdef BLUB_TRACE
+#   define BLUB_TRACE_CONCAT_IMPL(first, second) first##second
+#   define BLUB_TRACE_CONCAT(first, second) BLUB_TRACE_CONCAT_IMPL(first, second)
+#   define BLUB_TRACE_SCOPE(name, category) blub::trace::scope BLUB_TRACE_CONCAT(blubTraceScope, __LINE__)(name, category)
+#   define BLUB_TRACE_SCOPE_TILE(name, category, id, lod) blub::trace::scope BLUB_TRACE_CONCAT(blubTraceScope, __LINE__)(name, category, (id).x, (id).y, (id).z, lod)
+#   define BLUB_TRACE_THREAD_NAME(name) blub::trace::tracer::getGlobal().setThreadName(name)
+#   define BLUB_TRACE_WRAP(handler, name, category) blub::trace::wrap(handler, name, category)
+#else
+#   define BLUB_TRACE_SCOPE(name, category)
+#   define BLUB_TRACE_SCOPE_TILE(name, category, id, lod)
+#   define BLUB_TRACE_THREAD_NAME(name)
+#   define BLUB_TRACE_WRAP(handler, name, category) handler
+#endif
+
+
+#endif // BLUB_CORE_TRACE_HPP
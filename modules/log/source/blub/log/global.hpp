@@ -5,6 +5,7 @@
 #include "blub/log/globalLogger.hpp"
 #include "blub/log/logger.hpp"
 #include "blub/log/predecl.hpp"
+#include "blub/log/rateLimiter.hpp"
 
 #include <boost/log/utility/manipulators/add_value.hpp>
 
@@ -27,14 +28,36 @@ BLUB_LOG_GLOBAL_LOGGER(global, logger)
 #   define BLUB_LOG_SEV_WITHOUT_LOCATION(destination, severity) BOOST_LOG_SEV(destination, severity)
 #endif
 
-#define BLUB_LOG_OUT_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::out)
+// severities below BLUB_LOG_MIN_SEVERITY compile to dead code, the message doesn't get evaluated
+#define BLUB_LOG_SEV_DISABLED(destination, severity) if (true) {} else BLUB_LOG_SEV(destination, severity)
+
+#if BLUB_LOG_MIN_SEVERITY <= 0
+#   define BLUB_LOG_OUT_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::out)
+#else
+#   define BLUB_LOG_OUT_TO(destination) BLUB_LOG_SEV_DISABLED(destination, blub::log::severity::out)
+#endif
 #define BLUB_LOG_OUT() BLUB_LOG_OUT_TO(blub::log::global::get())
 
-#define BLUB_LOG_WARNING_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::warning)
+#if BLUB_LOG_MIN_SEVERITY <= 1
+#   define BLUB_LOG_WARNING_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::warning)
+#else
+#   define BLUB_LOG_WARNING_TO(destination) BLUB_LOG_SEV_DISABLED(destination, blub::log::severity::warning)
+#endif
 #define BLUB_LOG_WARNING() BLUB_LOG_WARNING_TO(blub::log::global::get())
 
-#define BLUB_LOG_ERROR_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::error)
+#if BLUB_LOG_MIN_SEVERITY <= 2
+#   define BLUB_LOG_ERROR_TO(destination) BLUB_LOG_SEV(destination, blub::log::severity::error)
+#else
+#   define BLUB_LOG_ERROR_TO(destination) BLUB_LOG_SEV_DISABLED(destination, blub::log::severity::error)
+#endif
 #define BLUB_LOG_ERROR() BLUB_LOG_ERROR_TO(blub::log::global::get())
 
+// logs at most maxPerSecond messages per second of this call-site, for example BLUB_LOG_RATE_LIMITED(BLUB_LOG_WARNING(), 1) << "message";
+// the next message that passes tells how many got suppressed
+#define BLUB_LOG_RATE_LIMITED(logMacro, maxPerSecond) \
+    for (blub::log::rateLimiter* blubLogLimiter = &[]() -> blub::log::rateLimiter& {static blub::log::rateLimiter result(maxPerSecond); return result;}(); \
+         blubLogLimiter != nullptr; blubLogLimiter = nullptr) \
+        if (!blubLogLimiter->tryAcquire()) {} else logMacro << blub::log::suppressed(*blubLogLimiter)
+
 
 #endif // BLUB_LOG_GLOBAL_HPP
@@ -0,0 +1,109 @@
+#ifndef BLUB_LOG_RATELIMITER_HPP
+#define BLUB_LOG_RATELIMITER_HPP
+
+#include "blub/core/globals.hpp"
+#include "blub/core/noncopyable.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+
+namespace blub
+{
+namespace log
+{
+
+
+/**
+ * @brief The rateLimiter class lets pass a maximum number of messages per interval and counts the ones it suppresses.
+ * Use the macro BLUB_LOG_RATE_LIMITED(), which creates one per call-site.
+ */
+class rateLimiter : public noncopyable
+{
+public:
+    typedef std::chrono::steady_clock t_clock;
+
+    rateLimiter(const uint32& maxPerInterval, const std::chrono::milliseconds& interval = std::chrono::seconds(1))
+        : m_maxPerInterval(maxPerInterval)
+        , m_interval(std::chrono::duration_cast<t_clock::duration>(interval).count())
+        , m_intervalBegin(t_clock::now().time_since_epoch().count())
+        , m_numInInterval(0)
+        , m_numSuppressed(0)
+    {
+        ;
+    }
+
+    /**
+     * @brief tryAcquire returns if a message may get logged. Thread-safe and lock-free.
+     * At an interval change threads may race, so a few messages more than maxPerInterval may pass.
+     * @return
+     */
+    bool tryAcquire()
+    {
+        const int64 now(t_clock::now().time_since_epoch().count());
+        int64 intervalBegin(m_intervalBegin.load(std::memory_order_relaxed));
+        if (now - intervalBegin >= m_interval)
+        {
+            if (m_intervalBegin.compare_exchange_strong(intervalBegin, now, std::memory_order_relaxed))
+            {
+                m_numInInterval.store(0, std::memory_order_relaxed);
+            }
+        }
+        if (m_numInInterval.load(std::memory_order_relaxed) < m_maxPerInterval &&
+            m_numInInterval.fetch_add(1, std::memory_order_relaxed) < m_maxPerInterval)
+        {
+            return true;
+        }
+        m_numSuppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * @brief takeNumSuppressed returns the number of messages suppressed since the last call and resets it.
+     * @return
+     */
+    uint64 takeNumSuppressed()
+    {
+        return m_numSuppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+protected:
+    const uint32 m_maxPerInterval;
+    const int64 m_interval;
+    std::atomic<int64> m_intervalBegin;
+    std::atomic<uint32> m_numInInterval;
+    std::atomic<uint64> m_numSuppressed;
+
+};
+
+
+/**
+ * @brief The suppressed struct writes "(n suppressed) " to a log message, if the rateLimiter suppressed messages since the last one.
+ */
+struct suppressed
+{
+    suppressed(rateLimiter& limiter)
+        : numSuppressed(limiter.takeNumSuppressed())
+    {
+        ;
+    }
+
+    const uint64 numSuppressed;
+};
+
+inline std::ostream& operator<< (std::ostream& strm, const suppressed& toWrite)
+{
+    if (toWrite.numSuppressed > 0)
+    {
+        strm << "(" << toWrite.numSuppressed << " suppressed) ";
+    }
+    return strm;
+}
+
+
+}
+}
+
+
+#endif // BLUB_LOG_RATELIMITER_HPP
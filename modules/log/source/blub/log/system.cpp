@@ -4,15 +4,26 @@
 #include "blub/core/string.hpp"
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/core/null_deleter.hpp>
 #include <boost/log/attributes.hpp>
+#include <boost/log/core.hpp>
 #include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+#include <boost/log/sinks/unbounded_fifo_queue.hpp>
 #include <boost/log/sources/record_ostream.hpp>
 #include <boost/log/utility/manipulators/to_log.hpp>
 #include <boost/log/utility/setup/console.hpp>
 #include <boost/log/utility/setup/file.hpp>
 #include <boost/log/support/date_time.hpp>
 
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 using namespace blub::log;
@@ -50,25 +61,98 @@ boost::log::formatting_ostream& operator<<
 }
 
 
-void system::addFile(const string &file)
+namespace
 {
-    boost::log::add_file_log(
-                static_cast<std::string>(file),
-                boost::log::keywords::format =
-                        (
-                            boost::log::expressions::stream
-                                << boost::log::expressions::attr< severity, severity_tag >("Severity")
-                                << " " << boost::log::expressions::attr< boost::posix_time::ptime >("TimeStamp")
-                                << " " << boost::log::expressions::attr< boost::log::attributes::current_thread_id::value_type >("ThreadID")
-                                << " " << boost::log::expressions::attr< blub::string >("Module")
+
+boost::log::formatter createFormatter()
+{
+    return boost::log::expressions::stream
+            << boost::log::expressions::attr< blub::log::severity, severity_tag >("Severity")
+            << " " << boost::log::expressions::attr< boost::posix_time::ptime >("TimeStamp")
+            << " " << boost::log::expressions::attr< boost::log::attributes::current_thread_id::value_type >("ThreadID")
+            << " " << boost::log::expressions::attr< blub::string >("Module")
 #ifdef BLUB_LOG_LOCATION
-                                << " " << boost::log::expressions::attr< blub::string >("Location")
-                                << "\n"
+            << " " << boost::log::expressions::attr< blub::string >("Location")
+            << "\n"
 #else
-                                << " "
+            << " "
 #endif
-                                << boost::log::expressions::smessage
-                        ),
+            << boost::log::expressions::smessage;
+}
+
+/**
+ * @brief The asynchronousWriter class feeds the records queued by an asynchronous sink to its backend, every interval and at destruction.
+ */
+class asynchronousWriter
+{
+public:
+    asynchronousWriter(const boost::shared_ptr<boost::log::sinks::sink>& sink, const std::chrono::milliseconds& interval)
+        : m_sink(sink)
+        , m_stop(false)
+    {
+        m_thread = std::thread([this, interval]
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            while (!m_stop)
+            {
+                m_condition.wait_for(locker, interval, [this] {return m_stop;});
+                m_sink->flush();
+            }
+        });
+    }
+    ~asynchronousWriter()
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+protected:
+    boost::shared_ptr<boost::log::sinks::sink> m_sink;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+    std::thread m_thread;
+
+};
+
+// destroyed at exit, which writes the records still queued
+std::vector<std::unique_ptr<asynchronousWriter> >& getAsynchronousWriters()
+{
+    static std::vector<std::unique_ptr<asynchronousWriter> > result;
+    return result;
+}
+std::mutex& getAsynchronousWritersMutex()
+{
+    static std::mutex result;
+    return result;
+}
+
+template <class backendType>
+void addAsynchronous(const boost::shared_ptr<backendType>& backend, const std::chrono::milliseconds& flushInterval)
+{
+    // the lock-free queue; records get fed by the asynchronousWriter instead of a dedicated thread of boost, to batch them
+    typedef boost::log::sinks::asynchronous_sink<backendType, boost::log::sinks::unbounded_fifo_queue> t_sink;
+
+    boost::shared_ptr<t_sink> sink(new t_sink(backend, false));
+    sink->set_formatter(createFormatter());
+    boost::log::core::get()->add_sink(sink);
+
+    std::lock_guard<std::mutex> locker(getAsynchronousWritersMutex());
+    getAsynchronousWriters().emplace_back(new asynchronousWriter(sink, flushInterval));
+}
+
+}
+
+
+void system::addFile(const string &file)
+{
+    boost::log::add_file_log(
+                static_cast<std::string>(file),
+                boost::log::keywords::format = createFormatter(),
                 boost::log::keywords::auto_flush = true
         );
 }
@@ -77,21 +161,26 @@ void system::addConsole()
 {
     boost::log::add_console_log(
                 std::cout,
-                boost::log::keywords::format =
-                        (
-                            boost::log::expressions::stream
-                                << boost::log::expressions::attr<severity, severity_tag>("Severity")
-                                << " " << boost::log::expressions::attr<boost::posix_time::ptime>("TimeStamp")
-                                << " " << boost::log::expressions::attr<boost::log::attributes::current_thread_id::value_type>("ThreadID")
-                                << " " << boost::log::expressions::attr< blub::string >("Module")
-#ifdef BLUB_LOG_LOCATION
-                                << " " << boost::log::expressions::attr< blub::string >("Location")
-                                << "\n"
-#else
-                                << " "
-#endif
-                                << boost::log::expressions::smessage
-                        ),
+                boost::log::keywords::format = createFormatter(),
                 boost::log::keywords::auto_flush = true
         );
 }
+
+void system::addFileAsynchronous(const string &file, const std::chrono::milliseconds &flushInterval)
+{
+    boost::shared_ptr<boost::log::sinks::text_file_backend> backend(
+                new boost::log::sinks::text_file_backend(boost::log::keywords::file_name = static_cast<std::string>(file)));
+    addAsynchronous(backend, flushInterval);
+}
+
+void system::addConsoleAsynchronous(const std::chrono::milliseconds &flushInterval)
+{
+    boost::shared_ptr<boost::log::sinks::text_ostream_backend> backend(new boost::log::sinks::text_ostream_backend());
+    backend->add_stream(boost::shared_ptr<std::ostream>(&std::cout, boost::null_deleter()));
+    addAsynchronous(backend, flushInterval);
+}
+
+void system::flush()
+{
+    boost::log::core::get()->flush();
+}
@@ -4,6 +4,7 @@
 #include "blub/core/predecl.hpp"
 #include "blub/log/predecl.hpp"
 
+#include <chrono>
 
 
 namespace blub
@@ -16,6 +17,24 @@ namespace log
         static void addFile(const blub::string &file);
         static void addConsole();
 
+        /**
+         * @brief addFileAsynchronous same as addFile(), but a logging thread only queues the record, without locking.
+         * A background thread writes the queued records batched and flushes the file every flushInterval.
+         * Queued records get written by flush() and at exit at the latest.
+         * @param file
+         * @param flushInterval
+         */
+        static void addFileAsynchronous(const blub::string &file, const std::chrono::milliseconds& flushInterval = std::chrono::milliseconds(100));
+        /**
+         * @brief addConsoleAsynchronous same as addFileAsynchronous() for the console.
+         * @param flushInterval
+         */
+        static void addConsoleAsynchronous(const std::chrono::milliseconds& flushInterval = std::chrono::milliseconds(100));
+        /**
+         * @brief flush writes the records queued by the asynchronous sinks and flushes all sinks. Blocks until written.
+         */
+        static void flush();
+
     };
 }
 }
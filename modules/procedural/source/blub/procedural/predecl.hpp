@@ -10,6 +10,7 @@ namespace procedural
     {
         class config;
         class data;
+        class indexBuffer;
         struct vertex;
         namespace tile
         {
@@ -41,6 +42,10 @@ namespace procedural
                 template <class configType = config>
                 class base;
                 template <class configType = config>
+                class downsampled;
+                template <class configType = config>
+                class generated;
+                template <class configType = config>
                 class inMemory;
                 template <class configType = config>
                 class database;
@@ -72,6 +77,8 @@ namespace procedural
             template <class configType = config>
             class box;
             template <class configType = config>
+            class composite;
+            template <class configType = config>
             class mesh;
             template <class configType = config>
             class noise;
@@ -0,0 +1,858 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_BVH
+#define BLUB_PROCEDURAL_VOXEL_BVH
+
+#include "blub/core/globals.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/math.hpp"
+#include "blub/math/vector3.hpp"
+#include "blub/procedural/voxel/raycast.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The bvh class is a bounding volume hierarchy over the triangles of a surface-tile, for raycasts, sphere-sweeps and closest-point queries.
+ * Gets built top-down by the surface area heuristic over binned triangle-centroids. The binary tree gets collapsed to nodes with 4 children,
+ * whose bounding boxes lie per axis in arrays of 4, so a node gets tested in one loop the compiler vectorises.
+ * Doesn't copy the mesh, the queries take the vertices and indices it got built from. An empty bvh makes the queries test all triangles.
+ * @see tile::surface::calculateBvh()
+ */
+class bvh
+{
+public:
+    static const int32 maxTrianglesPerLeaf = 4;
+    static const int32 numBins = 12;
+
+    /**
+     * @brief The t_hit struct is the result of a query.
+     */
+    struct t_hit
+    {
+        t_hit()
+            : hit(false)
+            , distance(0.)
+            , triangle(0)
+        {
+            ;
+        }
+
+        bool hit;
+        real distance;
+        // index of the first vertex-index of the triangle in the index-list
+        uint32 triangle;
+        // on the triangle
+        vector3 position;
+        // facing the query
+        vector3 normal;
+    };
+
+    bvh()
+    {
+        ;
+    }
+
+    /**
+     * @brief build builds the hierarchy over the triangles of a mesh. Skips degenerated triangles.
+     * @param vertices Have to contain a member position.
+     * @param indices Three per triangle. A vector or an indexBuffer, needs size() and operator[].
+     */
+    template <typename vertexType, typename indicesType>
+    void build(const vector<vertexType>& vertices, const indicesType& indices)
+    {
+        clear();
+        vector<t_reference> references;
+        references.reserve(indices.size() / 3);
+        for (uint32 index = 0; index + 2 < indices.size(); index += 3)
+        {
+            const vector3& vertex0(vertices[indices[index]].position);
+            const vector3& vertex1(vertices[indices[index+1]].position);
+            const vector3& vertex2(vertices[indices[index+2]].position);
+            if ((vertex1 - vertex0).crossProduct(vertex2 - vertex0).squaredLength() <= 0.)
+            {
+                // the unused parts of a fragmented surface-tile
+                continue;
+            }
+            t_reference toAdd;
+            toAdd.triangle = index;
+            toAdd.bounds.extend(vertex0);
+            toAdd.bounds.extend(vertex1);
+            toAdd.bounds.extend(vertex2);
+            toAdd.centroid = (toAdd.bounds.minimum + toAdd.bounds.maximum) * 0.5;
+            references.push_back(toAdd);
+        }
+        if (references.empty())
+        {
+            return;
+        }
+        vector<t_buildNode> buildNodes;
+        buildNodes.reserve(references.size() / 2 * 2 + 1);
+        buildBinary(references, 0, references.size(), 0, buildNodes);
+
+        m_triangles.reserve(references.size());
+        for (const t_reference& work : references)
+        {
+            m_triangles.push_back(work.triangle);
+        }
+        m_nodes.reserve(buildNodes.size() / 4 + 1);
+        collapse(buildNodes, 0);
+    }
+
+    /**
+     * @brief clear removes the hierarchy.
+     */
+    void clear()
+    {
+        m_nodes.clear();
+        m_triangles.clear();
+    }
+
+    bool isEmpty() const
+    {
+        return m_nodes.empty();
+    }
+    /**
+     * @brief getNumNodes returns the number of nodes, each with up to 4 children.
+     * @return
+     */
+    uint32 getNumNodes() const
+    {
+        return m_nodes.size();
+    }
+    /**
+     * @brief getNumBytes returns the memory used by the hierarchy.
+     * @return
+     */
+    uint32 getNumBytes() const
+    {
+        return m_nodes.capacity()*sizeof(t_node) + m_triangles.capacity()*sizeof(uint32);
+    }
+
+    /**
+     * @brief raycast returns the nearest triangle hit by a ray, from both sides.
+     * @param vertices The ones passed to build().
+     * @param indices The ones passed to build().
+     * @param origin Of the ray.
+     * @param direction Of the ray. Has to be normalized.
+     * @param maxDistance Hits farther away get ignored.
+     * @return
+     */
+    template <typename vertexType, typename indicesType>
+    t_hit raycast(const vector<vertexType>& vertices, const indicesType& indices,
+                  const vector3& origin, const vector3& direction, const real& maxDistance) const
+    {
+        t_hit result;
+        real best(maxDistance);
+        const vector3 inverse(calculateInverse(direction));
+        query(vertices, indices,
+              [&] (const t_node& node, real distances[4])
+              {
+                  intersectBoxes(node, origin, inverse, 0., distances);
+              },
+              [&] (const uint32& triangle, const vector3& vertex0, const vector3& vertex1, const vector3& vertex2)
+              {
+                  real distance;
+                  if (intersectTriangle(origin, direction, vertex0, vertex1, vertex2, distance) && distance < best)
+                  {
+                      best = distance;
+                      result.hit = true;
+                      result.triangle = triangle;
+                      result.normal = (vertex1 - vertex0).crossProduct(vertex2 - vertex0);
+                  }
+              },
+              best);
+        if (result.hit)
+        {
+            result.distance = best;
+            result.position = origin + direction*best;
+            result.normal.normalise();
+            if (result.normal.dotProduct(direction) > 0.)
+            {
+                result.normal = -result.normal;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief sweepSphere returns the first triangle a sphere touches while moving along a ray.
+     * @param vertices The ones passed to build().
+     * @param indices The ones passed to build().
+     * @param origin The start of the sphere-center.
+     * @param direction Of the movement. Has to be normalized.
+     * @param radius Of the sphere.
+     * @param maxDistance Of the movement.
+     * @return distance is the movement till the contact, position the contact on the triangle, normal points from the contact to the sphere-center.
+     * Distance 0 if the sphere touches a triangle at origin already.
+     */
+    template <typename vertexType, typename indicesType>
+    t_hit sweepSphere(const vector<vertexType>& vertices, const indicesType& indices,
+                      const vector3& origin, const vector3& direction, const real& radius, const real& maxDistance) const
+    {
+        t_hit result;
+        real best(maxDistance);
+        const vector3 inverse(calculateInverse(direction));
+        query(vertices, indices,
+              [&] (const t_node& node, real distances[4])
+              {
+                  // the box grown by the radius contains the box swept by the sphere
+                  intersectBoxes(node, origin, inverse, radius, distances);
+              },
+              [&] (const uint32& triangle, const vector3& vertex0, const vector3& vertex1, const vector3& vertex2)
+              {
+                  real distance;
+                  vector3 contact;
+                  if (sweepSphereTriangle(origin, direction, radius, vertex0, vertex1, vertex2, distance, contact) && distance < best)
+                  {
+                      best = distance;
+                      result.hit = true;
+                      result.triangle = triangle;
+                      result.position = contact;
+                      result.normal = (vertex1 - vertex0).crossProduct(vertex2 - vertex0);
+                  }
+              },
+              best);
+        if (result.hit)
+        {
+            result.distance = best;
+            const vector3 toCenter(origin + direction*best - result.position);
+            if (toCenter.squaredLength() > 0.)
+            {
+                result.normal = toCenter;
+            }
+            else if (result.normal.dotProduct(direction) > 0.)
+            {
+                result.normal = -result.normal;
+            }
+            result.normal.normalise();
+        }
+        return result;
+    }
+
+    /**
+     * @brief calculateClosestPoint returns the point on the triangles closest to a position.
+     * @param vertices The ones passed to build().
+     * @param indices The ones passed to build().
+     * @param position The position to query.
+     * @param maxDistance Triangles farther away get ignored.
+     * @return distance is the one between position and the closest point, normal points from the closest point to position.
+     */
+    template <typename vertexType, typename indicesType>
+    t_hit calculateClosestPoint(const vector<vertexType>& vertices, const indicesType& indices,
+                                const vector3& position, const real& maxDistance) const
+    {
+        t_hit result;
+        // squared distances, so the boxes get tested without a root
+        real best(maxDistance*maxDistance);
+        query(vertices, indices,
+              [&] (const t_node& node, real distances[4])
+              {
+                  calculateSquaredDistanceBoxes(node, position, distances);
+              },
+              [&] (const uint32& triangle, const vector3& vertex0, const vector3& vertex1, const vector3& vertex2)
+              {
+                  const vector3 closest(calculateClosestPointOnTriangle(position, vertex0, vertex1, vertex2));
+                  const real distance(closest.squaredDistance(position));
+                  if (distance < best)
+                  {
+                      best = distance;
+                      result.hit = true;
+                      result.triangle = triangle;
+                      result.position = closest;
+                      result.normal = (vertex1 - vertex0).crossProduct(vertex2 - vertex0);
+                  }
+              },
+              best);
+        if (result.hit)
+        {
+            result.distance = math::sqrt(best);
+            const vector3 toPosition(position - result.position);
+            if (toPosition.squaredLength() > 0.)
+            {
+                result.normal = toPosition;
+            }
+            result.normal.normalise();
+        }
+        return result;
+    }
+
+    /**
+     * @brief calculateClosestPointOnTriangle returns the point of a triangle closest to a position. By Christer Ericson, Real-Time Collision Detection.
+     * @param position
+     * @param vertex0
+     * @param vertex1
+     * @param vertex2
+     * @return
+     */
+    static vector3 calculateClosestPointOnTriangle(const vector3& position, const vector3& vertex0, const vector3& vertex1, const vector3& vertex2)
+    {
+        const vector3 edge0(vertex1 - vertex0);
+        const vector3 edge1(vertex2 - vertex0);
+        const vector3 to0(position - vertex0);
+        const real d1(edge0.dotProduct(to0));
+        const real d2(edge1.dotProduct(to0));
+        if (d1 <= 0. && d2 <= 0.)
+        {
+            return vertex0;
+        }
+        const vector3 to1(position - vertex1);
+        const real d3(edge0.dotProduct(to1));
+        const real d4(edge1.dotProduct(to1));
+        if (d3 >= 0. && d4 <= d3)
+        {
+            return vertex1;
+        }
+        const real vc(d1*d4 - d3*d2);
+        if (vc <= 0. && d1 >= 0. && d3 <= 0.)
+        {
+            return vertex0 + edge0*(d1 / (d1 - d3));
+        }
+        const vector3 to2(position - vertex2);
+        const real d5(edge0.dotProduct(to2));
+        const real d6(edge1.dotProduct(to2));
+        if (d6 >= 0. && d5 <= d6)
+        {
+            return vertex2;
+        }
+        const real vb(d5*d2 - d1*d6);
+        if (vb <= 0. && d2 >= 0. && d6 <= 0.)
+        {
+            return vertex0 + edge1*(d2 / (d2 - d6));
+        }
+        const real va(d3*d6 - d5*d4);
+        if (va <= 0. && (d4 - d3) >= 0. && (d5 - d6) >= 0.)
+        {
+            return vertex1 + (vertex2 - vertex1)*((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        const real denominator(1. / (va + vb + vc));
+        return vertex0 + edge0*(vb*denominator) + edge1*(vc*denominator);
+    }
+
+    /**
+     * @brief sweepSphereTriangle intersects a sphere moving along a ray with a triangle: its face, its edges and its vertices.
+     * @param origin The start of the sphere-center.
+     * @param direction Has to be normalized.
+     * @param radius
+     * @param vertex0
+     * @param vertex1
+     * @param vertex2
+     * @param distance Gets set to the movement till the contact.
+     * @param contact Gets set to the contact on the triangle.
+     * @return false for no contact and degenerated triangles.
+     */
+    static bool sweepSphereTriangle(const vector3& origin, const vector3& direction, const real& radius,
+                                    const vector3& vertex0, const vector3& vertex1, const vector3& vertex2,
+                                    real& distance, vector3& contact)
+    {
+        const vector3 closest(calculateClosestPointOnTriangle(origin, vertex0, vertex1, vertex2));
+        if (closest.squaredDistance(origin) <= radius*radius)
+        {
+            distance = 0.;
+            contact = closest;
+            return true;
+        }
+        bool result(false);
+        distance = std::numeric_limits<real>::max();
+        // the face, moved by the radius towards the origin
+        const vector3 winding((vertex1 - vertex0).crossProduct(vertex2 - vertex0));
+        const real windingLength(winding.length());
+        if (windingLength <= 0.)
+        {
+            return false;
+        }
+        vector3 normal(winding / windingLength);
+        real side(normal.dotProduct(origin - vertex0));
+        if (side < 0.)
+        {
+            normal = -normal;
+            side = -side;
+        }
+        const vector3* const vertices[3] = {&vertex0, &vertex1, &vertex2};
+        const real approach(normal.dotProduct(direction));
+        // closer to the plane the sphere can only touch an edge or a vertex first
+        if (approach < 0. && side > radius)
+        {
+            const real face((side - radius) / -approach);
+            const vector3 onPlane(origin + direction*face - normal*radius);
+            bool inside(true);
+            for (int32 edge = 0; edge < 3 && inside; ++edge)
+            {
+                const vector3& begin(*vertices[edge]);
+                inside = (*vertices[(edge + 1) % 3] - begin).crossProduct(onPlane - begin).dotProduct(winding) >= 0.;
+            }
+            if (inside)
+            {
+                distance = face;
+                contact = onPlane;
+                return true;
+            }
+        }
+        // the edges as cylinders
+        for (int32 edge = 0; edge < 3; ++edge)
+        {
+            const vector3& begin(*vertices[edge]);
+            const vector3 along(*vertices[(edge + 1) % 3] - begin);
+            const vector3 toOrigin(origin - begin);
+            const real alongSquared(along.squaredLength());
+            const real alongDirection(along.dotProduct(direction));
+            const real alongOrigin(along.dotProduct(toOrigin));
+            const real a(alongSquared - alongDirection*alongDirection);
+            if (a <= 1e-12*alongSquared)
+            {
+                // parallel, the vertices get hit first
+                continue;
+            }
+            const real b(alongSquared*direction.dotProduct(toOrigin) - alongDirection*alongOrigin);
+            const real c(alongSquared*(toOrigin.squaredLength() - radius*radius) - alongOrigin*alongOrigin);
+            const real discriminant(b*b - a*c);
+            if (discriminant < 0.)
+            {
+                continue;
+            }
+            const real along0((-b - math::sqrt(discriminant)) / a);
+            if (along0 < 0. || along0 >= distance)
+            {
+                continue;
+            }
+            const real onEdge((alongOrigin + along0*alongDirection) / alongSquared);
+            if (onEdge < 0. || onEdge > 1.)
+            {
+                continue;
+            }
+            distance = along0;
+            contact = begin + along*onEdge;
+            result = true;
+        }
+        // the vertices as spheres
+        for (int32 vertex = 0; vertex < 3; ++vertex)
+        {
+            const vector3 toOrigin(origin - *vertices[vertex]);
+            const real b(toOrigin.dotProduct(direction));
+            const real c(toOrigin.squaredLength() - radius*radius);
+            const real discriminant(b*b - c);
+            if (discriminant < 0.)
+            {
+                continue;
+            }
+            const real along0(-b - math::sqrt(discriminant));
+            if (along0 < 0. || along0 >= distance)
+            {
+                continue;
+            }
+            distance = along0;
+            contact = *vertices[vertex];
+            result = true;
+        }
+        return result;
+    }
+
+protected:
+    /**
+     * @brief The t_bounds struct is an axis aligned box, invalid till extended by a point.
+     */
+    struct t_bounds
+    {
+        t_bounds()
+            : minimum(std::numeric_limits<real>::max())
+            , maximum(-std::numeric_limits<real>::max())
+        {
+            ;
+        }
+        void extend(const vector3& toExtend)
+        {
+            extend(toExtend, toExtend);
+        }
+        void extend(const t_bounds& toExtend)
+        {
+            extend(toExtend.minimum, toExtend.maximum);
+        }
+        void extend(const vector3& toExtendMinimum, const vector3& toExtendMaximum)
+        {
+            minimum.x = selectMinimum(minimum.x, toExtendMinimum.x);
+            minimum.y = selectMinimum(minimum.y, toExtendMinimum.y);
+            minimum.z = selectMinimum(minimum.z, toExtendMinimum.z);
+            maximum.x = selectMaximum(maximum.x, toExtendMaximum.x);
+            maximum.y = selectMaximum(maximum.y, toExtendMaximum.y);
+            maximum.z = selectMaximum(maximum.z, toExtendMaximum.z);
+        }
+        // by value, so the compiler doesn't branch like it does for vector3::makeFloor() and std::min() on members
+        static real selectMinimum(const real lhs, const real rhs)
+        {
+            return rhs < lhs ? rhs : lhs;
+        }
+        static real selectMaximum(const real lhs, const real rhs)
+        {
+            return rhs > lhs ? rhs : lhs;
+        }
+        real getHalfSurfaceArea() const
+        {
+            if (minimum.x > maximum.x)
+            {
+                return 0.;
+            }
+            const vector3 size(maximum - minimum);
+            return size.x*size.y + size.y*size.z + size.z*size.x;
+        }
+
+        vector3 minimum;
+        vector3 maximum;
+    };
+
+    struct t_reference
+    {
+        t_bounds bounds;
+        vector3 centroid;
+        uint32 triangle;
+    };
+
+    /**
+     * @brief The t_buildNode struct is a node of the binary tree, which gets collapsed after the build.
+     */
+    struct t_buildNode
+    {
+        t_bounds bounds;
+        // -1 for leafs
+        int32 children[2];
+        uint32 begin;
+        uint32 end;
+    };
+
+    /**
+     * @brief The t_node struct has up to 4 children, which are other nodes or leafs.
+     */
+    struct t_node
+    {
+        real minimum[3][4];
+        real maximum[3][4];
+        // index of a node, or the first triangle in m_triangles if numTriangles is larger zero. -1 for unused children.
+        int32 child[4];
+        int32 numTriangles[4];
+    };
+
+    // deeper the build splits in the middle, which bounds the depth and so the traversal-stack
+    static const int32 maxDepthHeuristic = 48;
+    static const int32 maxStack = 256;
+
+    int32 buildBinary(vector<t_reference>& references, const uint32& begin, const uint32& end, const int32& depth, vector<t_buildNode>& result)
+    {
+        const int32 index(result.size());
+        result.push_back(t_buildNode());
+        t_bounds bounds;
+        t_bounds centroids;
+        for (uint32 ind = begin; ind < end; ++ind)
+        {
+            bounds.extend(references[ind].bounds);
+            centroids.extend(references[ind].centroid);
+        }
+        result[index].bounds = bounds;
+        result[index].children[0] = -1;
+        result[index].children[1] = -1;
+        result[index].begin = begin;
+        result[index].end = end;
+
+        const uint32 numReferences(end - begin);
+        if (numReferences <= (uint32)maxTrianglesPerLeaf)
+        {
+            return index;
+        }
+
+        // surface area heuristic over binned centroids, cost in triangle-tests with a node-test costing one
+        int32 bestAxis(-1);
+        int32 bestBin(0);
+        real bestCost(std::numeric_limits<real>::max());
+        if (depth < maxDepthHeuristic)
+        {
+            // all axes get binned in one pass over the references
+            real scales[3];
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                const real extent(centroids.maximum[axis] - centroids.minimum[axis]);
+                scales[axis] = extent > 0. ? (real)numBins / extent : 0.;
+            }
+            t_bounds binBounds[3][numBins];
+            uint32 binCounts[3][numBins] = {{0}};
+            for (uint32 ind = begin; ind < end; ++ind)
+            {
+                const t_reference& work(references[ind]);
+                for (int32 axis = 0; axis < 3; ++axis)
+                {
+                    const int32 bin(calculateBin(work.centroid[axis], centroids.minimum[axis], scales[axis]));
+                    binBounds[axis][bin].extend(work.bounds);
+                    ++binCounts[axis][bin];
+                }
+            }
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                if (scales[axis] <= 0.)
+                {
+                    continue;
+                }
+                real areasRight[numBins];
+                uint32 countsRight[numBins];
+                t_bounds right;
+                uint32 countRight(0);
+                for (int32 bin = numBins - 1; bin > 0; --bin)
+                {
+                    right.extend(binBounds[axis][bin]);
+                    countRight += binCounts[axis][bin];
+                    areasRight[bin] = right.getHalfSurfaceArea();
+                    countsRight[bin] = countRight;
+                }
+                t_bounds left;
+                uint32 countLeft(0);
+                for (int32 bin = 1; bin < numBins; ++bin)
+                {
+                    left.extend(binBounds[axis][bin - 1]);
+                    countLeft += binCounts[axis][bin - 1];
+                    if (countLeft == 0 || countsRight[bin] == 0)
+                    {
+                        continue;
+                    }
+                    const real cost(left.getHalfSurfaceArea()*countLeft + areasRight[bin]*countsRight[bin]);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+        }
+        const real costLeaf(bounds.getHalfSurfaceArea()*numReferences);
+        const real costSplit(bounds.getHalfSurfaceArea() + bestCost);
+        if (numReferences <= (uint32)maxTrianglesPerLeaf && (bestAxis < 0 || costLeaf <= costSplit))
+        {
+            return index;
+        }
+
+        uint32 middle;
+        if (bestAxis < 0)
+        {
+            // equal centroids or too deep
+            middle = begin + numReferences / 2;
+            const int32 axis(calculateLongestAxis(centroids));
+            std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end,
+                             [axis] (const t_reference& lhs, const t_reference& rhs) {return lhs.centroid[axis] < rhs.centroid[axis];});
+        }
+        else
+        {
+            const real minimum(centroids.minimum[bestAxis]);
+            const real scale((real)numBins / (centroids.maximum[bestAxis] - minimum));
+            middle = std::partition(references.begin() + begin, references.begin() + end,
+                                    [bestAxis, bestBin, minimum, scale] (const t_reference& toTest)
+                                    {return calculateBin(toTest.centroid[bestAxis], minimum, scale) < bestBin;})
+                    - references.begin();
+        }
+        const int32 child0(buildBinary(references, begin, middle, depth + 1, result));
+        const int32 child1(buildBinary(references, middle, end, depth + 1, result));
+        result[index].children[0] = child0;
+        result[index].children[1] = child1;
+        return index;
+    }
+
+    static int32 calculateBin(const real& centroid, const real& minimum, const real& scale)
+    {
+        return math::min((int32)((centroid - minimum)*scale), numBins - 1);
+    }
+
+    static int32 calculateLongestAxis(const t_bounds& bounds)
+    {
+        const vector3 size(bounds.maximum - bounds.minimum);
+        if (size.x >= size.y && size.x >= size.z)
+        {
+            return 0;
+        }
+        return size.y >= size.z ? 1 : 2;
+    }
+
+    /**
+     * @brief collapse creates a node of up to 4 children by opening the binary node with the largest surface, till 4 are found.
+     * @return Index of the created node.
+     */
+    int32 collapse(const vector<t_buildNode>& buildNodes, const int32& buildIndex)
+    {
+        int32 children[4] = {buildIndex, -1, -1, -1};
+        int32 numChildren(1);
+        while (numChildren < 4)
+        {
+            int32 toOpen(-1);
+            real largest(-1.);
+            for (int32 ind = 0; ind < numChildren; ++ind)
+            {
+                const t_buildNode& work(buildNodes[children[ind]]);
+                if (work.children[0] >= 0 && work.bounds.getHalfSurfaceArea() > largest)
+                {
+                    largest = work.bounds.getHalfSurfaceArea();
+                    toOpen = ind;
+                }
+            }
+            if (toOpen < 0)
+            {
+                break;
+            }
+            const t_buildNode& opened(buildNodes[children[toOpen]]);
+            children[toOpen] = opened.children[0];
+            children[numChildren++] = opened.children[1];
+        }
+
+        const int32 result(m_nodes.size());
+        m_nodes.push_back(t_node());
+        for (int32 ind = 0; ind < 4; ++ind)
+        {
+            t_node& node(m_nodes[result]);
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                node.minimum[axis][ind] = std::numeric_limits<real>::max();
+                node.maximum[axis][ind] = -std::numeric_limits<real>::max();
+            }
+            node.child[ind] = -1;
+            node.numTriangles[ind] = 0;
+            if (ind >= numChildren)
+            {
+                continue;
+            }
+            const t_buildNode& work(buildNodes[children[ind]]);
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                node.minimum[axis][ind] = work.bounds.minimum[axis];
+                node.maximum[axis][ind] = work.bounds.maximum[axis];
+            }
+            if (work.children[0] < 0)
+            {
+                node.child[ind] = work.begin;
+                node.numTriangles[ind] = work.end - work.begin;
+                continue;
+            }
+            // m_nodes may reallocate
+            const int32 child(collapse(buildNodes, children[ind]));
+            m_nodes[result].child[ind] = child;
+        }
+        return result;
+    }
+
+    static vector3 calculateInverse(const vector3& direction)
+    {
+        vector3 result;
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            // a huge value instead of infinity keeps the slab test free of nan
+            result[axis] = 1. / (math::abs(direction[axis]) > 1e-20 ? direction[axis] : 1e-20);
+        }
+        return result;
+    }
+
+    /**
+     * @brief intersectBoxes sets the distance at which a ray enters each box of a node, grown by a margin. Max if the ray misses.
+     */
+    static void intersectBoxes(const t_node& node, const vector3& origin, const vector3& inverse, const real& margin, real distances[4])
+    {
+        for (int32 ind = 0; ind < 4; ++ind)
+        {
+            const real x0((node.minimum[0][ind] - margin - origin.x)*inverse.x);
+            const real x1((node.maximum[0][ind] + margin - origin.x)*inverse.x);
+            const real y0((node.minimum[1][ind] - margin - origin.y)*inverse.y);
+            const real y1((node.maximum[1][ind] + margin - origin.y)*inverse.y);
+            const real z0((node.minimum[2][ind] - margin - origin.z)*inverse.z);
+            const real z1((node.maximum[2][ind] + margin - origin.z)*inverse.z);
+            const real enter(std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), (real)0.)));
+            const real exit(std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1)));
+            distances[ind] = enter <= exit ? enter : std::numeric_limits<real>::max();
+        }
+    }
+
+    /**
+     * @brief calculateSquaredDistanceBoxes sets the squared distance of a position to each box of a node.
+     */
+    static void calculateSquaredDistanceBoxes(const t_node& node, const vector3& position, real distances[4])
+    {
+        for (int32 ind = 0; ind < 4; ++ind)
+        {
+            const real x(std::max(std::max(node.minimum[0][ind] - position.x, position.x - node.maximum[0][ind]), (real)0.));
+            const real y(std::max(std::max(node.minimum[1][ind] - position.y, position.y - node.maximum[1][ind]), (real)0.));
+            const real z(std::max(std::max(node.minimum[2][ind] - position.z, position.z - node.maximum[2][ind]), (real)0.));
+            distances[ind] = x*x + y*y + z*z;
+        }
+    }
+
+    /**
+     * @brief query visits the triangles whose boxes testBoxes() reports nearer than best, nearest box first.
+     * @param testBoxes Sets the distances of the 4 children of a node.
+     * @param testTriangle Gets called per triangle, may lower best.
+     * @param best Gets read after every triangle.
+     */
+    template <typename vertexType, typename indicesType, typename testBoxesType, typename testTriangleType>
+    void query(const vector<vertexType>& vertices, const indicesType& indices,
+               const testBoxesType& testBoxes, const testTriangleType& testTriangle, const real& best) const
+    {
+        if (m_nodes.empty())
+        {
+            for (uint32 index = 0; index + 2 < indices.size(); index += 3)
+            {
+                testTriangle(index, vertices[indices[index]].position, vertices[indices[index+1]].position, vertices[indices[index+2]].position);
+            }
+            return;
+        }
+        struct t_entry
+        {
+            int32 child;
+            int32 numTriangles;
+            real distance;
+        };
+        t_entry stack[maxStack];
+        int32 numStack(0);
+        stack[numStack++] = t_entry{0, 0, 0.};
+        while (numStack > 0)
+        {
+            const t_entry work(stack[--numStack]);
+            if (work.distance > best)
+            {
+                continue;
+            }
+            if (work.numTriangles > 0)
+            {
+                for (int32 ind = work.child; ind < work.child + work.numTriangles; ++ind)
+                {
+                    const uint32 index(m_triangles[ind]);
+                    testTriangle(index, vertices[indices[index]].position, vertices[indices[index+1]].position, vertices[indices[index+2]].position);
+                }
+                continue;
+            }
+            const t_node& node(m_nodes[work.child]);
+            real distances[4];
+            testBoxes(node, distances);
+            // the farthest child gets pushed first, so the nearest gets visited first
+            int32 order[4] = {0, 1, 2, 3};
+            std::sort(order, order + 4, [&distances] (const int32& lhs, const int32& rhs) {return distances[lhs] > distances[rhs];});
+            for (const int32& ind : order)
+            {
+                if (node.child[ind] < 0 || distances[ind] > best)
+                {
+                    continue;
+                }
+                BASSERT(numStack < maxStack);
+                stack[numStack++] = t_entry{node.child[ind], node.numTriangles[ind], distances[ind]};
+            }
+        }
+    }
+
+    vector<t_node> m_nodes;
+    // per leaf-triangle the index of its first vertex-index
+    vector<uint32> m_triangles;
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_BVH
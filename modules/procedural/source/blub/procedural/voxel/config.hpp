@@ -3,6 +3,7 @@
 
 #include "blub/procedural/predecl.hpp"
 #include "blub/procedural/voxel/data.hpp"
+#include "blub/procedural/voxel/indexBuffer.hpp"
 #include "blub/procedural/voxel/vertex.hpp"
 
 
@@ -20,7 +21,8 @@ public:
     typedef config t_config;
 
     typedef data t_data;
-    typedef uint16 t_index;
+    // selects 16 or 32 bit indices per tile, see tile::surface::getIndices()
+    typedef indexBuffer t_indices;
     typedef vertex t_vertex;
 
     static const int32 voxelsPerTile = 20; // means 20^3!
@@ -0,0 +1,468 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_DECIMATION
+#define BLUB_PROCEDURAL_VOXEL_DECIMATION
+
+#include "blub/core/globals.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/vector3.hpp"
+#include "blub/procedural/voxel/indexBuffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The decimation class simplifies a triangle list by edge collapses, ordered by their quadric error (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+ * A vertex collapses into a neighbour, so no new vertices get created. Collapses that would flip a triangle or make the mesh non-manifold get skipped.
+ * Works in passes: per pass every vertex collapses at most once, along its cheapest edge, and its neighbours wait for the next pass.
+ * Keeps its lists between calls, so reuse an instance per thread.
+ */
+class decimation
+{
+public:
+    /**
+     * @brief simplify collapses edges until every further collapse exceeds maxError. The remaining triangles get moved to the front of indices.
+     * Vertices of open edges, the border of the mesh, get locked in addition to locked. Collapses that would remove a triangle
+     * with two locked vertices get skipped, so the edges between locked vertices stay too.
+     * @param vertices Vertex-list, need a member position. Doesn't change.
+     * @param indices Triangle list, 3 per triangle. Degenerated triangles get removed.
+     * @param numIndices
+     * @param locked Per vertex of vertices, unequal 0 if the vertex may neither move nor vanish.
+     * @param maxError The error of a vertex is the sum of its squared distances to the planes of the triangles it replaced; may get at most maxError*maxError.
+     * In the units of the positions.
+     * @return The number of indices left.
+     */
+    template <typename vertexType, typename indexType>
+    uint32 simplify(const vector<vertexType>& vertices, indexType* indices, const uint32& numIndices, const vector<uint8>& locked, const real& maxError)
+    {
+        BASSERT(locked.size() >= vertices.size());
+        // local vertices, numbered by first use
+        m_triangles.clear();
+        m_vertices.clear();
+        m_localOfIndex.assign(vertices.size(), -1);
+        for (uint32 ind = 0; ind + 2 < numIndices; ind += 3)
+        {
+            if (indices[ind] == indices[ind + 1] || indices[ind + 1] == indices[ind + 2] || indices[ind] == indices[ind + 2])
+            {
+                continue;
+            }
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                const uint32 index(indices[ind + corner]);
+                if (m_localOfIndex[index] < 0)
+                {
+                    m_localOfIndex[index] = m_vertices.size();
+                    m_vertices.push_back(t_vertex());
+                    m_vertices.back().index = index;
+                    m_vertices.back().position = vertices[index].position;
+                    m_vertices.back().locked = locked[index] != 0;
+                }
+                m_triangles.push_back(m_localOfIndex[index]);
+            }
+        }
+        lockOpenEdges();
+
+        for (uint32 ind = 0; ind < m_triangles.size(); ind += 3)
+        {
+            const vector3& position0(m_vertices[m_triangles[ind]].position);
+            vector3 normal((m_vertices[m_triangles[ind + 1]].position - position0).crossProduct(m_vertices[m_triangles[ind + 2]].position - position0));
+            const real length(normal.length());
+            if (length <= 0.)
+            {
+                continue;
+            }
+            normal /= length;
+            t_quadric plane;
+            plane.setPlane(normal, -normal.dotProduct(position0));
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                m_vertices[m_triangles[ind + corner]].quadric += plane;
+            }
+        }
+
+        const double maxErrorSquared((double)maxError*(double)maxError);
+        for (;;)
+        {
+            if (collapsePass(maxErrorSquared) == 0)
+            {
+                break;
+            }
+        }
+
+        uint32 result(0);
+        for (uint32 ind = 0; ind < m_triangles.size(); ++ind)
+        {
+            indices[result++] = m_vertices[m_triangles[ind]].index;
+        }
+        return result;
+    }
+    /**
+     * @brief simplify simplifies an indexBuffer of any width and shrinks it to the remaining triangles.
+     * @param vertices
+     * @param indices
+     * @param locked
+     * @param maxError
+     */
+    template <typename vertexType>
+    void simplify(const vector<vertexType>& vertices, indexBuffer& indices, const vector<uint8>& locked, const real& maxError)
+    {
+        uint32 numIndices;
+        if (indices.getWidth() == indexBuffer::width::bits16)
+        {
+            numIndices = simplify(vertices, indices.getData16(), indices.size(), locked, maxError);
+        }
+        else
+        {
+            numIndices = simplify(vertices, indices.getData32(), indices.size(), locked, maxError);
+        }
+        indices.resize(numIndices);
+    }
+
+protected:
+    /**
+     * @brief The t_quadric struct is a symmetric 4x4 matrix, the sum of the squared distances to planes.
+     */
+    struct t_quadric
+    {
+        t_quadric()
+        {
+            std::fill(values, values + 10, 0.);
+        }
+
+        void setPlane(const vector3& normal, const real& distance)
+        {
+            const double plane[] = {normal.x, normal.y, normal.z, distance};
+            int32 value(0);
+            for (int32 row = 0; row < 4; ++row)
+            {
+                for (int32 column = row; column < 4; ++column)
+                {
+                    values[value++] = plane[row]*plane[column];
+                }
+            }
+        }
+        t_quadric& operator += (const t_quadric& other)
+        {
+            for (int32 value = 0; value < 10; ++value)
+            {
+                values[value] += other.values[value];
+            }
+            return *this;
+        }
+        double calculateError(const vector3& position) const
+        {
+            const double x(position.x), y(position.y), z(position.z);
+            return values[0]*x*x + 2.*values[1]*x*y + 2.*values[2]*x*z + 2.*values[3]*x
+                    + values[4]*y*y + 2.*values[5]*y*z + 2.*values[6]*y
+                    + values[7]*z*z + 2.*values[8]*z
+                    + values[9];
+        }
+
+        // upper triangle, row by row
+        double values[10];
+    };
+
+    struct t_vertex
+    {
+        t_vertex()
+            : index(0)
+            , locked(false)
+            , touched(false)
+            , changed(true)
+            , trianglesOffset(0)
+            , numTriangles(0)
+        {
+            ;
+        }
+
+        uint32 index;
+        vector3 position;
+        t_quadric quadric;
+        bool locked;
+        // collapsed or neighbour of a collapse in the current pass
+        bool touched;
+        // near a collapse of the last pass, so its cheapest edge may have changed
+        bool changed;
+        uint32 trianglesOffset;
+        uint32 numTriangles;
+    };
+
+    void lockOpenEdges()
+    {
+        // an edge used by one triangle only is open
+        m_edges.clear();
+        for (uint32 ind = 0; ind < m_triangles.size(); ind += 3)
+        {
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                const uint32 vertex0(m_triangles[ind + corner]);
+                const uint32 vertex1(m_triangles[ind + (corner + 1) % 3]);
+                m_edges.push_back(vertex0 < vertex1 ? ((uint64)vertex0 << 32) | vertex1 : ((uint64)vertex1 << 32) | vertex0);
+            }
+        }
+        std::sort(m_edges.begin(), m_edges.end());
+        for (uint32 ind = 0; ind < m_edges.size();)
+        {
+            uint32 end(ind + 1);
+            while (end < m_edges.size() && m_edges[end] == m_edges[ind])
+            {
+                ++end;
+            }
+            if (end - ind == 1)
+            {
+                m_vertices[(uint32)(m_edges[ind] >> 32)].locked = true;
+                m_vertices[(uint32)(m_edges[ind] & 0xffffffff)].locked = true;
+            }
+            ind = end;
+        }
+    }
+
+    /**
+     * @brief collapsePass collapses every vertex along its cheapest edge, if it doesn't exceed maxErrorSquared and the vertex didn't get touched by a collapse before in this pass.
+     * @return The number of collapses.
+     */
+    uint32 collapsePass(const double& maxErrorSquared)
+    {
+        // triangles per vertex
+        for (t_vertex& vertex : m_vertices)
+        {
+            vertex.numTriangles = 0;
+            vertex.touched = false;
+        }
+        for (const uint32& vertex : m_triangles)
+        {
+            ++m_vertices[vertex].numTriangles;
+        }
+        uint32 offset(0);
+        for (t_vertex& vertex : m_vertices)
+        {
+            vertex.trianglesOffset = offset;
+            offset += vertex.numTriangles;
+            vertex.numTriangles = 0;
+        }
+        m_vertexTriangles.resize(offset);
+        for (uint32 ind = 0; ind < m_triangles.size(); ++ind)
+        {
+            t_vertex& vertex(m_vertices[m_triangles[ind]]);
+            m_vertexTriangles[vertex.trianglesOffset + vertex.numTriangles++] = ind / 3;
+        }
+
+        // cheapest edge per vertex
+        m_collapses.clear();
+        for (uint32 from = 0; from < m_vertices.size(); ++from)
+        {
+            t_vertex& vertex(m_vertices[from]);
+            if (vertex.locked || vertex.numTriangles == 0 || !vertex.changed)
+            {
+                continue;
+            }
+            // neither the edges nor the quadrics around it change until a collapse nearby
+            vertex.changed = false;
+            double best(maxErrorSquared);
+            int32 bestTo(-1);
+            for (uint32 work = vertex.trianglesOffset; work < vertex.trianglesOffset + vertex.numTriangles; ++work)
+            {
+                const uint32 triangle(m_vertexTriangles[work]);
+                for (uint32 corner = 0; corner < 3; ++corner)
+                {
+                    const uint32 to(m_triangles[triangle*3 + corner]);
+                    if (to == from)
+                    {
+                        continue;
+                    }
+                    t_quadric sum(vertex.quadric);
+                    sum += m_vertices[to].quadric;
+                    const double error(sum.calculateError(m_vertices[to].position));
+                    if (error <= best)
+                    {
+                        best = error;
+                        bestTo = to;
+                    }
+                }
+            }
+            if (bestTo >= 0)
+            {
+                m_collapses.push_back(t_collapse(best, std::make_pair(from, (uint32)bestTo)));
+            }
+        }
+        std::sort(m_collapses.begin(), m_collapses.end());
+
+        m_remap.resize(m_vertices.size());
+        for (uint32 vertex = 0; vertex < m_vertices.size(); ++vertex)
+        {
+            m_remap[vertex] = vertex;
+        }
+        uint32 numCollapsed(0);
+        for (const t_collapse& work : m_collapses)
+        {
+            const uint32 from(work.second.first);
+            const uint32 to(work.second.second);
+            if (m_vertices[from].touched || m_vertices[to].touched || !isCollapseValid(from, to))
+            {
+                continue;
+            }
+            const t_vertex& vertex(m_vertices[from]);
+            for (uint32 triangle = vertex.trianglesOffset; triangle < vertex.trianglesOffset + vertex.numTriangles; ++triangle)
+            {
+                for (uint32 corner = 0; corner < 3; ++corner)
+                {
+                    m_vertices[m_triangles[m_vertexTriangles[triangle]*3 + corner]].touched = true;
+                }
+            }
+            m_vertices[to].quadric += m_vertices[from].quadric;
+            m_remap[from] = to;
+            ++numCollapsed;
+        }
+        if (numCollapsed == 0)
+        {
+            return 0;
+        }
+
+        // remove the triangles around the collapsed edges
+        uint32 numIndices(0);
+        for (uint32 ind = 0; ind < m_triangles.size(); ind += 3)
+        {
+            const uint32 vertex0(m_remap[m_triangles[ind]]);
+            const uint32 vertex1(m_remap[m_triangles[ind + 1]]);
+            const uint32 vertex2(m_remap[m_triangles[ind + 2]]);
+            if (vertex0 == vertex1 || vertex1 == vertex2 || vertex0 == vertex2)
+            {
+                continue;
+            }
+            if (m_vertices[vertex0].touched || m_vertices[vertex1].touched || m_vertices[vertex2].touched)
+            {
+                m_vertices[vertex0].changed = true;
+                m_vertices[vertex1].changed = true;
+                m_vertices[vertex2].changed = true;
+            }
+            m_triangles[numIndices++] = vertex0;
+            m_triangles[numIndices++] = vertex1;
+            m_triangles[numIndices++] = vertex2;
+        }
+        m_triangles.resize(numIndices);
+        return numCollapsed;
+    }
+
+    /**
+     * @brief isCollapseValid returns false if moving from onto to would flip or fold a triangle, make the mesh non-manifold or remove a triangle between locked vertices.
+     */
+    bool isCollapseValid(const uint32& from, const uint32& to)
+    {
+        const t_vertex& vertexFrom(m_vertices[from]);
+        const t_vertex& vertexTo(m_vertices[to]);
+        uint32 numShared(0);
+        m_neighbours.clear();
+        for (uint32 work = vertexFrom.trianglesOffset; work < vertexFrom.trianglesOffset + vertexFrom.numTriangles; ++work)
+        {
+            const uint32* triangle(&m_triangles[m_vertexTriangles[work]*3]);
+            bool containsTo(false);
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                if (triangle[corner] != from)
+                {
+                    m_neighbours.push_back(triangle[corner]);
+                }
+                containsTo |= triangle[corner] == to;
+            }
+            if (containsTo)
+            {
+                // gets removed
+                ++numShared;
+                for (uint32 corner = 0; corner < 3; ++corner)
+                {
+                    if (triangle[corner] != from && triangle[corner] != to && vertexTo.locked && m_vertices[triangle[corner]].locked)
+                    {
+                        return false;
+                    }
+                }
+                continue;
+            }
+            // the normal may not turn by more than about 75 degree
+            vector3 positions[3];
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                positions[corner] = m_vertices[triangle[corner]].position;
+            }
+            const vector3 normalBefore((positions[1] - positions[0]).crossProduct(positions[2] - positions[0]));
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                if (triangle[corner] == from)
+                {
+                    positions[corner] = vertexTo.position;
+                }
+            }
+            const vector3 normalAfter((positions[1] - positions[0]).crossProduct(positions[2] - positions[0]));
+            const real dot(normalBefore.dotProduct(normalAfter));
+            if (dot <= 0. || dot*dot <= 0.0625*normalBefore.squaredLength()*normalAfter.squaredLength())
+            {
+                return false;
+            }
+        }
+        // link condition, the only common neighbours are the third vertices of the removed triangles
+        std::sort(m_neighbours.begin(), m_neighbours.end());
+        m_neighbours.erase(std::unique(m_neighbours.begin(), m_neighbours.end()), m_neighbours.end());
+        m_neighboursTo.clear();
+        for (uint32 work = vertexTo.trianglesOffset; work < vertexTo.trianglesOffset + vertexTo.numTriangles; ++work)
+        {
+            const uint32* triangle(&m_triangles[m_vertexTriangles[work]*3]);
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                if (triangle[corner] != to && triangle[corner] != from)
+                {
+                    m_neighboursTo.push_back(triangle[corner]);
+                }
+            }
+        }
+        std::sort(m_neighboursTo.begin(), m_neighboursTo.end());
+        m_neighboursTo.erase(std::unique(m_neighboursTo.begin(), m_neighboursTo.end()), m_neighboursTo.end());
+        uint32 numCommon(0);
+        for (std::size_t ind0 = 0, ind1 = 0; ind0 < m_neighbours.size() && ind1 < m_neighboursTo.size();)
+        {
+            if (m_neighbours[ind0] < m_neighboursTo[ind1])
+            {
+                ++ind0;
+            }
+            else if (m_neighboursTo[ind1] < m_neighbours[ind0])
+            {
+                ++ind1;
+            }
+            else
+            {
+                ++numCommon;
+                ++ind0;
+                ++ind1;
+            }
+        }
+        return numCommon == numShared;
+    }
+
+    typedef std::pair<double, std::pair<uint32, uint32> > t_collapse;
+
+    vector<t_vertex> m_vertices;
+    // index to local vertex, -1 if none
+    vector<int32> m_localOfIndex;
+    // local vertices, 3 per triangle
+    vector<uint32> m_triangles;
+    vector<uint32> m_vertexTriangles;
+    vector<uint64> m_edges;
+    vector<t_collapse> m_collapses;
+    vector<uint32> m_remap;
+    vector<uint32> m_neighbours;
+    vector<uint32> m_neighboursTo;
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_DECIMATION
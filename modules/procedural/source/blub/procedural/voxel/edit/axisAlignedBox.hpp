@@ -75,6 +75,28 @@ protected:
                                     m_aab.getMaximum()*trans.scale + trans.position);
     }
 
+    /**
+     * @brief calculateTileState returns full if all voxel of the tile are inside the box.
+     * @see base::calculateTileState()
+     */
+    simple::container::utils::tileState calculateTileState(const vector3int32& voxelContainerOffset, const transform& trans) const override
+    {
+        const simple::container::utils::tileState result(t_base::calculateTileState(voxelContainerOffset, trans));
+        if (result != simple::container::utils::tileState::partitial)
+        {
+            return result;
+        }
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const vector3 tileMinimum(voxelContainerOffset*voxelsPerTile);
+        const vector3 tileMaximum(tileMinimum + vector3(voxelsPerTile-1));
+        if (m_aab.contains((tileMinimum - trans.position) / trans.scale) &&
+            m_aab.contains((tileMaximum - trans.position) / trans.scale))
+        {
+            return simple::container::utils::tileState::full;
+        }
+        return result;
+    }
+
     /**
      * @brief checks if voxel is inside aab
      * @param pos describes the voxel-position
@@ -94,6 +116,35 @@ protected:
         }
     }
 
+    /**
+     * @brief calculateVoxelRow same as calculateOneVoxel() but for a whole row. Checks x and y only once per row.
+     * @see base::calculateVoxelRow()
+     */
+    void calculateVoxelRow(const real& posX,
+                           const real& posY,
+                           const real* posZ,
+                           const int32& count,
+                           t_voxel* resultVoxel,
+                           bool* resultChanged) const override
+    {
+        const vector3 &minimum(m_aab.getMinimum());
+        const vector3 &maximum(m_aab.getMaximum());
+        const bool rowInside(minimum.x <= posX && posX <= maximum.x &&
+                             minimum.y <= posY && posY <= maximum.y);
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            resultChanged[ind] = rowInside && minimum.z <= posZ[ind] && posZ[ind] <= maximum.z;
+        }
+        if (!rowInside)
+        {
+            return;
+        }
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            resultVoxel[ind].setInterpolationMax();
+        }
+    }
+
 private:
     /**
      * @brief see create()
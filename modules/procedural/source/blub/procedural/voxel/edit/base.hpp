@@ -62,6 +62,7 @@ public:
     /**
      * @brief calculates all voxel in getAxisAlignedBoundingBox() and inserts them into voxelContainer.
      * Method gets called once per tile from various threads.
+     * The voxel get clipped to getAxisAlignedBoundingBox() before calculation and get calculated row by row using calculateVoxelRow().
      * Voxel only will get set if the interpolation is higher than the inerpoaltion before calculation.
      * @param voxelContainer The container where the voxel have to get set in.
      * @param voxelContainerOffset The absolut offset of the container
@@ -75,34 +76,43 @@ public:
         BLUB_PROCEDURAL_LOG_OUT() << "calculateVoxel trans:" << trans;
 #endif
 
-        const blub::axisAlignedBox aabb(getAxisAlignedBoundingBox(trans));
+        vector3int32 voxelStart;
+        vector3int32 voxelEnd;
+        if (!calculateVoxelBoundsInTile(getAxisAlignedBoundingBox(trans), voxelContainerOffset, voxelStart, voxelEnd))
+        {
+            return;
+        }
 
         const int32 voxelsPerTile(t_config::voxelsPerTile);
         const vector3int32 posContainerAbsolut(voxelContainerOffset*voxelsPerTile);
-        for (int32 indX = 0; indX < t_config::voxelsPerTile; ++indX)
-        {
-            for (int32 indY = 0; indY < t_config::voxelsPerTile; ++indY)
-            {
-                for (int32 indZ = 0; indZ < t_config::voxelsPerTile; ++indZ)
-                {
-                    const vector3int32 posVoxel(indX, indY, indZ);
-                    vector3 posAbsolut(posContainerAbsolut + posVoxel);
+        const int32 rowLength(voxelEnd.z - voxelStart.z);
 
-                    if (!aabb.contains(posAbsolut))
-                    {
-                        continue;
-                    }
+        // the z-positions are the same for every row - transform them once per tile.
+        real rowPosZ[voxelsPerTile];
+        for (int32 indZ = 0; indZ < rowLength; ++indZ)
+        {
+            rowPosZ[indZ] = (static_cast<real>(posContainerAbsolut.z + voxelStart.z + indZ) - trans.position.z) / trans.scale.z;
+        }
 
-                    posAbsolut -= trans.position;
-                    posAbsolut /= trans.scale;
+        t_voxel rowVoxel[voxelsPerTile];
+        bool rowChange[voxelsPerTile];
+        for (int32 indX = voxelStart.x; indX < voxelEnd.x; ++indX)
+        {
+            const real posX((static_cast<real>(posContainerAbsolut.x + indX) - trans.position.x) / trans.scale.x);
+            for (int32 indY = voxelStart.y; indY < voxelEnd.y; ++indY)
+            {
+                const real posY((static_cast<real>(posContainerAbsolut.y + indY) - trans.position.y) / trans.scale.y);
 
-                    t_voxel voxelResult;
-                    const bool changeVoxel(calculateOneVoxel(posAbsolut, &voxelResult));
+                calculateVoxelRow(posX, posY, rowPosZ, rowLength, rowVoxel, rowChange);
 
-                    if (!changeVoxel)
+                for (int32 indZ = 0; indZ < rowLength; ++indZ)
+                {
+                    if (!rowChange[indZ])
                     {
                         continue;
                     }
+                    const vector3int32 posVoxel(indX, indY, voxelStart.z + indZ);
+                    t_voxel &voxelResult(rowVoxel[indZ]);
                     if (!m_cut)
                     {
                         voxelContainer->setVoxelIfInterpolationHigher(posVoxel, voxelResult);
@@ -157,6 +167,25 @@ public:
      */
     virtual blub::axisAlignedBox getAxisAlignedBoundingBox(const transform& trans) const = 0;
 
+    /**
+     * @brief calculateTileState classifies a tile without calculating its voxel, as if the edit gets applied to an empty tile.
+     * Used by simple::container::generated to skip the calculation of homogeneous tiles.
+     * Override it if your edit knows cheaply that a tile gets completely filled.
+     * @param voxelContainerOffset The tile id.
+     * @param trans The transform.
+     * @return empty or full if all voxel of the tile will be minimum or maximum, partitial if the tile has to get calculated.
+     */
+    virtual simple::container::utils::tileState calculateTileState(const vector3int32& voxelContainerOffset, const transform& trans) const
+    {
+        vector3int32 voxelStart;
+        vector3int32 voxelEnd;
+        if (m_cut || !calculateVoxelBoundsInTile(getAxisAlignedBoundingBox(trans), voxelContainerOffset, voxelStart, voxelEnd))
+        {
+            return simple::container::utils::tileState::empty;
+        }
+        return simple::container::utils::tileState::partitial;
+    }
+
 protected:
     base()
         : m_voxelContainer(nullptr)
@@ -175,6 +204,63 @@ protected:
         return false;
     }
 
+    /**
+     * @brief Override this method for a faster, row-wise calculation of your edit. Gets called by calculateVoxel() for every row along the z-axis inside getAxisAlignedBoundingBox().
+     * The default implementation calls calculateOneVoxel() for every voxel of the row.
+     * Write the loops over the arrays without branches where possible, so the compiler is able to vectorize them.
+     * @param posX Transformed x-position of the row.
+     * @param posY Transformed y-position of the row.
+     * @param posZ Array of count transformed z-positions.
+     * @param count Number of voxel in the row. At most t_config::voxelsPerTile.
+     * @param resultVoxel Array of count voxel. Set the calculated values in here.
+     * @param resultChanged Array of count flags. Set true for every voxel a value could get calculated for, else false.
+     */
+    virtual void calculateVoxelRow(const real& posX,
+                                   const real& posY,
+                                   const real* posZ,
+                                   const int32& count,
+                                   t_voxel* resultVoxel,
+                                   bool* resultChanged) const
+    {
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            resultChanged[ind] = calculateOneVoxel(vector3(posX, posY, posZ[ind]), &resultVoxel[ind]);
+        }
+    }
+
+    /**
+     * @brief calculateVoxelBoundsInTile clips an absolute axisAlignedBox to the voxel of a tile.
+     * @param aabb Absolute bounds, for example the result of getAxisAlignedBoundingBox().
+     * @param voxelContainerOffset The tile id.
+     * @param startResult First local voxel inside aabb.
+     * @param endResult Local voxel behind the last one inside aabb.
+     * @return false if no voxel of the tile is inside aabb.
+     */
+    static bool calculateVoxelBoundsInTile(const blub::axisAlignedBox& aabb,
+                                           const vector3int32& voxelContainerOffset,
+                                           vector3int32& startResult,
+                                           vector3int32& endResult)
+    {
+        if (aabb.isNull())
+        {
+            return false;
+        }
+
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const vector3 posContainerAbsolut(voxelContainerOffset*voxelsPerTile);
+        const vector3 minimum(aabb.getMinimum() - posContainerAbsolut);
+        const vector3 maximum(aabb.getMaximum() - posContainerAbsolut);
+
+        startResult = vector3int32(math::clamp<real>(math::ceil(minimum.x), 0., voxelsPerTile),
+                                   math::clamp<real>(math::ceil(minimum.y), 0., voxelsPerTile),
+                                   math::clamp<real>(math::ceil(minimum.z), 0., voxelsPerTile));
+        endResult = vector3int32(math::clamp<real>(math::floor(maximum.x) + 1., 0., voxelsPerTile),
+                                 math::clamp<real>(math::floor(maximum.y) + 1., 0., voxelsPerTile),
+                                 math::clamp<real>(math::floor(maximum.z) + 1., 0., voxelsPerTile));
+
+        return startResult < endResult;
+    }
+
     /**
      * @brief The axis enum is used by createLine() for describing the direction.
      */
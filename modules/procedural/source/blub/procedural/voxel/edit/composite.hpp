@@ -0,0 +1,332 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_EDIT_COMPOSITE_HPP
+#define BLUB_PROCEDURAL_VOXEL_EDIT_COMPOSITE_HPP
+
+#include "blub/core/sharedPointer.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/axisAlignedBox.hpp"
+#include "blub/math/axisAlignedBoxInt32.hpp"
+#include "blub/math/transform.hpp"
+#include "blub/procedural/voxel/edit/base.hpp"
+
+#include <algorithm>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+namespace edit
+{
+
+
+/**
+ * @brief The composite class applies an ordered list of edits in one pass per tile.
+ * Instead of calling simple::container::base::editVoxel() once per primitive, and so visiting every affected tile once per primitive,
+ * every affected tile gets visited once for the whole list. A bounding volume hierarchy over the bounding boxes of the primitives
+ * makes sure only the primitives overlapping a tile get calculated for it.
+ * The primitives get applied in order of the list, so a subtract only affects the primitives before it.
+ * The operation of a primitive decides if it adds or removes voxel, the edits don't get changed. So an edit can be used by several primitives
+ * and other edits at the same time.
+ * The bounding box of a primitive has to scale and move with its transform, like the ones of all edits in this namespace do.
+ */
+template <class configType>
+class composite : public base<configType>
+{
+public:
+    typedef configType t_config;
+    typedef base<t_config> t_base;
+    typedef sharedPointer<composite> pointer;
+    typedef typename t_base::pointer t_editPtr;
+    typedef typename t_base::t_voxelContainerTile t_voxelContainerTile;
+    typedef typename t_base::t_voxel t_voxel;
+
+    /**
+     * @brief The operation enum describes how a primitive gets combined with the primitives before it.
+     */
+    enum class operation
+    {
+        unite,
+        subtract
+    };
+
+    /**
+     * @brief The primitive struct describes one entry of the list.
+     */
+    struct primitive
+    {
+        primitive(t_editPtr edit_ = t_editPtr(), const blub::transform& trans_ = blub::transform(), const operation& op_ = operation::unite)
+            : edit(edit_)
+            , trans(trans_)
+            , op(op_)
+        {
+            ;
+        }
+
+        t_editPtr edit;
+        blub::transform trans;
+        operation op;
+    };
+    typedef vector<primitive> t_primitives;
+
+    /**
+     * @brief creates an instance of the class and returns it as shared_ptr<>
+     * @param primitives The ordered list of primitives. Every edit must not be nullptr and must not cut, see base::setCut().
+     * @return An instance of the class as shared_ptr<>
+     */
+    static pointer create(const t_primitives& primitives)
+    {
+        return pointer(new composite(primitives));
+    }
+    /**
+     * @brief ~composite destructor
+     */
+    virtual ~composite()
+    {
+        ;
+    }
+
+    /**
+     * @brief getAxisAlignedBoundingBox returns the transformed bounding box including all primitives.
+     * @param trans Transform of the whole list. Rotation gets ignored.
+     * @return
+     */
+    blub::axisAlignedBox getAxisAlignedBoundingBox(const transform& trans) const override
+    {
+        if (m_nodes.empty())
+        {
+            return blub::axisAlignedBox();
+        }
+        const blub::axisAlignedBox &aabb(m_nodes[0].aabb);
+        return blub::axisAlignedBox(aabb.getMinimum()*trans.scale + trans.position,
+                                    aabb.getMaximum()*trans.scale + trans.position);
+    }
+
+    /**
+     * @brief calculateVoxel looks up the primitives overlapping the tile and calculates them in order of the list.
+     * A subtract gets calculated into an empty tile of the thread first, which then gets removed from voxelContainer.
+     * @param voxelContainer The container where the voxel have to get set in.
+     * @param voxelContainerOffset The absolut offset of the container
+     * @param trans Transform of the whole list. Gets applied on top of the transform of every primitive. Rotation gets ignored.
+     */
+    void calculateVoxel(t_voxelContainerTile* voxelContainer,
+                        const vector3int32& voxelContainerOffset,
+                        const transform& trans) const override
+    {
+        if (m_nodes.empty())
+        {
+            return;
+        }
+
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const vector3 tileMinimum(voxelContainerOffset*voxelsPerTile);
+        const vector3 tileMaximum(tileMinimum + vector3(voxelsPerTile-1));
+        const blub::axisAlignedBox tileLocal((tileMinimum - trans.position) / trans.scale,
+                                             (tileMaximum - trans.position) / trans.scale);
+
+        vector<uint32> found;
+        found.reserve(16);
+        findPrimitives(tileLocal, found);
+        // keep the order of the list
+        std::sort(found.begin(), found.end());
+
+        for (const uint32& ind : found)
+        {
+            const primitive &work(m_primitives[ind]);
+            const blub::transform transWork(work.trans.position*trans.scale + trans.position,
+                                            work.trans.rotation,
+                                            work.trans.scale*trans.scale);
+            if (work.op == operation::unite)
+            {
+                work.edit->calculateVoxel(voxelContainer, voxelContainerOffset, transWork);
+                continue;
+            }
+            subtract(work.edit, voxelContainer, voxelContainerOffset, transWork);
+        }
+    }
+
+protected:
+    /**
+     * @brief The node struct is a node of the bounding volume hierarchy. Leafs have count > 0 and reference the primitives m_indices[first] to m_indices[first+count-1].
+     * Inner nodes have count == 0, their first child is the next node, the second child is at first.
+     */
+    struct node
+    {
+        blub::axisAlignedBox aabb;
+        uint32 first;
+        uint32 count;
+    };
+    typedef vector<node> t_nodes;
+
+    /**
+     * @brief composite constructor - same as create()
+     */
+    composite(const t_primitives& primitives)
+        : m_primitives(primitives)
+    {
+        m_bounds.reserve(m_primitives.size());
+        m_indices.reserve(m_primitives.size());
+        for (uint32 ind = 0; ind < m_primitives.size(); ++ind)
+        {
+            const primitive &work(m_primitives[ind]);
+            BASSERT(!work.edit.isNull());
+            BASSERT(!work.edit->getCut());
+
+            m_bounds.push_back(work.edit->getAxisAlignedBoundingBox(work.trans));
+            m_indices.push_back(ind);
+        }
+        if (!m_indices.empty())
+        {
+            m_nodes.reserve(m_indices.size()*2);
+            buildNode(0, m_indices.size());
+        }
+    }
+
+    /**
+     * @brief buildNode builds the hierarchy recursively by splitting the primitives at the median of their centers along the longest axis.
+     * @param first First index in m_indices.
+     * @param count Number of indices.
+     * @return Index of the created node.
+     */
+    uint32 buildNode(const uint32& first, const uint32& count)
+    {
+        const uint32 result(m_nodes.size());
+        m_nodes.push_back(node());
+
+        blub::axisAlignedBox aabb;
+        for (uint32 ind = first; ind < first + count; ++ind)
+        {
+            aabb.merge(m_bounds[m_indices[ind]]);
+        }
+        m_nodes[result].aabb = aabb;
+
+        if (count <= maxPrimitivesPerLeaf)
+        {
+            m_nodes[result].first = first;
+            m_nodes[result].count = count;
+            return result;
+        }
+
+        const vector3 size(aabb.getSize());
+        int32 axis(0);
+        if (size.y > size[axis])
+        {
+            axis = 1;
+        }
+        if (size.z > size[axis])
+        {
+            axis = 2;
+        }
+        const uint32 half(count / 2);
+        std::nth_element(m_indices.begin() + first, m_indices.begin() + first + half, m_indices.begin() + first + count,
+                         [this, axis] (const uint32& lhs, const uint32& rhs)
+        {
+            return m_bounds[lhs].getCenter()[axis] < m_bounds[rhs].getCenter()[axis];
+        });
+
+        buildNode(first, half);
+        const uint32 second(buildNode(first + half, count - half));
+        m_nodes[result].first = second;
+        m_nodes[result].count = 0;
+
+        return result;
+    }
+
+    /**
+     * @brief findPrimitives collects the indices of all primitives whose bounding box intersects aabb.
+     * @param aabb Bounds to test against, untransformed.
+     * @param result The indices get added here. Unsorted.
+     */
+    void findPrimitives(const blub::axisAlignedBox& aabb, vector<uint32>& result) const
+    {
+        uint32 stack[64];
+        int32 stackSize(0);
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const node &work(m_nodes[stack[--stackSize]]);
+            if (!work.aabb.intersects(aabb))
+            {
+                continue;
+            }
+            if (work.count > 0)
+            {
+                for (uint32 ind = work.first; ind < work.first + work.count; ++ind)
+                {
+                    if (m_bounds[m_indices[ind]].intersects(aabb))
+                    {
+                        result.push_back(m_indices[ind]);
+                    }
+                }
+                continue;
+            }
+            BASSERT(stackSize + 2 <= 64);
+            stack[stackSize++] = work.first;
+            stack[stackSize++] = (&work - &m_nodes[0]) + 1;
+        }
+    }
+
+    /**
+     * @brief subtract calculates an edit into the empty tile of the thread and removes every voxel it set from voxelContainer,
+     * the same way base::calculateVoxel() does for a cutting edit. Empties the changed voxel of the tile again afterwards.
+     * @param toSubtract
+     * @param voxelContainer
+     * @param voxelContainerOffset
+     * @param trans Transform of the primitive.
+     */
+    static void subtract(const t_editPtr& toSubtract,
+                         t_voxelContainerTile* voxelContainer,
+                         const vector3int32& voxelContainerOffset,
+                         const transform& trans)
+    {
+        t_voxelContainerTile &scratch(getScratch());
+        BASSERT(scratch.isEmpty());
+        scratch.startEdit();
+        toSubtract->calculateVoxel(&scratch, voxelContainerOffset, trans);
+
+        const axisAlignedBoxInt32 &changed(scratch.getEditedVoxelBoundingBox());
+        for (int32 indX = changed.getMinimum().x; indX <= changed.getMaximum().x; ++indX)
+        {
+            for (int32 indY = changed.getMinimum().y; indY <= changed.getMaximum().y; ++indY)
+            {
+                for (int32 indZ = changed.getMinimum().z; indZ <= changed.getMaximum().z; ++indZ)
+                {
+                    const vector3int32 posVoxel(indX, indY, indZ);
+                    t_voxel toSet(scratch.getVoxel(posVoxel));
+                    toSet.getInterpolation() *= -1;
+                    // voxel the edit didn't set stay minimum and so maximum here, which never is lower
+                    voxelContainer->setVoxelIfInterpolationLower(posVoxel, toSet);
+                    scratch.setVoxel(posVoxel, t_voxel());
+                }
+            }
+        }
+        scratch.endEdit();
+    }
+    /**
+     * @brief getScratch returns the empty tile subtract() calculates in. One instance per thread, reused for every tile.
+     * @return
+     */
+    static t_voxelContainerTile& getScratch()
+    {
+        static thread_local typename t_voxelContainerTile::pointer result(t_voxelContainerTile::create());
+        return *result;
+    }
+
+    static const uint32 maxPrimitivesPerLeaf = 4;
+
+    t_primitives m_primitives;
+    vector<blub::axisAlignedBox> m_bounds;
+    vector<uint32> m_indices;
+    t_nodes m_nodes;
+
+};
+
+
+}
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_EDIT_COMPOSITE_HPP
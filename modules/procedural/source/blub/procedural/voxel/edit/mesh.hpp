@@ -15,6 +15,7 @@
 #include "blub/procedural/voxel/edit/base.hpp"
 #include "blub/procedural/voxel/tile/container.hpp"
 
+#include <algorithm>
 #include <utility>
 
 #ifdef BLUB_USE_ASSIMP
@@ -43,8 +44,8 @@ namespace edit
 
 
 /**
- * @brief convertes a mesh to voxel. Fills a boost::geometry::index::rtree with the polygons.
- * Initialization O(numTriangles). Voxel-generation O(numVoxel)
+ * @brief convertes a closed mesh to voxel. Fills a boost::geometry::index::rtree with the polygons.
+ * Initialization O(numTriangles*log(numTriangles)). Voxel-generation per tile O(numVoxel + numTrianglesInTile).
  */
 template <class voxelType>
 class mesh : public base<voxelType>
@@ -61,6 +62,7 @@ public:
     typedef boost::geometry::model::segment<t_point> t_segment;
     typedef std::pair<t_box, triangleVector3> t_value;
     typedef boost::geometry::index::rtree<t_value, boost::geometry::index::quadratic<16> > t_tree;
+    typedef vector<triangleVector3> t_triangles;
 
     /**
      * @brief creates an instance of the class.
@@ -154,9 +156,6 @@ public:
             return false;
         }
 
-        t_tree *tree = new t_tree();
-        m_trees.push_back(tree);
-
         t_positions positions;
         positions.resize(mesh.mNumVertices);
         for (blub::uint32 indVertex = 0; indVertex < mesh.mNumVertices; ++indVertex)
@@ -165,8 +164,9 @@ public:
             vector3 casted(posToCast.x, posToCast.y, posToCast.z);
             casted *= trans.scale;
             positions[indVertex] = casted;
-            m_aabb.merge(casted);
         }
+        t_triangles triangles;
+        triangles.reserve(mesh.mNumFaces);
         for (blub::uint32 indFace = 0; indFace < mesh.mNumFaces; ++indFace)
         {
             const aiFace &faceToCast(mesh.mFaces[indFace]);
@@ -176,20 +176,39 @@ public:
 				BLUB_PROCEDURAL_LOG_WARNING() << "faceToCast.mNumIndices != 3";
                 continue;
             }
-            const triangleVector3 resultTriangle(   positions[faceToCast.mIndices[0]],
-                                                    positions[faceToCast.mIndices[1]],
-                                                    positions[faceToCast.mIndices[2]]);
+            triangles.push_back(triangleVector3(positions[faceToCast.mIndices[0]],
+                                                positions[faceToCast.mIndices[1]],
+                                                positions[faceToCast.mIndices[2]]));
+        }
+
+        return addTriangles(triangles);
+    }
+#endif
+
+    /**
+     * @brief adds a closed mesh. Every call adds a mesh, which gets voxelised independent of the others.
+     * @param triangles Triangles of the mesh, already transformed.
+     * @return true if at least one triangle got added
+     */
+    bool addTriangles(const t_triangles &triangles)
+    {
+        t_tree *tree = new t_tree();
+        m_trees.push_back(tree);
+
+        for (typename t_triangles::const_iterator it = triangles.cbegin(); it != triangles.cend(); ++it)
+        {
+            const triangleVector3 &resultTriangle(*it);
 
             const blub::axisAlignedBox &aabb(resultTriangle.getAxisAlignedBoundingBox());
             const blub::vector3 &aabbMin(aabb.getMinimum());
             const blub::vector3 &aabbMax(aabb.getMaximum());
+            m_aabb.merge(aabb);
             t_box toInsert(t_point(aabbMin.x, aabbMin.y, aabbMin.z), t_point(aabbMax.x, aabbMax.y, aabbMax.z));
             tree->insert(std::make_pair(toInsert, resultTriangle));
         }
 
         return !tree->empty();
     }
-#endif
 
 protected:
     /**
@@ -207,150 +226,214 @@ protected:
      */
     blub::axisAlignedBox getAxisAlignedBoundingBox(const transform &trans) const override
     {
-        BLUB_LOG_OUT() << "trans:" << trans;
-
         return blub::axisAlignedBox(m_aabb.getMinimum()*trans.scale + trans.position,
                                     m_aabb.getMaximum()*trans.scale + trans.position);
     }
 
     /**
-     * @brief calculateVoxel The tree, which got generated in load() gets intersected for every voxel line.
+     * @brief calculateVoxel voxelises the meshes added by addTriangles() by casting a row of rays per axis through the tile.
+     * The triangles that may cut the tile get queried once per tile and axis from the tree.
+     * Every triangle then gets projected along the axis and tested against all rays inside its projected bounds using a 2d point-in-triangle test.
+     * The hits get sorted once per tile and axis. Every pair of hits of a ray gets filled using createLine().
+     * Points exactly on an edge shared by two triangles only hit one of them (top-left fill rule).
      * @param voxelContainer Container where to set the voxel in.
      * @param voxelContainerOffset Absolut position of the voxelContainer.
      * @param trans Transform
      */
     void calculateVoxel(t_tileContainer *voxelContainer, const vector3int32 &voxelContainerOffset, const transform &/*trans*/) const
     {
-        const vector3int32 posContainerAbsolut(voxelContainerOffset*t_tileContainer::voxelLength);
-
-        vector3int32 toLoop[] = {{1, t_tileContainer::voxelLength, t_tileContainer::voxelLength},
-                                 {t_tileContainer::voxelLength, 1, t_tileContainer::voxelLength},
-                                 {t_tileContainer::voxelLength, t_tileContainer::voxelLength, 1}
-                                };
-        vector3 rayDir[] = {{1., 0., 0.},
-                            {0., 1., 0.},
-                            {0., 0., 1.}};
+        const int32 voxelLength(t_tileContainer::voxelLength);
+        const vector3int32 posContainerAbsolut(voxelContainerOffset*voxelLength);
+        const vector3 &meshMinimum(m_aabb.getMinimum());
+        const vector3 &meshMaximum(m_aabb.getMaximum());
+
+        t_scratch &scratch(getScratch());
+
         for (uint32 indMesh = 0; indMesh < m_trees.size(); ++indMesh)
         {
-            t_tree *tree(static_cast<t_tree*>(m_trees[indMesh]));
+            const t_tree *tree(m_trees[indMesh]);
             for (int32 indAxis = 0; indAxis < 3; ++indAxis)
             {
-                for (int32 indX = 0; indX < toLoop[indAxis].x; ++indX)
+                // u and v span the plane the rays start in
+                const int32 axisU((indAxis+1)%3);
+                const int32 axisV((indAxis+2)%3);
+                const real tileU(posContainerAbsolut[axisU]);
+                const real tileV(posContainerAbsolut[axisV]);
+                const real tileAxis(posContainerAbsolut[indAxis]);
+
+                vector3 queryMinimum(meshMinimum);
+                vector3 queryMaximum(meshMaximum);
+                queryMinimum[axisU] = tileU;
+                queryMinimum[axisV] = tileV;
+                queryMaximum[axisU] = tileU + static_cast<real>(voxelLength-1);
+                queryMaximum[axisV] = tileV + static_cast<real>(voxelLength-1);
+                const t_box query(t_point(queryMinimum.x, queryMinimum.y, queryMinimum.z),
+                                  t_point(queryMaximum.x, queryMaximum.y, queryMaximum.z));
+
+                scratch.triangles.clear();
+                tree->query(boost::geometry::index::intersects(query), std::back_inserter(scratch.triangles));
+                if (scratch.triangles.empty())
+                {
+                    continue;
+                }
+
+                scratch.hits.clear();
+                for (uint32 indTriangle = 0; indTriangle < scratch.triangles.size(); ++indTriangle)
                 {
-                    for (int32 indY = 0; indY < toLoop[indAxis].y; ++indY)
+                    const triangleVector3 &triangleWork(scratch.triangles[indTriangle].second);
+                    real posU[3];
+                    real posV[3];
+                    real depth[3];
+                    for (int32 indPoint = 0; indPoint < 3; ++indPoint)
+                    {
+                        posU[indPoint] = triangleWork.positions[indPoint][axisU] - tileU;
+                        posV[indPoint] = triangleWork.positions[indPoint][axisV] - tileV;
+                        depth[indPoint] = triangleWork.positions[indPoint][indAxis] - tileAxis;
+                    }
+                    real area(edgeFunction(posU[0], posV[0], posU[1], posV[1], posU[2], posV[2]));
+                    if (area == 0.)
                     {
-                        for (int32 indZ = 0; indZ < toLoop[indAxis].z; ++indZ)
+                        // parallel to the rays
+                        continue;
+                    }
+                    if (area < 0.)
+                    {
+                        std::swap(posU[1], posU[2]);
+                        std::swap(posV[1], posV[2]);
+                        std::swap(depth[1], depth[2]);
+                    }
+                    const bool owns0(ownsEdge(posU[1], posV[1], posU[2], posV[2]));
+                    const bool owns1(ownsEdge(posU[2], posV[2], posU[0], posV[0]));
+                    const bool owns2(ownsEdge(posU[0], posV[0], posU[1], posV[1]));
+
+                    const int32 startU(math::clamp<real>(math::ceil(std::min(std::min(posU[0], posU[1]), posU[2])), 0., voxelLength));
+                    const int32 startV(math::clamp<real>(math::ceil(std::min(std::min(posV[0], posV[1]), posV[2])), 0., voxelLength));
+                    const int32 endU(math::clamp<real>(math::floor(std::max(std::max(posU[0], posU[1]), posU[2])) + 1., 0., voxelLength));
+                    const int32 endV(math::clamp<real>(math::floor(std::max(std::max(posV[0], posV[1]), posV[2])) + 1., 0., voxelLength));
+                    for (int32 indU = startU; indU < endU; ++indU)
+                    {
+                        for (int32 indV = startV; indV < endV; ++indV)
                         {
-                            const vector3int32 posVoxel(indX, indY, indZ);
-                            vector3 posAbsolut(posContainerAbsolut + posVoxel);
-
-                            // posAbsolut = posAbsolut / trans.scale;
-                            // posAbsolut -= trans.position;
-
-                            const ray test(posAbsolut, rayDir[indAxis]);
-
-                            const vector3 segmentStart  (posAbsolut+rayDir[indAxis]*(-10000.)); // TODO: fix me after ray support for boost::geometry is of their todolist
-                            const vector3 segmentEnd    (posAbsolut+rayDir[indAxis]*(+10000.));
-
-                            t_segment segment(t_point(segmentStart.x, segmentStart.y, segmentStart.z), t_point(segmentEnd.x, segmentEnd.y, segmentEnd.z));
-                            typedef std::vector<t_value> t_resultTriangles;
-                            t_resultTriangles resultTriangles;
-                            tree->query(boost::geometry::index::intersects(segment), std::back_inserter(resultTriangles));
-
-                            typedef pair<real, blub::plane> t_cutPoint;
-                            typedef vector<t_cutPoint> t_cutPoints;
-                            t_cutPoints cutPoints;
-                            vector3 cutPoint;
-                            for (t_resultTriangles::const_iterator it = resultTriangles.cbegin(); it != resultTriangles.cend(); ++it)
-                            {
-                                const triangleVector3 &triangleWork(it->second);
-                                if (intersection::intersect(test, triangleWork, &cutPoint))
-                                {
-                                    bool insert(true);
-//                                    if (!cutPoints.empty())
-//                                    {
-//                                        const plane planeTriBefore(cutPoints.at(cutPoints.size()-1).second);
-//                                        if (/*math::abs*/(planeTriBefore.normal.dotProduct(triangleWork.getPlane().normal)) < 0.)
-//                                        {
-//                                            insert = false;
-//                                        }
-//                                    }
-                                    if (insert)
-                                    {
-                                        real cutPointStart = cutPoint[indAxis] - static_cast<real>(posContainerAbsolut[indAxis]);
-                                        cutPoints.push_back(t_cutPoint(cutPointStart, triangleWork.getPlane()));
-                                    }
-                                }
-                            }
-                            if(cutPoints.size() < 2)
+                            const real weight0(edgeFunction(posU[1], posV[1], posU[2], posV[2], indU, indV));
+                            const real weight1(edgeFunction(posU[2], posV[2], posU[0], posV[0], indU, indV));
+                            const real weight2(edgeFunction(posU[0], posV[0], posU[1], posV[1], indU, indV));
+                            const bool inside((weight0 > 0. || (weight0 == 0. && owns0)) &&
+                                              (weight1 > 0. || (weight1 == 0. && owns1)) &&
+                                              (weight2 > 0. || (weight2 == 0. && owns2)));
+                            if (!inside)
                             {
                                 continue;
                             }
+                            t_hit hit;
+                            hit.row = indU*voxelLength + indV;
+                            hit.depth = (weight0*depth[0] + weight1*depth[1] + weight2*depth[2]) / (weight0 + weight1 + weight2);
+                            hit.triangle = indTriangle;
+                            scratch.hits.push_back(hit);
+                        }
+                    }
+                }
 
-                            typedef vector<t_cutPoint> t_cutPointsFiltered;
-                            t_cutPointsFiltered cutPointsFiltered;
-                            for (t_cutPoints::const_iterator it = cutPoints.cbegin(); it != cutPoints.cend(); ++it)
-                            {
-                                if (cutPointsFiltered.empty())
-                                {
-                                    cutPointsFiltered.push_back(*it);
-                                    continue;
-                                }
-                                if (math::abs(cutPointsFiltered.back().first - it->first) < 1e-4f)
-                                {
-                                    continue;
-                                }
-                                cutPointsFiltered.push_back(*it);
-                            }
+                std::sort(scratch.hits.begin(), scratch.hits.end());
 
-                            if(cutPointsFiltered.size()%2 != 0 && cutPointsFiltered.size() > 0)
-                            {
-								BLUB_PROCEDURAL_LOG_WARNING() << "cutPointsFiltered.size()%2 != 0 cutPointsFiltered.size():" << cutPointsFiltered.size();
-                                cutPointsFiltered.pop_back();
-                            }
-                            for (t_cutPointsFiltered::const_iterator it = cutPointsFiltered.cbegin(); it != cutPointsFiltered.cend(); ++it)
-                            {
-                                real cutPointsSorted[2];
-                                blub::plane cutPlanes[2];
-                                cutPointsSorted[0] = it->first;
-                                cutPlanes[0] = it->second;
-                                ++it;
-                                BASSERT(it != cutPointsFiltered.cend());
-                                cutPointsSorted[1] = it->first;
-                                cutPlanes[1] = it->second;
-
-                                const real length(cutPointsSorted[1]-cutPointsSorted[0]);
-                                if (length < 1.)
-                                {
-#ifdef BLUB_LOG_PROCEDURAL_VOXEL_EDIT_MESH
-//                                    blub::BOUT("length < 1.");
-#endif
-//                                    continue;
-                                }
-                                //BLUB_LOG_OUT() << "creating line length:" << length;
-                                switch (indAxis)
-                                {
-                                case 0:
-                                    t_base::createLine(voxelContainer, posVoxel, cutPointsSorted[0], length, t_base::axis::x, cutPlanes[0], cutPlanes[1]);
-                                    break;
-                                case 1:
-                                    t_base::createLine(voxelContainer, posVoxel, cutPointsSorted[0], length, t_base::axis::y, cutPlanes[0], cutPlanes[1]);
-                                    break;
-                                case 2:
-                                    t_base::createLine(voxelContainer, posVoxel, cutPointsSorted[0], length, t_base::axis::z, cutPlanes[0], cutPlanes[1]);
-                                    break;
-                                default:
-                                    BASSERT(false);
-                                    break;
-                                }
-                            }
-                        }
+                typename t_hits::const_iterator itRow(scratch.hits.cbegin());
+                while (itRow != scratch.hits.cend())
+                {
+                    typename t_hits::const_iterator itRowEnd(itRow);
+                    while (itRowEnd != scratch.hits.cend() && itRowEnd->row == itRow->row)
+                    {
+                        ++itRowEnd;
+                    }
+                    typename t_hits::const_iterator itPairsEnd(itRowEnd);
+                    if ((itRowEnd - itRow) % 2 != 0)
+                    {
+                        BLUB_PROCEDURAL_LOG_WARNING() << "odd number of cut points, mesh isn't closed. numCutPoints:" << (itRowEnd - itRow);
+                        --itPairsEnd;
                     }
+
+                    vector3int32 posVoxel;
+                    switch (indAxis)
+                    {
+                    case 0:
+                        posVoxel = vector3int32(0, itRow->row / voxelLength, itRow->row % voxelLength);
+                        break;
+                    case 1:
+                        posVoxel = vector3int32(itRow->row % voxelLength, 0, itRow->row / voxelLength);
+                        break;
+                    case 2:
+                        posVoxel = vector3int32(itRow->row / voxelLength, itRow->row % voxelLength, 0);
+                        break;
+                    default:
+                        BASSERT(false);
+                        break;
+                    }
+                    const typename t_base::axis ax(indAxis == 0 ? t_base::axis::x : (indAxis == 1 ? t_base::axis::y : t_base::axis::z));
+
+                    for (typename t_hits::const_iterator it = itRow; it != itPairsEnd; it += 2)
+                    {
+                        const real length((it+1)->depth - it->depth);
+                        t_base::createLine(voxelContainer, posVoxel, it->depth, length, ax,
+                                           scratch.triangles[it->triangle].second.getPlane(),
+                                           scratch.triangles[(it+1)->triangle].second.getPlane());
+                    }
+
+                    itRow = itRowEnd;
                 }
             }
         }
     }
 
+    /**
+     * @brief edgeFunction calculates twice the signed area of the triangle a, b, p in 2d.
+     * Gets calculated in the same order for the edge a, b and the edge b, a, so the result for both is exactly negated.
+     * @return positive if p is left of a to b.
+     */
+    static real edgeFunction(const real &aU, const real &aV, const real &bU, const real &bV, const real &pU, const real &pV)
+    {
+        if (aU < bU || (aU == bU && aV < bV))
+        {
+            return (bU-aU)*(pV-aV) - (bV-aV)*(pU-aU);
+        }
+        return -((aU-bU)*(pV-bV) - (aV-bV)*(pU-bU));
+    }
+
+    /**
+     * @brief ownsEdge top-left fill rule. Of the edges a, b and b, a exactly one owns the points on it.
+     */
+    static bool ownsEdge(const real &aU, const real &aV, const real &bU, const real &bV)
+    {
+        return bV > aV || (bV == aV && bU < aU);
+    }
+
+    /**
+     * @brief The t_hit struct is a cut point of a ray with a triangle.
+     */
+    struct t_hit
+    {
+        int32 row;
+        real depth;
+        uint32 triangle;
+
+        bool operator < (const t_hit &other) const
+        {
+            return row < other.row || (row == other.row && depth < other.depth);
+        }
+    };
+    typedef std::vector<t_hit> t_hits;
+
+    /**
+     * @brief The t_scratch struct holds the buffers used by calculateVoxel(). One instance per thread, reused for every tile.
+     */
+    struct t_scratch
+    {
+        std::vector<t_value> triangles;
+        t_hits hits;
+    };
+    static t_scratch& getScratch()
+    {
+        static thread_local t_scratch result;
+        return result;
+    }
+
 protected:
     typedef vector<t_tree*> t_trees;
     t_trees m_trees;
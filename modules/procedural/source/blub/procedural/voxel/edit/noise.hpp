@@ -1,7 +1,7 @@
 #ifndef BLUB_PROCEDURAL_VOXEL_EDIT_NOISE_HPP
 #define BLUB_PROCEDURAL_VOXEL_EDIT_NOISE_HPP
 
-#include "blub/core/vector.hpp"
+#include "blub/core/array.hpp"
 #include "blub/math/axisAlignedBox.hpp"
 #include "blub/procedural/log/global.hpp"
 #include "blub/procedural/voxel/edit/base.hpp"
@@ -22,8 +22,9 @@ namespace edit
 
 
 /**
- * @brief The noise class generates a random terrain using simplex noise http://en.wikipedia.org/wiki/Simplex_noise .
- * Original code http://webstaff.itn.liu.se/~stegu/simplexnoise/SimplexNoise.java
+ * @brief The noise class generates a random terrain using improved perlin noise http://mrl.nyu.edu/~perlin/noise/ .
+ * Supports multiple octaves (fractional brownian motion), ridged noise and domain warping - all calculated in one pass per tile row.
+ * The permutation gets shuffled by an own deterministic random number generator, so the same seed results in the same terrain on every platform.
  */
 template <class configType>
 class noise : public base<configType>
@@ -36,20 +37,56 @@ public:
     typedef sharedPointer<noise> pointer;
     typedef typename t_config::t_data t_voxel;
 
+    /**
+     * @brief The fractal struct describes how multiple octaves of noise get combined.
+     * The default describes a single octave of plain noise.
+     */
+    struct fractal
+    {
+        /**
+         * @param octaves_ Number of noise octaves to sum up. Each octave costs about one single octave noise.
+         * @param lacunarity_ Frequency multiplier from one octave to the next.
+         * @param gain_ Amplitude multiplier from one octave to the next.
+         * @param ridged_ If true every octave gets mapped to (1-|noise|)^2*2-1, what results in sharp ridges. The range stays -1 to 1.
+         * @param warp_ Strength of the domain warp in noise space. 0 disables it. Costs three additional single octave noise.
+         */
+        fractal(const int32& octaves_ = 1,
+                const real& lacunarity_ = 2.,
+                const real& gain_ = 0.5,
+                const bool& ridged_ = false,
+                const real& warp_ = 0.)
+            : octaves(octaves_)
+            , lacunarity(lacunarity_)
+            , gain(gain_)
+            , ridged(ridged_)
+            , warp(warp_)
+        {
+            BASSERT(octaves > 0);
+        }
+
+        int32 octaves;
+        real lacunarity;
+        real gain;
+        bool ridged;
+        real warp;
+    };
+
     /**
      * @brief creates an instance of the class and returns it as shared_ptr<>
      * @param desc Defines the size in which the terrain should get generated.
      * @param scale Gets used to scale the voxel-position before calculating the interpolation
-     * @param seed Used before calling std::random_shuffle
-     * @param callbackInterpolation Callback for the generated interpolation.
+     * @param seed Seed for shuffling the permutation. Same seed results in same noise.
+     * @param callbackInterpolation Callback for the generated interpolation. If empty the interpolation gets multiplied by 1024.
+     * @param fractalDesc Describes octaves, ridges and domain warp. Default is a single octave.
      * @return An instance of the class as shared_ptr<>
      */
     static pointer create(const blub::axisAlignedBox& desc,
                           const vector3& scale,
                           const uint32& seed = 0,
-                          const t_callbackInterpolation& callbackInterpolation = [] (const vector3&, real& value) {value*=1024;return true;})
+                          const t_callbackInterpolation& callbackInterpolation = t_callbackInterpolation(),
+                          const fractal& fractalDesc = fractal())
     {
-        return pointer(new noise(desc, scale, seed, callbackInterpolation));
+        return pointer(new noise(desc, scale, seed, callbackInterpolation, fractalDesc));
     }
     /**
      * @brief ~noise destructor
@@ -85,85 +122,289 @@ protected:
                    v = h < 4 ? y : h == 12 || h == 14 ? x : z;
         return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
     }
+    static real ridge(const real& value)
+    {
+        const real inverted(1. - (value < 0. ? -value : value));
+        return inverted*inverted*2. - 1.;
+    }
     int32 permutation(const int32 index) const
     {
         BASSERT(index >= 0);
         BASSERT(index < 512);
-        return m_permutation[index%256];
+        return m_permutation[index];
     }
 
     /**
-     * @brief calculateOneVoxel scales pos by scale set in constructor and calculates the noise.
-     * @param pos absolute voxel-position
-     * @param resultVoxel gets set if interpolation larger -127
-     * @return Returns true if interpolation larger -127
+     * @brief calculateNoise calculates one octave of noise at one position.
+     * @param x Position in noise space.
+     * @param y Position in noise space.
+     * @param z Position in noise space.
+     * @return Noise in range about -1 to 1.
      */
-    bool calculateOneVoxel(const vector3& pos, t_voxel* resultVoxel) const override
+    real calculateNoise(real x, real y, real z) const
     {
-        real x(pos.x*m_scale.x);
-        real y(pos.y*m_scale.y);
-        real z(pos.z*m_scale.z);
-
-        const int32 X = static_cast<int32>(math::floor(x)) & 255;                  // FIND UNIT CUBE THAT
-        const int32 Y = static_cast<int32>(math::floor(y)) & 255;                  // CONTAINS POINT.
-        const int32 Z = static_cast<int32>(math::floor(z)) & 255;
-        x -= static_cast<int32>(math::floor(x));                                // FIND RELATIVE X,Y,Z
-        y -= static_cast<int32>(math::floor(y));                                // OF POINT IN CUBE.
-        z -= static_cast<int32>(math::floor(z));
-        const real u = fade(x);                                // COMPUTE FADE CURVES
-        const real v = fade(y);                                // FOR EACH OF X,Y,Z.
+        const int32 floorX(static_cast<int32>(math::floor(x)));
+        const int32 floorY(static_cast<int32>(math::floor(y)));
+        const int32 floorZ(static_cast<int32>(math::floor(z)));
+        const int32 X = floorX & 255;                  // FIND UNIT CUBE THAT
+        const int32 Y = floorY & 255;                  // CONTAINS POINT.
+        const int32 Z = floorZ & 255;
+        x -= floorX;                                   // FIND RELATIVE X,Y,Z
+        y -= floorY;                                   // OF POINT IN CUBE.
+        z -= floorZ;
+        const real u = fade(x);                        // COMPUTE FADE CURVES
+        const real v = fade(y);                        // FOR EACH OF X,Y,Z.
         const real w = fade(z);
         const int32 A =  permutation(X  )+Y;
         const int32 AA = permutation(A)+Z;
-        const int32 AB = permutation(A+1)+Z;      // HASH COORDINATES OF
+        const int32 AB = permutation(A+1)+Z;           // HASH COORDINATES OF
         const int32 B =  permutation(X+1)+Y;
         const int32 BA = permutation(B)+Z;
-        const int32 BB = permutation(B+1)+Z;      // THE 8 CUBE CORNERS,
-
-        real resultInterpolation =   lerp(w, lerp(v, lerp(u, grad(permutation(AA  ), x  , y  , z   ),  // AND ADD
-                                                             grad(permutation(BA  ), x-1, y  , z   )), // BLENDED
-                                                     lerp(u, grad(permutation(AB  ), x  , y-1, z   ),  // RESULTS
-                                                             grad(permutation(BB  ), x-1, y-1, z   ))),// FROM  8
-                                             lerp(v, lerp(u, grad(permutation(AA+1), x  , y  , z-1 ),  // CORNERS
-                                                             grad(permutation(BA+1), x-1, y  , z-1 )), // OF CUBE
-                                                     lerp(u, grad(permutation(AB+1), x  , y-1, z-1 ),
-                                                             grad(permutation(BB+1), x-1, y-1, z-1 ))));
-        if (!m_callbackInterpolation(pos, resultInterpolation))
+        const int32 BB = permutation(B+1)+Z;           // THE 8 CUBE CORNERS,
+
+        return lerp(w, lerp(v, lerp(u, grad(permutation(AA  ), x  , y  , z   ),  // AND ADD
+                                       grad(permutation(BA  ), x-1, y  , z   )), // BLENDED
+                               lerp(u, grad(permutation(AB  ), x  , y-1, z   ),  // RESULTS
+                                       grad(permutation(BB  ), x-1, y-1, z   ))),// FROM  8
+                       lerp(v, lerp(u, grad(permutation(AA+1), x  , y  , z-1 ),  // CORNERS
+                                       grad(permutation(BA+1), x-1, y  , z-1 )), // OF CUBE
+                               lerp(u, grad(permutation(AB+1), x  , y-1, z-1 ),
+                                       grad(permutation(BB+1), x-1, y-1, z-1 ))));
+    }
+
+    /**
+     * @brief calculateNoiseRow calculates one octave of noise for a row along the z-axis.
+     * The unit cube and the hashes for x and y get calculated once per row.
+     * The loop over z is free of branches and dependencies between the voxel, so the compiler may vectorize it.
+     * @param x Position of the row in noise space.
+     * @param y Position of the row in noise space.
+     * @param z Array of count positions in noise space.
+     * @param count Number of voxel in the row.
+     * @param amplitude Gets multiplied with the noise before it gets added to result.
+     * @param ridged If true the noise gets mapped to (1-|noise|)^2*2-1.
+     * @param result Array of count values the noise gets added to.
+     */
+    void calculateNoiseRow(real x, real y, const real* z, const int32& count, const real& amplitude, const bool& ridged, real* result) const
+    {
+        const int32 floorX(static_cast<int32>(math::floor(x)));
+        const int32 floorY(static_cast<int32>(math::floor(y)));
+        const int32 X = floorX & 255;
+        const int32 Y = floorY & 255;
+        x -= floorX;
+        y -= floorY;
+        const real u = fade(x);
+        const real v = fade(y);
+        const int32 A =  permutation(X  )+Y;
+        const int32 B =  permutation(X+1)+Y;
+        const int32 hashAA = permutation(A);
+        const int32 hashAB = permutation(A+1);
+        const int32 hashBA = permutation(B);
+        const int32 hashBB = permutation(B+1);
+
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            const int32 floorZ(static_cast<int32>(math::floor(z[ind])));
+            const int32 Z = floorZ & 255;
+            const real relZ(z[ind] - floorZ);
+            const real w = fade(relZ);
+            const int32 AA = hashAA+Z;
+            const int32 AB = hashAB+Z;
+            const int32 BA = hashBA+Z;
+            const int32 BB = hashBB+Z;
+
+            const real value(lerp(w, lerp(v, lerp(u, grad(permutation(AA  ), x  , y  , relZ   ),
+                                                     grad(permutation(BA  ), x-1, y  , relZ   )),
+                                             lerp(u, grad(permutation(AB  ), x  , y-1, relZ   ),
+                                                     grad(permutation(BB  ), x-1, y-1, relZ   ))),
+                                     lerp(v, lerp(u, grad(permutation(AA+1), x  , y  , relZ-1 ),
+                                                     grad(permutation(BA+1), x-1, y  , relZ-1 )),
+                                             lerp(u, grad(permutation(AB+1), x  , y-1, relZ-1 ),
+                                                     grad(permutation(BB+1), x-1, y-1, relZ-1 )))));
+            const real ridgedValue(ridge(value));
+            result[ind] += amplitude*(ridged ? ridgedValue : value);
+        }
+    }
+
+    /**
+     * @brief calculateOneVoxel scales pos by scale set in constructor and calculates the noise.
+     * @param pos absolute voxel-position
+     * @param resultVoxel gets set if interpolation larger -127
+     * @return Returns true if interpolation larger -127
+     */
+    bool calculateOneVoxel(const vector3& pos, t_voxel* resultVoxel) const override
+    {
+        bool result;
+        calculateVoxelRow(pos.x, pos.y, &pos.z, 1, resultVoxel, &result);
+        return result;
+    }
+
+    /**
+     * @brief calculateVoxelRow calculates all octaves for a whole row in one pass.
+     * Without domain warp every row gets calculated by calculateNoiseRow(), else every voxel by calculateNoise().
+     * @see base::calculateVoxelRow()
+     */
+    void calculateVoxelRow(const real& posX,
+                           const real& posY,
+                           const real* posZ,
+                           const int32& count,
+                           t_voxel* resultVoxel,
+                           bool* resultChanged) const override
+    {
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        BASSERT(count <= voxelsPerTile);
+
+        real resultInterpolation[voxelsPerTile];
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            resultInterpolation[ind] = 0.;
+        }
+
+        if (m_fractal.warp == 0.)
+        {
+            real posScaledZ[voxelsPerTile];
+            for (int32 ind = 0; ind < count; ++ind)
+            {
+                posScaledZ[ind] = posZ[ind]*m_scale.z;
+            }
+            real frequency(1.);
+            real amplitude(1.);
+            for (int32 octave = 0; octave < m_fractal.octaves; ++octave)
+            {
+                // every octave gets an offset, so their lattices don't line up at the origin.
+                const real offset(static_cast<real>(octave)*octaveOffset);
+                real posOctaveZ[voxelsPerTile];
+                for (int32 ind = 0; ind < count; ++ind)
+                {
+                    posOctaveZ[ind] = posScaledZ[ind]*frequency + offset;
+                }
+                calculateNoiseRow(posX*m_scale.x*frequency + offset,
+                                  posY*m_scale.y*frequency + offset,
+                                  posOctaveZ, count, amplitude/m_amplitudeSum, m_fractal.ridged, resultInterpolation);
+                frequency *= m_fractal.lacunarity;
+                amplitude *= m_fractal.gain;
+            }
+        }
+        else
+        {
+            for (int32 ind = 0; ind < count; ++ind)
+            {
+                vector3 pos(posX*m_scale.x, posY*m_scale.y, posZ[ind]*m_scale.z);
+                pos += vector3(calculateNoise(pos.x + warpOffsetX, pos.y, pos.z),
+                               calculateNoise(pos.x, pos.y + warpOffsetY, pos.z),
+                               calculateNoise(pos.x, pos.y, pos.z + warpOffsetZ)) * m_fractal.warp;
+
+                real frequency(1.);
+                real amplitude(1.);
+                for (int32 octave = 0; octave < m_fractal.octaves; ++octave)
+                {
+                    const real offset(static_cast<real>(octave)*octaveOffset);
+                    const real value(calculateNoise(pos.x*frequency + offset, pos.y*frequency + offset, pos.z*frequency + offset));
+                    const real ridgedValue(ridge(value));
+                    resultInterpolation[ind] += amplitude/m_amplitudeSum*(m_fractal.ridged ? ridgedValue : value);
+                    frequency *= m_fractal.lacunarity;
+                    amplitude *= m_fractal.gain;
+                }
+            }
+        }
+
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            resultChanged[ind] = setInterpolation(vector3(posX, posY, posZ[ind]), resultInterpolation[ind], &resultVoxel[ind]);
+        }
+    }
+
+    /**
+     * @brief setInterpolation calls the callback set in the constructor and sets the clamped interpolation.
+     * If no callback got set the interpolation gets multiplied by 1024.
+     * @param pos absolute voxel-position
+     * @param interpolation calculated noise
+     * @param resultVoxel gets set if callback returns true
+     * @return Returns false if callback returns false
+     */
+    bool setInterpolation(const vector3& pos, real& interpolation, t_voxel* resultVoxel) const
+    {
+        if (m_callbackInterpolation.empty())
+        {
+            interpolation *= 1024;
+        }
+        else if (!m_callbackInterpolation(pos, interpolation))
         {
             return false;
         }
-        const int8 resultCasted(static_cast<int8>(math::clamp<real>(resultInterpolation, -127., 127.)));
+        const int8 resultCasted(static_cast<int8>(math::clamp<real>(interpolation, -127., 127.)));
 
         resultVoxel->setInterpolation(resultCasted);
 
         return true;
     }
 
+    /**
+     * @brief shufflePermutation fills the permutation with 0-255 and shuffles it by Fisher-Yates.
+     * Uses an own linear congruential generator instead of std::rand(), because std::rand() isn't thread-safe and differs between platforms.
+     * The second half of the permutation is a copy of the first, so no modulo is needed on lookup.
+     * @param seed Seed of the generator.
+     */
+    void shufflePermutation(const uint32& seed)
+    {
+        std::iota(m_permutation.begin(), m_permutation.begin() + 256, 0);
+        uint64 state(static_cast<uint64>(seed)*6364136223846793005ULL + 1442695040888963407ULL);
+        for (int32 ind = 255; ind > 0; --ind)
+        {
+            state = state*6364136223846793005ULL + 1442695040888963407ULL;
+            const int32 swapWith(static_cast<int32>((state >> 33) % static_cast<uint64>(ind + 1)));
+            std::swap(m_permutation[ind], m_permutation[swapWith]);
+        }
+        std::copy(m_permutation.begin(), m_permutation.begin() + 256, m_permutation.begin() + 256);
+    }
 
     /**
      * @brief noise Contructor - same as create()
      */
-    noise(const blub::axisAlignedBox& desc, const vector3& scale, const uint32& seed, const t_callbackInterpolation &callbackInterpolation)
+    noise(const blub::axisAlignedBox& desc, const vector3& scale, const uint32& seed, const t_callbackInterpolation &callbackInterpolation, const fractal& fractalDesc)
         : m_aab(desc)
         , m_scale(scale)
         , m_callbackInterpolation(callbackInterpolation)
-        , m_permutation(256)
+        , m_fractal(fractalDesc)
+        , m_amplitudeSum(0.)
     {
-        std::srand(seed);
-        std::iota(m_permutation.begin(), m_permutation.end(), 0);
-        std::random_shuffle(m_permutation.begin(), m_permutation.end());
+        shufflePermutation(seed);
+
+        // normalise the sum of all octaves, so the result stays in the range of a single octave.
+        real amplitude(1.);
+        for (int32 octave = 0; octave < m_fractal.octaves; ++octave)
+        {
+            m_amplitudeSum += amplitude;
+            amplitude *= m_fractal.gain;
+        }
     }
 
 protected:
+    static constexpr real octaveOffset = 17.31;
+    static constexpr real warpOffsetX = 5.2;
+    static constexpr real warpOffsetY = 31.7;
+    static constexpr real warpOffsetZ = 73.9;
+
     const blub::axisAlignedBox m_aab;
     const vector3 m_scale;
     const t_callbackInterpolation m_callbackInterpolation;
+    const fractal m_fractal;
+    real m_amplitudeSum;
 
-    vector<uint8_t> m_permutation;
+    array<uint8, 512> m_permutation;
 
 };
 
 
+template <class configType>
+constexpr real noise<configType>::octaveOffset;
+template <class configType>
+constexpr real noise<configType>::warpOffsetX;
+template <class configType>
+constexpr real noise<configType>::warpOffsetY;
+template <class configType>
+constexpr real noise<configType>::warpOffsetZ;
+
+
 }
 }
 }
@@ -72,6 +72,35 @@ public:
                                     aabb.getMaximum()*trans.scale + trans.position);
     }
 
+    /**
+     * @brief calculateTileState returns full if all voxel of the tile are inside radius-1.
+     * @see base::calculateTileState()
+     */
+    simple::container::utils::tileState calculateTileState(const vector3int32& voxelContainerOffset, const transform& trans) const override
+    {
+        const simple::container::utils::tileState result(t_base::calculateTileState(voxelContainerOffset, trans));
+        if (result != simple::container::utils::tileState::partitial)
+        {
+            return result;
+        }
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const vector3 tileMinimum(voxelContainerOffset*voxelsPerTile);
+        const vector3 tileMaximum(tileMinimum + vector3(voxelsPerTile-1));
+        const vector3 localMinimum((tileMinimum - trans.position) / trans.scale);
+        const vector3 localMaximum((tileMaximum - trans.position) / trans.scale);
+        const vector3 &center(m_sphere.getCenter());
+        const real &radius(m_sphere.getRadius());
+        // the farthest corner
+        const vector3 farthest(std::max(math::abs(localMinimum.x - center.x), math::abs(localMaximum.x - center.x)),
+                               std::max(math::abs(localMinimum.y - center.y), math::abs(localMaximum.y - center.y)),
+                               std::max(math::abs(localMinimum.z - center.z), math::abs(localMaximum.z - center.z)));
+        if (farthest.squaredLength() < (radius-1.)*(radius-1.))
+        {
+            return simple::container::utils::tileState::full;
+        }
+        return result;
+    }
+
 protected:
     /**
      * @brief calculateOneVoxel calculates on voxel in getAxisAlignedBoundingBox().
@@ -99,6 +128,60 @@ protected:
         return false;
     }
 
+    /**
+     * @brief calculateVoxelRow same as calculateOneVoxel() but for a whole row.
+     * Skips the row if it doesn't intersect the sphere and only calls sqrt for voxel in the interpolated shell.
+     * @see base::calculateVoxelRow()
+     */
+    void calculateVoxelRow(const real& posX,
+                           const real& posY,
+                           const real* posZ,
+                           const int32& count,
+                           t_voxel* resultVoxel,
+                           bool* resultChanged) const override
+    {
+        const vector3 &center(m_sphere.getCenter());
+        const real &radius(m_sphere.getRadius());
+        const real radiusOuterSquared((radius+1.)*(radius+1.));
+        const real radiusInnerSquared((radius-1.)*(radius-1.));
+
+        const real diffX(posX - center.x);
+        const real diffY(posY - center.y);
+        const real squaredDistRow(diffX*diffX + diffY*diffY);
+        if (squaredDistRow >= radiusOuterSquared)
+        {
+            for (int32 ind = 0; ind < count; ++ind)
+            {
+                resultChanged[ind] = false;
+            }
+            return;
+        }
+
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        real squaredDist[voxelsPerTile];
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            const real diffZ(posZ[ind] - center.z);
+            squaredDist[ind] = squaredDistRow + diffZ*diffZ;
+        }
+        for (int32 ind = 0; ind < count; ++ind)
+        {
+            const real &dist(squaredDist[ind]);
+            resultChanged[ind] = dist < radiusOuterSquared;
+            if (!resultChanged[ind])
+            {
+                continue;
+            }
+            if (dist < radiusInnerSquared)
+            {
+                resultVoxel[ind].setInterpolationMax();
+                continue;
+            }
+            const blub::real result(blub::math::clamp<blub::real>((radius-blub::math::sqrt(dist))*127., -127., 127.));
+            resultVoxel[ind].setInterpolation(static_cast<blub::int8>(result));
+        }
+    }
+
     sphere(const ::blub::sphere& desc)
         : m_sphere(desc)
     {
@@ -0,0 +1,303 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_INDEXBUFFER
+#define BLUB_PROCEDURAL_VOXEL_INDEXBUFFER
+
+#include "blub/core/globals.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/serialization/access.hpp"
+#include "blub/serialization/nameValuePair.hpp"
+#include "blub/serialization/saveLoad.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The indexBuffer class is an index-list that stores its indices with 16 or 32 bit, see getWidth().
+ * tile::surface selects the smallest width that addresses all its vertices, so small tiles keep 16 bit indices and large tiles can't overflow.
+ * Upload getData() with getBytesPerIndex() to a gpu-buffer.
+ */
+class indexBuffer
+{
+public:
+    /**
+     * @brief The width enum describes the size of an index.
+     */
+    enum class width : uint8
+    {
+        bits16,
+        bits32
+    };
+
+    indexBuffer()
+        : m_width(width::bits16)
+    {
+        ;
+    }
+
+    /**
+     * @brief getMaxNumVertices returns the number of vertices an index of a width can address.
+     * @param toCheck
+     * @return
+     */
+    static uint64 getMaxNumVertices(const width& toCheck)
+    {
+        if (toCheck == width::bits16)
+        {
+            return static_cast<uint64>(std::numeric_limits<uint16>::max()) + 1;
+        }
+        return static_cast<uint64>(std::numeric_limits<uint32>::max()) + 1;
+    }
+    /**
+     * @brief calculateWidth returns the smallest width that addresses numVertices vertices.
+     * @param numVertices
+     * @return
+     */
+    static width calculateWidth(const uint64& numVertices)
+    {
+        return numVertices <= getMaxNumVertices(width::bits16) ? width::bits16 : width::bits32;
+    }
+
+    /**
+     * @brief getWidth returns the size of an index.
+     * @return
+     */
+    const width& getWidth() const
+    {
+        return m_width;
+    }
+    /**
+     * @brief getBytesPerIndex returns 2 or 4, depending on getWidth().
+     * @return
+     */
+    uint32 getBytesPerIndex() const
+    {
+        return m_width == width::bits16 ? sizeof(uint16) : sizeof(uint32);
+    }
+    /**
+     * @brief setWidth converts the indices to another width. Converting to 16 bit asserts that all indices fit.
+     * @param toSet
+     */
+    void setWidth(const width& toSet)
+    {
+        if (toSet == m_width)
+        {
+            return;
+        }
+        if (toSet == width::bits32)
+        {
+            m_indices32.assign(m_indices16.cbegin(), m_indices16.cend());
+            vector<uint16>().swap(m_indices16);
+        }
+        else
+        {
+            BASSERT(std::find_if(m_indices32.cbegin(), m_indices32.cend(), [] (const uint32& index) {return index > std::numeric_limits<uint16>::max();}) == m_indices32.cend());
+            m_indices16.assign(m_indices32.cbegin(), m_indices32.cend());
+            vector<uint32>().swap(m_indices32);
+        }
+        m_width = toSet;
+    }
+
+    uint32 size() const
+    {
+        return m_width == width::bits16 ? m_indices16.size() : m_indices32.size();
+    }
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    /**
+     * @brief clear removes all indices, the width stays.
+     */
+    void clear()
+    {
+        m_indices16.clear();
+        m_indices32.clear();
+    }
+    void reserve(const uint32& toReserve)
+    {
+        if (m_width == width::bits16)
+        {
+            m_indices16.reserve(toReserve);
+        }
+        else
+        {
+            m_indices32.reserve(toReserve);
+        }
+    }
+    /**
+     * @brief resize changes the number of indices, new ones are 0.
+     * @param toSet
+     */
+    void resize(const uint32& toSet)
+    {
+        if (m_width == width::bits16)
+        {
+            m_indices16.resize(toSet, 0);
+        }
+        else
+        {
+            m_indices32.resize(toSet, 0);
+        }
+    }
+    void swap(indexBuffer& other)
+    {
+        m_indices16.swap(other.m_indices16);
+        m_indices32.swap(other.m_indices32);
+        std::swap(m_width, other.m_width);
+    }
+
+    uint32 operator[](const uint32& index) const
+    {
+        BASSERT(index < size());
+        return m_width == width::bits16 ? m_indices16[index] : m_indices32[index];
+    }
+    void set(const uint32& index, const uint32& toSet)
+    {
+        BASSERT(index < size());
+        if (m_width == width::bits16)
+        {
+            BASSERT(toSet <= std::numeric_limits<uint16>::max());
+            m_indices16[index] = toSet;
+        }
+        else
+        {
+            m_indices32[index] = toSet;
+        }
+    }
+    void push_back(const uint32& toAdd)
+    {
+        if (m_width == width::bits16)
+        {
+            BASSERT(toAdd <= std::numeric_limits<uint16>::max());
+            m_indices16.push_back(toAdd);
+        }
+        else
+        {
+            m_indices32.push_back(toAdd);
+        }
+    }
+    /**
+     * @brief fill sets the indices [begin, end) to a value.
+     */
+    void fill(const uint32& begin, const uint32& end, const uint32& toSet)
+    {
+        BASSERT(begin <= end && end <= size());
+        if (m_width == width::bits16)
+        {
+            std::fill(m_indices16.begin() + begin, m_indices16.begin() + end, toSet);
+        }
+        else
+        {
+            std::fill(m_indices32.begin() + begin, m_indices32.begin() + end, toSet);
+        }
+    }
+
+    /**
+     * @brief getData returns the indices for an upload, getBytesPerIndex() each.
+     * @return
+     */
+    const void* getData() const
+    {
+        if (m_width == width::bits16)
+        {
+            return m_indices16.data();
+        }
+        return m_indices32.data();
+    }
+    /**
+     * @brief getData16 returns the indices if getWidth() is 16 bit, else nullptr.
+     * @return
+     */
+    uint16* getData16()
+    {
+        return m_width == width::bits16 ? m_indices16.data() : nullptr;
+    }
+    const uint16* getData16() const
+    {
+        return m_width == width::bits16 ? m_indices16.data() : nullptr;
+    }
+    /**
+     * @brief getData32 returns the indices if getWidth() is 32 bit, else nullptr.
+     * @return
+     */
+    uint32* getData32()
+    {
+        return m_width == width::bits32 ? m_indices32.data() : nullptr;
+    }
+    const uint32* getData32() const
+    {
+        return m_width == width::bits32 ? m_indices32.data() : nullptr;
+    }
+
+private:
+    BLUB_SERIALIZATION_ACCESS
+
+    template <class formatType>
+    void save(formatType & readWrite, const uint32& version) const
+    {
+        using namespace serialization;
+
+        (void)version;
+
+        const uint8 bits32(m_width == width::bits32 ? 1 : 0);
+        readWrite << nameValuePair::create("bits32", bits32);
+        if (m_width == width::bits16)
+        {
+            readWrite << nameValuePair::create("indices", m_indices16);
+        }
+        else
+        {
+            readWrite << nameValuePair::create("indices", m_indices32);
+        }
+    }
+    template <class formatType>
+    void load(formatType & readWrite, const uint32& version)
+    {
+        using namespace serialization;
+
+        (void)version;
+
+        uint8 bits32;
+        readWrite >> nameValuePair::create("bits32", bits32);
+        clear();
+        m_width = bits32 != 0 ? width::bits32 : width::bits16;
+        if (m_width == width::bits16)
+        {
+            readWrite >> nameValuePair::create("indices", m_indices16);
+        }
+        else
+        {
+            readWrite >> nameValuePair::create("indices", m_indices32);
+        }
+    }
+
+    template <class formatType>
+    void serialize(formatType & readWrite, const uint32& version)
+    {
+        using namespace serialization;
+
+        saveLoad(readWrite, *this, version);
+    }
+
+    // only the list of m_width is used
+    vector<uint16> m_indices16;
+    vector<uint32> m_indices32;
+    width m_width;
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_INDEXBUFFER
@@ -0,0 +1,244 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_MESHLET
+#define BLUB_PROCEDURAL_VOXEL_MESHLET
+
+#include "blub/core/globals.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/math.hpp"
+#include "blub/math/vector3.hpp"
+#include "blub/procedural/voxel/indexBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The meshlet struct describes a cluster of at most meshlets::maxVertices vertices and meshlets::maxTriangles triangles, for mesh-shaders and cluster culling.
+ * Its vertices are [vertexOffset, vertexOffset+numVertices) of meshlets::getVertices(), its triangles [triangleOffset, triangleOffset+numTriangles*3) of meshlets::getTriangles().
+ */
+struct meshlet
+{
+    meshlet()
+        : vertexOffset(0)
+        , triangleOffset(0)
+        , numVertices(0)
+        , numTriangles(0)
+        , radius(0.)
+        , coneCutoff(1.)
+    {
+        ;
+    }
+
+    uint32 vertexOffset;
+    uint32 triangleOffset;
+    uint32 numVertices;
+    uint32 numTriangles;
+    // bounding sphere
+    vector3 center;
+    real radius;
+    // all triangle-normals lie in the cone around coneAxis, see meshlets::isBackfacing()
+    vector3 coneAxis;
+    real coneCutoff;
+};
+
+
+/**
+ * @brief The meshlets class splits a triangle list into meshlets in list order, so optimize the order for the vertex-cache before, see vertexCache.
+ * Keeps its lists between calls.
+ */
+class meshlets
+{
+public:
+    static const uint32 maxVertices = 64;
+    static const uint32 maxTriangles = 124;
+
+    /**
+     * @brief build splits the triangles into meshlets. Skips degenerated triangles.
+     * @param vertices Vertex-list, need a member position.
+     * @param indices Triangle list, 3 per triangle.
+     * @param numIndices
+     */
+    template <typename vertexType, typename indexType>
+    void build(const vector<vertexType>& vertices, const indexType* indices, const uint32& numIndices)
+    {
+        clear();
+        m_localOfVertex.assign(vertices.size(), (uint8)invalidLocal);
+
+        meshlet building;
+        for (uint32 ind = 0; ind + 2 < numIndices; ind += 3)
+        {
+            const uint32 triangle[] = {indices[ind], indices[ind + 1], indices[ind + 2]};
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+            {
+                continue;
+            }
+            uint32 numNew(0);
+            for (const uint32& index : triangle)
+            {
+                numNew += m_localOfVertex[index] == invalidLocal ? 1 : 0;
+            }
+            if (building.numVertices + numNew > maxVertices || building.numTriangles + 1 > maxTriangles)
+            {
+                finish(vertices, building);
+            }
+            for (const uint32& index : triangle)
+            {
+                if (m_localOfVertex[index] == invalidLocal)
+                {
+                    m_localOfVertex[index] = building.numVertices++;
+                    m_vertices.push_back(index);
+                }
+                m_triangles.push_back(m_localOfVertex[index]);
+            }
+            ++building.numTriangles;
+        }
+        finish(vertices, building);
+    }
+    /**
+     * @brief build splits the triangles of an indexBuffer of any width into meshlets.
+     * @param vertices
+     * @param indices
+     */
+    template <typename vertexType>
+    void build(const vector<vertexType>& vertices, const indexBuffer& indices)
+    {
+        if (indices.getWidth() == indexBuffer::width::bits16)
+        {
+            build(vertices, indices.getData16(), indices.size());
+        }
+        else
+        {
+            build(vertices, indices.getData32(), indices.size());
+        }
+    }
+
+    void clear()
+    {
+        m_meshlets.clear();
+        m_vertices.clear();
+        m_triangles.clear();
+    }
+
+    /**
+     * @brief getMeshlets returns the meshlets built by build().
+     * @return
+     */
+    const vector<meshlet>& getMeshlets() const
+    {
+        return m_meshlets;
+    }
+    /**
+     * @brief getVertices returns per meshlet its vertices, as index into the vertex-list.
+     * @return
+     */
+    const vector<uint32>& getVertices() const
+    {
+        return m_vertices;
+    }
+    /**
+     * @brief getTriangles returns per meshlet its triangles, 3 indices into the meshlet's part of getVertices() per triangle.
+     * @return
+     */
+    const vector<uint8>& getTriangles() const
+    {
+        return m_triangles;
+    }
+
+    /**
+     * @brief isBackfacing returns true if all triangles of a meshlet face away from a position, so the meshlet can get culled.
+     * @param toTest
+     * @param position For example the camera, in the space of the vertices.
+     * @return
+     */
+    static bool isBackfacing(const meshlet& toTest, const vector3& position)
+    {
+        const vector3 toCenter(toTest.center - position);
+        return toCenter.dotProduct(toTest.coneAxis) >= toTest.coneCutoff*toCenter.length() + toTest.radius;
+    }
+
+protected:
+    static const uint8 invalidLocal = 0xff;
+
+    template <typename vertexType>
+    void finish(const vector<vertexType>& vertices, meshlet& toFinish)
+    {
+        if (toFinish.numTriangles == 0)
+        {
+            return;
+        }
+        // bounding sphere around the center of the bounding box
+        vector3 minimum(vertices[m_vertices[toFinish.vertexOffset]].position);
+        vector3 maximum(minimum);
+        for (uint32 ind = toFinish.vertexOffset; ind < m_vertices.size(); ++ind)
+        {
+            minimum.makeFloor(vertices[m_vertices[ind]].position);
+            maximum.makeCeil(vertices[m_vertices[ind]].position);
+        }
+        toFinish.center = (minimum + maximum)*0.5;
+        real radiusSquared(0.);
+        for (uint32 ind = toFinish.vertexOffset; ind < m_vertices.size(); ++ind)
+        {
+            radiusSquared = math::max(radiusSquared, vertices[m_vertices[ind]].position.squaredDistance(toFinish.center));
+        }
+        toFinish.radius = std::sqrt(radiusSquared);
+
+        // normal cone, its axis is the average of the triangle-normals
+        m_normals.clear();
+        vector3 axis(0.);
+        for (uint32 ind = toFinish.triangleOffset; ind < m_triangles.size(); ind += 3)
+        {
+            const vector3& position0(vertices[m_vertices[toFinish.vertexOffset + m_triangles[ind]]].position);
+            const vector3& position1(vertices[m_vertices[toFinish.vertexOffset + m_triangles[ind + 1]]].position);
+            const vector3& position2(vertices[m_vertices[toFinish.vertexOffset + m_triangles[ind + 2]]].position);
+            vector3 normal((position1 - position0).crossProduct(position2 - position0));
+            const real length(normal.length());
+            if (length > 0.)
+            {
+                normal /= length;
+                m_normals.push_back(normal);
+                axis += normal;
+            }
+        }
+        const real axisLength(axis.length());
+        toFinish.coneAxis = axisLength > 0. ? axis / axisLength : vector3(0., 0., 1.);
+        real minimumDot(axisLength > 0. ? 1. : -1.);
+        for (const vector3& normal : m_normals)
+        {
+            minimumDot = math::min(minimumDot, normal.dotProduct(toFinish.coneAxis));
+        }
+        // sine of the cone's half angle; 1 if the cone is wider than a half-space, so isBackfacing() never passes
+        toFinish.coneCutoff = minimumDot <= 0. ? 1. : std::sqrt(1. - minimumDot*minimumDot);
+
+        m_meshlets.push_back(toFinish);
+        for (uint32 ind = toFinish.vertexOffset; ind < m_vertices.size(); ++ind)
+        {
+            m_localOfVertex[m_vertices[ind]] = invalidLocal;
+        }
+        toFinish = meshlet();
+        toFinish.vertexOffset = m_vertices.size();
+        toFinish.triangleOffset = m_triangles.size();
+    }
+
+    vector<meshlet> m_meshlets;
+    vector<uint32> m_vertices;
+    vector<uint8> m_triangles;
+    // per vertex of the vertex-list its index in the meshlet in progress
+    vector<uint8> m_localOfVertex;
+    vector<vector3> m_normals;
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_MESHLET
@@ -0,0 +1,245 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_RAYCAST
+#define BLUB_PROCEDURAL_VOXEL_RAYCAST
+
+#include "blub/core/globals.hpp"
+#include "blub/math/math.hpp"
+#include "blub/math/vector3.hpp"
+#include "blub/math/vector3int.hpp"
+
+#include <limits>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The raycastHit struct is the result of a raycast, see simple::container::base::raycast() and simple::surface::raycast().
+ */
+struct raycastHit
+{
+    raycastHit()
+        : hit(false)
+        , distance(0.)
+    {
+        ;
+    }
+
+    // false if the ray didn't hit anything closer than its maximum distance
+    bool hit;
+    // along the normalized ray-direction
+    real distance;
+    vector3 position;
+    // points away from the solid
+    vector3 normal;
+    // the voxel-cell (container) or tile (surface) of the hit
+    vector3int32 id;
+};
+
+
+/**
+ * @brief intersectTriangle intersects a ray with a triangle, from both sides. By Moeller and Trumbore.
+ * @param origin Of the ray.
+ * @param direction Of the ray.
+ * @param vertex0
+ * @param vertex1
+ * @param vertex2
+ * @param distance Gets set to the distance along the ray in units of direction, if hit.
+ * @return false for degenerated triangles and hits behind the origin.
+ */
+inline bool intersectTriangle(const vector3& origin, const vector3& direction,
+                              const vector3& vertex0, const vector3& vertex1, const vector3& vertex2,
+                              real& distance)
+{
+    const vector3 edge0(vertex1 - vertex0);
+    const vector3 edge1(vertex2 - vertex0);
+    const vector3 perpendicular(direction.crossProduct(edge1));
+    const real determinant(edge0.dotProduct(perpendicular));
+    if (determinant > -1e-12 && determinant < 1e-12)
+    {
+        return false;
+    }
+    const real determinantInverse(1. / determinant);
+    const vector3 toOrigin(origin - vertex0);
+    const real u(toOrigin.dotProduct(perpendicular) * determinantInverse);
+    if (u < 0. || u > 1.)
+    {
+        return false;
+    }
+    const vector3 perpendicularV(toOrigin.crossProduct(edge0));
+    const real v(direction.dotProduct(perpendicularV) * determinantInverse);
+    if (v < 0. || u + v > 1.)
+    {
+        return false;
+    }
+    distance = edge1.dotProduct(perpendicularV) * determinantInverse;
+    return distance >= 0.;
+}
+
+
+/**
+ * @brief The gridTraversal class visits all cells of a regular grid a ray passes, in order. A 3d-dda by Amanatides and Woo.
+ * restart() continues at a later distance, to jump over cells known to be uninteresting.
+ */
+class gridTraversal
+{
+public:
+    /**
+     * @brief gridTraversal constructor.
+     * @param origin Of the ray.
+     * @param direction Of the ray. Has to be normalized.
+     * @param cellSize Cell i contains [i*cellSize, (i+1)*cellSize).
+     * @param distanceBegin Distance along the ray to begin with.
+     * @param distanceEnd Distance along the ray to end with.
+     */
+    gridTraversal(const vector3& origin, const vector3& direction, const real& cellSize, const real& distanceBegin, const real& distanceEnd)
+        : m_origin(origin)
+        , m_direction(direction)
+        , m_cellSize(cellSize)
+        , m_distanceEnd(distanceEnd)
+    {
+        restart(distanceBegin);
+    }
+
+    /**
+     * @brief restart continues the traversal with the cell at distance.
+     * @param distance Along the ray.
+     */
+    void restart(const real& distance)
+    {
+        m_distanceEnter = distance;
+        const vector3 position((m_origin + m_direction*distance) / m_cellSize);
+        const vector3int32 cell(position.getFloor());
+        m_cell[0] = cell.x;
+        m_cell[1] = cell.y;
+        m_cell[2] = cell.z;
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            const real direction(m_direction[axis]);
+            if (direction > 0.)
+            {
+                m_step[axis] = 1;
+                m_distanceNext[axis] = ((real)(m_cell[axis] + 1)*m_cellSize - m_origin[axis]) / direction;
+                m_distanceDelta[axis] = m_cellSize / direction;
+            }
+            else if (direction < 0.)
+            {
+                m_step[axis] = -1;
+                m_distanceNext[axis] = ((real)m_cell[axis]*m_cellSize - m_origin[axis]) / direction;
+                m_distanceDelta[axis] = -m_cellSize / direction;
+            }
+            else
+            {
+                m_step[axis] = 0;
+                m_distanceNext[axis] = std::numeric_limits<real>::max();
+                m_distanceDelta[axis] = std::numeric_limits<real>::max();
+            }
+        }
+        // on a cell border, or rounded back by a large coordinate, the cell may be one the ray already leaves
+        for (int32 axis = getAxisNext(); m_distanceNext[axis] <= m_distanceEnter; axis = getAxisNext())
+        {
+            m_cell[axis] += m_step[axis];
+            m_distanceNext[axis] += m_distanceDelta[axis];
+        }
+    }
+
+    /**
+     * @brief isValid returns false after the traversal passed distanceEnd.
+     * @return
+     */
+    bool isValid() const
+    {
+        return m_distanceEnter < m_distanceEnd;
+    }
+
+    /**
+     * @brief next moves to the next cell along the ray.
+     */
+    void next()
+    {
+        const int32 axis(getAxisNext());
+        m_distanceEnter = m_distanceNext[axis];
+        m_cell[axis] += m_step[axis];
+        m_distanceNext[axis] += m_distanceDelta[axis];
+    }
+
+    vector3int32 getCell() const
+    {
+        return vector3int32(m_cell[0], m_cell[1], m_cell[2]);
+    }
+    /**
+     * @brief getDistanceEnter returns the distance at which the ray enters the current cell.
+     * @return
+     */
+    const real& getDistanceEnter() const
+    {
+        return m_distanceEnter;
+    }
+    /**
+     * @brief getDistanceExit returns the distance at which the ray leaves the current cell, at most distanceEnd.
+     * @return
+     */
+    real getDistanceExit() const
+    {
+        return math::min(m_distanceNext[getAxisNext()], m_distanceEnd);
+    }
+
+    /**
+     * @brief calculateDistanceExit returns the distance at which a ray leaves an axis aligned box it is in.
+     * @param origin Of the ray.
+     * @param direction Of the ray.
+     * @param minimum Of the box.
+     * @param maximum Of the box.
+     * @return
+     */
+    static real calculateDistanceExit(const vector3& origin, const vector3& direction, const vector3& minimum, const vector3& maximum)
+    {
+        real result(std::numeric_limits<real>::max());
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            if (direction[axis] > 0.)
+            {
+                result = math::min(result, (maximum[axis] - origin[axis]) / direction[axis]);
+            }
+            else if (direction[axis] < 0.)
+            {
+                result = math::min(result, (minimum[axis] - origin[axis]) / direction[axis]);
+            }
+        }
+        return result;
+    }
+
+protected:
+    int32 getAxisNext() const
+    {
+        if (m_distanceNext[0] < m_distanceNext[1])
+        {
+            return m_distanceNext[0] < m_distanceNext[2] ? 0 : 2;
+        }
+        return m_distanceNext[1] < m_distanceNext[2] ? 1 : 2;
+    }
+
+    const vector3 m_origin;
+    const vector3 m_direction;
+    const real m_cellSize;
+    const real m_distanceEnd;
+
+    real m_distanceEnter;
+    int32 m_cell[3];
+    int32 m_step[3];
+    real m_distanceNext[3];
+    real m_distanceDelta[3];
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_RAYCAST
@@ -0,0 +1,194 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_SAMPLE
+#define BLUB_PROCEDURAL_VOXEL_SAMPLE
+
+#include "blub/core/globals.hpp"
+#include "blub/math/vector3.hpp"
+
+#include <algorithm>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The densitySample struct is the density and its gradient at a position, see simple::container::base::sampleDensity().
+ */
+struct densitySample
+{
+    densitySample()
+        : density(0.)
+    {
+        ;
+    }
+
+    // interpolation of the voxel, larger zero is solid
+    real density;
+    // per voxel, points into the solid
+    vector3 gradient;
+};
+
+
+/**
+ * @brief The sampleBatch class interpolates density and gradient of numLanes positions at once.
+ * Each lane gets the 4x4x4 voxel around its position: the 8 voxel of the cell the position lies in, plus one voxel on each side for the central differences.
+ * The density gets interpolated trilinear between the 8 voxel of the cell, the gradient trilinear between the central differences at these 8 voxel.
+ * Stencil and weights are stored lane-minor, so calculate() compiles to vector instructions.
+ */
+class sampleBatch
+{
+public:
+    static const int32 numLanes = 8;
+    static const int32 stencilLength = 4;
+    static const int32 stencilCount = stencilLength*stencilLength*stencilLength;
+
+    sampleBatch()
+    {
+        // unused lanes get calculated too and must not contain denormals
+        std::fill(&m_stencil[0][0], &m_stencil[0][0] + stencilCount*numLanes, 0.);
+        std::fill(&m_inCell[0][0], &m_inCell[0][0] + 3*numLanes, 0.);
+    }
+
+    /**
+     * @brief calculateStencilIndex converts a position in the stencil to the index used by setStencil().
+     * @param x 0 to 3, 1 is the cell-minimum.
+     * @param y 0 to 3, 1 is the cell-minimum.
+     * @param z 0 to 3, 1 is the cell-minimum.
+     * @return
+     */
+    static int32 calculateStencilIndex(const int32& x, const int32& y, const int32& z)
+    {
+        return x*stencilLength*stencilLength + y*stencilLength + z;
+    }
+
+    /**
+     * @brief setStencil sets a voxel-density of a lane.
+     * @param lane
+     * @param index See calculateStencilIndex().
+     * @param density
+     */
+    void setStencil(const int32& lane, const int32& index, const real& density)
+    {
+        m_stencil[index][lane] = density;
+    }
+    /**
+     * @brief setPosition sets the position of a lane inside its cell.
+     * @param lane
+     * @param inCell 0 to 1 per axis.
+     */
+    void setPosition(const int32& lane, const vector3& inCell)
+    {
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            m_inCell[axis][lane] = inCell[axis];
+        }
+    }
+
+    /**
+     * @brief calculate interpolates all lanes. Unused lanes get calculated too, their results are meaningless.
+     * @param result numLanes results.
+     */
+    void calculate(densitySample result[numLanes])
+    {
+        // per axis the weights of the 4 stencil-voxel, for the density and for its derivative
+        real weight[3][stencilLength][numLanes];
+        real derivative[3][stencilLength][numLanes];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            for (int32 lane = 0; lane < numLanes; ++lane)
+            {
+                const real inCell(m_inCell[axis][lane]);
+                weight[axis][0][lane] = 0.;
+                weight[axis][1][lane] = 1. - inCell;
+                weight[axis][2][lane] = inCell;
+                weight[axis][3][lane] = 0.;
+                derivative[axis][0][lane] = -0.5*(1. - inCell);
+                derivative[axis][1][lane] = -0.5*inCell;
+                derivative[axis][2][lane] = 0.5*(1. - inCell);
+                derivative[axis][3][lane] = 0.5*inCell;
+            }
+        }
+
+        // separable, reduce z, then y, then x
+        real planeWeighted[stencilLength][stencilLength][numLanes];
+        real planeDerived[stencilLength][stencilLength][numLanes];
+        for (int32 x = 0; x < stencilLength; ++x)
+        {
+            for (int32 y = 0; y < stencilLength; ++y)
+            {
+                const int32 row(calculateStencilIndex(x, y, 0));
+                for (int32 lane = 0; lane < numLanes; ++lane)
+                {
+                    real weighted(0.);
+                    real derived(0.);
+                    for (int32 z = 0; z < stencilLength; ++z)
+                    {
+                        weighted += weight[2][z][lane]*m_stencil[row + z][lane];
+                        derived += derivative[2][z][lane]*m_stencil[row + z][lane];
+                    }
+                    planeWeighted[x][y][lane] = weighted;
+                    planeDerived[x][y][lane] = derived;
+                }
+            }
+        }
+        real lineWeighted[stencilLength][numLanes];
+        real lineDerivedY[stencilLength][numLanes];
+        real lineDerivedZ[stencilLength][numLanes];
+        for (int32 x = 0; x < stencilLength; ++x)
+        {
+            for (int32 lane = 0; lane < numLanes; ++lane)
+            {
+                real weighted(0.);
+                real derivedY(0.);
+                real derivedZ(0.);
+                for (int32 y = 0; y < stencilLength; ++y)
+                {
+                    weighted += weight[1][y][lane]*planeWeighted[x][y][lane];
+                    derivedY += derivative[1][y][lane]*planeWeighted[x][y][lane];
+                    derivedZ += weight[1][y][lane]*planeDerived[x][y][lane];
+                }
+                lineWeighted[x][lane] = weighted;
+                lineDerivedY[x][lane] = derivedY;
+                lineDerivedZ[x][lane] = derivedZ;
+            }
+        }
+        real density[numLanes];
+        real gradient[3][numLanes];
+        for (int32 lane = 0; lane < numLanes; ++lane)
+        {
+            density[lane] = 0.;
+            gradient[0][lane] = 0.;
+            gradient[1][lane] = 0.;
+            gradient[2][lane] = 0.;
+            for (int32 x = 0; x < stencilLength; ++x)
+            {
+                density[lane] += weight[0][x][lane]*lineWeighted[x][lane];
+                gradient[0][lane] += derivative[0][x][lane]*lineWeighted[x][lane];
+                gradient[1][lane] += weight[0][x][lane]*lineDerivedY[x][lane];
+                gradient[2][lane] += weight[0][x][lane]*lineDerivedZ[x][lane];
+            }
+        }
+        for (int32 lane = 0; lane < numLanes; ++lane)
+        {
+            result[lane].density = density[lane];
+            result[lane].gradient = vector3(gradient[0][lane], gradient[1][lane], gradient[2][lane]);
+        }
+    }
+
+protected:
+    real m_stencil[stencilCount][numLanes];
+    real m_inCell[3][numLanes];
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_SAMPLE
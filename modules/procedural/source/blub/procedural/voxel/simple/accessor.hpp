@@ -5,8 +5,10 @@
 #include "blub/core/globals.hpp"
 #include "blub/core/hashList.hpp"
 #include "blub/core/hashMap.hpp"
+#include "blub/core/metrics.hpp"
 #include "blub/core/noncopyable.hpp"
 #include "blub/core/signal.hpp"
+#include "blub/core/trace.hpp"
 #include "blub/math/axisAlignedBoxInt32.hpp"
 #include "blub/math/vector3.hpp"
 #include "blub/procedural/log/global.hpp"
@@ -31,6 +33,8 @@ namespace simple
  * @brief The accessor class accesses and caches voxels for the surface-calculation.
  * It caches voxel optimized for the marching cubes algorithm.
  * If lod is larger 0 it addionally caches voxel for the transvoxel aalgorithm.
+ * By default the voxel for the transvoxel algorithm of a side of a tile get cached, after the side got requested by requestLod().
+ * Tiles next to the positions set by setPriorityPositions() get calculated first.
  */
 template <class configType>
 class accessor : public base<typename configType::t_accessor::t_tile>
@@ -51,6 +55,24 @@ public:
     typedef container::utils::tileState t_tileState;
     typedef container::utils::tile<t_tileContainer> t_tileHolder;
     typedef hashMap<t_tileId, t_tileHolder> t_tileHolderMap;
+    typedef hashMap<t_tileId, axisAlignedBoxInt32> t_dirtyTiles;
+    typedef hashMap<t_tileId, uint8> t_lodRequests;
+    typedef typename t_base::t_job t_job;
+    typedef typename t_base::t_jobList t_jobList;
+    typedef typename t_jobList::value_type t_tileJob;
+    /**
+     * @brief The t_tileHolderCache struct caches the container-tiles looked up while calculating an accessor-tile.
+     */
+    struct t_tileHolderCache
+    {
+        t_tileHolderCache()
+            : last(nullptr)
+        {;}
+
+        t_tileHolderMap tiles;
+        t_tileId lastId;
+        const t_tileHolder* last;
+    };
 
     typedef typename t_config::t_container::t_simple t_simpleContainerVoxel;
 
@@ -67,15 +89,50 @@ public:
              const int32& lod)
         : t_base(worker)
         , m_voxels(voxels)
+        , m_voxelsLod(voxels)
         , m_lod(lod)
         , m_voxelSkip(math::pow(2, m_lod))
+        , m_voxelSkipLod(m_voxelSkip/2)
         , m_numTilesInWork(0)
+        , m_tilesGotChangedPending(false)
+        , m_calculateLodOnDemand(true)
     {
         m_connTilesGotChanged = m_voxels.signalEditDone()->connect(boost::bind(&accessor::tilesGotChanged, this));
 
         t_base::setCreateTileCallback(boost::bind(&t_tile::create));
     }
 
+    /**
+     * @brief accessor constructor for a level-of-detail pyramid, see container::downsampled.
+     * Instead of sampling the most detailed container with stride 2^lod, the voxel get read from a container of the same resolution as the lod.
+     * @param worker May gets run by multiple threads.
+     * @param voxels The container to read the voxels from. Has to have the resolution of lod, so every 2^lod voxel of the most detailed one got reduced to one.
+     * Only a point-filtered pyramid keeps the seams to the finer lod closed, see container::downsampled::filter.
+     * The Accessor will connect the signal container::base::signalEditDone() to this class, so it keeps up to date.
+     * Every change in voxelsLod has to lead to a change in voxels, like container::downsampled does.
+     * @param voxelsLod The container with twice the resolution of voxels, used for the transvoxel-voxel.
+     * @param lod Indicates the level of detail. Must be larger 0.
+     */
+    accessor(async::dispatcher &worker,
+             t_simpleContainerVoxel &voxels,
+             t_simpleContainerVoxel &voxelsLod,
+             const int32& lod)
+        : t_base(worker)
+        , m_voxels(voxels)
+        , m_voxelsLod(voxelsLod)
+        , m_lod(lod)
+        , m_voxelSkip(1)
+        , m_voxelSkipLod(1)
+        , m_numTilesInWork(0)
+        , m_tilesGotChangedPending(false)
+        , m_calculateLodOnDemand(true)
+    {
+        BASSERT(m_lod > 0);
+        m_connTilesGotChanged = m_voxels.signalEditDone()->connect(boost::bind(&accessor::tilesGotChanged, this));
+
+        t_base::setCreateTileCallback(boost::bind(&t_tile::create));
+    }
+
     /**
      * @brief ~accessor destructor
      */
@@ -95,6 +152,45 @@ public:
         return m_voxels;
     }
 
+    /**
+     * @brief getVoxelContainerLod returns the voxel container for the transvoxel-voxel. Same as getVoxelContainer() if not constructed for a level-of-detail pyramid.
+     * @return
+     */
+    t_simpleContainerVoxel &getVoxelContainerLod() const
+    {
+        return m_voxelsLod;
+    }
+
+    /**
+     * @brief setCalculateLodOnDemand sets if the voxel for the transvoxel algorithm of a side get cached only after requestLod() got called for it.
+     * If false all 6 sides of every tile get cached. Affects only tiles created afterwards, so call it before the first edit.
+     * @param toSet Default true.
+     */
+    void setCalculateLodOnDemand(const bool& toSet)
+    {
+        m_calculateLodOnDemand = toSet;
+    }
+    /**
+     * @brief getCalculateLodOnDemand returns the value set by setCalculateLodOnDemand().
+     * @return
+     */
+    const bool& getCalculateLodOnDemand() const
+    {
+        return m_calculateLodOnDemand;
+    }
+
+    /**
+     * @brief requestLod caches the voxel for the transvoxel algorithm of a side of a tile, if not done yet.
+     * Adds the tile to the change-list afterwards, without changing its edited voxel bounds. See t_tile::getEditedVoxelBoundingBox().
+     * Tiles that don't exist, because they are empty or full, get ignored. Thread-safe.
+     * @param id TileId
+     * @param lod Side of the tile, 0 to 5.
+     */
+    void requestLod(const t_tileId& id, const int32& lod) override
+    {
+        t_base::m_master.post(boost::bind(&accessor::requestLodMaster, this, id, lod));
+    }
+
     /**
      * @brief getTile returns an accessor tile.
      * Read-lock class before.
@@ -111,6 +207,15 @@ public:
         return it->second;
     }
 
+    /**
+     * @brief getTileSize returns the size of a tile in world-coordinates.
+     * @return voxelLength*pow(2, lod)
+     */
+    real getTileSize() const
+    {
+        return t_tile::voxelLength*math::pow(2., m_lod);
+    }
+
 protected:
     /**
      * @brief tilesGotChanged gets called after in the voxel container m_voxels, set in the constructor, the voxels changed.
@@ -118,7 +223,7 @@ protected:
      */
     void tilesGotChanged()
     {
-        m_voxels.lockForRead();
+        lockVoxelsForRead();
         t_base::m_master.post(boost::bind(&accessor::tilesGotChangedMaster, this));
     }
 
@@ -128,6 +233,12 @@ protected:
      */
     void tilesGotChangedMaster()
     {
+        if (m_numTilesInWork > 0)
+        {
+            // requested lod-voxel get cached, the voxel stay read-locked until then
+            m_tilesGotChangedPending = true;
+            return;
+        }
         const auto& changedTiles(m_voxels.getTilesThatGotEdited());
 #ifdef BLUB_LOG_VOXEL
         BLUB_PROCEDURAL_LOG_OUT() << "accessor tilesGotChangedMaster changedTiles.size():" << changedTiles.size();
@@ -135,11 +246,11 @@ protected:
         BASSERT(!changedTiles.empty());
         /*if (changedTiles.empty())
         {
-            m_voxels.unlockRead();
+            unlockVoxelsRead();
             return;
         }*/
 
-        t_tileIdList affectedTiles;
+        t_dirtyTiles affectedTiles;
         for (auto change : changedTiles)
         {
             const t_tileId id(change.first);
@@ -162,102 +273,300 @@ protected:
         if (affectedTiles.empty())
         {
 //            blub::BWARNING("affectedTiles.empty()");
-            m_voxels.unlockRead();
+            unlockVoxelsRead();
+            return;
+        }
+
+        const axisAlignedBoxInt32 surfaceBounds(vector3int32(0), vector3int32(t_tile::voxelLengthSurface-1));
+        t_dirtyTiles toCalculate;
+        for (auto affected : affectedTiles)
+        {
+            // a missing tile was empty or full. Changes in the voxel for normal-correction only can't change that.
+            if (m_tiles.find(affected.first) == m_tiles.cend() &&
+                !(affected.second.getMinimum() <= surfaceBounds.getMaximum() && affected.second.getMaximum() >= surfaceBounds.getMinimum()))
+            {
+                continue;
+            }
+            toCalculate.insert(affected.first, affected.second);
+        }
+
+        if (toCalculate.empty())
+        {
+            unlockVoxelsRead();
             return;
         }
 
-        t_base::lockForEditMaster();
         BASSERT(m_numTilesInWork == 0);
-        m_numTilesInWork = affectedTiles.size();
+        m_numTilesInWork = toCalculate.size();
+        t_base::lockForEditMasterAsync(boost::bind(&accessor::calculateAccessorTilesMaster, this, toCalculate));
+    }
+
+    /**
+     * @brief calculateAccessorTilesMaster dispatches the calculation of the tiles after locked for write.
+     * @param toCalculate Tiles and their dirty voxel.
+     */
+    void calculateAccessorTilesMaster(const t_dirtyTiles& toCalculate)
+    {
+        t_jobList jobs;
+        for (auto work : toCalculate)
+        {
+            jobs.push_back(t_tileJob(work.first, boost::bind(&accessor::calculateAccessorTS, this, work.first, getTile(work.first), work.second)));
+        }
+        t_base::dispatchJobsMaster(jobs, getTileSize());
+    }
 
-        for (const t_tileId id : affectedTiles)
+    /**
+     * @brief The t_metrics struct contains the metrics all accessors record to, see metrics::registry::getGlobal().
+     */
+    struct t_metrics
+    {
+        t_metrics()
+            : gatherTime(metrics::registry::getGlobal().getHistogram("blub_voxel_accessor_gather_microseconds", "Time to gather the voxel of an accessor-tile from the container."))
+            , tilesChanged(metrics::registry::getGlobal().getCounter("blub_voxel_accessor_tiles_changed_total", "Accessor-tiles reported as changed."))
         {
-            t_base::m_worker.post(boost::bind(&accessor::calculateAccessorTS, this, id, getTile(id)));
+            ;
         }
+
+        metrics::histogram& gatherTime;
+        metrics::counter& tilesChanged;
+    };
+    static t_metrics& getMetrics()
+    {
+        static t_metrics result;
+        return result;
     }
 
     /**
      * @brief calculateAccessorTS accesses the container and pulls out all voxel needed for surface calculation (marching-cubes/transvoxel).
+     * Only the voxel inside dirty and the lod-voxel between them get pulled out again. A new tile gets filled completely.
+     * The changed voxel get reported by t_tile::getEditedVoxelBoundingBox().
      * @param id Accessor-TileId
      * @param workTile The accessor-tile to fill with.
+     * @param dirty Voxel to pull out again, in tile-coordinates.
      */
-    void calculateAccessorTS(const t_tileId& id, t_tilePtr workTile)
+    void calculateAccessorTS(const t_tileId& id, t_tilePtr workTile, const axisAlignedBoxInt32& dirty)
     {
+        BLUB_TRACE_SCOPE_TILE("calculateAccessorTS", "accessor", id, m_lod);
+        metrics::scopedTimer timer(getMetrics().gatherTime);
+
+        axisAlignedBoxInt32 toGather(dirty);
         if (workTile.isNull())
         {
             workTile = createTile();
             // workTile->setEmpty();
+            toGather.setMinimumAndMaximum(vector3int32(-1), vector3int32(t_tile::voxelLength+1));
+        }
+        else
+        {
+            workTile = copyTile(workTile);
         }
+        workTile->resetEditedVoxelBoundingBox();
+        t_tileHolderCache lastUsedTilesLod;
 
-        const vector3int32 voxelStart(id*t_tile::voxelLength*m_voxelSkip);
-        // axisAlignedBoxInt32 lastUsedTileBounds;
-        t_tileHolderMap lastUsedTiles;
+        bool valuesChanged(gatherVoxel(id, workTile, toGather));
+
+        if (workTile->getCalculateLod())
+        {
+            valuesChanged |= calculateAccessorLod(id, workTile, toGather, lastUsedTilesLod);
+        }
 
+        if (workTile->isEmpty() || workTile->isFull())
+        {
+            t_base::m_master.post(boost::bind(&accessor::afterCalculateAccessorMaster, this, id, nullptr, true, workTile->isFull()));
+            return;
+        }
+
+        t_base::m_master.post(boost::bind(&accessor::afterCalculateAccessorMaster, this, id, workTile, valuesChanged, false));
+    }
+
+    /**
+     * @brief calculateAccessorLod pulls out the lod-voxel of all sides that get cached by the tile, for the transvoxel algorithm.
+     * Only the lod-voxel between the voxel of toGather get pulled out.
+     * @param id Accessor-TileId
+     * @param workTile The accessor-tile to fill with. Its voxel for marching-cubes have to be up to date.
+     * @param toGather Voxel to pull out the lod-voxel for, in tile-coordinates.
+     * @param lastUsedTilesLod Last used container-tiles.
+     * @return true if any lod-voxel changed.
+     */
+    bool calculateAccessorLod(const t_tileId& id, t_tilePtr workTile, const axisAlignedBoxInt32& toGather, t_tileHolderCache& lastUsedTilesLod)
+    {
+        BASSERT(m_voxelSkipLod > 0);
+
+        const vector3int32 voxelStartLod(id*t_tile::voxelLength*2*m_voxelSkipLod);
+        const int32 voxelLengthLod = t_tile::voxelLengthLod;
+        const vector3int32 toIterate[][2] = {
+                                            {vector3int32(0, 0, 0), vector3int32(1, voxelLengthLod, voxelLengthLod)},
+                                            {vector3int32(voxelLengthLod-2, 0, 0), vector3int32(voxelLengthLod-1, voxelLengthLod, voxelLengthLod)},
+                                            {vector3int32(0, 0, 0), vector3int32(voxelLengthLod, 1, voxelLengthLod)},
+                                            {vector3int32(0, voxelLengthLod-2, 0), vector3int32(voxelLengthLod, voxelLengthLod-1, voxelLengthLod)},
+                                            {vector3int32(0, 0, 0), vector3int32(voxelLengthLod, voxelLengthLod, 1)},
+                                            {vector3int32(0, 0, voxelLengthLod-2), vector3int32(voxelLengthLod, voxelLengthLod, voxelLengthLod-1)},
+                                            };
+        // lod-voxel have double resolution
+        vector3int32 gatherLodMinimum(toGather.getMinimum()*2);
+        vector3int32 gatherLodMaximum(toGather.getMaximum()*2 + vector3int32(1));
+        gatherLodMinimum = gatherLodMinimum.getMaximum(vector3int32(0));
+        gatherLodMaximum = gatherLodMaximum.getMinimum(vector3int32(voxelLengthLod));
         bool valuesChanged(false);
-        for (int32 indX = -1; indX < t_tile::voxelLength+2; ++indX)
+        for (int32 lod = 0; lod < 6; ++lod)
         {
-            for (int32 indY = -1; indY < t_tile::voxelLength+2; ++indY)
+            if (!workTile->getCalculateLodFace(lod))
+            {
+                continue;
+            }
+            const vector3int32& start(toIterate[lod][0]);
+            const vector3int32& end(toIterate[lod][1]);
+            vector3int32 from(gatherLodMinimum);
+            vector3int32 to(gatherLodMaximum);
+            from = from.getMaximum(start);
+            to = to.getMinimum(end);
+            for (int32 indX = from.x; indX < to.x; ++indX)
             {
-                for (int32 indZ = -1; indZ < t_tile::voxelLength+2; ++indZ)
+                for (int32 indY = from.y; indY < to.y; ++indY)
                 {
-                    const vector3int32 pos(indX, indY, indZ);
-                    const vector3int32 voxelPosAbs(voxelStart + pos*m_voxelSkip);
+                    for (int32 indZ = from.z; indZ < to.z; ++indZ)
+                    {
+                        const vector3int32 pos(indX, indY, indZ);
+                        t_voxel result;
+                        if (indX % 2 == 0 &&
+                            indY % 2 == 0 &&
+                            indZ % 2 == 0)
+                        {
+                            // same voxel as the marching-cubes ones, so the transition cells match the regular ones
+                            result = workTile->getVoxel(pos / 2);
+                        }
+                        else
+                        {
+                            const vector3int32 voxelPosAbs(voxelStartLod + pos*m_voxelSkipLod);
+                            result = getVoxelData(m_voxelsLod, voxelPosAbs, /*lastUsedTileBounds, */lastUsedTilesLod);
+                        }
 
-                    valuesChanged |= workTile->setVoxel(pos, getVoxelData(voxelPosAbs, /*lastUsedTileBounds, */lastUsedTiles));
+                        valuesChanged |= workTile->setVoxelLod(pos-start, result, lod);
+                    }
                 }
             }
         }
+        return valuesChanged;
+    }
 
-        if (workTile->getCalculateLod())
+    /**
+     * @brief requestLodMaster collects the requested sides. They get cached as soon as no tile is in work.
+     * @see requestLod()
+     */
+    void requestLodMaster(const t_tileId& id, const int32& lod)
+    {
+        BASSERT(lod >= 0);
+        BASSERT(lod < 6);
+        if (m_lod == 0 || !m_calculateLodOnDemand)
         {
-            BASSERT(m_voxelSkip > 0);
-
-            const int32 voxelLengthLod = t_tile::voxelLengthLod;
-            const vector3int32 toIterate[][2] = {
-                                                {vector3int32(0, 0, 0), vector3int32(1, voxelLengthLod, voxelLengthLod)},
-                                                {vector3int32(voxelLengthLod-2, 0, 0), vector3int32(voxelLengthLod-1, voxelLengthLod, voxelLengthLod)},
-                                                {vector3int32(0, 0, 0), vector3int32(voxelLengthLod, 1, voxelLengthLod)},
-                                                {vector3int32(0, voxelLengthLod-2, 0), vector3int32(voxelLengthLod, voxelLengthLod-1, voxelLengthLod)},
-                                                {vector3int32(0, 0, 0), vector3int32(voxelLengthLod, voxelLengthLod, 1)},
-                                                {vector3int32(0, 0, voxelLengthLod-2), vector3int32(voxelLengthLod, voxelLengthLod, voxelLengthLod-1)},
-                                                };
+            return;
+        }
+        const bool firstRequest(m_lodRequests.empty());
+        typename t_lodRequests::iterator it(m_lodRequests.find(id));
+        if (it == m_lodRequests.end())
+        {
+            m_lodRequests.insert(id, 1 << lod);
+        }
+        else
+        {
+            it->second |= (1 << lod);
+        }
+        if (firstRequest && m_numTilesInWork == 0)
+        {
+            // collect all requests posted until then
+            t_base::m_master.post(boost::bind(&accessor::calculateLodRequestsMaster, this));
+        }
+    }
+
+    /**
+     * @brief calculateLodRequestsMaster caches the lod-voxel of the requested sides, by the worker-threads. Does nothing while tiles are in work.
+     * @see requestLod()
+     */
+    void calculateLodRequestsMaster()
+    {
+        if (m_numTilesInWork > 0 || m_lodRequests.empty())
+        {
+            return;
+        }
+        t_lodRequests toCalculate;
+        for (auto request : m_lodRequests)
+        {
+            t_tilePtr workTile(getTile(request.first));
+            if (workTile.isNull())
+            {
+                continue;
+            }
+            uint8 sides(0);
             for (int32 lod = 0; lod < 6; ++lod)
             {
-                const vector3int32& start(toIterate[lod][0]);
-                const vector3int32& end(toIterate[lod][1]);
-                for (int32 indX = start.x; indX < end.x; ++indX)
+                if ((request.second & (1 << lod)) != 0 && !workTile->getCalculateLodFace(lod))
                 {
-                    for (int32 indY = start.y; indY < end.y; ++indY)
-                    {
-                        for (int32 indZ = start.z; indZ < end.z; ++indZ)
-                        {
-                            const vector3int32 pos(indX, indY, indZ);
-                            const vector3int32 voxelPosAbs(voxelStart + pos*(m_voxelSkip/2));
-
-                            const t_voxel result(getVoxelData(voxelPosAbs, /*lastUsedTileBounds, */lastUsedTiles));
-    #ifdef BLUB_DEBUG
-                            if (indX % 2 == 0 &&
-                                indY % 2 == 0 &&
-                                indZ % 2 == 0)
-                            {
-                                BASSERT(workTile->getVoxel(pos / 2) == result);
-                            }
-    #endif
-
-                            valuesChanged |= workTile->setVoxelLod(pos-start, result, lod);
-                        }
-                    }
+                    sides |= (1 << lod);
                 }
             }
+            if (sides != 0)
+            {
+                toCalculate.insert(request.first, sides);
+            }
         }
-
-        if (workTile->isEmpty() || workTile->isFull())
+        m_lodRequests.clear();
+        if (toCalculate.empty())
         {
-            t_base::m_master.post(boost::bind(&accessor::afterCalculateAccessorMaster, this, id, nullptr, true));
             return;
         }
 
-        t_base::m_master.post(boost::bind(&accessor::afterCalculateAccessorMaster, this, id, workTile, valuesChanged));
+        // tilesGotChangedMaster() waits until the sides got cached
+        m_numTilesInWork = toCalculate.size();
+        lockVoxelsForReadAsync(boost::bind(&accessor::lockForCalculateAccessorLodTilesMaster, this, toCalculate));
+    }
+
+    /**
+     * @brief lockForCalculateAccessorLodTilesMaster locks for write after the voxel got read-locked by calculateLodRequestsMaster().
+     * @param toCalculate Tiles and their sides.
+     */
+    void lockForCalculateAccessorLodTilesMaster(const t_lodRequests& toCalculate)
+    {
+        t_base::lockForEditMasterAsync(boost::bind(&accessor::calculateAccessorLodTilesMaster, this, toCalculate));
+    }
+
+    /**
+     * @brief calculateAccessorLodTilesMaster dispatches the caching of the requested sides after locked for write.
+     * @param toCalculate Tiles and their sides.
+     */
+    void calculateAccessorLodTilesMaster(const t_lodRequests& toCalculate)
+    {
+        t_jobList jobs;
+        for (auto work : toCalculate)
+        {
+            jobs.push_back(t_tileJob(work.first, boost::bind(&accessor::calculateAccessorLodTS, this, work.first, getTile(work.first), work.second)));
+        }
+        t_base::dispatchJobsMaster(jobs, getTileSize());
+    }
+
+    /**
+     * @brief calculateAccessorLodTS enables the caching of sides of a tile and pulls out their lod-voxel. Gets called by any worker-thread.
+     * The edited voxel bounds of the tile stay invalid, so surface calculates only the transvoxel-lists.
+     * @param id Accessor-TileId
+     * @param workTile The accessor-tile.
+     * @param sides One bit per side to cache.
+     */
+    void calculateAccessorLodTS(const t_tileId& id, t_tilePtr workTile, const uint8& sides)
+    {
+        BLUB_TRACE_SCOPE_TILE("calculateAccessorLodTS", "accessor", id, m_lod);
+        workTile = copyTile(workTile);
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            if ((sides & (1 << lod)) != 0)
+            {
+                workTile->setCalculateLodFace(lod, true);
+            }
+        }
+        t_tileHolderCache lastUsedTilesLod;
+        calculateAccessorLod(id, workTile, axisAlignedBoxInt32(vector3int32(-1), vector3int32(t_tile::voxelLength+1)), lastUsedTilesLod);
+        // the voxel for marching-cubes didn't change
+        workTile->resetEditedVoxelBoundingBox();
+
+        t_base::m_master.post(boost::bind(&accessor::afterCalculateAccessorMaster, this, id, workTile, true, false));
     }
 
     /**
@@ -265,8 +574,9 @@ protected:
      * @param id TileId
      * @param workTile The resulting accessor-tile.
      * @param didValuesChanged Tells if anything changed.
+     * @param isFull If workTile is nullptr, tells if the tile is full instead of empty.
      */
-    void afterCalculateAccessorMaster(const t_tileId& id, t_tilePtr workTile, const bool &didValuesChanged)
+    void afterCalculateAccessorMaster(const t_tileId& id, t_tilePtr workTile, const bool &didValuesChanged, const bool &isFull)
     {
         BASSERT(t_base::getTilesThatGotEdited().find(id) == t_base::getTilesThatGotEdited().cend());
 
@@ -275,148 +585,374 @@ protected:
         // no indices
         if (workTile.isNull())
         {
-            if (it != m_tiles.cend())
+            const bool wasFull(m_tilesFull.find(id) != m_tilesFull.cend());
+            if (it != m_tiles.cend() || wasFull != isFull)
             {
-                m_tiles.erase(it);
-                t_base::addToChangeList(id, nullptr);
+                if (it != m_tiles.cend())
+                {
+                    it->second->increaseVersion();
+                    m_tiles.erase(it);
+                }
+                if (isFull)
+                {
+                    m_tilesFull.insert(id);
+                    t_base::addFullToChangeList(id);
+                }
+                else
+                {
+                    m_tilesFull.erase(id);
+                    t_base::addToChangeList(id, nullptr);
+                }
             }
         }
         else
         {
             BASSERT(!workTile.isNull());
+            m_tilesFull.erase(id);
             if (it == m_tiles.cend())
             {
                 m_tiles.insert(id, workTile);
+                t_base::addToChangeList(id, workTile);
             }
+            else
             if (didValuesChanged)
             {
+                // jobs of the reading classes, that didn't start yet, skip the replaced tile
+                it->second->increaseVersion();
+                m_tiles.insert(id, workTile);
                 t_base::addToChangeList(id, workTile);
             }
+            // else the copy gets dropped
         }
 
 
         --m_numTilesInWork;
+        t_base::afterJobMaster();
         if (m_numTilesInWork == 0)
         {
             if (t_base::m_tilesThatGotEdited.size() == 0)
             {
-                BLUB_LOG_WARNING() << "nothing changed";
+                BLUB_LOG_RATE_LIMITED(BLUB_LOG_WARNING(), 1) << "nothing changed";
             }
-            m_voxels.unlockRead();
+            getMetrics().tilesChanged.add(t_base::m_tilesThatGotEdited.size());
+            unlockVoxelsRead();
             t_base::unlockForEditMaster();
+
+            if (m_tilesGotChangedPending)
+            {
+                m_tilesGotChangedPending = false;
+                // voxel got read-locked by tilesGotChanged()
+                tilesGotChangedMaster();
+            }
+            // does nothing if the change above got in work
+            calculateLodRequestsMaster();
         }
     }
 
 
     /**
-     * @brief When a tile in container gets changed it affects (because of normal-correction and lod) 3^3 accessor-tiles.
+     * @brief When a tile in container gets changed it affects (because of normal-correction and lod) up to 3^3 accessor-tiles.
      * @param conterainerId Container-Tile-Id
      * @param holder Container-Data
-     * @param resultingSurfaceTiles Resulting, up to 27, to recalculate tiles.
+     * @param resultingSurfaceTiles Resulting, up to 27, to recalculate tiles and their voxel to pull out again, in tile-coordinates.
      * Depending on how the change-axisAligendBox in the container-tile looks like.
      */
-    void calculateAffectedAccessorTilesByContainerTile(const t_tileId& conterainerId, const t_tileHolder &holder, t_tileIdList& resultingSurfaceTiles)
+    void calculateAffectedAccessorTilesByContainerTile(const t_tileId& conterainerId, const t_tileHolder &holder, t_dirtyTiles& resultingSurfaceTiles)
     {
-        const vector3 forDiv(conterainerId);
-        const vector3int32 result((forDiv / (real)m_voxelSkip).getFloor());
-        resultingSurfaceTiles.insert(result);
-
-        vector3int32 minimum(0);
+        const int32 voxelLength(t_tile::voxelLength);
+        axisAlignedBoxInt32 changed(vector3int32(0), vector3int32(voxelLength-1));
         if (holder.state == t_tileState::partitial)
         {
             BASSERT(holder.data->getEditedVoxelBoundingBox().isValid());
-            minimum = holder.data->getEditedVoxelBoundingBox().getMinimum();
+            changed = holder.data->getEditedVoxelBoundingBox();
         }
-        if (minimum > vector3int32(0))
+        const vector3int32 changedMinimum(conterainerId*voxelLength + changed.getMinimum());
+        vector3int32 changedMaximum(conterainerId*voxelLength + changed.getMaximum());
+        if (&m_voxelsLod != &m_voxels)
         {
-            return;
+            // voxel x got reduced from lod-voxel 2*x to 2*x+1, see container::downsampled
+            changedMaximum = changedMaximum + vector3int32(1);
         }
 
-        const vector3int32 resultMod(conterainerId%m_voxelSkip);
-        if (resultMod.x == 0 && minimum.x == 0)
+        // accessor-tile id reads the voxel from id*tileLength-m_voxelSkip to (id+1)*tileLength+m_voxelSkip
+        const int32 tileLength(voxelLength*m_voxelSkip);
+        const vector3int32 first(divideCeil(changedMinimum - vector3int32(tileLength + m_voxelSkip), tileLength));
+        const vector3int32 last(divideFloor(changedMaximum + vector3int32(m_voxelSkip), tileLength));
+        for (int32 indX = first.x; indX <= last.x; ++indX)
         {
-            resultingSurfaceTiles.insert(result - vector3int32(1, 0, 0));
-        }
-        if (resultMod.y == 0 && minimum.y == 0)
-        {
-            resultingSurfaceTiles.insert(result - vector3int32(0, 1, 0));
-        }
-        if (resultMod.z == 0 && minimum.z == 0)
-        {
-            resultingSurfaceTiles.insert(result - vector3int32(0, 0, 1));
-        }
-        if (resultMod.x == 0 && resultMod.y == 0 && minimum.x == 0 && minimum.y == 0)
-        {
-            resultingSurfaceTiles.insert(result - vector3int32(1, 1, 0));
+            for (int32 indY = first.y; indY <= last.y; ++indY)
+            {
+                for (int32 indZ = first.z; indZ <= last.z; ++indZ)
+                {
+                    const t_tileId id(indX, indY, indZ);
+                    const vector3int32 start(id*tileLength);
+                    vector3int32 dirtyMinimum(divideFloor(changedMinimum - start, m_voxelSkip));
+                    vector3int32 dirtyMaximum(divideCeil(changedMaximum - start, m_voxelSkip));
+                    dirtyMinimum = dirtyMinimum.getMaximum(vector3int32(-1));
+                    dirtyMaximum = dirtyMaximum.getMinimum(vector3int32(voxelLength+1));
+                    const axisAlignedBoxInt32 dirty(dirtyMinimum, dirtyMaximum);
+
+                    typename t_dirtyTiles::iterator it(resultingSurfaceTiles.find(id));
+                    if (it == resultingSurfaceTiles.end())
+                    {
+                        resultingSurfaceTiles.insert(id, dirty);
+                    }
+                    else
+                    {
+                        it->second.extend(dirty);
+                    }
+                }
+            }
         }
-        if (resultMod.x == 0 && resultMod.z == 0 && minimum.x == 0 && minimum.z == 0)
+    }
+
+    /**
+     * @brief divideFloor divides every component and rounds towards negative infinity.
+     */
+    static vector3int32 divideFloor(const vector3int32& value, const int32& divisor)
+    {
+        return vector3int32(divideFloor(value.x, divisor), divideFloor(value.y, divisor), divideFloor(value.z, divisor));
+    }
+    static int32 divideFloor(const int32& value, const int32& divisor)
+    {
+        BASSERT(divisor > 0);
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+    /**
+     * @brief divideCeil divides every component and rounds towards positive infinity.
+     */
+    static vector3int32 divideCeil(const vector3int32& value, const int32& divisor)
+    {
+        return -divideFloor(-value, divisor);
+    }
+
+    /**
+     * @brief createTile creates an empty tile.
+     * @return
+     */
+    t_tilePtr createTile() const override
+    {
+        t_tilePtr result(t_base::createTile());
+        result->setCalculateLod(m_lod > 0 && !m_calculateLodOnDemand);
+        return result;
+    }
+
+    /**
+     * @brief copyTile copies a tile before it gets changed. The tiles of m_tiles never change, the reading classes
+     * keep the tiles of a change without locking this class, while the next change gets calculated (copy-on-write).
+     * The replaced tiles get freed after the last reading class released them.
+     * @param toCopy Must not be nullptr.
+     * @return The copy.
+     * @see tile::accessor::copy()
+     */
+    t_tilePtr copyTile(t_tilePtr toCopy) const
+    {
+        BASSERT(!toCopy.isNull());
+        t_tilePtr result(t_base::createTile());
+        result->copy(*toCopy);
+        return result;
+    }
+
+    /**
+     * @brief lockVoxelsForRead read-locks the voxel containers. The one with more detail first, same order as container::downsampled locks.
+     */
+    void lockVoxelsForRead()
+    {
+        if (&m_voxelsLod != &m_voxels)
         {
-            resultingSurfaceTiles.insert(result - vector3int32(1, 0, 1));
+            m_voxelsLod.lockForRead();
         }
-        if (resultMod.y == 0 && resultMod.z == 0 && minimum.y == 0 && minimum.z == 0)
+        m_voxels.lockForRead();
+    }
+
+    /**
+     * @brief lockVoxelsForReadAsync read-locks the voxel containers like lockVoxelsForRead(), without blocking the thread while one of them gets edited.
+     * See simple::base::lockForReadAsync().
+     * @param afterLocked Gets called by the master dispatcher after both got locked.
+     */
+    void lockVoxelsForReadAsync(const t_job& afterLocked)
+    {
+        async::strand& master(t_base::m_master);
+        const t_job postAfterLocked([&master, afterLocked] {master.post(afterLocked);});
+        if (&m_voxelsLod != &m_voxels)
         {
-            resultingSurfaceTiles.insert(result - vector3int32(0, 1, 1));
+            t_simpleContainerVoxel& voxels(m_voxels);
+            m_voxelsLod.lockForReadAsync([&voxels, postAfterLocked] {voxels.lockForReadAsync(postAfterLocked);});
+            return;
         }
-        if (resultMod.x == 0 && resultMod.y == 0 && resultMod.z == 0 && minimum == vector3int32(0))
+        m_voxels.lockForReadAsync(postAfterLocked);
+    }
+
+    /**
+     * @brief unlockVoxelsRead unlocks the voxel containers locked by lockVoxelsForRead() or lockVoxelsForReadAsync().
+     */
+    void unlockVoxelsRead()
+    {
+        m_voxels.unlockRead();
+        if (&m_voxelsLod != &m_voxels)
         {
-            resultingSurfaceTiles.insert(result - vector3int32(1, 1, 1));
+            m_voxelsLod.unlockRead();
         }
     }
 
     /**
-     * @brief createTile creates an empty tile.
-     * @return
+     * @brief gatherVoxel pulls out the voxel of toGather, container-brick by container-brick.
+     * Bricks that are completely minimum or maximum get filled without reading their voxel.
+     * @param id Accessor-TileId
+     * @param workTile The accessor-tile to fill.
+     * @param toGather Voxel to pull out, in tile-coordinates.
+     * @return true if any voxel changed.
+     * @see tile::container::isBrickEmpty()
      */
-    t_tilePtr createTile() const override
+    bool gatherVoxel(const t_tileId& id, t_tilePtr workTile, const axisAlignedBoxInt32& toGather)
     {
-        t_tilePtr result(t_base::createTile());
-        result->setCalculateLod(m_lod > 0);
+        const int32 voxelLength(t_tile::voxelLength);
+        const int32 brickLength(t_tileContainer::brickLength);
+
+        const vector3int32 voxelStart(id*voxelLength*m_voxelSkip);
+        const vector3int32 gatherMinimumAbs(voxelStart + toGather.getMinimum()*m_voxelSkip);
+        const vector3int32 gatherMaximumAbs(voxelStart + toGather.getMaximum()*m_voxelSkip);
+        const t_tileId containerFirst(divideFloor(gatherMinimumAbs, voxelLength));
+        const t_tileId containerLast(divideFloor(gatherMaximumAbs, voxelLength));
+
+        bool result(false);
+        for (int32 containerX = containerFirst.x; containerX <= containerLast.x; ++containerX)
+        {
+            for (int32 containerY = containerFirst.y; containerY <= containerLast.y; ++containerY)
+            {
+                for (int32 containerZ = containerFirst.z; containerZ <= containerLast.z; ++containerZ)
+                {
+                    const t_tileId containerId(containerX, containerY, containerZ);
+                    const t_tileHolder holder(m_voxels.getTileHolder(containerId));
+                    const vector3int32 containerStart(containerId*voxelLength);
+                    const vector3int32 localMinimum((gatherMinimumAbs - containerStart).getMaximum(vector3int32(0)));
+                    const vector3int32 localMaximum((gatherMaximumAbs - containerStart).getMinimum(vector3int32(voxelLength-1)));
+                    const vector3int32 brickFirst(localMinimum / brickLength);
+                    const vector3int32 brickLast(localMaximum / brickLength);
+
+                    for (int32 brickX = brickFirst.x; brickX <= brickLast.x; ++brickX)
+                    {
+                        for (int32 brickY = brickFirst.y; brickY <= brickLast.y; ++brickY)
+                        {
+                            for (int32 brickZ = brickFirst.z; brickZ <= brickLast.z; ++brickZ)
+                            {
+                                const vector3int32 brick(brickX, brickY, brickZ);
+                                const vector3int32 brickMinimum((brick*brickLength).getMaximum(localMinimum));
+                                const vector3int32 brickMaximum((brick*brickLength + vector3int32(brickLength-1)).getMinimum(localMaximum));
+                                // the accessor-voxel inside the brick
+                                const vector3int32 posMinimum(divideCeil(containerStart + brickMinimum - voxelStart, m_voxelSkip));
+                                const vector3int32 posMaximum(divideFloor(containerStart + brickMaximum - voxelStart, m_voxelSkip));
+                                if (!(posMinimum <= posMaximum))
+                                {
+                                    continue;
+                                }
+
+                                t_voxel uniform;
+                                bool isUniform(true);
+                                switch (holder.state)
+                                {
+                                case t_tileState::partitial:
+                                    if (holder.data->isBrickEmpty(brick))
+                                    {
+                                        uniform.setMin();
+                                    }
+                                    else if (holder.data->isBrickFull(brick))
+                                    {
+                                        uniform.setMax();
+                                    }
+                                    else
+                                    {
+                                        isUniform = false;
+                                    }
+                                    break;
+                                case t_tileState::empty:
+                                    uniform.setMin();
+                                    break;
+                                case t_tileState::full:
+                                    uniform.setMax();
+                                    break;
+                                default:
+                                    BASSERT(false);
+                                }
+
+                                for (int32 indX = posMinimum.x; indX <= posMaximum.x; ++indX)
+                                {
+                                    for (int32 indY = posMinimum.y; indY <= posMaximum.y; ++indY)
+                                    {
+                                        for (int32 indZ = posMinimum.z; indZ <= posMaximum.z; ++indZ)
+                                        {
+                                            const vector3int32 pos(indX, indY, indZ);
+                                            if (isUniform)
+                                            {
+                                                result |= workTile->setVoxel(pos, uniform);
+                                            }
+                                            else
+                                            {
+                                                const vector3int32 voxelPos(voxelStart + pos*m_voxelSkip - containerStart);
+                                                result |= workTile->setVoxel(pos, holder.data->getVoxel(t_tileContainer::calculateIndex(voxelPos)));
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
         return result;
     }
 
     /**
      * @brief getVoxelData returns a voxel from a cahned container-tile or looks up the tile and returns it.
+     * @param voxels The container to look up.
      * @param voxelPosAbs Absolut voxel position.
-     * @param lastUsedTiles Last used container-tile.
+     * @param lastUsedTiles Last used container-tiles.
      * @return Always a valid voxel. If not found a default-constructed voxel.
      */
-    t_voxel getVoxelData(const vector3int32& voxelPosAbs, t_tileHolderMap& lastUsedTiles)
+    t_voxel getVoxelData(const t_simpleContainerVoxel& voxels, const vector3int32& voxelPosAbs, t_tileHolderCache& lastUsedTiles)
     {
-        const vector3int32 &tilePos(m_voxels.calculateVoxelPosToTileId(voxelPosAbs));
-        const vector3int32 &tilePosAbs(tilePos*vector3int32(t_tile::voxelLength));
+        const int32 voxelLength(t_tile::voxelLength);
 
-        typename t_tileHolderMap::const_iterator it = lastUsedTiles.find(tilePos);
-
-        t_voxel result;
-        if (it != lastUsedTiles.cend())
+        // neighbouring voxel mostly lie in the same tile - skip the look up
+        if (lastUsedTiles.last != nullptr)
         {
-            const t_tileHolder &lastUsedTile(it->second);
-            switch(lastUsedTile.state)
+            const vector3int32 posInLast(voxelPosAbs - lastUsedTiles.lastId*voxelLength);
+            if (posInLast >= vector3int32(0) && posInLast < vector3int32(voxelLength))
             {
-            case t_tileState::partitial:
-                result = lastUsedTile.data->getVoxel(voxelPosAbs-tilePosAbs);
-                break;
-            case t_tileState::empty:
-                result.setMin();
-                break;
-            case t_tileState::full:
-                result.setMax();
-                break;
-            default:
-                BASSERT(false);
+                return getVoxelData(*lastUsedTiles.last, posInLast);
             }
-            return result;
         }
 
-        // get new tile
-        const t_tileHolder &lastUsedTile(m_voxels.getTileHolder(tilePos));
-        lastUsedTiles.insert(tilePos, lastUsedTile);
+        const vector3int32 &tilePos(voxels.calculateVoxelPosToTileId(voxelPosAbs));
+        const vector3int32 &tilePosAbs(tilePos*vector3int32(voxelLength));
+
+        typename t_tileHolderMap::const_iterator it = lastUsedTiles.tiles.find(tilePos);
+        if (it == lastUsedTiles.tiles.cend())
+        {
+            // get new tile
+            lastUsedTiles.tiles.insert(tilePos, voxels.getTileHolder(tilePos));
+            it = lastUsedTiles.tiles.find(tilePos);
+        }
+        lastUsedTiles.lastId = tilePos;
+        lastUsedTiles.last = &it->second;
+
+        return getVoxelData(it->second, voxelPosAbs-tilePosAbs);
+    }
 
-        // repeat step ahead
+    /**
+     * @brief getVoxelData returns a voxel of a container-tile.
+     * @param lastUsedTile The container-tile.
+     * @param voxelPos Voxel position inside the tile.
+     * @return Always a valid voxel.
+     */
+    static t_voxel getVoxelData(const t_tileHolder &lastUsedTile, const vector3int32& voxelPos)
+    {
+        t_voxel result;
         switch(lastUsedTile.state)
         {
         case t_tileState::partitial:
-            result = lastUsedTile.data->getVoxel(voxelPosAbs-tilePosAbs);
+            result = lastUsedTile.data->getVoxel(voxelPos);
             break;
         case t_tileState::empty:
             result.setMin();
@@ -433,11 +969,19 @@ protected:
 protected:
 
     t_simpleContainerVoxel& m_voxels;
+    t_simpleContainerVoxel& m_voxelsLod;
     const int32 m_lod;
     const int32 m_voxelSkip;
+    const int32 m_voxelSkipLod;
     int32 m_numTilesInWork;
+    bool m_tilesGotChangedPending;
+
+    bool m_calculateLodOnDemand;
+    t_lodRequests m_lodRequests;
 
     t_tiles m_tiles;
+    // the tiles without accessor-tile that are full, the others are empty
+    t_tileIdList m_tilesFull;
 
     boost::signals2::scoped_connection m_connTilesGotChanged;
 };
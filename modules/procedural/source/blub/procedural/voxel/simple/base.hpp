@@ -1,18 +1,26 @@
 #ifndef PROCEDURAL_VOXEL_SIMPLE_BASE_HPP
 #define PROCEDURAL_VOXEL_SIMPLE_BASE_HPP
 
+#include "blub/async/mutexLocker.hpp"
 #include "blub/async/mutexReadWrite.hpp"
 #include "blub/async/predecl.hpp"
 #include "blub/core/bind.hpp"
 #include "blub/core/globals.hpp"
+#include "blub/core/hashList.hpp"
 #include "blub/core/hashMap.hpp"
+#include "blub/core/pair.hpp"
 #include "blub/core/signal.hpp"
+#include "blub/core/vector.hpp"
 #include "blub/async/dispatcher.hpp"
 #include "blub/async/strand.hpp"
+#include "blub/math/math.hpp"
+#include "blub/math/vector3.hpp"
 #include "blub/math/vector3int.hpp"
 #include "blub/procedural/log/global.hpp"
 #include "blub/procedural/predecl.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 
 
@@ -43,9 +51,14 @@ public:
     /** id Identifier. Contains voxel from id*blub::procedural::voxel::tile::container::voxelLength to (id+1)*blub::procedural::voxel::tile::container::voxelLength-1 */
     typedef vector3int32 t_tileId;
     typedef hashMap<t_tileId, t_tilePtr> t_tilesGotChangedMap;
+    typedef hashList<t_tileId> t_tilesGotFullList;
 
     typedef std::function<t_tilePtr ()> t_createTileCallback;
 
+    typedef vector<vector3> t_positionList;
+    typedef std::function<void ()> t_job;
+    typedef vector<pair<t_tileId, t_job> > t_jobList;
+
     /**
      * @brief base constructor
      * @param worker may gets run by multiple threads.
@@ -73,8 +86,16 @@ public:
      * @brief lockForRead locks the class for reading.
      */
     void lockForRead();
+    /**
+     * @brief lockForReadAsync locks the class for reading and calls afterLocked, without blocking the thread while the class is locked for write.
+     * In that case afterLocked gets called by the master dispatcher of this class, after unlockForEditMaster(). Thread-safe.
+     * Use it from a master dispatcher, where waiting for another class' edit would block a worker-thread.
+     * @param afterLocked Post it to your own dispatcher, it may get called by a foreign one.
+     */
+    void lockForReadAsync(const t_job& afterLocked);
     /**
      * @brief unlockRead unlocks the class after reading.
+     * Continues a lockForEditMasterAsync() waiting for the readers.
      */
     void unlockRead();
 
@@ -83,6 +104,12 @@ public:
      * @return
      */
     const t_tilesGotChangedMap &getTilesThatGotEdited() const;
+    /**
+     * @brief getTilesThatGotFull returns the tiles of getTilesThatGotEdited() that got removed because all their voxel are maximum.
+     * The other removed tiles are empty. A tile that was full before and got removed again is empty now.
+     * @return
+     */
+    const t_tilesGotFullList &getTilesThatGotFull() const;
 
     /**
      * @brief setCreateTileCallback sets a callback for creating tiles.
@@ -99,6 +126,51 @@ public:
      */
     blub::async::strand &getMaster();
 
+    /**
+     * @brief requestLod requests the transvoxel-list (the crack closing submesh) of a side of a tile.
+     * Classes that calculate the lists only on demand implement it and report the tile as changed after the list got calculated.
+     * The default implementation does nothing. Thread-safe.
+     * @param id TileId
+     * @param lod Side of the tile, 0 to 5, same index as tile::renderer::setVisibleLod().
+     */
+    virtual void requestLod(const t_tileId& id, const int32& lod);
+
+    /**
+     * @brief setPriorityPositions sets the positions, for example of the cameras, near which tiles get calculated first.
+     * Affects the tiles that get dispatched afterwards. Thread-safe.
+     * Classes that get their tiles from another class forward the positions to it.
+     * @param positions In world-coordinates. If empty the tiles get dispatched in no particular order.
+     * @see setIncrementalRelease()
+     */
+    virtual void setPriorityPositions(const t_positionList& positions);
+
+    /**
+     * @brief setIncrementalRelease sets if the tiles of a change get reported in parts, the ones next to the priority positions first.
+     * The first part contains firstPart tiles, every following twice as many as the one before. After a part got calculated
+     * the class gets unlocked and signalEditDone() gets called, so the tiles get shown before the whole change got calculated.
+     * Works only if priority positions got set. Call by master dispatcher, or before the first edit.
+     * @param firstPart Number of tiles of the first part. 0 reports all tiles at once. Default 0.
+     * @see setPriorityPositions()
+     */
+    void setIncrementalRelease(const int32& firstPart);
+    /**
+     * @brief getIncrementalRelease returns the value set by setIncrementalRelease().
+     * @return
+     */
+    const int32& getIncrementalRelease() const;
+
+    /**
+     * @brief getNumJobs returns the number of tile-jobs dispatched since construction. Call by master dispatcher or after all work got done.
+     * @return
+     */
+    const uint64& getNumJobs() const;
+    /**
+     * @brief getNumJobsCancelled returns the number of tile-jobs that skipped their work, because the tile changed again before they started.
+     * @return Part of getNumJobs().
+     * @see tile::accessor::getVersion()
+     */
+    const uint64& getNumJobsCancelled() const;
+
     typedef blub::signal<void ()> t_sigEditDone;
     /**
      * @brief signalEditDone gets called after unlockForEdit() got called.
@@ -114,6 +186,12 @@ protected:
      * @see getTilesThatGotEdited()
      */
     void addToChangeList(const t_tileId& id, t_tilePtr toAdd);
+    /**
+     * @brief addFullToChangeList adds a tile to the change-list that got removed because it is full.
+     * @param id
+     * @see getTilesThatGotFull()
+     */
+    void addFullToChangeList(const t_tileId& id);
 
     /**
      * @brief tryLockForEditMaster tries to lock for write. Call by master dispatcher.
@@ -126,8 +204,17 @@ protected:
     virtual void lockForEditMaster();
     /**
      * @brief unlockForEditMaster unlocks write. Call by master dispatcher.
+     * Continues a lockForEditMasterAsync() waiting for the lock and all lockForReadAsync() waiting for the unlock.
      */
     virtual void unlockForEditMaster();
+    /**
+     * @brief lockForEditMasterAsync locks for write and calls afterLocked by the master dispatcher afterwards. Call by master dispatcher.
+     * Unlike lockForEditMaster() it doesn't block the thread while the lock is taken, unlockRead() and unlockForEditMaster() continue it.
+     * Blocking would stall the pipeline as soon as all worker-threads wait for a lock, while the readers need a thread to finish.
+     * Calls of other methods by the master dispatcher may run before afterLocked; keep track of the waiting state.
+     * @param afterLocked Gets called in order of the calls.
+     */
+    void lockForEditMasterAsync(const t_job& afterLocked);
 
     /**
      * @brief createTile creates a new Tile. Uses callback set by setCreateTileCallback()
@@ -135,6 +222,33 @@ protected:
      */
     virtual t_tilePtr createTile() const;
 
+    /**
+     * @brief setPriorityPositionsMaster see setPriorityPositions(). Call by master dispatcher.
+     * @param positions
+     */
+    virtual void setPriorityPositionsMaster(const t_positionList& positions);
+
+    /**
+     * @brief dispatchJobsMaster posts jobs to the worker, the ones of tiles next to the priority positions first.
+     * Lock for edit before. Every job has to lead to exactly one call of afterJobMaster(), by the master dispatcher.
+     * If incremental release is enabled only a part gets posted, see setIncrementalRelease().
+     * @param jobs Jobs and the tile they calculate. Gets cleared.
+     * @param tileSize Size of a tile in world-coordinates.
+     */
+    void dispatchJobsMaster(t_jobList& jobs, const real& tileSize);
+    /**
+     * @brief afterJobMaster gets called by the derived class after a job posted by dispatchJobsMaster() got done.
+     * If the current part got done and jobs are left, unlocks for edit, which calls signalEditDone(),
+     * and posts the next part after the write-lock got received again.
+     * @param cancelled true if the job skipped its work. See getNumJobsCancelled().
+     */
+    void afterJobMaster(const bool& cancelled = false);
+    /**
+     * @brief isDispatchingMaster returns true as long as jobs posted by dispatchJobsMaster() are left.
+     * @return
+     */
+    bool isDispatchingMaster() const;
+
 protected:
     /**
      * @brief m_master The master synchronises jobs for the worker-thread and writes to class member.
@@ -148,12 +262,36 @@ protected:
     blub::async::dispatcher &m_worker;
 
     t_tilesGotChangedMap m_tilesThatGotEdited;
+    t_tilesGotFullList m_tilesThatGotFull;
 
     t_createTileCallback m_createTileCallback;
 
     async::mutexReadWrite m_classLocker;
 
     t_sigEditDone m_sigEditDone;
+
+private:
+    void dispatchPartMaster();
+    void tryLockForEditMasterAsync();
+    void retryLockForEditMasterAsync();
+    void notifyUnlocked();
+    void continueLockForReadAsync();
+
+    t_positionList m_priorityPositions;
+    int32 m_incrementalRelease;
+    // sorted, the job of the tile nearest to the priority positions at the back
+    vector<t_job> m_jobs;
+    int32 m_jobsInWork;
+    int32 m_partSize;
+    vector<t_job> m_waitingForLock;
+    // set while m_waitingForLock isn't empty, read by the threads that unlock
+    std::atomic<bool> m_waitingForUnlock;
+    std::atomic<bool> m_retryLockPosted;
+    // read-locks waiting for the write-lock to get released, locked by the threads calling lockForReadAsync()
+    vector<t_job> m_waitingForRead;
+    async::mutex m_waitingForReadMutex;
+    uint64 m_numJobs;
+    uint64 m_numJobsCancelled;
 };
 
 template <class tileType>
@@ -161,6 +299,13 @@ base<tileType>::base(async::dispatcher &worker)
     : m_master(worker)
     , m_worker(worker)
 //    , m_createTileCallback(blub::bind(&t_tile::create)) // TODO good idea, techn difficult, via config
+    , m_incrementalRelease(0)
+    , m_jobsInWork(0)
+    , m_partSize(0)
+    , m_waitingForUnlock(false)
+    , m_retryLockPosted(false)
+    , m_numJobs(0)
+    , m_numJobsCancelled(0)
 {
     ;
 }
@@ -188,10 +333,27 @@ void base<tileType>::lockForRead()
     m_classLocker.lockForRead();
 }
 
+template <class tileType>
+void base<tileType>::lockForReadAsync(const t_job &afterLocked)
+{
+    {
+        // an unlock between the try and the push_back would get lost otherwise
+        async::mutexLocker locker(m_waitingForReadMutex);
+        if (!m_classLocker.tryLockForRead())
+        {
+            // gets continued by unlockForEditMaster()
+            m_waitingForRead.push_back(afterLocked);
+            return;
+        }
+    }
+    afterLocked();
+}
+
 template <class tileType>
 void base<tileType>::unlockRead()
 {
     m_classLocker.unlockRead();
+    notifyUnlocked();
 }
 
 template <class tileType>
@@ -200,6 +362,12 @@ const typename base<tileType>::t_tilesGotChangedMap &base<tileType>::getTilesTha
     return m_tilesThatGotEdited;
 }
 
+template <class tileType>
+const typename base<tileType>::t_tilesGotFullList &base<tileType>::getTilesThatGotFull() const
+{
+    return m_tilesThatGotFull;
+}
+
 template <class tileType>
 void base<tileType>::setCreateTileCallback(const t_createTileCallback &callback)
 {
@@ -211,6 +379,15 @@ void base<tileType>::addToChangeList(const t_tileId &id, t_tilePtr toAdd)
 {
     BASSERT(!m_classLocker.tryLockForWrite());
     m_tilesThatGotEdited.insert(id, toAdd);
+    m_tilesThatGotFull.erase(id);
+}
+
+template <class tileType>
+void base<tileType>::addFullToChangeList(const t_tileId &id)
+{
+    BASSERT(!m_classLocker.tryLockForWrite());
+    m_tilesThatGotEdited.insert(id, nullptr);
+    m_tilesThatGotFull.insert(id);
 }
 
 template <class tileType>
@@ -220,6 +397,7 @@ bool base<tileType>::tryLockForEditMaster()
     if (result)
     {
         m_tilesThatGotEdited.clear();
+        m_tilesThatGotFull.clear();
     }
     return result;
 }
@@ -230,12 +408,15 @@ void base<tileType>::lockForEditMaster()
     m_classLocker.lockForWrite();
 
     m_tilesThatGotEdited.clear();
+    m_tilesThatGotFull.clear();
 }
 
 template <class tileType>
 void base<tileType>::unlockForEditMaster()
 {
     m_classLocker.unlock();
+    notifyUnlocked();
+    continueLockForReadAsync();
 #ifdef BLUB_LOG_VOXEL
     BLUB_PROCEDURAL_LOG_OUT() << "simple master unlock m_tilesThatGotEdited.size():" << m_tilesThatGotEdited.size();
 #endif
@@ -257,6 +438,199 @@ blub::async::strand &base<tileType>::getMaster()
     return m_master;
 }
 
+template <class tileType>
+void base<tileType>::requestLod(const t_tileId &id, const int32 &lod)
+{
+    (void)id;
+    (void)lod;
+}
+
+template <class tileType>
+void base<tileType>::setPriorityPositions(const t_positionList &positions)
+{
+    m_master.post(boost::bind(&base::setPriorityPositionsMaster, this, positions));
+}
+
+template <class tileType>
+void base<tileType>::setPriorityPositionsMaster(const t_positionList &positions)
+{
+    m_priorityPositions = positions;
+}
+
+template <class tileType>
+void base<tileType>::setIncrementalRelease(const int32 &firstPart)
+{
+    BASSERT(firstPart >= 0);
+    m_incrementalRelease = firstPart;
+}
+
+template <class tileType>
+const int32 &base<tileType>::getIncrementalRelease() const
+{
+    return m_incrementalRelease;
+}
+
+template <class tileType>
+const uint64 &base<tileType>::getNumJobs() const
+{
+    return m_numJobs;
+}
+
+template <class tileType>
+const uint64 &base<tileType>::getNumJobsCancelled() const
+{
+    return m_numJobsCancelled;
+}
+
+template <class tileType>
+void base<tileType>::dispatchJobsMaster(t_jobList &jobs, const real &tileSize)
+{
+    BASSERT(!isDispatchingMaster());
+    m_numJobs += jobs.size();
+    if (m_priorityPositions.empty())
+    {
+        for (auto work : jobs)
+        {
+            m_jobs.push_back(work.second);
+        }
+    }
+    else
+    {
+        // squared distance of the tile-center to the nearest position
+        vector<pair<real, int32> > sorted;
+        sorted.reserve(jobs.size());
+        for (uint32 index = 0; index < jobs.size(); ++index)
+        {
+            const vector3 center((vector3(jobs[index].first) + vector3(0.5))*tileSize);
+            real nearest(-1.);
+            for (const vector3& position : m_priorityPositions)
+            {
+                const real distance(center.squaredDistance(position));
+                if (nearest < 0. || distance < nearest)
+                {
+                    nearest = distance;
+                }
+            }
+            sorted.push_back(pair<real, int32>(nearest, index));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        for (auto it = sorted.crbegin(); it != sorted.crend(); ++it)
+        {
+            m_jobs.push_back(jobs[it->second].second);
+        }
+    }
+    jobs.clear();
+
+    m_partSize = m_jobs.size();
+    if (m_incrementalRelease > 0 && !m_priorityPositions.empty())
+    {
+        m_partSize = m_incrementalRelease;
+    }
+    dispatchPartMaster();
+}
+
+template <class tileType>
+void base<tileType>::afterJobMaster(const bool &cancelled)
+{
+    if (cancelled)
+    {
+        ++m_numJobsCancelled;
+    }
+    --m_jobsInWork;
+    BASSERT(m_jobsInWork >= 0);
+    if (m_jobsInWork > 0 || m_jobs.empty())
+    {
+        return;
+    }
+    // report the part, so it gets shown before the rest got calculated
+    unlockForEditMaster();
+    lockForEditMasterAsync(boost::bind(&base::dispatchPartMaster, this));
+}
+
+template <class tileType>
+bool base<tileType>::isDispatchingMaster() const
+{
+    return m_jobsInWork > 0 || !m_jobs.empty();
+}
+
+template <class tileType>
+void base<tileType>::dispatchPartMaster()
+{
+    BASSERT(m_jobsInWork == 0);
+    const int32 numJobs(math::min(m_partSize, (int32)m_jobs.size()));
+    m_jobsInWork = numJobs;
+    for (int32 index = 0; index < numJobs; ++index)
+    {
+        m_worker.post(m_jobs.back());
+        m_jobs.pop_back();
+    }
+    m_partSize *= 2;
+}
+
+template <class tileType>
+void base<tileType>::lockForEditMasterAsync(const t_job &afterLocked)
+{
+    m_waitingForLock.push_back(afterLocked);
+    if (m_waitingForLock.size() == 1)
+    {
+        tryLockForEditMasterAsync();
+    }
+}
+
+template <class tileType>
+void base<tileType>::tryLockForEditMasterAsync()
+{
+    BASSERT(!m_waitingForLock.empty());
+    // set before trying, so an unlock between the try and the return can't get lost
+    m_waitingForUnlock = true;
+    if (!tryLockForEditMaster())
+    {
+        // gets continued by notifyUnlocked()
+        return;
+    }
+    const t_job afterLocked(m_waitingForLock.front());
+    m_waitingForLock.erase(m_waitingForLock.begin());
+    // the others wait for the unlock of afterLocked's lock
+    m_waitingForUnlock = !m_waitingForLock.empty();
+    afterLocked();
+}
+
+template <class tileType>
+void base<tileType>::retryLockForEditMasterAsync()
+{
+    m_retryLockPosted = false;
+    if (m_waitingForLock.empty())
+    {
+        // got locked meanwhile
+        return;
+    }
+    tryLockForEditMasterAsync();
+}
+
+template <class tileType>
+void base<tileType>::notifyUnlocked()
+{
+    // one retry at a time; further unlocks until it runs get covered by it
+    if (m_waitingForUnlock && !m_retryLockPosted.exchange(true))
+    {
+        m_master.post(boost::bind(&base::retryLockForEditMasterAsync, this));
+    }
+}
+
+template <class tileType>
+void base<tileType>::continueLockForReadAsync()
+{
+    vector<t_job> waiting;
+    {
+        async::mutexLocker locker(m_waitingForReadMutex);
+        waiting.swap(m_waitingForRead);
+    }
+    for (const t_job& afterLocked : waiting)
+    {
+        lockForReadAsync(afterLocked);
+    }
+}
+
 template <class tileType>
 typename base<tileType>::t_sigEditDone *base<tileType>::signalEditDone()
 {
@@ -1,13 +1,23 @@
 #ifndef VOXEL_SIMPLE_CONTAINER_BASE_HPP
 #define VOXEL_SIMPLE_CONTAINER_BASE_HPP
 
+#include "blub/core/hashMap.hpp"
+#include "blub/core/metrics.hpp"
 #include "blub/core/sharedPointer.hpp"
+#include "blub/core/trace.hpp"
+#include "blub/core/vector.hpp"
 #include "blub/math/axisAlignedBox.hpp"
 #include "blub/math/axisAlignedBoxInt32.hpp"
+#include "blub/math/ray.hpp"
 #include "blub/math/transform.hpp"
+#include "blub/procedural/voxel/raycast.hpp"
+#include "blub/procedural/voxel/sample.hpp"
 #include "blub/procedural/voxel/simple/base.hpp"
 #include "blub/procedural/voxel/simple/container/utils/tile.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace blub
 {
@@ -50,6 +60,7 @@ public:
     base(blub::async::dispatcher &worker)
         : t_base(worker)
         , m_numInTilesInTask(0)
+        , m_lockingForEdit(false)
     {
 
     }
@@ -129,6 +140,186 @@ public:
         return workTile.data->getVoxel(calculateVoxelPosInTile(voxelPos));
     }
 
+    /**
+     * @brief raycast returns the first intersection of a ray with the iso-surface. Read-lock the class before call.
+     * Walks the voxel-cells by a 3d-dda and jumps over the cells of empty tiles and empty bricks (see tile::container::isBrickEmpty()) in one step.
+     * Inside a cell the density gets interpolated trilinear between its 8 voxel, sampled along the ray and the hit refined by regula falsi.
+     * @param toCast In absolute voxel-coordinates. The direction doesn't need to be normalized.
+     * @param maxDistance In voxel.
+     * @return If the origin is inside the solid the hit has distance 0.
+     */
+    raycastHit raycast(const ray& toCast, const real& maxDistance) const
+    {
+        t_raycastCache cache(*this);
+        return raycast(toCast, maxDistance, cache);
+    }
+    /**
+     * @brief raycast casts many rays, for example all projectiles of a frame. Shares the tile-lookups between the rays,
+     * so cast rays near each other together. Read-lock the class before call.
+     * @param toCast See raycast().
+     * @param maxDistance See raycast().
+     * @param result Gets resized to the number of rays.
+     */
+    void raycast(const vector<ray>& toCast, const real& maxDistance, vector<raycastHit>& result) const
+    {
+        t_raycastCache cache(*this);
+        result.resize(toCast.size());
+        for (std::size_t ind = 0; ind < toCast.size(); ++ind)
+        {
+            result[ind] = raycast(toCast[ind], maxDistance, cache);
+        }
+    }
+
+    /**
+     * @brief sampleDensity interpolates density and gradient at many positions, for example for particles or to place foliage. Read-lock the class before call.
+     * The positions get bucketed by tile, so each tile gets looked up once, and get interpolated sampleBatch::numLanes at a time.
+     * The density gets interpolated trilinear between the 8 voxel around a position, the gradient between the central differences at these voxel. See sampleBatch.
+     * @param positions In absolute voxel-coordinates.
+     * @param numPositions
+     * @param result Must hold numPositions samples, in the order of positions.
+     */
+    void sampleDensity(const vector3* positions, const std::size_t& numPositions, densitySample* result) const
+    {
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const int32 strideX(voxelsPerTile*voxelsPerTile);
+        const int32 strideY(voxelsPerTile);
+
+        // bucket the positions by tile, counting sort
+        hashMap<t_tileId, uint32> bucketOfTile;
+        vector<uint32> bucketOfPosition(numPositions);
+        vector<uint32> bucketBegin;
+        for (std::size_t ind = 0; ind < numPositions; ++ind)
+        {
+            const t_tileId id(calculateVoxelPosToTileId(calculateCell(positions[ind])));
+            const uint32 bucket(bucketOfTile.emplace(id, (uint32)bucketBegin.size()).first->second);
+            if (bucket == bucketBegin.size())
+            {
+                bucketBegin.push_back(0);
+            }
+            ++bucketBegin[bucket];
+            bucketOfPosition[ind] = bucket;
+        }
+        uint32 numBefore(0);
+        for (uint32& count : bucketBegin)
+        {
+            std::swap(count, numBefore);
+            numBefore += count;
+        }
+        vector<uint32> sorted(numPositions);
+        for (std::size_t ind = 0; ind < numPositions; ++ind)
+        {
+            sorted[bucketBegin[bucketOfPosition[ind]]++] = (uint32)ind;
+        }
+
+        t_sampleNeighbourhood neighbourhood(*this);
+        sampleBatch batch;
+        uint32 lanes[sampleBatch::numLanes];
+        densitySample calculated[sampleBatch::numLanes];
+        int32 numLanes(0);
+        for (std::size_t ind = 0; ind < sorted.size(); ++ind)
+        {
+            const uint32 index(sorted[ind]);
+            const vector3& position(positions[index]);
+            const vector3int32 cell(calculateCell(position));
+            const t_tileId id(calculateVoxelPosToTileId(cell));
+            if (ind == 0 || !(id == neighbourhood.getCenter()))
+            {
+                neighbourhood.setCenter(id);
+            }
+            // the stencil starts one voxel before the cell
+            const vector3int32 begin(cell - id*voxelsPerTile - vector3int32(1));
+            const t_utilsTile& center(neighbourhood.getTile(t_sampleNeighbourhood::centerIndex));
+            if (begin >= vector3int32(0) && begin + vector3int32(sampleBatch::stencilLength) <= vector3int32(voxelsPerTile))
+            {
+                if (center.state == utils::tileState::partitial)
+                {
+                    const t_voxel* voxels(&center.data->getVoxel(t_tile::calculateIndex(begin)));
+                    for (int32 x = 0; x < sampleBatch::stencilLength; ++x)
+                    {
+                        for (int32 y = 0; y < sampleBatch::stencilLength; ++y)
+                        {
+                            for (int32 z = 0; z < sampleBatch::stencilLength; ++z)
+                            {
+                                batch.setStencil(numLanes, sampleBatch::calculateStencilIndex(x, y, z), voxels[x*strideX + y*strideY + z].getInterpolation());
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    const real density(neighbourhood.getDensity(center, vector3int32(0)));
+                    for (int32 stencil = 0; stencil < sampleBatch::stencilCount; ++stencil)
+                    {
+                        batch.setStencil(numLanes, stencil, density);
+                    }
+                }
+            }
+            else
+            {
+                // the stencil reaches into the neighbour tiles; per axis and stencil-voxel the neighbour and the position in it
+                int32 neighbour[3][sampleBatch::stencilLength];
+                int32 inNeighbour[3][sampleBatch::stencilLength];
+                for (int32 axis = 0; axis < 3; ++axis)
+                {
+                    for (int32 stencil = 0; stencil < sampleBatch::stencilLength; ++stencil)
+                    {
+                        const int32 relative(begin[axis] + stencil);
+                        neighbour[axis][stencil] = relative < 0 ? 0 : (relative >= voxelsPerTile ? 2 : 1);
+                        inNeighbour[axis][stencil] = relative - (neighbour[axis][stencil] - 1)*voxelsPerTile;
+                    }
+                }
+                for (int32 x = 0; x < sampleBatch::stencilLength; ++x)
+                {
+                    for (int32 y = 0; y < sampleBatch::stencilLength; ++y)
+                    {
+                        for (int32 z = 0; z < sampleBatch::stencilLength; ++z)
+                        {
+                            const t_utilsTile& tile(neighbourhood.getTile(neighbour[0][x]*9 + neighbour[1][y]*3 + neighbour[2][z]));
+                            const vector3int32 inTile(inNeighbour[0][x], inNeighbour[1][y], inNeighbour[2][z]);
+                            batch.setStencil(numLanes, sampleBatch::calculateStencilIndex(x, y, z), neighbourhood.getDensity(tile, inTile));
+                        }
+                    }
+                }
+            }
+            batch.setPosition(numLanes, position - vector3(cell));
+            lanes[numLanes] = index;
+            ++numLanes;
+            if (numLanes == sampleBatch::numLanes || ind + 1 == sorted.size())
+            {
+                batch.calculate(calculated);
+                for (int32 lane = 0; lane < numLanes; ++lane)
+                {
+                    result[lanes[lane]] = calculated[lane];
+                }
+                numLanes = 0;
+            }
+        }
+    }
+    /**
+     * @brief sampleDensity see sampleDensity(const vector3*, const std::size_t&, densitySample*).
+     * @param positions
+     * @param result Gets resized to the number of positions.
+     */
+    void sampleDensity(const vector<vector3>& positions, vector<densitySample>& result) const
+    {
+        result.resize(positions.size());
+        if (!positions.empty())
+        {
+            sampleDensity(&positions[0], positions.size(), &result[0]);
+        }
+    }
+    /**
+     * @brief sampleDensity see sampleDensity(const vector3*, const std::size_t&, densitySample*). Use the batched version for many positions.
+     * @param position
+     * @return
+     */
+    densitySample sampleDensity(const vector3& position) const
+    {
+        densitySample result;
+        sampleDensity(&position, 1, &result);
+        return result;
+    }
+
     /**
      * @brief calculateVoxelPosToTileId converts an absolute voxel-position to an relative container-id position.
      * @param voxelPos An absolute voxel-postion.
@@ -136,7 +327,7 @@ public:
      */
     static t_tileId calculateVoxelPosToTileId(const vector3int32& voxelPos)
     {
-        return vector3int32((blub::vector3(voxelPos) / (real)t_config::voxelsPerTile).getFloor());
+        return t_tileId(calculateFloorDivision(voxelPos.x), calculateFloorDivision(voxelPos.y), calculateFloorDivision(voxelPos.z));
     }
 
     /**
@@ -240,12 +431,14 @@ protected:
         editTodo edit(change, trans);
 
         m_editsTodo.push_back(edit);
+        getMetrics().editQueueDepth.add(1);
 
         doNextEditMaster();
     }
 
     /**
      * @brief doNextEditMaster finds out which tiles the edit affects and dispaches the change to the worker-threads.
+     * Locks for write before, without blocking the thread. See simple::base::lockForEditMasterAsync().
      * @param alreadyLocked optimization parameter, if class is already write locked. (indirect recursive calls)
      */
     void doNextEditMaster(const bool &alreadyLocked = false)
@@ -266,13 +459,22 @@ protected:
 
         if (!alreadyLocked)
         {
-            lockForEditMaster();
+            if (m_lockingForEdit)
+            {
+                // gets continued after locked
+                return;
+            }
+            m_lockingForEdit = true;
+            t_base::lockForEditMasterAsync(boost::bind(&base::doNextEditMaster, this, true));
+            return;
         }
+        m_lockingForEdit = false;
 
         BASSERT(m_numInTilesInTask == 0);
 
         editTodo edit(*m_editsTodo.begin());
         m_editsTodo.erase(m_editsTodo.begin());
+        getMetrics().editQueueDepth.add(-1);
         t_editConstPtr change(edit.edit_);
 
         const blub::transform trans(edit.trans);
@@ -282,6 +484,8 @@ protected:
         blub::vector3int32 endEdit;
 
         calculateAffectetedTilesByAabb(aabbScaled, startEdit, endEdit);
+        const blub::vector3int32 numTiles(endEdit - startEdit);
+        getMetrics().tilesPerEdit.record(numTiles.x*numTiles.y*numTiles.z);
 
         for (blub::int32 indX = startEdit.x; indX < endEdit.x; ++indX)
         {
@@ -312,6 +516,9 @@ protected:
     #ifdef BLUB_LOG_VOXEL
         blub::BOUT("base::editVoxelTS id:" + blub::string::number(id));
     #endif
+        BLUB_TRACE_SCOPE_TILE("editVoxelWorker", "container", id, -1);
+        metrics::scopedTimer timer(getMetrics().workerTime);
+
         t_tilePtr workTile;
         if (holder.state == utils::tileState::partitial)
         {
@@ -441,6 +648,29 @@ protected:
      */
     virtual void setTileToEmtpyMaster(const t_tileId& id) = 0;
 
+    /**
+     * @brief The t_metrics struct contains the metrics all containers record to, see metrics::registry::getGlobal().
+     */
+    struct t_metrics
+    {
+        t_metrics()
+            : editQueueDepth(metrics::registry::getGlobal().getGauge("blub_voxel_container_edit_queue_depth", "Edits waiting for the edit before to get done."))
+            , tilesPerEdit(metrics::registry::getGlobal().getHistogram("blub_voxel_container_edit_tiles", "Container-tiles affected by an edit."))
+            , workerTime(metrics::registry::getGlobal().getHistogram("blub_voxel_container_edit_worker_microseconds", "Time to apply an edit to a container-tile."))
+        {
+            ;
+        }
+
+        metrics::gauge& editQueueDepth;
+        metrics::histogram& tilesPerEdit;
+        metrics::histogram& workerTime;
+    };
+    static t_metrics& getMetrics()
+    {
+        static t_metrics result;
+        return result;
+    }
+
     /**
      * @brief calculateAffectetedTilesByAabb caluclates a list of affected tiles by an axisAlignedBox. Used to determine which tiles to recalculate for an edit.
      * @param voxelAabb axisAlignedBox
@@ -453,8 +683,320 @@ protected:
         endResult = calculateVoxelPosToTileId(voxelAabb.getMaximum()) + blub::vector3int32(1, 1, 1);
     }
 
+    /**
+     * @brief calculateFloorDivision divides by voxelsPerTile, rounding towards negative infinity.
+     * @param toDivide
+     * @return
+     */
+    static int32 calculateFloorDivision(const int32& toDivide)
+    {
+        const int32 result(toDivide / t_config::voxelsPerTile);
+        return (toDivide % t_config::voxelsPerTile < 0) ? result - 1 : result;
+    }
+
+    /**
+     * @brief The t_raycastCache class looks up the tiles for raycast(). Keeps the tiles it looked up, so they can get read without locking.
+     */
+    class t_raycastCache
+    {
+    public:
+        t_raycastCache(const base& container)
+            : m_container(container)
+        {
+            t_voxel voxel;
+            voxel.setMin();
+            m_densityMin = voxel.getInterpolation();
+            voxel.setMax();
+            m_densityMax = voxel.getInterpolation();
+        }
+
+        const t_utilsTile& getTile(const t_tileId& id)
+        {
+            if (!m_tiles.empty() && m_lastId == id)
+            {
+                return *m_last;
+            }
+            typename hashMap<t_tileId, t_utilsTile>::const_iterator it(m_tiles.find(id));
+            if (it == m_tiles.cend())
+            {
+                it = m_tiles.emplace(id, m_container.getTileHolder(id)).first;
+            }
+            m_lastId = id;
+            m_last = &it->second;
+            return *m_last;
+        }
+        real getDensity(const vector3int32& voxelPos)
+        {
+            const t_utilsTile& work(getTile(calculateVoxelPosToTileId(voxelPos)));
+            if (work.state == utils::tileState::partitial)
+            {
+                return work.data->getVoxel(calculateVoxelPosInTile(voxelPos)).getInterpolation();
+            }
+            return work.state == utils::tileState::full ? m_densityMax : m_densityMin;
+        }
+
+        /**
+         * @brief loadCell reads the densities of the 8 voxel of a cell.
+         * @param cell The voxel at the minimum of the cell.
+         * @param result Index x*4 + y*2 + z.
+         */
+        void loadCell(const vector3int32& cell, real result[8])
+        {
+            const t_tileId id(calculateVoxelPosToTileId(cell));
+            const vector3int32 inTile(cell - id*t_config::voxelsPerTile);
+            const t_utilsTile& work(getTile(id));
+            if (inTile < vector3int32(t_config::voxelsPerTile - 1))
+            {
+                if (work.state != utils::tileState::partitial)
+                {
+                    std::fill(result, result + 8, work.state == utils::tileState::full ? m_densityMax : m_densityMin);
+                    return;
+                }
+                const int32 index(t_tile::calculateIndex(inTile));
+                const int32 strideX(t_config::voxelsPerTile*t_config::voxelsPerTile);
+                const int32 strideY(t_config::voxelsPerTile);
+                for (int32 ind = 0; ind < 8; ++ind)
+                {
+                    result[ind] = work.data->getVoxel(index + (ind >> 2)*strideX + ((ind >> 1) & 1)*strideY + (ind & 1)).getInterpolation();
+                }
+                return;
+            }
+            // the cell reaches into the neighbour tiles
+            for (int32 ind = 0; ind < 8; ++ind)
+            {
+                result[ind] = getDensity(cell + vector3int32(ind >> 2, (ind >> 1) & 1, ind & 1));
+            }
+        }
+
+    protected:
+        const base& m_container;
+        hashMap<t_tileId, t_utilsTile> m_tiles;
+        t_tileId m_lastId;
+        const t_utilsTile* m_last;
+        real m_densityMin;
+        real m_densityMax;
+    };
+
+    /**
+     * @brief The t_sampleNeighbourhood class looks up a tile and its 26 neighbours for sampleDensity(). Each one gets looked up once, when needed first.
+     */
+    class t_sampleNeighbourhood
+    {
+    public:
+        static const int32 centerIndex = 13;
+
+        t_sampleNeighbourhood(const base& container)
+            : m_container(container)
+        {
+            t_voxel voxel;
+            voxel.setMin();
+            m_densityMin = voxel.getInterpolation();
+            voxel.setMax();
+            m_densityMax = voxel.getInterpolation();
+        }
+
+        void setCenter(const t_tileId& id)
+        {
+            m_center = id;
+            std::fill(m_resolved, m_resolved + 27, false);
+        }
+        const t_tileId& getCenter() const
+        {
+            return m_center;
+        }
+
+        /**
+         * @brief getTile returns a tile of the neighbourhood.
+         * @param index x*9 + y*3 + z, with 0 to 2 per axis and 1 the center.
+         * @return
+         */
+        const t_utilsTile& getTile(const int32& index)
+        {
+            if (!m_resolved[index])
+            {
+                m_tiles[index] = m_container.getTileHolder(m_center + vector3int32(index / 9, (index / 3) % 3, index % 3) - vector3int32(1));
+                m_resolved[index] = true;
+            }
+            return m_tiles[index];
+        }
+        /**
+         * @brief getDensity returns the density of a voxel.
+         * @param tile
+         * @param inTile Voxel-position in tile.
+         * @return
+         */
+        real getDensity(const t_utilsTile& tile, const vector3int32& inTile) const
+        {
+            if (tile.state == utils::tileState::partitial)
+            {
+                return tile.data->getVoxel(inTile).getInterpolation();
+            }
+            return tile.state == utils::tileState::full ? m_densityMax : m_densityMin;
+        }
+
+    protected:
+        const base& m_container;
+        t_tileId m_center;
+        t_utilsTile m_tiles[27];
+        bool m_resolved[27];
+        real m_densityMin;
+        real m_densityMax;
+    };
+
+    /**
+     * @brief calculateCell returns the voxel-cell a position lies in, the voxel at its minimum.
+     * @param position
+     * @return
+     */
+    static vector3int32 calculateCell(const vector3& position)
+    {
+        return vector3int32((int32)std::floor(position.x), (int32)std::floor(position.y), (int32)std::floor(position.z));
+    }
+
+    /**
+     * @brief calculateDensityTrilinear interpolates the densities of a cell, see t_raycastCache::loadCell().
+     * @param corners The densities of the cell.
+     * @param inCell 0 to 1 per axis.
+     * @param gradient If not nullptr gets set to the gradient of the density.
+     * @return
+     */
+    static real calculateDensityTrilinear(const real corners[8], const vector3& inCell, vector3* gradient = nullptr)
+    {
+        const real y0z0(corners[0] + (corners[1] - corners[0])*inCell.z);
+        const real y1z0(corners[2] + (corners[3] - corners[2])*inCell.z);
+        const real y0z1(corners[4] + (corners[5] - corners[4])*inCell.z);
+        const real y1z1(corners[6] + (corners[7] - corners[6])*inCell.z);
+        const real x0(y0z0 + (y1z0 - y0z0)*inCell.y);
+        const real x1(y0z1 + (y1z1 - y0z1)*inCell.y);
+        if (gradient != nullptr)
+        {
+            gradient->x = x1 - x0;
+            gradient->y = (y1z0 - y0z0)*(1. - inCell.x) + (y1z1 - y0z1)*inCell.x;
+            gradient->z = ((corners[1] - corners[0])*(1. - inCell.y) + (corners[3] - corners[2])*inCell.y)*(1. - inCell.x)
+                        + ((corners[5] - corners[4])*(1. - inCell.y) + (corners[7] - corners[6])*inCell.y)*inCell.x;
+        }
+        return x0 + (x1 - x0)*inCell.x;
+    }
+
+    /**
+     * @brief raycast see raycast(const ray&, const real&).
+     */
+    raycastHit raycast(const ray& toCast, const real& maxDistance, t_raycastCache& cache) const
+    {
+        raycastHit result;
+        const vector3 origin(toCast.getOrigin());
+        const vector3 direction(toCast.getDirection().normalisedCopy());
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const int32 brickLength(t_tile::brickLength);
+
+        real corners[8];
+        gridTraversal cells(origin, direction, 1., 0., maxDistance);
+        while (cells.isValid())
+        {
+            const vector3int32 cell(cells.getCell());
+            const t_tileId id(calculateVoxelPosToTileId(cell));
+            const vector3int32 inTile(cell - id*voxelsPerTile);
+            const t_utilsTile& tile(cache.getTile(id));
+
+            // cells that lie completely in an empty tile or brick can't contain surface
+            if (inTile < vector3int32(voxelsPerTile - 1))
+            {
+                vector3int32 skipMinimum;
+                vector3int32 skipMaximum;
+                bool skip(false);
+                if (tile.state == utils::tileState::empty)
+                {
+                    skipMinimum = id*voxelsPerTile;
+                    skipMaximum = skipMinimum + vector3int32(voxelsPerTile - 1);
+                    skip = true;
+                }
+                else if (tile.state == utils::tileState::partitial)
+                {
+                    const vector3int32 brick(inTile / brickLength);
+                    const vector3int32 inBrick(inTile - brick*brickLength);
+                    skipMinimum = id*voxelsPerTile + brick*brickLength;
+                    skipMaximum = (id*voxelsPerTile + (brick + vector3int32(1))*brickLength).getMinimum(id*voxelsPerTile + vector3int32(voxelsPerTile)) - vector3int32(1);
+                    skip = inBrick < vector3int32(brickLength - 1) &&
+                           tile.data->isBrickEmpty(brick) &&
+                           cell < skipMaximum;
+                }
+                if (skip)
+                {
+                    const real exit(gridTraversal::calculateDistanceExit(origin, direction, vector3(skipMinimum), vector3(skipMaximum)));
+                    cells.restart(math::max(exit, cells.getDistanceExit()));
+                    continue;
+                }
+            }
+
+            cache.loadCell(cell, corners);
+            // trilinear interpolation stays between the corners
+            if (*std::max_element(corners, corners + 8) < 0.)
+            {
+                cells.next();
+                continue;
+            }
+            const vector3 cellPosition(cell);
+            const real distanceEnter(cells.getDistanceEnter());
+            const real distanceExit(cells.getDistanceExit());
+            real lower(distanceEnter);
+            real densityLower(calculateDensityTrilinear(corners, origin + direction*lower - cellPosition));
+            if (densityLower >= 0.)
+            {
+                // only possible for the first cell
+                result.hit = true;
+                result.distance = distanceEnter;
+                result.position = origin + direction*distanceEnter;
+                result.normal = -direction;
+                result.id = cell;
+                return result;
+            }
+            // the density is cubic along the ray and may get positive and negative again inside of the cell, so it gets sampled
+            const int32 numSamples(4);
+            for (int32 sample = 1; sample <= numSamples; ++sample)
+            {
+                real upper(distanceEnter + (distanceExit - distanceEnter)*(real)sample/(real)numSamples);
+                real densityUpper(calculateDensityTrilinear(corners, origin + direction*upper - cellPosition));
+                if (densityUpper < 0.)
+                {
+                    lower = upper;
+                    densityLower = densityUpper;
+                    continue;
+                }
+                // regula falsi on the trilinear density along the ray
+                for (int32 iteration = 0; iteration < 3; ++iteration)
+                {
+                    const real middle(lower + (upper - lower)*densityLower/(densityLower - densityUpper));
+                    const real densityMiddle(calculateDensityTrilinear(corners, origin + direction*middle - cellPosition));
+                    if (densityMiddle >= 0.)
+                    {
+                        upper = middle;
+                        densityUpper = densityMiddle;
+                    }
+                    else
+                    {
+                        lower = middle;
+                        densityLower = densityMiddle;
+                    }
+                }
+                result.hit = true;
+                result.distance = lower + (upper - lower)*densityLower/(densityLower - densityUpper);
+                result.position = origin + direction*result.distance;
+                vector3 gradient;
+                calculateDensityTrilinear(corners, result.position - cellPosition, &gradient);
+                const real gradientLength(gradient.length());
+                result.normal = gradientLength > 0. ? -gradient / gradientLength : -direction;
+                result.id = cell;
+                return result;
+            }
+            cells.next();
+        }
+        return result;
+    }
+
 protected:
     int32 m_numInTilesInTask;
+    // waits for the write-lock, to continue an edit or a generation
+    bool m_lockingForEdit;
 
     typedef list<editTodo> t_editTodoList;
     t_editTodoList m_editsTodo;
@@ -6,6 +6,7 @@
 // #include "blub/log/global.hpp"
 #include "blub/core/base64.hpp"
 #include "blub/core/byteArray.hpp"
+#include "blub/core/trace.hpp"
 #include "blub/core/vector.hpp"
 #include "blub/database/connection.hpp"
 #include "blub/database/functions.hpp"
@@ -58,6 +59,7 @@ public:
 
     void loadTS()
     {
+        BLUB_TRACE_SCOPE("loadTS", "container");
         t_base::m_master.dispatch(boost::bind(&database::loadMaster, this));
     }
 
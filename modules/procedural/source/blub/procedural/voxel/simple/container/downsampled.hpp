@@ -0,0 +1,355 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_DOWNSAMPLED_HPP
+#define BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_DOWNSAMPLED_HPP
+
+#include "blub/core/hashMap.hpp"
+#include "blub/core/signal.hpp"
+#include "blub/core/trace.hpp"
+#include "blub/math/axisAlignedBoxInt32.hpp"
+#include "blub/procedural/voxel/simple/container/inMemory.hpp"
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+namespace simple
+{
+namespace container
+{
+
+
+/**
+ * @brief The downsampled class is a container with half the resolution of a source container, one level of a level-of-detail pyramid.
+ * Voxel x of this container gets reduced from the voxel 2*x to 2*x+1 of the source container, so every tile depends on 2^3 tiles of the source only.
+ * The class keeps up to date by the signal signalEditDone() of the source. Only the voxel inside the edited bounding box of every changed source tile get reduced again.
+ * Don't edit this class directly by editVoxel().
+ * Stack them to get a pyramid: level N+1 gets reduced from level N. A simple::accessor of lod N may read level N instead of sampling level 0 with stride 2^N.
+ * Such a pyramid needs filter::point, see filter.
+ */
+template <class configType>
+class downsampled : public inMemory<configType>
+{
+public:
+    typedef inMemory<configType> t_base;
+    typedef typename t_base::t_config t_config;
+    typedef typename t_base::t_voxel t_voxel;
+    typedef typename t_base::t_tile t_tile;
+    typedef typename t_base::t_tilePtr t_tilePtr;
+    typedef typename t_base::t_utilsTile t_utilsTile;
+    typedef typename t_base::t_tileId t_tileId;
+    typedef typename t_config::t_container::t_simple t_simpleContainer;
+    typedef hashMap<t_tileId, axisAlignedBoxInt32> t_tilesToReduce;
+
+    /**
+     * @brief The filter enum defines how 2^3 source voxel get reduced to one.
+     * Only point keeps the lod-seams closed if the container feeds a simple::accessor of a lod. Its transvoxel-cells take their even face-voxel from the
+     * marching-cubes voxel of level N, their odd ones from level N-1. The other filters let the voxel of level N differ from the voxel 2*x of level N-1,
+     * so the transition cells don't match the finer neighbour and cracks open. Use them for containers read by other means, for example raycasts or collision.
+     */
+    enum class filter
+    {
+        /** takes the voxel 2*x. Same result as sampling the source with stride 2. */
+        point,
+        /** averages the interpolation of all 2^3 voxel. */
+        average,
+        /** takes the voxel with the lowest interpolation. Thin walls vanish, thin holes stay. */
+        minimum,
+        /** takes the voxel with the highest interpolation. Thin walls stay, thin holes vanish. */
+        maximum
+    };
+
+    /**
+     * @brief downsampled constructor
+     * @param worker May gets called by several threads.
+     * @param source The container to reduce. Connects to its signalEditDone().
+     * @param filter_ How to reduce.
+     */
+    downsampled(blub::async::dispatcher &worker, t_simpleContainer &source, const filter& filter_ = filter::point)
+        : t_base(worker)
+        , m_source(source)
+        , m_filter(filter_)
+        , m_numTilesInWork(0)
+    {
+        m_connSourceGotChanged = m_source.signalEditDone()->connect(boost::bind(&downsampled::sourceGotChanged, this));
+    }
+
+    /**
+     * @brief ~downsampled destructor
+     */
+    ~downsampled()
+    {
+        ;
+    }
+
+    /**
+     * @brief getSource returns the container set in the constructor.
+     * @return
+     */
+    t_simpleContainer &getSource() const
+    {
+        return m_source;
+    }
+
+    /**
+     * @brief getFilter returns the filter set in the constructor.
+     * @return
+     */
+    const filter &getFilter() const
+    {
+        return m_filter;
+    }
+
+protected:
+    /**
+     * @brief sourceGotChanged gets called after voxel in the source changed.
+     */
+    void sourceGotChanged()
+    {
+        m_source.lockForRead();
+        t_base::m_master.post(boost::bind(&downsampled::sourceGotChangedMaster, this));
+    }
+
+    /**
+     * @brief sourceGotChangedMaster collects the voxel to reduce per tile and dispatches them to the worker.
+     */
+    void sourceGotChangedMaster()
+    {
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const auto& changedTiles(m_source.getTilesThatGotEdited());
+
+        t_tilesToReduce toReduce;
+        for (auto change : changedTiles)
+        {
+            const t_tileId &idSource(change.first);
+            const t_utilsTile &holder(change.second);
+
+            axisAlignedBoxInt32 changed(vector3int32(0), vector3int32(voxelsPerTile-1));
+            if (holder.state == utils::tileState::partitial)
+            {
+                changed = holder.data->getEditedVoxelBoundingBox();
+                BASSERT(changed.isValid());
+            }
+            const t_tileId idSourceFloored((vector3(idSource) / 2.).getFloor());
+            const vector3int32 sourceOffset((idSource - idSourceFloored*2)*voxelsPerTile);
+            const axisAlignedBoxInt32 reduce((changed.getMinimum() + sourceOffset) / 2,
+                                             (changed.getMaximum() + sourceOffset) / 2);
+
+            typename t_tilesToReduce::iterator it(toReduce.find(idSourceFloored));
+            if (it == toReduce.end())
+            {
+                toReduce.insert(idSourceFloored, reduce);
+            }
+            else
+            {
+                it->second.extend(reduce);
+            }
+        }
+
+        if (toReduce.empty())
+        {
+            m_source.unlockRead();
+            return;
+        }
+
+        BASSERT(m_numTilesInWork == 0);
+        m_numTilesInWork = toReduce.size();
+        t_base::lockForEditMasterAsync(boost::bind(&downsampled::reduceTilesMaster, this, toReduce));
+    }
+
+    /**
+     * @brief reduceTilesMaster dispatches the reduction of the tiles after locked for write.
+     * @param toReduce Tiles and their voxel to reduce again.
+     */
+    void reduceTilesMaster(const t_tilesToReduce& toReduce)
+    {
+        for (auto work : toReduce)
+        {
+            t_base::m_worker.post(boost::bind(&downsampled::reduceWorker, this, work.first, t_base::getTileHolder(work.first), work.second));
+        }
+    }
+
+    /**
+     * @brief reduceWorker reduces the voxel in bounds of a tile. Gets called paralell by various threads.
+     * @param id TileId
+     * @param holder The tile before reduction.
+     * @param bounds Voxel of the tile to reduce again. Inclusive.
+     */
+    void reduceWorker(const t_tileId& id, const t_utilsTile& holder, const axisAlignedBoxInt32& bounds)
+    {
+        BLUB_TRACE_SCOPE_TILE("reduceWorker", "container", id, -1);
+        // the 2^3 source tiles covering the tile
+        t_utilsTile sourceTiles[8];
+        bool sourceHomogeneous(true);
+        for (int32 ind = 0; ind < 8; ++ind)
+        {
+            sourceTiles[ind] = m_source.getTileHolder(id*2 + vector3int32(ind >> 2, (ind >> 1) & 1, ind & 1));
+            sourceHomogeneous &= sourceTiles[ind].state != utils::tileState::partitial && sourceTiles[ind].state == sourceTiles[0].state;
+        }
+        if (sourceHomogeneous)
+        {
+            t_base::m_master.post(boost::bind(&downsampled::reduceDoneMaster, this, t_utilsTile(sourceTiles[0].state), id));
+            return;
+        }
+
+        t_tilePtr workTile;
+        if (holder.state == utils::tileState::partitial)
+        {
+            workTile = holder.data;
+        }
+        else
+        {
+            workTile = t_base::createTileFull(holder.state == utils::tileState::full);
+        }
+        if (!workTile->getEditing())
+        {
+            workTile->startEdit();
+        }
+
+        const vector3int32 &minimum(bounds.getMinimum());
+        const vector3int32 &maximum(bounds.getMaximum());
+        for (int32 indX = minimum.x; indX <= maximum.x; ++indX)
+        {
+            for (int32 indY = minimum.y; indY <= maximum.y; ++indY)
+            {
+                for (int32 indZ = minimum.z; indZ <= maximum.z; ++indZ)
+                {
+                    const vector3int32 pos(indX, indY, indZ);
+                    workTile->setVoxel(pos, reduceVoxel(pos*2, sourceTiles));
+                }
+            }
+        }
+        // the source changed, so even if no reduced voxel changed mark them - an accessor reading the source for level-of-detail needs to get notified.
+        workTile->extendEditedVoxelBoundingBox(bounds);
+
+        t_utilsTile result;
+        if (workTile->isEmpty())
+        {
+            result.state = utils::tileState::empty;
+        }
+        else
+        {
+            if (workTile->isFull())
+            {
+                result.state = utils::tileState::full;
+            }
+            else
+            {
+                result.state = utils::tileState::partitial;
+                result.data = workTile;
+            }
+        }
+        t_base::m_master.post(boost::bind(&downsampled::reduceDoneMaster, this, result, id));
+    }
+
+    /**
+     * @brief reduceDoneMaster sets the reduced tile. After the last one unlocks the source and this class.
+     * @param holder The reduced tile.
+     * @param id TileId
+     */
+    void reduceDoneMaster(const t_utilsTile& holder, const t_tileId& id)
+    {
+        t_base::setTileMaster(id, holder);
+        if (t_base::getTilesThatGotEdited().find(id) == t_base::getTilesThatGotEdited().cend())
+        {
+            // reduced tile stayed empty or full, but the source changed. Signal it anyway for the accessor reading the source for level-of-detail.
+            t_base::addToChangeList(id, holder);
+        }
+
+        --m_numTilesInWork;
+        if (m_numTilesInWork > 0)
+        {
+            return;
+        }
+        for (const typename t_base::t_tilesGotChangedMap::value_type& work : t_base::getTilesThatGotEdited())
+        {
+            if (!work.second.data.isNull() && work.second.data->getEditing())
+            {
+                work.second.data->endEdit();
+            }
+        }
+        m_source.unlockRead();
+        t_base::unlockForEditMaster();
+    }
+
+    /**
+     * @brief reduceVoxel reduces the 2^3 source voxel starting at posSource by the filter set in the constructor.
+     * @param posSource Voxel position relative to the first of the 2^3 source tiles.
+     * @param sourceTiles The 2^3 source tiles.
+     * @return The reduced voxel.
+     */
+    t_voxel reduceVoxel(const vector3int32& posSource, const t_utilsTile* sourceTiles) const
+    {
+        t_voxel result(getSourceVoxel(posSource, sourceTiles));
+        if (m_filter == filter::point)
+        {
+            return result;
+        }
+
+        int32 sumInterpolation(0);
+        for (int32 ind = 0; ind < 8; ++ind)
+        {
+            const t_voxel work(ind == 0 ? result : getSourceVoxel(posSource + vector3int32(ind >> 2, (ind >> 1) & 1, ind & 1), sourceTiles));
+            sumInterpolation += work.getInterpolation();
+            if ((m_filter == filter::minimum && work.getInterpolation() < result.getInterpolation()) ||
+                (m_filter == filter::maximum && work.getInterpolation() > result.getInterpolation()))
+            {
+                result = work;
+            }
+        }
+        if (m_filter == filter::average)
+        {
+            result.setInterpolation(static_cast<int8>(sumInterpolation / 8));
+        }
+        return result;
+    }
+
+    /**
+     * @brief getSourceVoxel returns a voxel of the 2^3 source tiles.
+     * @param posSource Voxel position relative to the first of the 2^3 source tiles.
+     * @param sourceTiles The 2^3 source tiles.
+     * @return Always a valid voxel.
+     */
+    t_voxel getSourceVoxel(const vector3int32& posSource, const t_utilsTile* sourceTiles) const
+    {
+        const int32 voxelsPerTile(t_config::voxelsPerTile);
+        const vector3int32 idSource(posSource / voxelsPerTile);
+        const t_utilsTile &holder(sourceTiles[idSource.x*4 + idSource.y*2 + idSource.z]);
+
+        t_voxel result;
+        switch (holder.state)
+        {
+        case utils::tileState::partitial:
+            result = holder.data->getVoxel(posSource - idSource*voxelsPerTile);
+            break;
+        case utils::tileState::empty:
+            result.setMin();
+            break;
+        case utils::tileState::full:
+            result.setMax();
+            break;
+        default:
+            BASSERT(false);
+        }
+        return result;
+    }
+
+protected:
+    t_simpleContainer &m_source;
+    const filter m_filter;
+    int32 m_numTilesInWork;
+
+    boost::signals2::scoped_connection m_connSourceGotChanged;
+
+};
+
+
+}
+}
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_DOWNSAMPLED_HPP
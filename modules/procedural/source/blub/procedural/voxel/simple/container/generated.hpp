@@ -0,0 +1,372 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_GENERATED_HPP
+#define BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_GENERATED_HPP
+
+#include "blub/async/mutex.hpp"
+#include "blub/async/mutexLocker.hpp"
+#include "blub/core/deque.hpp"
+#include "blub/core/hashList.hpp"
+#include "blub/core/hashMap.hpp"
+#include "blub/core/list.hpp"
+#include "blub/core/trace.hpp"
+#include "blub/procedural/voxel/edit/base.hpp"
+#include "blub/procedural/voxel/simple/container/inMemory.hpp"
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+namespace simple
+{
+namespace container
+{
+
+
+/**
+ * @brief The generated class is a container whose voxel get defined by a deterministic generator - an edit and its transform.
+ * Instead of applying the generator eagerly to a huge axisAlignedBox by editVoxel(), tiles get generated on first access by getTileHolder() and get memoized.
+ * Tiles which are full or empty get classified by edit::base::calculateTileState() without calculating their voxel.
+ * Only tiles changed by editVoxel() or setTile() get stored like in inMemory. Generated tiles may get evicted, see setMaxGeneratedTiles(), and get regenerated on next access.
+ * Call generate() for the regions a camera sees, so the accessor and surface get calculated for them.
+ */
+template <class configType>
+class generated : public inMemory<configType>
+{
+public:
+    typedef inMemory<configType> t_base;
+    typedef typename t_base::t_utilsTile t_utilsTile;
+    typedef typename t_base::t_tileId t_tileId;
+    typedef typename t_base::t_tilePtr t_tilePtr;
+    typedef typename t_base::t_editConstPtr t_editConstPtr;
+
+    // least recently used first
+    typedef list<t_tileId> t_generatedTilesOrder;
+    /**
+     * @brief The t_generatedTile struct is a memoized generated tile and its place in the eviction order.
+     */
+    struct t_generatedTile
+    {
+        t_utilsTile tile;
+        typename t_generatedTilesOrder::iterator order;
+    };
+    typedef hashMap<t_tileId, t_generatedTile> t_generatedTilesMap;
+    typedef hashList<t_tileId> t_tileIdList;
+
+    /**
+     * @brief generated constructor
+     * @param worker May gets called by several threads.
+     * @param generator The edit which defines the voxel. Must not be nullptr. Must not get changed afterwards.
+     * @param trans The transform of the generator.
+     */
+    generated(blub::async::dispatcher &worker, t_editConstPtr generator, const blub::transform &trans = blub::transform())
+        : t_base(worker)
+        , m_generator(generator)
+        , m_generatorTransform(trans)
+        , m_maxGeneratedTiles(0)
+        , m_numInTilesInGeneration(0)
+    {
+        BASSERT(!m_generator.isNull());
+    }
+
+    /**
+     * @brief ~generated descructor
+     */
+    ~generated()
+    {
+        ;
+    }
+
+    /**
+     * @brief generate makes sure all tiles intersecting voxelAabb got generated and signals them as changed, so accessor and surface get calculated.
+     * Returns immediately. Gets queued behind edits issued before.
+     * Tiles classified as empty don't get signaled.
+     * @param voxelAabb Absolute voxel bounds, for example around a camera.
+     */
+    void generate(const blub::axisAlignedBox& voxelAabb)
+    {
+        t_base::m_master.post(boost::bind(&generated::generateMaster, this, voxelAabb));
+    }
+
+    /**
+     * @brief getTileHolder returns a tile set by setTile() or editVoxel(). If there is none, the tile gets generated and memoized. Read-lock class before call.
+     * Method is threadsafe.
+     * @param id Identifier. Contains voxel from id*blub::procedural::voxel::tile::container::voxelLength to (id+1)*blub::procedural::voxel::tile::container::voxelLength-1
+     * @return Always returns a valid value.
+     */
+    t_utilsTile getTileHolder(const blub::vector3int32& id) const override
+    {
+        if (m_tilesStored.find(id) != m_tilesStored.cend())
+        {
+            return t_base::getTileHolder(id);
+        }
+        {
+            async::mutexLocker locker(m_generatedTilesMutex);
+            const t_utilsTile* found(findGeneratedTile(id));
+            if (found != nullptr)
+            {
+                return *found;
+            }
+        }
+
+        // generate without lock. If another thread generated the tile the same time the first one wins.
+        const t_utilsTile result(generateTile(id));
+
+        async::mutexLocker locker(m_generatedTilesMutex);
+        const t_utilsTile* found(findGeneratedTile(id));
+        if (found != nullptr)
+        {
+            return *found;
+        }
+        m_generatedTilesOrder.push_back(id);
+        m_generatedTiles.insert(id, t_generatedTile{result, --m_generatedTilesOrder.end()});
+        while (m_maxGeneratedTiles > 0 && m_generatedTiles.size() > m_maxGeneratedTiles)
+        {
+            m_generatedTiles.erase(m_generatedTilesOrder.front());
+            m_generatedTilesOrder.pop_front();
+        }
+        return result;
+    }
+
+    /**
+     * @brief setMaxGeneratedTiles limits the number of memoized generated tiles. If exceeded, the least recently accessed get evicted. Edited tiles never get evicted.
+     * @param maxTiles 0 for no limit, the default.
+     */
+    void setMaxGeneratedTiles(const uint32& maxTiles)
+    {
+        async::mutexLocker locker(m_generatedTilesMutex);
+        m_maxGeneratedTiles = maxTiles;
+    }
+
+    /**
+     * @brief getNumGeneratedTiles returns the number of currently memoized generated tiles.
+     * @return
+     */
+    uint32 getNumGeneratedTiles() const
+    {
+        async::mutexLocker locker(m_generatedTilesMutex);
+        return m_generatedTiles.size();
+    }
+
+    /**
+     * @brief evictGeneratedTiles drops all memoized generated tiles. They get regenerated on next access.
+     */
+    void evictGeneratedTiles()
+    {
+        async::mutexLocker locker(m_generatedTilesMutex);
+        m_generatedTiles.clear();
+        m_generatedTilesOrder.clear();
+    }
+
+protected:
+    /**
+     * @brief findGeneratedTile returns a memoized generated tile and marks it as most recently used. Lock m_generatedTilesMutex before.
+     * @param id TileId
+     * @return nullptr if not memoized.
+     */
+    const t_utilsTile* findGeneratedTile(const t_tileId& id) const
+    {
+        typename t_generatedTilesMap::iterator it(m_generatedTiles.find(id));
+        if (it == m_generatedTiles.end())
+        {
+            return nullptr;
+        }
+        m_generatedTilesOrder.splice(m_generatedTilesOrder.end(), m_generatedTilesOrder, it->second.order);
+        return &it->second.tile;
+    }
+
+    /**
+     * @brief generateTile classifies or calculates a tile by the generator.
+     * @param id TileId
+     * @return The generated tile.
+     */
+    t_utilsTile generateTile(const t_tileId& id) const
+    {
+        const utils::tileState state(m_generator->calculateTileState(id, m_generatorTransform));
+        if (state != utils::tileState::partitial)
+        {
+            return t_utilsTile(state);
+        }
+
+        t_tilePtr workTile(t_base::createTileFull(false));
+        workTile->startEdit();
+        m_generator->calculateVoxel(workTile.data(), id, m_generatorTransform);
+        workTile->endEdit();
+
+        if (workTile->isEmpty())
+        {
+            return t_utilsTile(utils::tileState::empty);
+        }
+        if (workTile->isFull())
+        {
+            return t_utilsTile(utils::tileState::full);
+        }
+        t_utilsTile result(utils::tileState::partitial);
+        result.data = workTile;
+        return result;
+    }
+
+    /**
+     * @brief setTileToContainerMaster stores the tile like inMemory and drops the generated one. Write-lock class before.
+     * @see inMemory::setTileToContainerMaster()
+     */
+    void setTileToContainerMaster(const t_tileId id, const t_utilsTile &oldOne, const t_utilsTile &toSet) override
+    {
+        m_tilesStored.insert(id);
+        {
+            async::mutexLocker locker(m_generatedTilesMutex);
+            typename t_generatedTilesMap::iterator it(m_generatedTiles.find(id));
+            if (it != m_generatedTiles.end())
+            {
+                m_generatedTilesOrder.erase(it->second.order);
+                m_generatedTiles.erase(it);
+            }
+        }
+        t_base::setTileToContainerMaster(id, oldOne, toSet);
+    }
+
+    /**
+     * @brief generateMaster queues the region and starts generating, if no edit is in progress.
+     * @see generate()
+     */
+    void generateMaster(const blub::axisAlignedBox& voxelAabb)
+    {
+        m_generateTodo.push_back(voxelAabb);
+
+        if (t_base::m_numInTilesInTask > 0 || m_numInTilesInGeneration > 0 || t_base::m_lockingForEdit)
+        {
+            // gets continued by unlockForEditMaster()
+            return;
+        }
+        doNextGenerateMaster();
+    }
+
+    /**
+     * @brief doNextGenerateMaster locks for write, without blocking the thread, and continues with generateLockedMaster().
+     */
+    void doNextGenerateMaster()
+    {
+        if (m_generateTodo.empty() || t_base::m_lockingForEdit)
+        {
+            return;
+        }
+        t_base::m_lockingForEdit = true;
+        t_base::lockForEditMasterAsync(boost::bind(&generated::generateLockedMaster, this));
+    }
+
+    /**
+     * @brief generateLockedMaster dispatches the tiles of the next queued region to the worker-threads.
+     */
+    void generateLockedMaster()
+    {
+        t_base::m_lockingForEdit = false;
+        BASSERT(!m_generateTodo.empty());
+        const blub::axisAlignedBox voxelAabb(m_generateTodo.front());
+        m_generateTodo.pop_front();
+
+        const blub::axisAlignedBoxInt32 aabbScaled(voxelAabb.getMinimum(), voxelAabb.getMaximum());
+        t_tileId startGenerate;
+        t_tileId endGenerate;
+        t_base::calculateAffectetedTilesByAabb(aabbScaled, startGenerate, endGenerate);
+
+        for (blub::int32 indX = startGenerate.x; indX < endGenerate.x; ++indX)
+        {
+            for (blub::int32 indY = startGenerate.y; indY < endGenerate.y; ++indY)
+            {
+                for (blub::int32 indZ = startGenerate.z; indZ < endGenerate.z; ++indZ)
+                {
+                    const t_tileId id(indX, indY, indZ);
+                    if (m_tilesGenerated.find(id) != m_tilesGenerated.cend())
+                    {
+                        continue;
+                    }
+                    m_tilesGenerated.insert(id);
+
+                    ++m_numInTilesInGeneration;
+                    ++t_base::m_numInTilesInTask; // blocks edits while generating
+                    t_base::m_worker.post(boost::bind(&generated::generateWorker, this, id));
+                }
+            }
+        }
+
+        if (m_numInTilesInGeneration == 0)
+        {
+            t_base::unlockForEditMaster();
+        }
+    }
+
+    /**
+     * @brief generateWorker generates a tile. Gets called paralell by various threads.
+     * @param id TileId
+     */
+    void generateWorker(const t_tileId& id)
+    {
+        BLUB_TRACE_SCOPE_TILE("generateWorker", "container", id, -1);
+        const t_utilsTile result(getTileHolder(id));
+        t_base::m_master.post(boost::bind(&generated::generateDoneMaster, this, result, id));
+    }
+
+    /**
+     * @brief generateDoneMaster signals the generated tile as changed.
+     * @param holder The generated tile.
+     * @param id TileId
+     */
+    void generateDoneMaster(const t_utilsTile &holder, const t_tileId& id)
+    {
+        if (holder.state != utils::tileState::empty)
+        {
+            t_base::addToChangeList(id, holder);
+        }
+
+        --m_numInTilesInGeneration;
+        --t_base::m_numInTilesInTask;
+        if (m_numInTilesInGeneration == 0)
+        {
+            unlockForEditMaster();
+        }
+    }
+
+    /**
+     * @brief unlockForEditMaster unlocks and continues with edits queued while generating, or else with queued generate() calls.
+     * Edits don't get continued without unlock, because generated tiles aren't in edit-mode.
+     */
+    void unlockForEditMaster() override
+    {
+        t_base::unlockForEditMaster();
+        if (!t_base::m_editsTodo.empty())
+        {
+            t_base::doNextEditMaster();
+            return;
+        }
+        doNextGenerateMaster();
+    }
+
+protected:
+    const t_editConstPtr m_generator;
+    const blub::transform m_generatorTransform;
+
+    // tiles set by editVoxel() or setTile(). Write only by master with write-lock.
+    t_tileIdList m_tilesStored;
+    // tiles signaled by generate(). Master only.
+    t_tileIdList m_tilesGenerated;
+
+    mutable async::mutex m_generatedTilesMutex;
+    mutable t_generatedTilesMap m_generatedTiles;
+    mutable t_generatedTilesOrder m_generatedTilesOrder;
+    uint32 m_maxGeneratedTiles;
+
+    int32 m_numInTilesInGeneration;
+    deque<blub::axisAlignedBox> m_generateTodo;
+
+};
+
+
+}
+}
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_SIMPLE_CONTAINER_GENERATED_HPP
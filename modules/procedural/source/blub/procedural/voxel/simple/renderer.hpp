@@ -2,7 +2,10 @@
 #define BLUB_PROCEDURAL_VOXEL_SIMPLE_RENDERER_HPP
 
 #include "blub/core/globals.hpp"
+#include "blub/core/hashList.hpp"
 #include "blub/core/hashMap.hpp"
+#include "blub/core/metrics.hpp"
+#include "blub/core/vector.hpp"
 #include "blub/log/global.hpp"
 #include "blub/math/octree/container.hpp"
 #include "blub/math/vector3.hpp"
@@ -31,6 +34,9 @@ namespace simple
  * Including renderdistance and enabling the submeshes for losing the cracks (transvoxel results).
  * Takes the results and updates from the simple::surface and saves them into an octree.
  * Casts signals on when to update an LOD.
+ * The crack closing submeshes get requested by simple::surface::requestLod() the first time a tile shows them.
+ * The camera positions get set as priority positions of the surface, see simple::base::setPriorityPositions().
+ * Cave-culling hides the tiles no camera can see through empty space, see setCaveCulling().
  */
 // TODO reimplement class, with better threading and better octree/sync.
 template <class configType>
@@ -47,6 +53,8 @@ public:
     typedef sync::sender<t_tileId, t_cameraPtr> t_sync;
 
     typedef hashMap<vector3int32, t_tilePtr> t_tileMap;
+    typedef hashMap<vector3int32, uint8> t_lodRequestedMap;
+    typedef hashMap<t_cameraPtr, vector3> t_cameraPositionMap;
 
     typedef typename t_config::t_surface::t_tile t_tileSurface;
     typedef sharedPointer<t_tileSurface> t_tileDataPtr;
@@ -55,6 +63,35 @@ public:
 
     typedef typename t_config::t_surface::t_simple t_rendererSurface;
 
+    /**
+     * @brief The t_cullingTile struct contains what cave-culling needs to know about a tile.
+     */
+    struct t_cullingTile
+    {
+        t_cullingTile(const bool& full_ = false)
+            : connectivity(0)
+            , full(full_)
+        {
+            ;
+        }
+        t_cullingTile(t_tilePtr tile_, const uint16& connectivity_)
+            : tile(tile_)
+            , connectivity(connectivity_)
+            , full(false)
+        {
+            ;
+        }
+
+        // nullptr if the tile got removed
+        t_tilePtr tile;
+        // see tile::surface::getConnectivity()
+        uint16 connectivity;
+        // the tile got removed because it is full, blocks the search
+        bool full;
+    };
+    typedef hashMap<t_tileId, t_cullingTile> t_cullingTileMap;
+    typedef hashList<t_tileId> t_tileIdList;
+
 
     /**
      * @brief renderer constructor.
@@ -75,6 +112,8 @@ public:
         , m_lodCutDistFar(lodCutDistFar)
         , m_voxelSize(math::pow(2., m_lod))
         , m_voxels(tiles)
+        , m_caveCulling(true)
+        , m_cullingDirty(false)
     {
         const int32 voxelsPerTile(t_config::voxelsPerTile);
         m_sync = new t_sync(worker, vector3int32(voxelsPerTile));
@@ -102,6 +141,7 @@ public:
     void addCamera(t_cameraPtr toAdd, const blub::vector3& position)
     {
         m_sync->addReceiver(toAdd, position / m_voxelSize);
+        m_sync->getMaster().dispatch(boost::bind(&renderer::setCameraPositionMaster, this, toAdd, position));
     }
     /**
      * @brief updateCamera updates the position of a camera you have to add before by using addCamera()
@@ -119,6 +159,21 @@ public:
     void removeCamera(t_cameraPtr toRemove)
     {
         m_sync->removeReceiver(toRemove);
+        m_sync->getMaster().dispatch(boost::bind(&renderer::removeCameraPositionMaster, this, toRemove));
+    }
+
+    /**
+     * @brief setCaveCulling enables or disables cave-culling. Enabled by default.
+     * Starting at the tile of every camera, a breadth-first search walks through the tiles whose sides are connected by empty space,
+     * never turning back towards the camera. Tiles it doesn't reach get culled, see tile::renderer::setCulled().
+     * The search runs again after a camera moved to another tile or tiles changed, not on every frame.
+     * Tiles without surface block the search if they are full, see simple::base::getTilesThatGotFull(). The others are empty space.
+     * @param enable
+     * @see tile::surface::isConnected()
+     */
+    void setCaveCulling(const bool& enable)
+    {
+        m_sync->getMaster().dispatch(boost::bind(&renderer::setCaveCullingMaster, this, enable));
     }
 
     // lock class for read before work
@@ -132,6 +187,29 @@ public:
     }
 
 protected:
+    /**
+     * @brief The t_metrics struct contains the metrics all renderers record to, see metrics::registry::getGlobal().
+     */
+    struct t_metrics
+    {
+        t_metrics()
+            : editDoneTime(metrics::registry::getGlobal().getHistogram("blub_voxel_renderer_edit_done_microseconds", "Time to hand the changed surface-tiles of an edit to the render-tiles."))
+            , tilesSet(metrics::registry::getGlobal().getCounter("blub_voxel_renderer_tiles_set_total", "Surface-tiles handed to render-tiles by tile::renderer::setTileData()."))
+            , cullingTime(metrics::registry::getGlobal().getHistogram("blub_voxel_renderer_culling_microseconds", "Time to search the tiles reachable by the cameras, see setCaveCulling()."))
+        {
+            ;
+        }
+
+        metrics::histogram& editDoneTime;
+        metrics::counter& tilesSet;
+        metrics::histogram& cullingTime;
+    };
+    static t_metrics& getMetrics()
+    {
+        static t_metrics result;
+        return result;
+    }
+
     /**
      * @brief editDone gets called when simple::surface changed. Read-locks surface.
      */
@@ -147,7 +225,11 @@ protected:
      */
     void editDoneMaster()
     {
+        metrics::scopedTimer timer(getMetrics().editDoneTime);
+
         auto& change(m_voxels->getTilesThatGotEdited());
+        auto& full(m_voxels->getTilesThatGotFull());
+        t_cullingTileMap culling;
         for (auto hasChanged : change)
         {
             const t_tileId id(hasChanged.first);
@@ -155,15 +237,24 @@ protected:
 
             if (work.isNull())
             {
-                tileGotRemovedMaster(id);
+                // a tile that got full or empty again may have had no surface before
+                if (m_tileData.find(id) != m_tileData.cend())
+                {
+                    tileGotRemovedMaster(id);
+                }
+                culling.insert(id, t_cullingTile(full.find(id) != full.cend()));
             }
             else
             {
                 tileGotSetMaster(id, work);
+                culling.insert(id, t_cullingTile(m_tileData[id], work->getConnectivity()));
             }
         }
 
         m_voxels->unlockRead();
+
+        // same strand as the cameras and the visibility
+        m_sync->getMaster().post(boost::bind(&renderer::updateCullingTilesMaster, this, culling));
     }
 
     /**
@@ -193,6 +284,28 @@ protected:
         }
 
         workTile->setTileData(toSet, aabb);
+        getMetrics().tilesSet.add();
+
+        if (m_lod > 0)
+        {
+            // the surface-tile may got calculated again from scratch, without the crack closing submeshes shown
+            uint8 calculated(0);
+            for (int32 lod = 0; lod < 6; ++lod)
+            {
+                if (toSet->isIndicesLodCalculated(lod))
+                {
+                    calculated |= (1 << lod);
+                }
+            }
+            m_lodRequested[id] = calculated;
+            for (int32 lod = 0; lod < 6; ++lod)
+            {
+                if (workTile->getVisibleLod(lod))
+                {
+                    requestLod(id, lod);
+                }
+            }
+        }
 
         if (!found)
         {
@@ -216,6 +329,41 @@ protected:
         m_sync->removeSyncMaster(id);
 
         m_tileData.erase(it);
+        m_lodRequested.erase(id);
+    }
+
+    /**
+     * @brief setVisibleLod sets if a crack closing submesh of a tile should get rendered.
+     * Requests the submesh if it didn't get calculated yet.
+     * @param id TileId
+     * @param toSet Surface-tile to work on.
+     * @param lod 0 to 5
+     * @param vis
+     */
+    void setVisibleLod(const t_tileId& id, t_tilePtr toSet, const int32& lod, const bool& vis)
+    {
+        toSet->setVisibleLod(lod, vis);
+        if (vis)
+        {
+            requestLod(id, lod);
+        }
+    }
+
+    /**
+     * @brief requestLod requests a crack closing submesh from the surface, if not calculated or requested before.
+     * @param id TileId
+     * @param lod 0 to 5
+     * @see simple::surface::requestLod()
+     */
+    void requestLod(const t_tileId& id, const int32& lod)
+    {
+        uint8 &requested(m_lodRequested[id]);
+        if ((requested & (1 << lod)) != 0)
+        {
+            return;
+        }
+        requested |= (1 << lod);
+        m_voxels->requestLod(id, lod);
     }
 
     /**
@@ -314,11 +462,11 @@ protected:
             const int32 doLod(isInRange(m_cameraPositionInTreeLeaf, axisAlignedBox(neighbourOctreeNode)));
             if (toUpdate->getVisible())
             {
-                toUpdate->setVisibleLod(lod, doLod == 1);
+                setVisibleLod(id, toUpdate, lod, doLod == 1);
             }
             else
             {
-                toUpdate->setVisibleLod(lod, false);
+                setVisibleLod(id, toUpdate, lod, false);
             }
             typename t_tileMap::const_iterator it(m_tileData.find(neighbourId));
             if (it == m_tileData.cend())
@@ -327,11 +475,11 @@ protected:
             }
             if (toUpdate->getVisible())
             {
-                it->second->setVisibleLod(toSetOnNeighbour[lod], false);
+                setVisibleLod(neighbourId, it->second, toSetOnNeighbour[lod], false);
             }
             else
             {
-                it->second->setVisibleLod(toSetOnNeighbour[lod], tileWork == 1);
+                setVisibleLod(neighbourId, it->second, toSetOnNeighbour[lod], tileWork == 1);
             }
         }
     }
@@ -385,6 +533,206 @@ protected:
         const real tileContainerSize(t_config::voxelsPerTile);
         m_cameraPositionInTreeLeaf = (camPosScaled/tileContainerSize).getFloor()*tileContainerSize + vector3(tileContainerSize*0.5);
         m_sync->updateReceiverMaster(toUpdate, camPosScaled);
+        setCameraPositionMaster(toUpdate, position);
+    }
+
+    /**
+     * @brief setCameraPositionMaster saves the position of a camera and sets the positions of all cameras as priority positions of the surface.
+     * @param toSet The camera.
+     * @param position World-coordinates.
+     * @see simple::base::setPriorityPositions()
+     */
+    void setCameraPositionMaster(t_cameraPtr toSet, const blub::vector3& position)
+    {
+        typename t_cameraPositionMap::const_iterator it(m_cameraPositions.find(toSet));
+        if (it == m_cameraPositions.cend() || !(calculateCameraTile(it->second) == calculateCameraTile(position)))
+        {
+            m_cullingDirty = true;
+        }
+        m_cameraPositions[toSet] = position;
+        updatePriorityPositionsMaster();
+        updateCullingMaster();
+    }
+    /**
+     * @brief removeCameraPositionMaster removes the position saved by setCameraPositionMaster().
+     * @param toRemove The camera.
+     */
+    void removeCameraPositionMaster(t_cameraPtr toRemove)
+    {
+        m_cameraPositions.erase(toRemove);
+        updatePriorityPositionsMaster();
+        m_cullingDirty = true;
+        updateCullingMaster();
+    }
+    /**
+     * @brief updatePriorityPositionsMaster sets the positions of all cameras as priority positions of the surface, so tiles near a camera get calculated first.
+     */
+    void updatePriorityPositionsMaster()
+    {
+        typename t_base::t_positionList positions;
+        for (auto camera : m_cameraPositions)
+        {
+            positions.push_back(camera.second);
+        }
+        m_voxels->setPriorityPositions(positions);
+    }
+
+    /**
+     * @see setCaveCulling()
+     */
+    void setCaveCullingMaster(const bool& enable)
+    {
+        if (m_caveCulling == enable)
+        {
+            return;
+        }
+        m_caveCulling = enable;
+        m_cullingDirty = true;
+        updateCullingMaster();
+    }
+
+    /**
+     * @brief updateCullingTilesMaster saves the connectivity of the changed tiles and culls again if anything changed.
+     * @param changed The changed tiles, the ones with a nullptr got removed. Full ones get kept to block the search.
+     */
+    void updateCullingTilesMaster(const t_cullingTileMap& changed)
+    {
+        for (const auto& work : changed)
+        {
+            typename t_cullingTileMap::iterator it(m_cullingTiles.find(work.first));
+            if (work.second.tile.isNull() && !work.second.full)
+            {
+                if (it != m_cullingTiles.end())
+                {
+                    m_cullingTiles.erase(it);
+                    m_cullingDirty = true;
+                }
+                continue;
+            }
+            if (it == m_cullingTiles.end() || it->second.connectivity != work.second.connectivity || it->second.full != work.second.full)
+            {
+                m_cullingDirty = true;
+            }
+            m_cullingTiles.insert(work.first, work.second);
+        }
+        updateCullingMaster();
+    }
+
+    /**
+     * @brief updateCullingMaster searches the tiles reachable by the cameras and culls the others, if the tiles or the tiles of the cameras changed since the last call.
+     * @see setCaveCulling()
+     */
+    void updateCullingMaster()
+    {
+        if (!m_cullingDirty)
+        {
+            return;
+        }
+        m_cullingDirty = false;
+        metrics::scopedTimer timer(getMetrics().cullingTime);
+
+        t_tileIdList reachable;
+        if (m_caveCulling)
+        {
+            for (auto camera : m_cameraPositions)
+            {
+                searchReachableTilesMaster(calculateCameraTile(camera.second), reachable);
+            }
+        }
+        for (auto work : m_cullingTiles)
+        {
+            if (work.second.full)
+            {
+                continue;
+            }
+            const bool culled(m_caveCulling && reachable.find(work.first) == reachable.cend());
+            if (work.second.tile->getCulled() != culled)
+            {
+                work.second.tile->setCulled(culled);
+            }
+        }
+    }
+
+    /**
+     * @brief searchReachableTilesMaster does a breadth-first search starting at the tile of a camera.
+     * A tile gets left only through a side connected to the side it got entered by, and never towards the camera. Full tiles don't get entered.
+     * A tile gets visited once per side it got entered by. The search stops at tiles too far away to get rendered, see isInRange().
+     * @param start The tile of the camera. Gets left through all sides.
+     * @param reachable Gets extended by the tiles found.
+     */
+    void searchReachableTilesMaster(const t_tileId& start, t_tileIdList& reachable)
+    {
+        struct toVisit
+        {
+            t_tileId id;
+            // -1 for the start
+            int32 enteredBy;
+            // bit per side the search went through
+            uint8 directions;
+        };
+        const int32 sizeLeaf(t_config::voxelsPerTile);
+        const vector3 leafCenter(vector3(start*sizeLeaf) + vector3(sizeLeaf*0.5));
+        const vector3int32 toIterate[] = {vector3int32(-1, 0, 0),
+                                          vector3int32(1, 0, 0),
+                                          vector3int32(0, -1, 0),
+                                          vector3int32(0, 1, 0),
+                                          vector3int32(0, 0, -1),
+                                          vector3int32(0, 0, 1)
+                                         };
+
+        // per tile a bit per side it got entered by
+        hashMap<t_tileId, uint8> visited;
+        vector<toVisit> queue;
+        queue.push_back({start, -1, 0});
+        reachable.insert(start);
+        for (uint32 indQueue = 0; indQueue < queue.size(); ++indQueue)
+        {
+            const toVisit work(queue[indQueue]);
+            typename t_cullingTileMap::const_iterator it(m_cullingTiles.find(work.id));
+            const bool checkConnectivity(work.enteredBy != -1 && it != m_cullingTiles.cend());
+            for (int32 side = 0; side < 6; ++side)
+            {
+                const int32 opposite(side ^ 1);
+                if ((work.directions & (1 << opposite)) != 0)
+                {
+                    continue;
+                }
+                if (checkConnectivity && (it->second.connectivity & t_tileSurface::calculateConnectivityBit(work.enteredBy, side)) == 0)
+                {
+                    continue;
+                }
+                const t_tileId neighbour(work.id + toIterate[side]);
+                uint8 &enteredBy(visited[neighbour]);
+                if ((enteredBy & (1 << opposite)) != 0)
+                {
+                    continue;
+                }
+                enteredBy |= 1 << opposite;
+                typename t_cullingTileMap::const_iterator itNeighbour(m_cullingTiles.find(neighbour));
+                if (itNeighbour != m_cullingTiles.cend() && itNeighbour->second.full)
+                {
+                    continue;
+                }
+                const vector3int32 neighbourPosAbs(neighbour*sizeLeaf);
+                if (isInRange(leafCenter, axisAlignedBox(vector3(neighbourPosAbs), vector3(neighbourPosAbs+vector3int32(sizeLeaf)))) == 2)
+                {
+                    continue;
+                }
+                reachable.insert(neighbour);
+                queue.push_back({neighbour, opposite, static_cast<uint8>(work.directions | (1 << side))});
+            }
+        }
+    }
+
+    /**
+     * @brief calculateCameraTile returns the tile a camera is in.
+     * @param position World-coordinates.
+     * @return
+     */
+    t_tileId calculateCameraTile(const vector3& position) const
+    {
+        const real tileSize(t_config::voxelsPerTile);
+        return t_tileId((position / m_voxelSize / tileSize).getFloor());
     }
 
 private:
@@ -396,8 +744,17 @@ private:
     t_rendererSurface* m_voxels;
 
     t_tileMap m_tileData; // TODO remove me. insert the tile into the tree, instead of the id --> faster and cleaner.
+    // crack closing submeshes calculated or requested per tile
+    t_lodRequestedMap m_lodRequested;
+    // in world-coordinates
+    t_cameraPositionMap m_cameraPositions;
     t_sync *m_sync;
 
+    // cave-culling, used by the strand of m_sync like the cameras
+    bool m_caveCulling;
+    bool m_cullingDirty;
+    t_cullingTileMap m_cullingTiles;
+
 };
 
 
@@ -5,9 +5,15 @@
 #include "blub/core/globals.hpp"
 #include "blub/core/hashList.hpp"
 #include "blub/core/hashMap.hpp"
+#include "blub/core/metrics.hpp"
 #include "blub/core/signal.hpp"
+#include "blub/core/trace.hpp"
+#include "blub/math/axisAlignedBoxInt32.hpp"
+#include "blub/math/ray.hpp"
 #include "blub/math/vector3int.hpp"
 #include "blub/procedural/log/global.hpp"
+#include "blub/procedural/voxel/bvh.hpp"
+#include "blub/procedural/voxel/raycast.hpp"
 #include "blub/procedural/voxel/simple/accessor.hpp"
 
 #include <boost/signals2/connection.hpp>
@@ -25,6 +31,7 @@ namespace simple
 
 /**
  * @brief The surface class convertes accessor-tiles to surface-tiles. In between polygons get calculated by the surface-tile.
+ * Tiles next to the positions set by setPriorityPositions() get calculated first.
  */
 template <class configType>
 class surface : public base<typename configType::t_surface::t_tile>
@@ -43,6 +50,13 @@ public:
     typedef typename t_config::t_accessor::t_tile t_tileAccessor;
     typedef sharedPointer<t_tileAccessor> t_tileAccessorPtr;
     typedef base<t_tileAccessor> t_voxelAccessor;
+    typedef typename t_voxelAccessor::t_tilesGotChangedMap t_tilesAccessorMap;
+    typedef typename t_voxelAccessor::t_tilesGotFullList t_tilesAccessorFullList;
+    typedef hashMap<t_tileId, axisAlignedBoxInt32> t_tilesChangedMap;
+    typedef typename t_tile::normalCalculation t_normalCalculation;
+    typedef typename t_base::t_positionList t_positionList;
+    typedef typename t_base::t_jobList t_jobList;
+    typedef typename t_jobList::value_type t_tileJob;
 
 
     /**
@@ -57,6 +71,12 @@ public:
         : t_base(worker)
         , m_voxels(voxels)
         , m_lod(lod)
+        , m_normalCalculation(t_normalCalculation::faceWithCorrection)
+        , m_decimation(0.)
+        , m_optimizeVertexCache(false)
+        , m_calculateMeshlets(false)
+        , m_calculateBvh(false)
+        , m_calculating(false)
         , m_numTilesInWork(0)
     {
         voxels.signalEditDone()->connect(boost::bind(&surface::editDone, this));
@@ -88,6 +108,125 @@ public:
         return math::pow(2., m_lod);
     }
 
+    /**
+     * @brief setNormalCalculation sets how the surface-tiles calculate their normals. Affects only tiles that get calculated afterwards.
+     * Call it before the accessor gets edited, for example right after construction.
+     * @param toSet Default tile::surface::normalCalculation::faceWithCorrection.
+     * @see tile::surface::normalCalculation
+     */
+    void setNormalCalculation(const t_normalCalculation& toSet)
+    {
+        m_normalCalculation = toSet;
+    }
+    /**
+     * @brief getNormalCalculation returns the value set by setNormalCalculation().
+     * @return
+     */
+    const t_normalCalculation& getNormalCalculation() const
+    {
+        return m_normalCalculation;
+    }
+
+    /**
+     * @brief setDecimation sets the error budget with which the surface-tiles get simplified after their calculation, on the same worker. Meant for far lods.
+     * Edits of a simplified tile calculate its whole surface again, instead of only the changed cells.
+     * Affects only tiles that get calculated afterwards. Call it before the accessor gets edited, for example right after construction.
+     * @param maxError In world-units, so scale it with getVoxelSize() for an error per voxel. Default 0, which disables the simplification.
+     * @see tile::surface::decimate()
+     */
+    void setDecimation(const real& maxError)
+    {
+        m_decimation = maxError;
+    }
+    /**
+     * @brief getDecimation returns the value set by setDecimation().
+     * @return
+     */
+    const real& getDecimation() const
+    {
+        return m_decimation;
+    }
+    /**
+     * @brief setOptimizeVertexCache sets if the surface-tiles reorder their triangles and vertices for the vertex-cache of a gpu after their calculation, on the same worker.
+     * Edits of an optimized tile calculate its whole surface again, instead of only the changed cells. Suits far lods.
+     * Affects only tiles that get calculated afterwards. Call it before the accessor gets edited, for example right after construction.
+     * @param toSet Default false.
+     * @see tile::surface::optimizeVertexCache()
+     */
+    void setOptimizeVertexCache(const bool& toSet)
+    {
+        m_optimizeVertexCache = toSet;
+    }
+    /**
+     * @brief getOptimizeVertexCache returns the value set by setOptimizeVertexCache().
+     * @return
+     */
+    const bool& getOptimizeVertexCache() const
+    {
+        return m_optimizeVertexCache;
+    }
+    /**
+     * @brief setCalculateMeshlets sets if the surface-tiles split their triangles into meshlets after their calculation, on the same worker.
+     * Affects only tiles that get calculated afterwards. Call it before the accessor gets edited, for example right after construction.
+     * @param toSet Default false.
+     * @see tile::surface::calculateMeshlets()
+     */
+    void setCalculateMeshlets(const bool& toSet)
+    {
+        m_calculateMeshlets = toSet;
+    }
+    /**
+     * @brief getCalculateMeshlets returns the value set by setCalculateMeshlets().
+     * @return
+     */
+    const bool& getCalculateMeshlets() const
+    {
+        return m_calculateMeshlets;
+    }
+
+    /**
+     * @brief setCalculateBvh sets if the surface-tiles build a bounding volume hierarchy after their calculation, on the same worker.
+     * Speeds up raycast(), sweepSphere() and calculateClosestPoint(). Affects only tiles that get calculated afterwards.
+     * Call it before the accessor gets edited, for example right after construction.
+     * @param toSet Default false.
+     * @see tile::surface::calculateBvh()
+     */
+    void setCalculateBvh(const bool& toSet)
+    {
+        m_calculateBvh = toSet;
+    }
+    /**
+     * @brief getCalculateBvh returns the value set by setCalculateBvh().
+     * @return
+     */
+    const bool& getCalculateBvh() const
+    {
+        return m_calculateBvh;
+    }
+
+    /**
+     * @brief requestLod forwards the request to the accessor, which caches the voxel needed for the transvoxel-list of the side.
+     * The tile gets calculated again after that, and calculates the transvoxel-lists of all cached sides. Thread-safe.
+     * @param id TileId
+     * @param lod Side of the tile, 0 to 5.
+     * @see tile::surface::isIndicesLodCalculated()
+     */
+    void requestLod(const t_tileId& id, const int32& lod) override
+    {
+        m_voxels.requestLod(id, lod);
+    }
+
+    /**
+     * @brief setPriorityPositions sets the positions near which tiles get calculated first, for this class and the accessor. Thread-safe.
+     * @param positions In world-coordinates.
+     * @see base::setPriorityPositions()
+     */
+    void setPriorityPositions(const t_positionList& positions) override
+    {
+        t_base::setPriorityPositions(positions);
+        m_voxels.setPriorityPositions(positions);
+    }
+
     /**
      * @brief getTile returns a surface-tile. Lock-read class before.
      * @param id TileId
@@ -119,25 +258,125 @@ public:
         return workTile;
     }
 
+    /**
+     * @brief raycast intersects a ray with the triangles of the calculated surface-tiles. Exact to the rendered mesh, see container::base::raycast() for a raycast on the voxel.
+     * Visits the tiles along the ray in order and stops with the first one containing a hit. Read-lock class before.
+     * @param toCast Direction has to be normalized. In world-coordinates.
+     * @param maxDistance Maximum distance along the ray.
+     * @return id is the tile-id of the hit. The normal is the one of the hit triangle, facing against the ray.
+     * @see setCalculateBvh()
+     */
+    raycastHit raycast(const ray& toCast, const real& maxDistance) const
+    {
+        raycastHit result;
+        const vector3& origin(toCast.getOrigin());
+        const vector3& direction(toCast.getDirection());
+        const real tileSize(t_config::voxelsPerTile*getVoxelSize());
+        real distanceBest(maxDistance);
+        for (gridTraversal traversal(origin, direction, tileSize, 0., maxDistance); traversal.isValid(); traversal.next())
+        {
+            // the triangles of a tile may reach a bit into the next tile for normal-correction, so a hit found in an earlier tile may be farther away
+            if (result.hit && distanceBest <= traversal.getDistanceEnter())
+            {
+                break;
+            }
+            const t_tileId id(traversal.getCell());
+            typename t_tilesMap::const_iterator it(m_tiles.find(id));
+            if (it == m_tiles.cend())
+            {
+                continue;
+            }
+            const t_tilePtr& work(it->second);
+            // triangles are tile-local
+            const vector3 offset(vector3(id)*tileSize);
+            const bvh::t_hit hit(work->getBvh().raycast(work->getVertices(), work->getIndices(), origin - offset, direction, distanceBest));
+            if (hit.hit)
+            {
+                distanceBest = hit.distance;
+                setResult(hit, id, offset, result);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief sweepSphere returns the first contact of a sphere moving along a ray with the triangles of the calculated surface-tiles.
+     * Tests the tiles touched by the bounding box of the movement. Read-lock class before.
+     * @param toCast The movement of the sphere-center. Direction has to be normalized. In world-coordinates.
+     * @param radius Of the sphere.
+     * @param maxDistance Of the movement.
+     * @return distance is the movement till the contact, position the contact, normal points from the contact to the sphere-center. id is the tile-id of the contact.
+     * @see setCalculateBvh()
+     */
+    raycastHit sweepSphere(const ray& toCast, const real& radius, const real& maxDistance) const
+    {
+        raycastHit result;
+        const vector3& origin(toCast.getOrigin());
+        const vector3& direction(toCast.getDirection());
+        vector3 minimum(origin);
+        vector3 maximum(origin);
+        minimum.makeFloor(origin + direction*maxDistance);
+        maximum.makeCeil(origin + direction*maxDistance);
+        real distanceBest(maxDistance);
+        forEachTile(minimum - vector3(radius), maximum + vector3(radius),
+                    [&] (const t_tileId& id, const t_tile& work, const vector3& offset)
+        {
+            const bvh::t_hit hit(work.getBvh().sweepSphere(work.getVertices(), work.getIndices(), origin - offset, direction, radius, distanceBest));
+            if (hit.hit)
+            {
+                distanceBest = hit.distance;
+                setResult(hit, id, offset, result);
+            }
+        });
+        return result;
+    }
+
+    /**
+     * @brief calculateClosestPoint returns the point of the triangles of the calculated surface-tiles closest to a position. Read-lock class before.
+     * @param position In world-coordinates.
+     * @param maxDistance Triangles farther away get ignored. Tiles touched by a box of this half-size around position get tested.
+     * @return distance is the one to position, normal points from the closest point to position. id is the tile-id of the closest point.
+     * @see setCalculateBvh()
+     */
+    raycastHit calculateClosestPoint(const vector3& position, const real& maxDistance) const
+    {
+        raycastHit result;
+        real distanceBest(maxDistance);
+        forEachTile(position - vector3(maxDistance), position + vector3(maxDistance),
+                    [&] (const t_tileId& id, const t_tile& work, const vector3& offset)
+        {
+            const bvh::t_hit hit(work.getBvh().calculateClosestPoint(work.getVertices(), work.getIndices(), position - offset, distanceBest));
+            if (hit.hit)
+            {
+                distanceBest = hit.distance;
+                setResult(hit, id, offset, result);
+            }
+        });
+        return result;
+    }
+
 protected:
     /**
      * @brief editDone gets called when data in accessor changed.
+     * The accessor doesn't change its tiles but replaces them by changed copies, so the change-list gets kept without read-locking the accessor.
+     * The accessor calculates its next change while this class calculates the surfaces.
+     * @see accessor::copyTile()
      */
     void editDone()
     {
-        m_voxels.lockForRead();
-
-        t_base::m_master.post(boost::bind(&surface::editDoneMaster, this));
+        t_base::m_master.post(boost::bind(&surface::editDoneMaster, this, m_voxels.getTilesThatGotEdited(), m_voxels.getTilesThatGotFull()));
     }
 
     /**
      * @brief editDoneMaster same like editDone() but on master-thread.
-     * Write locks class, dispatches surface generation to worker threads.
+     * Adds the change to the tiles to calculate. Changes reported while tiles are in work get calculated afterwards;
+     * a tile reported several times gets calculated once, by its newest accessor-tile.
+     * @param change The change-list of the accessor.
+     * @param full The removed tiles of change that are full.
      * @see editDone()
      */
-    void editDoneMaster()
+    void editDoneMaster(const t_tilesAccessorMap& change, const t_tilesAccessorFullList& full)
     {
-        const typename t_voxelAccessor::t_tilesGotChangedMap& change(m_voxels.getTilesThatGotEdited());
 #ifdef BLUB_LOG_VOXEL
         BLUB_PROCEDURAL_LOG_OUT() << "surface editDoneMaster change.size():" << change.size();
 #endif
@@ -147,16 +386,60 @@ protected:
             return;
         }
 
-        t_base::lockForEditMaster();
+        for (auto work : change)
+        {
+            m_tilesPending.insert(work.first, work.second);
+            if (full.find(work.first) != full.cend())
+            {
+                m_tilesPendingFull.insert(work.first);
+            }
+            else
+            {
+                m_tilesPendingFull.erase(work.first);
+            }
+            if (work.second.isNull())
+            {
+                // a following accessor-tile is a new one and gets calculated completely
+                m_tilesChanged.erase(work.first);
+                continue;
+            }
+            extendChangedMaster(work.first, work.second->getEditedVoxelBoundingBox());
+        }
+
+        calculatePendingMaster();
+    }
+
+    /**
+     * @brief calculatePendingMaster write-locks the class and calculates the pending tiles, if no tiles are in work.
+     */
+    void calculatePendingMaster()
+    {
+        if (m_calculating || m_tilesPending.empty())
+        {
+            return;
+        }
+        m_calculating = true;
+        t_base::lockForEditMasterAsync(boost::bind(&surface::calculateSurfacesMaster, this));
+    }
 
+    /**
+     * @brief calculateSurfacesMaster dispatches the calculation of the pending tiles after locked for write.
+     */
+    void calculateSurfacesMaster()
+    {
         BASSERT(m_numTilesInWork == 0);
-        m_numTilesInWork = change.size();
 
+        t_tilesAccessorMap change;
+        change.swap(m_tilesPending);
+        t_tilesAccessorFullList full;
+        full.swap(m_tilesPendingFull);
+
+        t_jobList jobs;
         for (auto work : change)
         {
             if (work.second.isNull())
             {
-                afterCalculateSurfaceMaster(work.first, nullptr);
+                setTileMaster(work.first, nullptr, full.find(work.first) != full.cend());
                 continue;
             }
 
@@ -165,28 +448,177 @@ protected:
 
             t_tilePtr workTile(getTile(work.first));
 
-            t_base::m_worker.post(boost::bind(&surface::calculateSurfaceTS, this, work.first, work.second, workTile));
+            axisAlignedBoxInt32 changed;
+            typename t_tilesChangedMap::iterator it(m_tilesChanged.find(work.first));
+            if (it != m_tilesChanged.end())
+            {
+                changed = it->second;
+                m_tilesChanged.erase(it);
+            }
+
+            jobs.push_back(t_tileJob(work.first, boost::bind(&surface::calculateSurfaceTS, this, work.first, work.second, workTile, changed, work.second->getVersion())));
+        }
+        m_numTilesInWork = jobs.size();
+        if (m_numTilesInWork == 0)
+        {
+            afterCalculateSurfacesMaster();
+            return;
+        }
+        t_base::dispatchJobsMaster(jobs, t_config::voxelsPerTile*getVoxelSize());
+    }
+
+    /**
+     * @brief afterCalculateSurfacesMaster unlocks the class after all tiles got calculated and continues with the tiles reported meanwhile.
+     */
+    void afterCalculateSurfacesMaster()
+    {
+        t_base::unlockForEditMaster();
+        m_calculating = false;
+        calculatePendingMaster();
+    }
+
+    /**
+     * @brief extendChangedMaster extends the voxel of a tile that changed since its surface got calculated.
+     * @param id TileId
+     * @param changed May be invalid, if only lod-voxel got cached.
+     */
+    void extendChangedMaster(const t_tileId& id, const axisAlignedBoxInt32& changed)
+    {
+        typename t_tilesChangedMap::iterator it(m_tilesChanged.find(id));
+        if (it == m_tilesChanged.end())
+        {
+            m_tilesChanged.insert(id, changed);
+            return;
         }
+        it->second.extend(changed);
+    }
+
+    /**
+     * @brief forEachTile calls toCall for every calculated tile touched by a box.
+     * @param minimum Of the box, in world-coordinates.
+     * @param maximum Of the box, in world-coordinates.
+     * @param toCall Gets the tile-id, the tile and the world-position of the tile.
+     */
+    template <typename callType>
+    void forEachTile(const vector3& minimum, const vector3& maximum, const callType& toCall) const
+    {
+        const real tileSize(t_config::voxelsPerTile*getVoxelSize());
+        const vector3int32 start((minimum / tileSize).getFloor());
+        const vector3int32 end((maximum / tileSize).getFloor());
+        for (int32 x = start.x; x <= end.x; ++x)
+        {
+            for (int32 y = start.y; y <= end.y; ++y)
+            {
+                for (int32 z = start.z; z <= end.z; ++z)
+                {
+                    const t_tileId id(x, y, z);
+                    typename t_tilesMap::const_iterator it(m_tiles.find(id));
+                    if (it != m_tiles.cend())
+                    {
+                        toCall(id, *it->second, vector3(id)*tileSize);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief setResult converts the tile-local hit of a query to world-coordinates.
+     */
+    static void setResult(const bvh::t_hit& hit, const t_tileId& id, const vector3& offset, raycastHit& result)
+    {
+        result.hit = true;
+        result.distance = hit.distance;
+        result.position = hit.position + offset;
+        result.normal = hit.normal;
+        result.id = id;
+    }
+
+    /**
+     * @brief The t_metrics struct contains the metrics all surfaces record to, see metrics::registry::getGlobal().
+     */
+    struct t_metrics
+    {
+        t_metrics()
+            : extractionTime(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_extraction_microseconds", "Time to calculate the surface of a tile."))
+            , vertices(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_tile_vertices", "Vertices of a calculated surface-tile."))
+            , triangles(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_tile_triangles", "Triangles of a calculated surface-tile, without the crack closing ones."))
+            , decimationTime(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_decimation_microseconds", "Time to simplify a surface-tile, see setDecimation()."))
+            , vertexCacheTime(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_vertex_cache_microseconds", "Time to reorder a surface-tile for the vertex-cache, see setOptimizeVertexCache()."))
+            , meshletTime(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_meshlet_microseconds", "Time to split a surface-tile into meshlets, see setCalculateMeshlets()."))
+            , bvhTime(metrics::registry::getGlobal().getHistogram("blub_voxel_surface_bvh_microseconds", "Time to build the bounding volume hierarchy of a surface-tile, see setCalculateBvh()."))
+        {
+            ;
+        }
+
+        metrics::histogram& extractionTime;
+        metrics::histogram& vertices;
+        metrics::histogram& triangles;
+        metrics::histogram& decimationTime;
+        metrics::histogram& vertexCacheTime;
+        metrics::histogram& meshletTime;
+        metrics::histogram& bvhTime;
+    };
+    static t_metrics& getMetrics()
+    {
+        static t_metrics result;
+        return result;
     }
 
     /**
      * @brief calculateSurfaceTS gets called by editDoneMaster(), by any worker-thread.
      * Calls afterCalculateSurfaceMaster() after work is done.
      * @param id TileId
+     * Skips the calculation if the accessor-tile changes again meanwhile, the next change reports the tile again.
      * @param work The accessorTile to turn into a surface-tile.
      * @param workTile the resulting surface tile.
+     * @param changed The voxel of work that changed since workTile got calculated.
+     * @param version Version of work when the job got dispatched.
      * @see editDoneMaster()
      */
-    void calculateSurfaceTS(const t_tileId id, t_tileAccessorPtr work, t_tilePtr workTile)
+    void calculateSurfaceTS(const t_tileId id, t_tileAccessorPtr work, t_tilePtr workTile, const axisAlignedBoxInt32& changed, const uint32& version)
     {
+        BLUB_TRACE_SCOPE_TILE("calculateSurfaceTS", "surface", id, m_lod);
+        if (work->getVersion() != version)
+        {
+            t_base::m_master.post(boost::bind(&surface::skipSurfaceMaster, this, id, changed));
+            return;
+        }
         if (workTile.isNull())
         {
             workTile = t_base::createTile();
         }
-        workTile->calculateSurface(work,
-                                   getVoxelSize(),
-                                   true,
-                                   m_lod);
+        {
+            metrics::scopedTimer timer(getMetrics().extractionTime);
+            // only the part of the surface near the changed voxel gets calculated again, if the tile got calculated by the same accessor-tile before.
+            workTile->recalculateSurface(work,
+                                         changed,
+                                         getVoxelSize(),
+                                         m_normalCalculation,
+                                         m_lod);
+        }
+        if (m_decimation > 0.)
+        {
+            metrics::scopedTimer timer(getMetrics().decimationTime);
+            workTile->decimate(m_decimation);
+        }
+        if (m_optimizeVertexCache)
+        {
+            metrics::scopedTimer timer(getMetrics().vertexCacheTime);
+            workTile->optimizeVertexCache();
+        }
+        if (m_calculateMeshlets)
+        {
+            metrics::scopedTimer timer(getMetrics().meshletTime);
+            workTile->calculateMeshlets();
+        }
+        if (m_calculateBvh)
+        {
+            metrics::scopedTimer timer(getMetrics().bvhTime);
+            workTile->calculateBvh();
+        }
+        getMetrics().vertices.record(workTile->getVertices().size());
+        getMetrics().triangles.record(workTile->getIndices().size() / 3);
 
         if (workTile->getIndices().empty())
         {
@@ -212,6 +644,44 @@ protected:
         BLUB_LOG_OUT() << "afterCalculateSurfaceMaster id:" << id;
 #endif
 
+        setTileMaster(id, workTile, false);
+
+        --m_numTilesInWork;
+        BASSERT(m_numTilesInWork >= 0);
+        t_base::afterJobMaster();
+        if (m_numTilesInWork == 0)
+        {
+            afterCalculateSurfacesMaster();
+        }
+    }
+
+    /**
+     * @brief skipSurfaceMaster gets called by calculateSurfaceTS() on master-thread, if it skipped the calculation.
+     * The voxel changed get calculated with the newer accessor-tile.
+     * @param id TileId
+     * @param changed The voxel the skipped calculation should have calculated.
+     */
+    void skipSurfaceMaster(const t_tileId& id, const axisAlignedBoxInt32& changed)
+    {
+        extendChangedMaster(id, changed);
+
+        --m_numTilesInWork;
+        BASSERT(m_numTilesInWork >= 0);
+        t_base::afterJobMaster(true);
+        if (m_numTilesInWork == 0)
+        {
+            afterCalculateSurfacesMaster();
+        }
+    }
+
+    /**
+     * @brief setTileMaster sets or removes a tile and adds it to the change-list.
+     * @param id TileId
+     * @param workTile The surface-tile. If nullptr or without polygons the tile gets removed.
+     * @param isFull If the tile gets removed, tells if its accessor-tile is full instead of empty. See getTilesThatGotFull().
+     */
+    void setTileMaster(const t_tileId& id, t_tilePtr workTile, const bool& isFull)
+    {
         typename t_tilesMap::const_iterator it(m_tiles.find(id));
 
         int32 numIndices(0);
@@ -223,37 +693,57 @@ protected:
         // no indices
         if (numIndices == 0)
         {
-            if (it != m_tiles.cend())
+            const bool wasFull(m_tilesFull.find(id) != m_tilesFull.cend());
+            if (it != m_tiles.cend() || wasFull != isFull)
             {
-                t_base::addToChangeList(id, nullptr);
-                m_tiles.erase(it);
+                if (isFull)
+                {
+                    m_tilesFull.insert(id);
+                    t_base::addFullToChangeList(id);
+                }
+                else
+                {
+                    m_tilesFull.erase(id);
+                    t_base::addToChangeList(id, nullptr);
+                }
+                if (it != m_tiles.cend())
+                {
+                    m_tiles.erase(it);
+                }
             }
         }
         else
         {
             BASSERT(!workTile.isNull());
+            m_tilesFull.erase(id);
             if (it == m_tiles.cend())
             {
                 m_tiles.insert(id, workTile);
             }
             t_base::addToChangeList(id, workTile);
         }
-
-        --m_numTilesInWork;
-        BASSERT(m_numTilesInWork >= 0);
-        if (m_numTilesInWork == 0)
-        {
-            m_voxels.unlockRead();
-            t_base::unlockForEditMaster();
-        }
     }
 
 
 private:
     t_tilesMap m_tiles;
+    // the tiles without surface-tile whose accessor-tile is full, the others are empty
+    t_tileIdList m_tilesFull;
+    // accessor-tiles reported while tiles were in work
+    t_tilesAccessorMap m_tilesPending;
+    // the pending tiles removed because they are full
+    t_tilesAccessorFullList m_tilesPendingFull;
+    // voxel that changed since the surface-tile got calculated, of pending tiles and of tiles whose calculation got skipped
+    t_tilesChangedMap m_tilesChanged;
 
     t_voxelAccessor &m_voxels;
     int32 m_lod;
+    t_normalCalculation m_normalCalculation;
+    real m_decimation;
+    bool m_optimizeVertexCache;
+    bool m_calculateMeshlets;
+    bool m_calculateBvh;
+    bool m_calculating;
     int32 m_numTilesInWork;
 
     boost::signals2::scoped_connection m_connTilesGotChanged;
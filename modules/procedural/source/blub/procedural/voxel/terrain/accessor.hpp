@@ -2,7 +2,9 @@
 #define PROCEDURAL_VOXEL_TERRAIN_ACCESSOR_HPP
 
 #include "blub/core/globals.hpp"
+#include "blub/core/scopedPtr.hpp"
 #include "blub/core/vector.hpp"
+#include "blub/procedural/voxel/simple/container/downsampled.hpp"
 #include "blub/procedural/voxel/terrain/base.hpp"
 
 
@@ -29,6 +31,9 @@ public:
     typedef base<t_simple> t_base;
 
     typedef typename t_config::t_container::t_simple t_simpleContainer;
+    typedef simple::container::downsampled<t_config> t_downsampled;
+    typedef typename t_downsampled::filter t_filter;
+    typedef vector<scopedPointer<t_downsampled> > t_downsampledList;
 
     /**
      * @brief accessor constructor
@@ -48,11 +53,45 @@ public:
         }
     }
 
+    /**
+     * @brief accessor constructor, which builds a level-of-detail pyramid of type simple::container::downsampled.
+     * The lod N reads the voxel from level N of the pyramid instead of sampling voxels with stride 2^N, which touches 2^N less container-tiles per voxel.
+     * Every edit gets reduced level by level, only the edited voxel bounds.
+     * @param worker May get called by multiple threads.
+     * @param voxels The voxel-container to get the data from and to sync with. Level 0 of the pyramid.
+     * @param numLod Count of level of details.
+     * @param filter How voxel get reduced from one level to the next. filter::point results in the same voxel as the other constructor.
+     */
+    accessor(blub::async::dispatcher &worker,
+             t_simpleContainer &voxels,
+             const uint32& numLod,
+             const t_filter& filter)
+        : m_voxels(voxels)
+    {
+        for (uint32 indLod = 0; indLod < numLod; ++indLod)
+        {
+            t_simple* lod;
+            if (indLod == 0)
+            {
+                lod = new t_simple(worker, voxels, indLod);
+            }
+            else
+            {
+                t_simpleContainer &source(getVoxelContainerLevel(indLod-1));
+                m_downsampled.emplace_back(new t_downsampled(worker, source, filter));
+                lod = new t_simple(worker, *m_downsampled.back(), source, indLod);
+            }
+            t_base::m_lods.emplace_back(lod);
+        }
+    }
+
     /**
      * @brief ~accessor destructor
      */
     ~accessor()
     {
+        // the lods reference the pyramid
+        t_base::m_lods.clear();
     }
 
     /**
@@ -64,8 +103,24 @@ public:
         return m_voxels;
     }
 
+    /**
+     * @brief getVoxelContainerLevel returns the voxel-container of a level of the level-of-detail pyramid.
+     * @param level 0 returns getVoxelContainer(). Without pyramid only 0 is valid.
+     * @return
+     */
+    t_simpleContainer &getVoxelContainerLevel(const uint32& level) const
+    {
+        if (level == 0)
+        {
+            return m_voxels;
+        }
+        BASSERT(level <= m_downsampled.size());
+        return *m_downsampled[level-1];
+    }
+
 private:
     t_simpleContainer &m_voxels;
+    t_downsampledList m_downsampled;
 
 };
 
@@ -68,6 +68,13 @@ public:
      */
     void setCreateTileCallback(const t_createTileCallback &toSet);
 
+    /**
+     * @brief setIncrementalRelease sets the incremental release to all lods. Call before the first edit.
+     * @param firstPart
+     * @see simple::base::setIncrementalRelease()
+     */
+    void setIncrementalRelease(const int32 &firstPart);
+
 protected:
 
 
@@ -118,6 +125,15 @@ void base<tileType>::setCreateTileCallback(const t_createTileCallback &toSet)
     }
 }
 
+template <class tileType>
+void base<tileType>::setIncrementalRelease(const int32 &firstPart)
+{
+    for (typename t_lodList::value_type &lod : m_lods)
+    {
+        lod->setIncrementalRelease(firstPart);
+    }
+}
+
 
 }
 }
@@ -104,6 +104,18 @@ public:
             t_base::m_lods[indLod]->removeCamera(toRemove);
         }
     }
+    /**
+     * @brief setCaveCulling enables or disables cave-culling for all lods.
+     * @param enable
+     * @see simple::renderer::setCaveCulling()
+     */
+    void setCaveCulling(const bool& enable)
+    {
+        for (uint32 indLod = 0; indLod < t_base::m_lods.size(); ++indLod)
+        {
+            t_base::m_lods[indLod]->setCaveCulling(enable);
+        }
+    }
 
 protected:
 
@@ -3,12 +3,15 @@
 
 #include "blub/core/array.hpp"
 #include "blub/core/globals.hpp"
-#include "blub/core/scopedPtr.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/axisAlignedBoxInt32.hpp"
 #include "blub/math/vector2int.hpp"
 #include "blub/math/vector3int.hpp"
 #include "blub/serialization/access.hpp"
 #include "blub/serialization/nameValuePair.hpp"
 
+#include <atomic>
+
 
 namespace blub
 {
@@ -23,6 +26,7 @@ namespace tile
 /**
  * @brief The accessor class caches all voxel needed by tile::surface for an extremly optimized and fast calculation for the same.
  * This class looks up all voxel needed for the modified marching cubes and if lod is enabled 6*arrays for every side of the cube (transvoxel).
+ * Per brick of brickLength^3 voxel it counts the voxel with an interpolation larger or equal zero, so tile::surface can skip bricks without a surface.
  * See http://www.terathon.com/voxels/ and http://www.terathon.com/lengyel/Lengyel-VoxelTerrain.pdf
  */
 template <class configType>
@@ -42,6 +46,9 @@ public:
     static const int32 voxelCountLodAll;
     static const int32 voxelLengthSurface;
     static const int32 voxelCountSurface;
+    static const int32 brickLength;
+    static const int32 brickLengthPerTile;
+    static const int32 brickCount;
 #else
     static constexpr int32 voxelLength = t_config::voxelsPerTile;
     static constexpr int32 voxelLengthWithNormalCorrection = voxelLength+3;
@@ -51,10 +58,14 @@ public:
     static constexpr int32 voxelCountLodAll = 6*voxelCountLod;
     static constexpr int32 voxelLengthSurface = t_config::voxelsPerTile+1;
     static constexpr int32 voxelCountSurface = voxelLengthSurface*voxelLengthSurface*voxelLengthSurface;
+    static constexpr int32 brickLength = 4;
+    static constexpr int32 brickLengthPerTile = (voxelLength+1+brickLength)/brickLength + 1;
+    static constexpr int32 brickCount = brickLengthPerTile*brickLengthPerTile*brickLengthPerTile;
 #endif
 
     typedef vector<t_voxel> t_voxelArray;
     typedef vector<t_voxel> t_voxelArrayLod;
+    typedef vector<uint8> t_brickCounts;
 
     /**
      * @brief create creates an instance.
@@ -70,10 +81,7 @@ public:
      */
     virtual ~accessor()
     {
-        if (m_calculateLod)
-        {
-            m_voxelsLod.reset();
-        }
+        ;
     }
 
     /**
@@ -91,16 +99,26 @@ public:
         BASSERT(pos.y < voxelLengthWithNormalCorrection-1);
         BASSERT(pos.z < voxelLengthWithNormalCorrection-1);
 
-        if (toSet.getInterpolation() >= 0 && pos >= vector3int32(0) && pos < vector3int32(voxelLengthSurface))
-        {
-            ++m_numVoxelLargerZero;
-        }
-
         const int32 index((pos.x+1)*voxelLengthWithNormalCorrection*voxelLengthWithNormalCorrection + (pos.y+1)*voxelLengthWithNormalCorrection + pos.z+1);
         const t_voxel oldValue(m_voxels[index]);
+        if (oldValue == toSet)
+        {
+            return false;
+        }
         m_voxels[index] = toSet;
 
-        return oldValue != toSet;
+        const int32 largerZero((toSet.getInterpolation() >= 0 ? 1 : 0) - (oldValue.getInterpolation() >= 0 ? 1 : 0));
+        if (largerZero != 0)
+        {
+            m_brickCountLargerZero[calculateBrickIndex(calculateBrick(pos))] += largerZero;
+            if (pos >= vector3int32(0) && pos < vector3int32(voxelLengthSurface))
+            {
+                m_numVoxelLargerZero += largerZero;
+            }
+        }
+        m_changedVoxelBoundingBox.extend(pos);
+
+        return true;
     }
 
     /**
@@ -113,7 +131,47 @@ public:
      */
     bool setVoxelLod(const vector3int32& pos, const t_voxel& toSet, const int32& lod)
     {
-        return setVoxelLod(calculateCoordsLod(pos, lod), toSet, lod);
+        if (!setVoxelLod(calculateCoordsLod(pos, lod), toSet, lod))
+        {
+            return false;
+        }
+        // lod-voxel have double resolution
+        vector3int32 posInTile(pos);
+        switch (lod)
+        {
+        case 1:
+            posInTile = posInTile + vector3int32(voxelLengthLod-2, 0, 0);
+            break;
+        case 3:
+            posInTile = posInTile + vector3int32(0, voxelLengthLod-2, 0);
+            break;
+        case 5:
+            posInTile = posInTile + vector3int32(0, 0, voxelLengthLod-2);
+            break;
+        default:
+            break;
+        }
+        m_changedVoxelBoundingBox.extend(axisAlignedBoxInt32(posInTile / 2, (posInTile + vector3int32(1)) / 2));
+        return true;
+    }
+
+    /**
+     * @brief resetEditedVoxelBoundingBox resets the bounds returned by getEditedVoxelBoundingBox().
+     */
+    void resetEditedVoxelBoundingBox()
+    {
+        m_changedVoxelBoundingBox.setInvalid();
+    }
+
+    /**
+     * @brief getEditedVoxelBoundingBox returns the bounds of the voxel, including the lod-voxel, that changed since the last call of resetEditedVoxelBoundingBox().
+     * Lod-voxel get converted to voxel-coordinates.
+     * @return May be invalid if nothing changed.
+     * @see setVoxel()
+     */
+    const axisAlignedBoxInt32& getEditedVoxelBoundingBox() const
+    {
+        return m_changedVoxelBoundingBox;
     }
 
     /**
@@ -166,12 +224,79 @@ public:
     }
 
     /**
-     * @brief getCalculateLod returns true if surface later shall calculate level-of-detail
+     * @brief calculateBrick returns the brick that contains a voxel. Brick 1 starts at voxel 0, so the bricks line up with the ones of tile::container.
+     * @param pos -1 <= pos.xyz < voxelLengthWithNormalCorrection-1
+     * @return 0 <= brick.xyz < brickLengthPerTile
+     */
+    static vector3int32 calculateBrick(const vector3int32& pos)
+    {
+        return (pos + vector3int32(brickLength)) / brickLength;
+    }
+    /**
+     * @brief calculateBrickIndex convertes a 3d brick-pos to a 1d array-index.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile. The brick contains the voxel brick*brickLength-brickLength to brick*brickLength-1.
+     * @return
+     */
+    static int32 calculateBrickIndex(const vector3int32& brick)
+    {
+        BASSERT(brick >= vector3int32(0));
+        BASSERT(brick < vector3int32(brickLengthPerTile));
+        return brick.x*(brickLengthPerTile*brickLengthPerTile) + brick.y*brickLengthPerTile + brick.z;
+    }
+    /**
+     * @brief calculateBrickVoxelCount returns the number of voxel in a brick. The first and the last brick of an axis are smaller.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
+     * @return
+     */
+    static int32 calculateBrickVoxelCount(const vector3int32& brick)
+    {
+        const vector3int32 first((brick*brickLength - vector3int32(brickLength)).getMaximum(vector3int32(-1)));
+        const vector3int32 last((brick*brickLength - vector3int32(1)).getMinimum(vector3int32(voxelLengthWithNormalCorrection-2)));
+        const vector3int32 size(last - first + vector3int32(1));
+        return size.x*size.y*size.z;
+    }
+
+    /**
+     * @brief isBrickEmpty returns true if all voxel of a brick have an interpolation lower zero.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
      * @return
+     * @see calculateBrick()
      */
-    const bool& getCalculateLod() const
+    bool isBrickEmpty(const vector3int32& brick) const
     {
-        return m_calculateLod;
+        return m_brickCountLargerZero[calculateBrickIndex(brick)] == 0;
+    }
+    /**
+     * @brief isBrickFull returns true if all voxel of a brick have an interpolation larger or equal zero.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
+     * @return
+     * @see calculateBrick()
+     */
+    bool isBrickFull(const vector3int32& brick) const
+    {
+        return m_brickCountLargerZero[calculateBrickIndex(brick)] == calculateBrickVoxelCount(brick);
+    }
+
+    /**
+     * @brief getCalculateLod returns true if surface later shall calculate level-of-detail for at least one side of the tile.
+     * @return
+     * @see getCalculateLodFace()
+     */
+    bool getCalculateLod() const
+    {
+        return m_lodFaces != 0;
+    }
+
+    /**
+     * @brief getCalculateLodFace returns true if the lod-voxel of a side of the tile get cached, so surface can calculate its transvoxel-list.
+     * @param lod 0 to 5, same index as the lod-voxel.
+     * @return
+     */
+    bool getCalculateLodFace(const int32& lod) const
+    {
+        BASSERT(lod >= 0);
+        BASSERT(lod < 6);
+        return (m_lodFaces & (1 << lod)) != 0;
     }
 
     /**
@@ -210,45 +335,78 @@ public:
         return m_voxels;
     }
     /**
-     * @brief getVoxelArrayLod returns nullptr if no lod shall get calculated else 6-lod-arrays of voxels.
+     * @brief getVoxelArrayLod returns nullptr if the lod-voxel of a side don't get cached else the lod-array of voxels of the side.
+     * @param lod 0 to 5
      * @return
-     * @see getCalculateLod()
+     * @see getCalculateLodFace()
      */
-    t_voxelArrayLod* getVoxelArrayLod() const
+    const t_voxelArrayLod* getVoxelArrayLod(const int32& lod) const
     {
-        return m_voxelsLod.get();
+        if (!getCalculateLodFace(lod))
+        {
+            return nullptr;
+        }
+        return &m_voxelsLod[lod];
     }
     /**
-     * @brief getVoxelArrayLod returns nullptr if no lod shall get calculated else 6-lod-arrays of voxels.
-     * @return returns
-     * @see getCalculateLod()
+     * @brief getVoxelArrayLod returns nullptr if the lod-voxel of a side don't get cached else the lod-array of voxels of the side.
+     * @param lod 0 to 5
+     * @return
+     * @see getCalculateLodFace()
      */
-    t_voxelArrayLod* getVoxelArrayLod()
+    t_voxelArrayLod* getVoxelArrayLod(const int32& lod)
     {
-        return m_voxelsLod.get();
+        if (!getCalculateLodFace(lod))
+        {
+            return nullptr;
+        }
+        return &m_voxelsLod[lod];
     }
 
     /**
-     * @brief setCalculateLod enables or disables lod calculation and voxel buffering for it.
+     * @brief setCalculateLod enables or disables lod calculation and voxel buffering for it, for all 6 sides.
      * @param lod
+     * @see setCalculateLodFace()
      */
     void setCalculateLod(const bool& lod)
     {
-        if (m_calculateLod == lod)
+        for (int32 face = 0; face < 6; ++face)
+        {
+            setCalculateLodFace(face, lod);
+        }
+    }
+
+    /**
+     * @brief setCalculateLodFace enables or disables lod calculation and voxel buffering for one side of the tile.
+     * A side that got enabled contains default voxel until setVoxelLod() got called for all of its voxel.
+     * @param lod 0 to 5, same index as the lod-voxel.
+     * @param calculate
+     */
+    void setCalculateLodFace(const int32& lod, const bool& calculate)
+    {
+        if (getCalculateLodFace(lod) == calculate)
         {
             // do nothing
-//            BWARNING("m_calculateLod == lod");
             return;
         }
-        m_calculateLod = lod;
-        if (m_calculateLod)
+        t_voxelArrayLod &voxelsLod(m_voxelsLod[lod]);
+        if (calculate)
         {
-            BASSERT(m_voxelsLod == nullptr);
-            m_voxelsLod.reset(new t_voxelArrayLod(6*voxelCountLod)); // [6*voxelCountLod]
+            m_lodFaces |= (1 << lod);
+            voxelsLod.resize(voxelCountLod);
+            for (const t_voxel& work : voxelsLod)
+            {
+                m_numVoxelLargerZeroLod += work.getInterpolation() >= 0 ? 1 : 0;
+            }
         }
         else
         {
-            m_voxelsLod.reset();
+            m_lodFaces &= ~(1 << lod);
+            for (const t_voxel& work : voxelsLod)
+            {
+                m_numVoxelLargerZeroLod -= work.getInterpolation() >= 0 ? 1 : 0;
+            }
+            t_voxelArrayLod().swap(voxelsLod);
         }
     }
 
@@ -269,17 +427,101 @@ public:
         m_numVoxelLargerZeroLod = toSet;
     }
 
+    /**
+     * @brief copy copies the voxel and the cached sides of another tile. simple::accessor never changes a tile that other classes may read,
+     * it changes a copy and replaces the tile by it (copy-on-write).
+     * The copy gets the same lineage and version as other.
+     * @param other The tile to copy.
+     * @see getLineage()
+     */
+    void copy(const accessor& other)
+    {
+        m_voxels = other.m_voxels;
+        for (int32 face = 0; face < 6; ++face)
+        {
+            m_voxelsLod[face] = other.m_voxelsLod[face];
+        }
+        m_lodFaces = other.m_lodFaces;
+        m_numVoxelLargerZero = other.m_numVoxelLargerZero;
+        m_numVoxelLargerZeroLod = other.m_numVoxelLargerZeroLod;
+        m_brickCountLargerZero = other.m_brickCountLargerZero;
+        m_changedVoxelBoundingBox = other.m_changedVoxelBoundingBox;
+        m_lineage = other.m_lineage;
+        m_version = other.getVersion();
+    }
+
+    /**
+     * @brief getLineage returns an identifier shared by a tile and all copies made by copy(). A newly created tile gets a new one.
+     * tile::surface uses it to find out if it got calculated by an earlier version of the same tile.
+     * @return
+     */
+    const uint64& getLineage() const
+    {
+        return m_lineage;
+    }
+
+    /**
+     * @brief getVersion returns the version of the tile. Jobs reading the tile remember it and skip their work if it changed meanwhile,
+     * because their result would get replaced by the one of the newer copy anyway. Thread-safe.
+     * @return Starts with 0.
+     * @see increaseVersion()
+     */
+    uint32 getVersion() const
+    {
+        return m_version.load();
+    }
+    /**
+     * @brief increaseVersion gets called by simple::accessor after it replaced the tile by a changed copy. Thread-safe.
+     */
+    void increaseVersion()
+    {
+        ++m_version;
+    }
+
 protected:
     /**
      * @brief accessor constructor
      */
     accessor()
         : m_voxels(voxelCount)
-        , m_voxelsLod(nullptr)
-        , m_calculateLod(false)
+        , m_lodFaces(0)
         , m_numVoxelLargerZero(0)
         , m_numVoxelLargerZeroLod(0)
+        , m_brickCountLargerZero(brickCount, 0)
+        , m_lineage(createLineage())
+        , m_version(0)
+    {
+    }
+
+    /**
+     * @brief createLineage returns a new identifier for getLineage(). Thread-safe.
+     */
+    static uint64 createLineage()
+    {
+        static std::atomic<uint64> lastLineage(0);
+        return ++lastLineage;
+    }
+
+    /**
+     * @brief calculateBrickCounts counts for every brick the voxel with an interpolation larger or equal zero.
+     */
+    void calculateBrickCounts()
     {
+        m_brickCountLargerZero.assign(brickCount, 0);
+        int32 index(0);
+        for (int32 indX = -1; indX < voxelLengthWithNormalCorrection-1; ++indX)
+        {
+            for (int32 indY = -1; indY < voxelLengthWithNormalCorrection-1; ++indY)
+            {
+                for (int32 indZ = -1; indZ < voxelLengthWithNormalCorrection-1; ++indZ, ++index)
+                {
+                    if (m_voxels[index].getInterpolation() >= 0)
+                    {
+                        ++m_brickCountLargerZero[calculateBrickIndex(calculateBrick(vector3int32(indX, indY, indZ)))];
+                    }
+                }
+            }
+        }
     }
 
     /**
@@ -289,18 +531,18 @@ protected:
     {
         BASSERT(index >= 0);
         BASSERT(index < voxelCountLod);
-        BASSERT(m_calculateLod);
-        BASSERT(m_voxelsLod.get() != nullptr);
+        BASSERT(getCalculateLodFace(lod));
 
-        if (toSet.getInterpolation() >= 0)
+        t_voxel &voxel(m_voxelsLod[lod][index.x*voxelLengthLod + index.y]);
+        const t_voxel oldValue(voxel);
+        if (oldValue == toSet)
         {
-            ++m_numVoxelLargerZeroLod;
+            return false;
         }
-        const uint32 index_(lod*voxelCountLod + index.x*voxelLengthLod + index.y);
-        const t_voxel oldValue((*m_voxelsLod)[index_]);
-        (*m_voxelsLod)[index_] = toSet;
+        voxel = toSet;
+        m_numVoxelLargerZeroLod += (toSet.getInterpolation() >= 0 ? 1 : 0) - (oldValue.getInterpolation() >= 0 ? 1 : 0);
 
-        return oldValue != toSet;
+        return true;
     }
     /**
      * @see getVoxelLod()
@@ -309,8 +551,8 @@ protected:
     {
         BASSERT(index >= 0);
         BASSERT(index < voxelCountLod);
-        BASSERT(m_calculateLod);
-        return (*m_voxelsLod)[lod*voxelCountLod + index.x*voxelLengthLod + index.y];
+        BASSERT(getCalculateLodFace(lod));
+        return m_voxelsLod[lod][index.x*voxelLengthLod + index.y];
     }
 
     /**
@@ -362,7 +604,16 @@ private:
 
         (void)version;
 
-        readWrite << nameValuePair::create("calculateLod", m_calculateLod);
+        readWrite << nameValuePair::create("lodFaces", m_lodFaces);
+        readWrite << nameValuePair::create("voxels", m_voxels); // OPTIMISE gives twice the size in binary format (2 instead of 1)
+
+        for (int32 face = 0; face < 6; ++face)
+        {
+            if (getCalculateLodFace(face))
+            {
+                readWrite << nameValuePair::create("voxelsLod", m_voxelsLod[face]);
+            }
+        }
     }
     template <class formatType>
     void load(formatType & readWrite, const uint32& version)
@@ -371,9 +622,22 @@ private:
 
         (void)version;
 
-        bool calculateLod;
-        readWrite >> nameValuePair::create("calculateLod", calculateLod);
-        setCalculateLod(calculateLod);
+        uint8 lodFaces;
+        readWrite >> nameValuePair::create("lodFaces", lodFaces);
+        for (int32 face = 0; face < 6; ++face)
+        {
+            setCalculateLodFace(face, (lodFaces & (1 << face)) != 0);
+        }
+        readWrite >> nameValuePair::create("voxels", m_voxels);
+
+        for (int32 face = 0; face < 6; ++face)
+        {
+            if (getCalculateLodFace(face))
+            {
+                readWrite >> nameValuePair::create("voxelsLod", m_voxelsLod[face]);
+            }
+        }
+        calculateBrickCounts();
     }
 
     template <class formatType>
@@ -385,26 +649,26 @@ private:
 
         readWrite & nameValuePair::create("numVoxelLargerZero", m_numVoxelLargerZero);
         readWrite & nameValuePair::create("numVoxelLargerZeroLod", m_numVoxelLargerZeroLod);
-        saveLoad(readWrite, *this, version); // handle m_calculateLod
-        readWrite & nameValuePair::create("voxels", m_voxels); // OPTIMISE gives twice the size in binary format (2 instead of 1)
-
-        if (m_calculateLod)
-        {
-            BASSERT(!m_voxelsLod.isNull());
-            readWrite & nameValuePair::create("voxelsLod", *m_voxelsLod);
-        }
+        saveLoad(readWrite, *this, version); // handle m_lodFaces, the voxel and the brick-counts
     }
 
 
 
 private:
     t_voxelArray m_voxels;
-    blub::scopedPointer<t_voxelArrayLod> m_voxelsLod;
+    // per side, empty if the side doesn't get cached
+    t_voxelArrayLod m_voxelsLod[6];
 
-    bool m_calculateLod;
+    uint8 m_lodFaces;
     int32 m_numVoxelLargerZero;
     int32 m_numVoxelLargerZeroLod;
+    // per brick, see calculateBrick()
+    t_brickCounts m_brickCountLargerZero;
+
+    axisAlignedBoxInt32 m_changedVoxelBoundingBox;
 
+    uint64 m_lineage;
+    std::atomic<uint32> m_version;
 
 };
 
@@ -418,6 +682,9 @@ template <class voxelType> const int32 accessor<voxelType>::voxelCountLod = voxe
 template <class voxelType> const int32 accessor<voxelType>::voxelCountLodAll = 6*voxelCountLod;
 template <class voxelType> const int32 accessor<voxelType>::voxelLengthSurface = t_config::voxelsPerTile+1;
 template <class voxelType> const int32 accessor<voxelType>::voxelCountSurface = voxelLengthSurface*voxelLengthSurface*voxelLengthSurface;
+template <class voxelType> const int32 accessor<voxelType>::brickLength = 4;
+template <class voxelType> const int32 accessor<voxelType>::brickLengthPerTile = (voxelLength+1+brickLength)/brickLength + 1;
+template <class voxelType> const int32 accessor<voxelType>::brickCount = brickLengthPerTile*brickLengthPerTile*brickLengthPerTile;
 #else
 template <class voxelType> constexpr int32 accessor<voxelType>::voxelLength;
 template <class voxelType> constexpr int32 accessor<voxelType>::voxelLengthWithNormalCorrection;
@@ -427,6 +694,9 @@ template <class voxelType> constexpr int32 accessor<voxelType>::voxelCountLod;
 template <class voxelType> constexpr int32 accessor<voxelType>::voxelCountLodAll;
 template <class voxelType> constexpr int32 accessor<voxelType>::voxelLengthSurface;
 template <class voxelType> constexpr int32 accessor<voxelType>::voxelCountSurface;
+template <class voxelType> constexpr int32 accessor<voxelType>::brickLength;
+template <class voxelType> constexpr int32 accessor<voxelType>::brickLengthPerTile;
+template <class voxelType> constexpr int32 accessor<voxelType>::brickCount;
 #endif
 
 
@@ -24,6 +24,7 @@ namespace tile
 /**
  * @brief The container class contains an array of voxel. The amount of voxel per tile is voxelLength^3.
  * The class counts how many voxel are max and how many are min. if all voxel are min or max the class simple::container::base doesnt save them.
+ * The same gets counted per brick of brickLength^3 voxel, so readers can skip the voxel of bricks that are completely min or max.
  * Additionally it saves an axisAlignedBox which describes the bounds of the voxel that changed.
  */
 template <class configType>
@@ -37,12 +38,19 @@ public:
 #if defined(BOOST_NO_CXX11_CONSTEXPR)
     static const int32 voxelLength;
     static const int32 voxelCount;
+    static const int32 brickLength;
+    static const int32 brickLengthPerTile;
+    static const int32 brickCount;
 #else
     static constexpr int32 voxelLength = t_config::voxelsPerTile;
     static constexpr int32 voxelCount = voxelLength*voxelLength*voxelLength;
+    static constexpr int32 brickLength = 4;
+    static constexpr int32 brickLengthPerTile = (voxelLength+brickLength-1)/brickLength;
+    static constexpr int32 brickCount = brickLengthPerTile*brickLengthPerTile*brickLengthPerTile;
 #endif
  
     typedef vector<t_data> t_voxelArray;
+    typedef vector<uint8> t_brickCounts;
 
     /**
      * @brief create creates an instance.
@@ -93,6 +101,16 @@ public:
     {
         return m_changedVoxelBoundingBox;
     }
+    /**
+     * @brief extendEditedVoxelBoundingBox marks voxel as changed, even if their value did not change.
+     * @param toExtend Local voxel bounds. Inclusive.
+     * @see getEditedVoxelBoundingBox()
+     */
+    void extendEditedVoxelBoundingBox(const axisAlignedBoxInt32& toExtend)
+    {
+        BASSERT(m_editing);
+        m_changedVoxelBoundingBox.extend(toExtend);
+    }
 
     /**
      * @brief setVoxel sets an voxel to a local position.
@@ -148,6 +166,7 @@ public:
         m_countVoxelInterpolationLargerZero = voxelCount;
         m_countVoxelMinimum = 0;
         m_countVoxelMaximum = voxelCount;
+        calculateBrickCounts();
     }
     /**
      * @brief setFull sets all voxel to max.
@@ -164,6 +183,7 @@ public:
         m_countVoxelInterpolationLargerZero = 0;
         m_countVoxelMinimum = voxelCount;
         m_countVoxelMaximum = 0;
+        calculateBrickCounts();
     }
 
     /**
@@ -266,6 +286,49 @@ public:
         return m_countVoxelMaximum == container::voxelCount;
     }
 
+    /**
+     * @brief calculateBrickIndex convertes a 3d brick-pos to a 1d array-index.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile. The brick contains the voxel brick*brickLength to brick*brickLength+brickLength-1.
+     * @return
+     */
+    static int32 calculateBrickIndex(const vector3int32& brick)
+    {
+        BASSERT(brick >= vector3int32(0));
+        BASSERT(brick < vector3int32(brickLengthPerTile));
+        return brick.x*(brickLengthPerTile*brickLengthPerTile) + brick.y*brickLengthPerTile + brick.z;
+    }
+    /**
+     * @brief calculateBrickVoxelCount returns the number of voxel in a brick. The last brick of an axis is smaller if voxelLength isn't a multiple of brickLength.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
+     * @return
+     */
+    static int32 calculateBrickVoxelCount(const vector3int32& brick)
+    {
+        const vector3int32 size((brick*brickLength + vector3int32(brickLength)).getMinimum(vector3int32(voxelLength)) - brick*brickLength);
+        return size.x*size.y*size.z;
+    }
+
+    /**
+     * @brief isBrickEmpty returns true if all voxel of a brick are minimum.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
+     * @return
+     * @see calculateBrickIndex()
+     */
+    bool isBrickEmpty(const vector3int32& brick) const
+    {
+        return m_brickCountMinimum[calculateBrickIndex(brick)] == calculateBrickVoxelCount(brick);
+    }
+    /**
+     * @brief isBrickFull returns true if all voxel of a brick are maximum.
+     * @param brick 0 <= brick.xyz < brickLengthPerTile
+     * @return
+     * @see calculateBrickIndex()
+     */
+    bool isBrickFull(const vector3int32& brick) const
+    {
+        return m_brickCountMaximum[calculateBrickIndex(brick)] == calculateBrickVoxelCount(brick);
+    }
+
     /**
      * @brief operator = copy operator
      * @param other
@@ -276,6 +339,8 @@ public:
         m_countVoxelMinimum = other.getCountVoxelMinimum();
         m_countVoxelMaximum = other.getCountVoxelMaximum();
         m_voxels = other.getVoxelArray();
+        m_brickCountMinimum = other.m_brickCountMinimum;
+        m_brickCountMaximum = other.m_brickCountMaximum;
     }
 
 protected:
@@ -289,7 +354,7 @@ protected:
         , m_countVoxelMaximum(0)
         , m_editing(false)
     {
-        ;
+        calculateBrickCounts();
     }
 
     // TODO remove me - do lambda / boost/std::function
@@ -357,6 +422,7 @@ protected:
         {
             return false;
         }
+        const int32 brickIndex(calculateBrickIndexByVoxelIndex(index));
 
         // count for full/empty voxel --> memory optimisation
         if (currentVoxel.getInterpolation() < 0 && toSet.getInterpolation() >= 0)
@@ -373,23 +439,27 @@ protected:
         if (!currentVoxel.isMin() && toSet.isMin())
         {
             ++m_countVoxelMinimum;
+            ++m_brickCountMinimum[brickIndex];
         }
         else
         {
             if (currentVoxel.isMin() && !toSet.isMin())
             {
                 --m_countVoxelMinimum;
+                --m_brickCountMinimum[brickIndex];
             }
         }
         if (!currentVoxel.isMax() && toSet.isMax())
         {
             ++m_countVoxelMaximum;
+            ++m_brickCountMaximum[brickIndex];
         }
         else
         {
             if (currentVoxel.isMax() && !toSet.isMax())
             {
                 --m_countVoxelMaximum;
+                --m_brickCountMaximum[brickIndex];
             }
         }
 
@@ -399,9 +469,66 @@ protected:
         return true;
     }
 
+    /**
+     * @brief calculateBrickIndexByVoxelIndex returns the index of the brick that contains a voxel.
+     * @param index Voxel-index.
+     * @return
+     * @see calculateIndex()
+     * @see calculateBrickIndex()
+     */
+    static int32 calculateBrickIndexByVoxelIndex(const int32& index)
+    {
+        const vector3int32 pos(index / (voxelLength*voxelLength), (index / voxelLength) % voxelLength, index % voxelLength);
+        return calculateBrickIndex(pos / brickLength);
+    }
+
+    /**
+     * @brief calculateBrickCounts counts for every brick the voxel that are minimum and maximum.
+     */
+    void calculateBrickCounts()
+    {
+        m_brickCountMinimum.assign(brickCount, 0);
+        m_brickCountMaximum.assign(brickCount, 0);
+        int32 index(0);
+        for (int32 indX = 0; indX < voxelLength; ++indX)
+        {
+            for (int32 indY = 0; indY < voxelLength; ++indY)
+            {
+                for (int32 indZ = 0; indZ < voxelLength; ++indZ, ++index)
+                {
+                    const t_data& work(m_voxels[index]);
+                    const int32 brickIndex(calculateBrickIndex(vector3int32(indX, indY, indZ) / brickLength));
+                    if (work.isMin())
+                    {
+                        ++m_brickCountMinimum[brickIndex];
+                    }
+                    if (work.isMax())
+                    {
+                        ++m_brickCountMaximum[brickIndex];
+                    }
+                }
+            }
+        }
+    }
+
 private:
     BLUB_SERIALIZATION_ACCESS
 
+    template <class formatType>
+    void save(formatType & readWrite, const uint32& version) const
+    {
+        (void)readWrite;
+        (void)version;
+    }
+    template <class formatType>
+    void load(formatType & readWrite, const uint32& version)
+    {
+        (void)readWrite;
+        (void)version;
+
+        calculateBrickCounts();
+    }
+
     template <class formatType>
     void serialize(formatType & readWrite, const uint32& version)
     {
@@ -415,6 +542,7 @@ private:
         readWrite & nameValuePair::create("editing", m_editing);
         readWrite & nameValuePair::create("changedVoxelBoundingBox", m_changedVoxelBoundingBox);
         readWrite & nameValuePair::create("voxels", m_voxels);
+        saveLoad(readWrite, *this, version); // recalculates the brick-counts
     }
 
 private:
@@ -423,6 +551,9 @@ private:
     int32 m_countVoxelInterpolationLargerZero;
     int32 m_countVoxelMinimum;
     int32 m_countVoxelMaximum;
+    // per brick, see calculateBrickIndex()
+    t_brickCounts m_brickCountMinimum;
+    t_brickCounts m_brickCountMaximum;
 
     bool m_editing;
     axisAlignedBoxInt32 m_changedVoxelBoundingBox;
@@ -435,11 +566,23 @@ template <class voxelType>
 const int32 container<voxelType>::voxelLength = t_config::voxelsPerTile;
 template <class voxelType>
 const int32 container<voxelType>::voxelCount = voxelLength*voxelLength*voxelLength;
+template <class voxelType>
+const int32 container<voxelType>::brickLength = 4;
+template <class voxelType>
+const int32 container<voxelType>::brickLengthPerTile = (voxelLength+brickLength-1)/brickLength;
+template <class voxelType>
+const int32 container<voxelType>::brickCount = brickLengthPerTile*brickLengthPerTile*brickLengthPerTile;
 #else
 template <class voxelType>
 constexpr int32 container<voxelType>::voxelLength;
 template <class voxelType>
 constexpr int32 container<voxelType>::voxelCount;
+template <class voxelType>
+constexpr int32 container<voxelType>::brickLength;
+template <class voxelType>
+constexpr int32 container<voxelType>::brickLengthPerTile;
+template <class voxelType>
+constexpr int32 container<voxelType>::brickCount;
 #endif
 
 
@@ -39,7 +39,8 @@ public:
 
     /**
      * @brief Implement this method and cast the data to your graphic engine.
-     * @param convertToRenderAble Contains vertices and indices.
+     * @param convertToRenderAble Contains vertices and indices. If a buffer of the tile exists already, update only the parts
+     * surface::getDirtyVertexRange() and surface::getDirtyIndexRange() and resize it if the size of the lists changed.
      * @param aabb The axisAlignedBox that describes the bound of the vertices.
      */
     void setTileData(t_tileDataPtr convertToRenderAble, const axisAlignedBox &aabb) {;}
@@ -55,6 +56,8 @@ public:
 
     /**
      * @brief setVisibleLod sets if one of the 6 crack closing submeshes (for lod) should get rendered.
+     * A submesh gets calculated the first time it should get rendered, until then surface::getIndicesLod() is empty and the tile gets set again by setTileData() afterwards.
+     * See surface::isIndicesLodCalculated().
      * @param indLod 0 to 6
      * @param vis
      */
@@ -82,12 +85,33 @@ public:
         return m_lodShouldBeVisible[indLod];
     }
 
+    /**
+     * @brief setCulled sets if a tile is hidden by cave-culling, because no camera can see it through empty space.
+     * A culled tile must not be rendered, even if getVisible() returns true. getVisible() and getVisibleLod() don't change.
+     * @param culled true for hidden.
+     * @see simple::renderer::setCaveCulling()
+     */
+    virtual void setCulled(const bool& culled)
+    {
+        m_culled = culled;
+    }
+
+    /**
+     * @brief getCulled returns if a tile is hidden by cave-culling.
+     * @return
+     */
+    const bool &getCulled() const
+    {
+        return m_culled;
+    }
+
 protected:
     /**
      * @brief renderer constructor.
      */
     renderer()
         : m_shouldBeVisible(false)
+        , m_culled(false)
     {
         for (int32 ind = 0; ind < 6; ++ind)
         {
@@ -105,6 +129,10 @@ protected:
      * @brief saves if crack closing submesh should get rendered.
      */
     bool m_lodShouldBeVisible[6];
+    /**
+     * @brief m_culled saves if the tile is hidden by cave-culling.
+     */
+    bool m_culled;
 
 
 };
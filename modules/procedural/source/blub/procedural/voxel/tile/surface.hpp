@@ -4,11 +4,23 @@
 #include "blub/core/array.hpp"
 #include "blub/core/sharedPointer.hpp"
 #include "blub/core/vector.hpp"
+#include "blub/math/axisAlignedBoxInt32.hpp"
+#include "blub/math/math.hpp"
 #include "blub/math/vector2int.hpp"
 #include "blub/math/vector3.hpp"
 #include "blub/math/vector3int.hpp"
+#include "blub/procedural/log/global.hpp"
+#include "blub/procedural/voxel/bvh.hpp"
+#include "blub/procedural/voxel/decimation.hpp"
+#include "blub/procedural/voxel/indexBuffer.hpp"
+#include "blub/procedural/voxel/meshlet.hpp"
 #include "blub/procedural/voxel/tile/base.hpp"
 #include "blub/procedural/voxel/tile/internal/transvoxelTables.hpp"
+#include "blub/procedural/voxel/vertexCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 
 namespace blub
@@ -39,13 +51,55 @@ public:
     typedef typename t_config::t_accessor::t_tile t_voxelAccessor;
     typedef sharedPointer<t_voxelAccessor> t_voxelAccessorPtr;
     typedef vector<typename t_config::t_vertex> t_vertices;
-    typedef vector<typename t_config::t_index> t_indices;
+    typedef typename t_config::t_indices t_indices;
     typedef typename t_config::t_data t_voxel;
     typedef typename t_config::t_vertex t_vertex;
 
     typedef array<t_voxel, 2*2*2> t_calcVoxel;
     typedef array<t_voxel, 3*3*3+2*2> t_calcVoxelLod;
 
+    /**
+     * @brief The normalCalculation enum describes how the vertex-normals get calculated.
+     */
+    enum class normalCalculation
+    {
+        /**
+         * @brief face sums up the normals of the faces around a vertex. The normals at the tile-border don't match the ones of the neighbour tile.
+         */
+        face,
+        /**
+         * @brief faceWithCorrection same like face, but the ring of cells around the tile gets triangulated too, so the normals at the tile-border match.
+         * Check chapter 3.3 in Eric Lengyel’s Dissertation.
+         */
+        faceWithCorrection,
+        /**
+         * @brief gradient interpolates the central differences of the voxel at the two ends of the edge of a vertex.
+         * No cells outside the tile get triangulated and the normals at the tile-border match.
+         */
+        gradient
+    };
+
+    /**
+     * @brief The range struct describes the part [begin, end) of a list.
+     */
+    struct range
+    {
+        range(const uint32& begin_ = 0, const uint32& end_ = 0)
+            : begin(begin_)
+            , end(end_)
+        {
+            ;
+        }
+
+        bool isEmpty() const
+        {
+            return begin >= end;
+        }
+
+        uint32 begin;
+        uint32 end;
+    };
+
     /**
      * @brief create creates an instance.
      * @return never nullptr.
@@ -79,12 +133,12 @@ public:
      * @brief calculateSurface calculates the iso surface.
      * @param voxel Contains the voxel needed for the surface calculation.
      * @param voxelSize voxel-scale.
-     * @param calculateNormalCorrection check chapter 3.3 in Eric Lengyel’s Dissertation.
+     * @param normals How the vertex-normals get calculated.
      * @param lod Lod index starting with 0.
      */
     void calculateSurface(const t_voxelAccessorPtr voxel,
                           const real &voxelSize = 1.,
-                          const bool& calculateNormalCorrection = true,
+                          const normalCalculation& normals = normalCalculation::faceWithCorrection,
                           const int32 &lod = 0)
     {
 #ifdef BLUB_LOG_VOXEL_SURFACE
@@ -96,32 +150,643 @@ public:
 
         m_voxel = voxel;
         m_lod = lod;
+        m_voxelSize = voxelSize;
+        m_normalCalculation = normals;
 
         m_vertices.reserve(1000);
         m_indices.reserve(2000);
+        m_vertexSlabs.resize(getNumVertexSlabs());
+        m_indexSlabs.resize(getNumIndexSlabs());
+
+        const bool calculated(calculateCellSlabs(getFirstCell(), getLastCell()));
+        BASSERT(calculated);
+        (void)calculated;
+        calculateConnectivity();
+
+#ifdef BLUB_LOG_VOXEL_SURFACE
+        blub::BOUT("surface::calculateSurface(..) end");
+#endif
+    }
+
+    /**
+     * @brief recalculateSurface recalculates the iso surface after voxel of the same accessor-tile changed.
+     * Only the cell-slabs (all cells with the same x) near the changed voxel get triangulated again and get spliced into the vertex- and index-list.
+     * Slabs that got bigger get appended, so the lists fragment. They get compacted after getFragmentation() passed getMaxFragmentation().
+     * The transvoxel-lists get calculated completely. If changed is invalid only the transvoxel-lists get calculated, for example after more sides got cached by the accessor-tile.
+     * Falls back to calculateSurface() if the surface didn't get calculated by the same accessor-tile, or an earlier copy of it, and parameters before.
+     * Use getDirtyVertexRange() and getDirtyIndexRange() afterwards to update only the changed part of a gpu-buffer.
+     * @param voxel Contains the voxel needed for the surface calculation.
+     * @param changed The voxel that changed since the last calculation. See tile::accessor::getEditedVoxelBoundingBox(). Inclusive.
+     * If voxel is a copy of the accessor-tile of the last calculation it has to contain the changes of all copies in between. See tile::accessor::getLineage().
+     * @param voxelSize voxel-scale.
+     * @param normals How the vertex-normals get calculated.
+     * @param lod Lod index starting with 0.
+     */
+    void recalculateSurface(const t_voxelAccessorPtr voxel,
+                            const axisAlignedBoxInt32& changed,
+                            const real &voxelSize = 1.,
+                            const normalCalculation& normals = normalCalculation::faceWithCorrection,
+                            const int32 &lod = 0)
+    {
+        // the indices may change or move
+        m_bvh.clear();
+        m_meshlets.clear();
+        if (m_vertexSlabs.empty() ||
+                m_voxel->getLineage() != voxel->getLineage() ||
+                m_lod != lod ||
+                m_voxelSize != voxelSize ||
+                m_normalCalculation != normals)
+        {
+            calculateSurface(voxel, voxelSize, normals, lod);
+            return;
+        }
+#ifdef BLUB_LOG_VOXEL_SURFACE
+        blub::BOUT("surface::recalculateSurface(..) lod:" + blub::string::number(lod));
+#endif
+        // may be a newer copy
+        m_voxel = voxel;
+        if (!changed.isValid())
+        {
+            // the voxel for marching-cubes didn't change
+            m_dirtyVertices = range();
+            m_dirtyIndices = range();
+            if (getCaluculateTransvoxel())
+            {
+                if (!calculateTransvoxel(getScratch()))
+                {
+                    BLUB_PROCEDURAL_LOG_WARNING() << "surface::recalculateSurface(..) surface didn't match the one calculated before, calculating all";
+                    calculateSurface(voxel, voxelSize, normals, lod);
+                    return;
+                }
+                if (getFragmentation() > m_maxFragmentation)
+                {
+                    compact();
+                }
+            }
+            return;
+        }
+        // a voxel at x changes the vertices on the edges of the cells x-1 and x, which change the normals of the vertices of the cells x-2 to x+1.
+        // the gradient of a voxel at x depends on the voxel at x-1 and x+1, which touches the same cells.
+        const int32 cellStart(math::max(changed.getMinimum().x - 2, getFirstCell()));
+        const int32 cellEnd(math::min(changed.getMaximum().x + 2, getLastCell()));
+        if (!calculateCellSlabs(cellStart, cellEnd))
+        {
+            BLUB_PROCEDURAL_LOG_WARNING() << "surface::recalculateSurface(..) surface didn't match the one calculated before, calculating all";
+            calculateSurface(voxel, voxelSize, normals, lod);
+            return;
+        }
+        calculateConnectivity();
+    }
+
+    /**
+     * @brief clear erases all buffer/results.
+     */
+    void clear()
+    {
+        m_vertices.clear();
+        m_indices.clear();
+        m_indices.setWidth(indexBuffer::width::bits16);
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            m_indicesLod[lod].clear();
+            m_indicesLod[lod].setWidth(indexBuffer::width::bits16);
+        }
+        m_indicesLodCalculated = 0;
+        m_vertexEdgeIds.clear();
+        m_vertexNormals.clear();
+        m_vertexSlabs.clear();
+        m_indexSlabs.clear();
+        m_dirtyVertices = range();
+        m_dirtyIndices = range();
+        m_connectivity = 0;
+        m_bvh.clear();
+        m_meshlets.clear();
+    }
+
+    /**
+     * @brief does the transvoxel algo get applied.
+     * @return
+     */
+    bool getCaluculateTransvoxel() const
+    {
+        return m_lod > 0;
+    }
+
+    /**
+     * @brief same as getCaluculateTransvoxel()
+     * @see getCaluculateTransvoxel()
+     */
+    bool getCaluculateLod() const
+    {
+        return getCaluculateTransvoxel();
+    }
+
+    /**
+     * @brief getPositions returns resulting position-list.
+     * @return
+     */
+    const t_vertices& getVertices() const
+    {
+        return m_vertices;
+    }
+    /**
+     * @brief getIndices returns resulting index-list. Its indices have 16 bit as long as the vertices fit, else 32 bit, see indexBuffer::getWidth().
+     * getIndicesLod() have the same width.
+     * @return
+     */
+    const t_indices& getIndices() const
+    {
+        return m_indices;
+    }
+    /**
+     * @brief getPositions returns resulting transvoxel-list. Vertices for these indices are in getPositions() and getNormals().
+     * @return
+     */
+    const t_indices& getIndicesLod(const uint16& lod) const
+    {
+        BASSERT(lod < 6);
+        return m_indicesLod[lod];
+    }
+    /**
+     * @brief isIndicesLodCalculated returns true if the transvoxel-list of a side got calculated.
+     * Only the sides cached by the accessor-tile get calculated, see tile::accessor::getCalculateLodFace().
+     * @param lod 0 to 5
+     * @return
+     * @see simple::base::requestLod()
+     */
+    bool isIndicesLodCalculated(const uint16& lod) const
+    {
+        BASSERT(lod < 6);
+        return (m_indicesLodCalculated & (1 << lod)) != 0;
+    }
+
+    /**
+     * @brief isConnected returns true if two sides of the tile are connected through voxel with an interpolation lower zero (empty space).
+     * simple::renderer uses it to hide tiles that are enclosed by solid voxel, for example caves.
+     * @param side0 0 to 5, same index as the transvoxel-lists: -x, +x, -y, +y, -z, +z.
+     * @param side1 0 to 5, unequal side0.
+     * @return
+     */
+    bool isConnected(const int32& side0, const int32& side1) const
+    {
+        return (m_connectivity & calculateConnectivityBit(side0, side1)) != 0;
+    }
+    /**
+     * @brief getConnectivity returns one bit per pair of sides, 15 in total.
+     * @return
+     * @see isConnected()
+     * @see calculateConnectivityBit()
+     */
+    const uint16& getConnectivity() const
+    {
+        return m_connectivity;
+    }
+    /**
+     * @brief calculateConnectivityBit returns the bit of getConnectivity() that describes if two sides are connected.
+     * @param side0 0 to 5
+     * @param side1 0 to 5, unequal side0.
+     * @return
+     */
+    static uint16 calculateConnectivityBit(const int32& side0, const int32& side1)
+    {
+        BASSERT(side0 >= 0 && side0 < 6);
+        BASSERT(side1 >= 0 && side1 < 6);
+        BASSERT(side0 != side1);
+        const int32 lower(math::min(side0, side1));
+        const int32 higher(math::max(side0, side1));
+        return 1 << (lower*(9-lower)/2 + higher - 1);
+    }
+
+    /**
+     * @brief getDirtyVertexRange returns the part of getVertices() that changed by the last calculation. Upload only this part to a gpu-buffer.
+     * If the size of getVertices() changed, the buffer has to get resized.
+     * @return May be empty.
+     */
+    const range& getDirtyVertexRange() const
+    {
+        return m_dirtyVertices;
+    }
+    /**
+     * @brief getDirtyIndexRange returns the part of getIndices() that changed by the last calculation. Upload only this part to a gpu-buffer.
+     * The transvoxel-lists getIndicesLod() change completely on every calculation.
+     * @return May be empty.
+     */
+    const range& getDirtyIndexRange() const
+    {
+        return m_dirtyIndices;
+    }
+
+    /**
+     * @brief getFragmentation returns the unused part of the vertex- or index-list, whichever is bigger. The unused parts get left by recalculateSurface().
+     * getIndices() contains degenerated triangles for the unused parts.
+     * @return 0. to 1.
+     */
+    real getFragmentation() const
+    {
+        if (m_vertexSlabs.empty())
+        {
+            return 0.;
+        }
+        uint32 numVertices(0);
+        for (const slab& work : m_vertexSlabs)
+        {
+            numVertices += work.count;
+        }
+        uint32 numIndices(0);
+        for (const slab& work : m_indexSlabs)
+        {
+            numIndices += work.count;
+        }
+        real result(0.);
+        if (!m_vertices.empty())
+        {
+            result = 1. - (real)numVertices / (real)m_vertices.size();
+        }
+        if (!m_indices.empty())
+        {
+            result = math::max(result, (real)(1. - (real)numIndices / (real)m_indices.size()));
+        }
+        return result;
+    }
+
+    /**
+     * @brief setMaxFragmentation sets the fragmentation at which recalculateSurface() compacts the lists.
+     * @param fragmentation Default 0.5. 0. compacts after every recalculation.
+     * @see getFragmentation()
+     */
+    void setMaxFragmentation(const real& fragmentation)
+    {
+        m_maxFragmentation = fragmentation;
+    }
+    /**
+     * @brief getMaxFragmentation returns the value set by setMaxFragmentation().
+     * @return
+     */
+    const real& getMaxFragmentation() const
+    {
+        return m_maxFragmentation;
+    }
+
+    /**
+     * @brief compact removes the unused parts of the vertex- and index-list. Marks both lists as dirty.
+     * The index-lists switch back to 16 bit if the remaining vertices fit.
+     */
+    void compact()
+    {
+        if (m_vertexSlabs.empty())
+        {
+            // optimizeVertexCache() compacted already
+            return;
+        }
+        vector<uint32> newIndex;
+        compact(newIndex);
+        m_bvh.clear();
+        m_meshlets.clear();
+    }
+
+    /**
+     * @brief decimate simplifies getIndices() by edge collapses, see voxel::decimation. Suits far lods, whose flat parts get covered by many small triangles.
+     * The vertices on the border of the tile and the ones used by the transvoxel-lists don't move or vanish, so no cracks to the neighbours appear.
+     * Removes the vertices not used anymore, compacts the lists and marks both as dirty. Like optimizeVertexCache() the next recalculateSurface() calculates the whole surface again.
+     * Call after calculateSurface() or recalculateSurface(), before optimizeVertexCache().
+     * @param maxError Maximum error of a collapse, in the units of getVertices(). See voxel::decimation::simplify().
+     */
+    void decimate(const real& maxError)
+    {
+        if (m_indices.empty())
+        {
+            return;
+        }
+        compact();
+        t_scratch &scratch(getScratch());
+        scratch.locked.assign(m_vertices.size(), 0);
+        const real border(t_voxelAccessor::voxelLength*m_voxelSize);
+        const real epsilon(m_voxelSize*1e-4);
+        for (uint32 index = 0; index < m_vertices.size(); ++index)
+        {
+            const vector3& position(m_vertices[index].position);
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                if (std::abs(position[axis]) <= epsilon || std::abs(position[axis] - border) <= epsilon)
+                {
+                    scratch.locked[index] = 1;
+                }
+            }
+        }
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            for (uint32 ind = 0; ind < m_indicesLod[lod].size(); ++ind)
+            {
+                scratch.locked[m_indicesLod[lod][ind]] = 1;
+            }
+        }
+        scratch.decimator.simplify(m_vertices, m_indices, scratch.locked, maxError);
+
+        // keep the vertices used by an index-list, in their order
+        std::fill(scratch.locked.begin(), scratch.locked.end(), 0);
+        for (uint32 ind = 0; ind < m_indices.size(); ++ind)
+        {
+            scratch.locked[m_indices[ind]] = 1;
+        }
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            for (uint32 ind = 0; ind < m_indicesLod[lod].size(); ++ind)
+            {
+                scratch.locked[m_indicesLod[lod][ind]] = 1;
+            }
+        }
+        scratch.newIndex.resize(m_vertices.size());
+        uint32 numVertices(0);
+        for (uint32 index = 0; index < m_vertices.size(); ++index)
+        {
+            if (scratch.locked[index] != 0)
+            {
+                scratch.newIndex[index] = numVertices;
+                m_vertices[numVertices] = m_vertices[index];
+                m_vertexEdgeIds[numVertices] = m_vertexEdgeIds[index];
+                m_vertexNormals[numVertices] = m_vertexNormals[index];
+                ++numVertices;
+            }
+        }
+        resizeVertexLists(numVertices);
+        const indexBuffer::width indexWidth(indexBuffer::calculateWidth(numVertices));
+        remapIndices(m_indices, scratch.newIndex);
+        m_indices.setWidth(indexWidth);
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            remapIndices(m_indicesLod[lod], scratch.newIndex);
+            m_indicesLod[lod].setWidth(indexWidth);
+        }
+
+        // the slabs don't describe the lists anymore
+        m_vertexSlabs.clear();
+        m_indexSlabs.clear();
+        m_dirtyVertices = range(0, m_vertices.size());
+        m_dirtyIndices = range(0, m_indices.size());
+        m_bvh.clear();
+        m_meshlets.clear();
+    }
 
-        const vector3int32 voxelStart(-1);
-        const vector3int32 voxelEnd(t_voxelAccessor::voxelLength+2);
+    /**
+     * @brief optimizeVertexCache reorders the triangles of getIndices() for the post-transform vertex-cache of a gpu, see voxel::vertexCache,
+     * and the vertices in the order of their first use, so the gpu fetches them in order. Compacts the lists before and marks both as dirty.
+     * The triangles get reordered across the cell-slabs, so the next recalculateSurface() calculates the whole surface again.
+     * Suits tiles that rarely change, like the ones of far lods. The transvoxel-lists get remapped to the moved vertices, but not reordered.
+     * Call after calculateSurface() or recalculateSurface().
+     */
+    void optimizeVertexCache()
+    {
+        if (m_indices.empty())
+        {
+            return;
+        }
+        compact();
+        t_scratch &scratch(getScratch());
+        scratch.cacheOptimizer.optimizeTriangleOrder(m_indices);
+
+        // vertices not used by the index-list, for the normal correction or the transvoxel-lists, stay behind in their order
+        scratch.newIndex.assign(m_vertices.size(), std::numeric_limits<uint32>::max());
+        uint32 numVertices(0);
+        for (uint32 ind = 0; ind < m_indices.size(); ++ind)
+        {
+            const uint32 index(m_indices[ind]);
+            if (scratch.newIndex[index] == std::numeric_limits<uint32>::max())
+            {
+                scratch.newIndex[index] = numVertices++;
+            }
+        }
+        for (uint32& newIndex : scratch.newIndex)
+        {
+            if (newIndex == std::numeric_limits<uint32>::max())
+            {
+                newIndex = numVertices++;
+            }
+        }
+        scratch.vertices.resize(m_vertices.size());
+        scratch.edgeIds.resize(m_vertices.size());
+        scratch.normals.resize(m_vertices.size());
+        for (uint32 index = 0; index < m_vertices.size(); ++index)
+        {
+            scratch.vertices[scratch.newIndex[index]] = m_vertices[index];
+            scratch.edgeIds[scratch.newIndex[index]] = m_vertexEdgeIds[index];
+            scratch.normals[scratch.newIndex[index]] = m_vertexNormals[index];
+        }
+        std::copy(scratch.vertices.cbegin(), scratch.vertices.cend(), m_vertices.begin());
+        std::copy(scratch.edgeIds.cbegin(), scratch.edgeIds.cend(), m_vertexEdgeIds.begin());
+        std::copy(scratch.normals.cbegin(), scratch.normals.cend(), m_vertexNormals.begin());
+        scratch.vertices.clear();
+        remapIndices(m_indices, scratch.newIndex);
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            remapIndices(m_indicesLod[lod], scratch.newIndex);
+        }
+
+        // the slabs don't describe the lists anymore
+        m_vertexSlabs.clear();
+        m_indexSlabs.clear();
+        m_dirtyVertices = range(0, m_vertices.size());
+        m_dirtyIndices = range(0, m_indices.size());
+        m_bvh.clear();
+        m_meshlets.clear();
+    }
+
+    /**
+     * @brief calculateMeshlets splits the triangles of getIndices() into meshlets, for mesh-shaders and cluster culling. Call after optimizeVertexCache().
+     * Call after calculateSurface() or recalculateSurface(), which clear them. The transvoxel-lists don't get included.
+     * @see getMeshlets()
+     */
+    void calculateMeshlets()
+    {
+        m_meshlets.build(m_vertices, m_indices);
+    }
+    /**
+     * @brief getMeshlets returns the meshlets built by calculateMeshlets(). Empty if not built since the last calculation.
+     * @return
+     */
+    const meshlets& getMeshlets() const
+    {
+        return m_meshlets;
+    }
 
-        const int32 vertexIndicesReuseSize(((voxelEnd.x-voxelStart.x)*3)*((voxelEnd.y-voxelStart.y)*3)*((voxelEnd.z-voxelStart.z)*3));
-        // the indexer for the vertices. *3 because gets saved with edge-id
-        int32 *vertexIndicesReuse = new int32[vertexIndicesReuseSize];
-        for (int32 index = 0; index < vertexIndicesReuseSize; ++index)
+    /**
+     * @brief calculateBvh builds a bounding volume hierarchy over the triangles of getIndices(), for the queries of simple::surface.
+     * Call after calculateSurface() or recalculateSurface(), which clear it. The transvoxel-lists don't get included.
+     * @see getBvh()
+     */
+    void calculateBvh()
+    {
+        m_bvh.build(m_vertices, m_indices);
+    }
+    /**
+     * @brief getBvh returns the hierarchy built by calculateBvh(). Empty if not built since the last calculation, the queries test all triangles then.
+     * @return
+     */
+    const bvh& getBvh() const
+    {
+        return m_bvh;
+    }
+
+    /**
+     * @brief getNormalCalculation returns how the normals got calculated by the last calculation.
+     * @return
+     */
+    const normalCalculation& getNormalCalculation() const
+    {
+        return m_normalCalculation;
+    }
+
+protected:
+    /**
+     * @brief surface constructor
+     */
+    surface()
+        : m_lod(0)
+        , m_voxelSize(1.)
+        , m_normalCalculation(normalCalculation::faceWithCorrection)
+        , m_indicesLodCalculated(0)
+        , m_maxFragmentation(0.5)
+        , m_connectivity(0)
+    {
+    }
+
+    /**
+     * @brief Creates a vertex
+     */
+    t_vertex createVertex(const vector3int32& /*voxelPos*/, const t_voxel &/*voxel0*/, const t_voxel &/*voxel1*/, const vector3 &position, const vector3 &normal)
+    {
+        t_vertex result;
+        result.position = position;
+        result.normal = normal;
+        return result;
+    }
+
+    /**
+     * @brief Creates a vertex for lod
+     */
+    t_vertex createVertexLod(const vector3int32& /*voxelPos*/, const t_voxel &/*voxel0*/, const t_voxel &/*voxel1*/, const vector3 &position, const vector3 &normal)
+    {
+        t_vertex result;
+        result.position = position;
+        result.normal = normal;
+        return result;
+    }
+
+    /**
+     * @brief The slab struct describes the part of the vertex- or index-list a vertex group or cell-slab got spliced into.
+     * [offset, offset+count) is in use, [offset+count, offset+capacity) is unused.
+     */
+    struct slab
+    {
+        slab()
+            : offset(0)
+            , count(0)
+            , capacity(0)
+        {
+            ;
+        }
+
+        uint32 offset;
+        uint32 count;
+        uint32 capacity;
+    };
+    typedef vector<slab> t_slabs;
+
+    /**
+     * @brief The t_scratch struct contains the lists needed while calculating. Gets reused by every calculation of a thread.
+     * Vertices get referenced by their index in the vertex-list, or if just created by createdToReference().
+     */
+    struct t_scratch
+    {
+        // edge-id to vertex-reference, -1 if none
+        vector<int32> reuse;
+        // edge-ids set in reuse, besides the ones in vertexEdgeIds
+        vector<int32> reuseSet;
+        t_vertices vertices;
+        vector<int32> vertexGroups;
+        vector<int32> vertexEdgeIds;
+        vector<uint32> verticesFinal;
+        vector<uint32> groupCounts;
+        vector<uint32> groupOffsets;
+        vector<vector<int32> > indices;
+        vector<int32> indicesLod[6];
+        // per cell-brick, see calculateCellBricksWithoutSurface()
+        vector<uint8> cellBricksWithoutSurface;
+        // see decimate()
+        decimation decimator;
+        vector<uint8> locked;
+        // see optimizeVertexCache()
+        vertexCache cacheOptimizer;
+        vector<uint32> newIndex;
+        vector<int32> edgeIds;
+        vector<vector3> normals;
+        // per voxel of the tile, see calculateConnectivity()
+        vector<uint8> connectivityVisited;
+        vector<int32> connectivityToVisit;
+    };
+
+    /**
+     * @brief calculateCellSlabs triangulates the cells from x == cellStart to x == cellEnd again and splices the result into the lists.
+     * The vertices are grouped by the highest x of their edge. A group gets touched by the cells x-1 and x, so the groups between the recalculated cells get replaced.
+     * The groups at the border only get looked up. The transvoxel-lists get calculated completely.
+     * @param cellStart getFirstCell() <= cellStart
+     * @param cellEnd cellEnd <= getLastCell()
+     * @return false if a vertex of a border group is missing, so the lists don't match the voxel. Lists stay unchanged if so.
+     */
+    bool calculateCellSlabs(const int32& cellStart, const int32& cellEnd)
+    {
+        const int32 firstCell(getFirstCell());
+        const int32 lastCell(getLastCell());
+        const int32 groupStart(cellStart == firstCell ? firstCell : cellStart + 1);
+        const int32 groupEnd(cellEnd == lastCell ? lastCell + 1 : cellEnd);
+        const bool gradientNormals(m_normalCalculation == normalCalculation::gradient);
+
+        BASSERT(cellStart >= firstCell);
+        BASSERT(cellEnd <= lastCell);
+        BASSERT(cellStart <= cellEnd);
+
+        m_dirtyVertices = range();
+        m_dirtyIndices = range();
+
+        t_scratch &scratch(getScratch());
+        scratch.vertices.clear();
+        scratch.vertexGroups.clear();
+        scratch.vertexEdgeIds.clear();
+        for (vector<int32>& indices : scratch.indices)
+        {
+            indices.clear();
+        }
+
+        // the border groups only get looked up, their cells didn't change
+        if (groupStart > firstCell)
         {
-            vertexIndicesReuse[index] = -1;
+            setReuseToGroup(scratch, groupStart - 1);
         }
+        if (groupEnd < lastCell + 1)
+        {
+            setReuseToGroup(scratch, groupEnd + 1);
+        }
+
+        calculateCellBricksWithoutSurface(scratch.cellBricksWithoutSurface);
 
         // isLevel describes at which interpolation-level a surface is generated around the voxel
         const int8 isoLevel(0);
-        for (int32 x = voxelStart.x; x < voxelEnd.x-1; ++x)
+        for (int32 x = cellStart; x <= cellEnd; ++x)
         {
-            for (int32 y = voxelStart.y; y < voxelEnd.y-1; ++y)
+            vector<int32> &indicesSlab(scratch.indices[x+1]);
+            for (int32 y = firstCell; y <= lastCell; ++y)
             {
-                for (int32 z = voxelStart.z; z < voxelEnd.z-1; ++z)
+                for (int32 z = firstCell; z <= lastCell; ++z)
                 {
+                    const vector3int32 posVoxel(x, y, z);
+                    const vector3int32 brick(t_voxelAccessor::calculateBrick(posVoxel));
+                    if (scratch.cellBricksWithoutSurface[t_voxelAccessor::calculateBrickIndex(brick)])
+                    {
+                        // continue with the first cell of the next brick
+                        z = brick.z*t_voxelAccessor::brickLength - 1;
+                        continue;
+                    }
                     // depending on the voxel-neighbour- the count and look, of the triangles gets calculated.
                     uint8 tableIndex(0);
-                    const vector3int32 posVoxel(x, y, z);
                     t_calcVoxel voxelCalc;
                     const vector3int32 toCheck[] = {
                         vector3int32(0, 0, 0),
@@ -151,9 +816,9 @@ public:
                         continue;
                     }
                     bool calculateFaces(true);
-                    if (calculateNormalCorrection)
+                    if (m_normalCalculation == normalCalculation::faceWithCorrection)
                     {
-                        calculateFaces = (posVoxel >= vector3int32(0) && posVoxel < voxelEnd - vector3int32(2));
+                        calculateFaces = (posVoxel >= vector3int32(0) && posVoxel < vector3int32(t_voxelAccessor::voxelLength));
                     }
                     // OPTIMISE: too many vertices get calculated because of normalcorrection; optimise!
                     const RegularCellData *data = &regularCellData[regularCellClass[tableIndex]];
@@ -165,23 +830,34 @@ public:
                         int32 corner1 = (data2 & 0xF0) >> 4;
                         int32 id = calculateEdgeId(posVoxel, data2 >> 8); // for reuse
                         BASSERT(id >= 0);
-                        BASSERT(id < vertexIndicesReuseSize);
+                        BASSERT(id < (int32)scratch.reuse.size());
 
-                        if (vertexIndicesReuse[id] == -1)
+                        if (scratch.reuse[id] == -1)
                         {
+                            const int32 group(x + math::max(calculateCorner(corner0).x, calculateCorner(corner1).x));
+                            if (group < groupStart || group > groupEnd)
+                            {
+                                // vertex of a border group is missing
+                                resetReuse(scratch);
+                                return false;
+                            }
                             vector3 point = calculateIntersectionPosition(posVoxel, corner0, corner1); // OPTIMISE so dirty - use voxelCalc inside the method!
                             // we calucluate here everything in positive values; but normal correction starts @ -1
-                            point *= voxelSize;
+                            point *= m_voxelSize;
                             t_voxel voxel0 = getVoxel(posVoxel + calculateCorner(corner0)); // OPTIMISE so dirty - use voxelCalc!
                             t_voxel voxel1 = getVoxel(posVoxel + calculateCorner(corner1));
-                            const t_vertex vertex(static_cast<t_thiz>(this)->createVertex(posVoxel, voxel0, voxel1, point, vector3()));
-                            m_vertices.push_back(vertex);
-                            ids[ind] = vertexIndicesReuse[id] = m_vertices.size()-1;
-                        }
-                        else
-                        {
-                            ids[ind] = vertexIndicesReuse[id];
+                            vector3 normal;
+                            if (gradientNormals)
+                            {
+                                normal = calculateGradientNormal(posVoxel, corner0, corner1);
+                            }
+                            const t_vertex vertex(static_cast<t_thiz>(this)->createVertex(posVoxel, voxel0, voxel1, point, normal));
+                            scratch.vertices.push_back(vertex);
+                            scratch.vertexGroups.push_back(group);
+                            scratch.vertexEdgeIds.push_back(id);
+                            scratch.reuse[id] = createdToReference(scratch.vertices.size()-1);
                         }
+                        ids[ind] = scratch.reuse[id];
                     }
                     for (int32 ind = 0; ind < data->GetTriangleCount()*3; ind+=3)
                     {
@@ -189,418 +865,834 @@ public:
                         const int32 vertexIndex0(ids[data->vertexIndex[ind+0]]);
                         const int32 vertexIndex1(ids[data->vertexIndex[ind+1]]);
                         const int32 vertexIndex2(ids[data->vertexIndex[ind+2]]);
-                        const vector3 vertex0(m_vertices.at(vertexIndex0).position);
-                        const vector3 vertex1(m_vertices.at(vertexIndex1).position);
-                        const vector3 vertex2(m_vertices.at(vertexIndex2).position);
+                        const vector3 vertex0(getVertexByReference(scratch, vertexIndex0).position);
+                        const vector3 vertex1(getVertexByReference(scratch, vertexIndex1).position);
+                        const vector3 vertex2(getVertexByReference(scratch, vertexIndex2).position);
                         if (vertex0 == vertex1 || vertex0 == vertex2 || vertex1 == vertex2)
                         {
                             continue; // triangle with zero space
                         }
-                        const vector3 addNormal = (vertex1 - vertex0).crossProduct(vertex2 - vertex0);//.normalisedCopy();
-                        // if (calculateFaces) // for normal-correction-test
+                        if (!gradientNormals)
                         {
-                            m_vertices.at(vertexIndex0).normal += addNormal;
-                            m_vertices.at(vertexIndex1).normal += addNormal;
-                            m_vertices.at(vertexIndex2).normal += addNormal;
+                            const vector3 addNormal = (vertex1 - vertex0).crossProduct(vertex2 - vertex0);//.normalisedCopy();
+                            // vertices of the border groups already got their normal
+                            if (vertexIndex0 < 0)
+                            {
+                                scratch.vertices[referenceToCreated(vertexIndex0)].normal += addNormal;
+                            }
+                            if (vertexIndex1 < 0)
+                            {
+                                scratch.vertices[referenceToCreated(vertexIndex1)].normal += addNormal;
+                            }
+                            if (vertexIndex2 < 0)
+                            {
+                                scratch.vertices[referenceToCreated(vertexIndex2)].normal += addNormal;
+                            }
                         }
                         if (calculateFaces)
                         {
                             // insert new triangle
-                            m_indices.push_back(vertexIndex0);
-                            m_indices.push_back(vertexIndex1);
-                            m_indices.push_back(vertexIndex2);
+                            indicesSlab.push_back(vertexIndex0);
+                            indicesSlab.push_back(vertexIndex1);
+                            indicesSlab.push_back(vertexIndex2);
                         }
                     }
                 }
             }
         }
+        resetReuse(scratch);
+
+        // splice the vertex groups
+        scratch.groupCounts.assign(getNumVertexSlabs(), 0);
+        for (const int32& group : scratch.vertexGroups)
+        {
+            ++scratch.groupCounts[group+1];
+        }
+        uint32 sizeAfterSplice(m_vertices.size());
+        for (int32 group = groupStart; group <= groupEnd; ++group)
+        {
+            if (scratch.groupCounts[group+1] > m_vertexSlabs[group+1].capacity)
+            {
+                sizeAfterSplice += scratch.groupCounts[group+1];
+            }
+        }
+        if (sizeAfterSplice > indexBuffer::getMaxNumVertices(m_indices.getWidth()))
+        {
+            // may spare the switch to 32 bit indices
+            compactScratch(scratch.indices);
+        }
+        scratch.groupOffsets.assign(getNumVertexSlabs(), 0);
+        uint32 numVertices(m_vertices.size());
+        for (int32 group = groupStart; group <= groupEnd; ++group)
+        {
+            slab &work(m_vertexSlabs[group+1]);
+            scratch.groupOffsets[group+1] = allocateSlab(work, scratch.groupCounts[group+1], numVertices);
+            extendRange(m_dirtyVertices, work.offset, work.offset + work.count);
+        }
+        resizeVertexLists(numVertices);
+        updateIndexWidth();
+        scratch.verticesFinal.resize(scratch.vertices.size());
+        for (uint32 ind = 0; ind < scratch.vertices.size(); ++ind)
+        {
+            const uint32 index(scratch.groupOffsets[scratch.vertexGroups[ind]+1]++);
+            scratch.verticesFinal[ind] = index;
+            setVertex(index, scratch.vertices[ind], scratch.vertexEdgeIds[ind]);
+        }
+
+        // splice the index slabs
+        uint32 numIndices(m_indices.size());
+        for (int32 x = cellStart; x <= cellEnd; ++x)
+        {
+            slab &work(m_indexSlabs[x+1]);
+            const uint32 count(scratch.indices[x+1].size());
+            if (count > work.capacity)
+            {
+                // gets appended, degenerate the triangles left behind
+                m_indices.fill(work.offset, work.offset + work.capacity, 0);
+                extendRange(m_dirtyIndices, work.offset, work.offset + work.capacity);
+            }
+            allocateSlab(work, count, numIndices);
+        }
+        m_indices.resize(numIndices);
+        for (int32 x = cellStart; x <= cellEnd; ++x)
+        {
+            const vector<int32> &indicesSlab(scratch.indices[x+1]);
+            const slab &work(m_indexSlabs[x+1]);
+            for (uint32 ind = 0; ind < indicesSlab.size(); ++ind)
+            {
+                m_indices.set(work.offset + ind, referenceToIndex(scratch, indicesSlab[ind]));
+            }
+            // degenerated triangles for the rest of the slab
+            m_indices.fill(work.offset + work.count, work.offset + work.capacity, 0);
+            extendRange(m_dirtyIndices, work.offset, work.offset + work.capacity);
+        }
+
+        // transvoxel, only for the sides cached by the accessor-tile
+        if (getCaluculateTransvoxel() && (m_voxel->getCalculateLod() || m_indicesLodCalculated != 0))
+        {
+            if (!calculateTransvoxel(scratch))
+            {
+                // can only happen if the vertices got spliced wrong
+                BASSERT(false);
+                return false;
+            }
+        }
+
+        uint32 numTriangles(0);
+        for (const slab& work : m_indexSlabs)
+        {
+            numTriangles += work.count;
+        }
+        if (numTriangles == 0)
+        {
+            static_cast<t_thiz>(this)->clear();
+            return true;
+        }
+        if (getFragmentation() > m_maxFragmentation)
+        {
+            compact();
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief calculateTransvoxel calculates the transvoxel-lists of all sides cached by the accessor-tile. The vertices get appended to their own group.
+     * @param scratch Thread local lists.
+     * @return false if a needed vertex of the regular cells is missing.
+     */
+    bool calculateTransvoxel(t_scratch &scratch)
+    {
+        // look up all regular vertices
+        for (int32 group = -1; group <= t_voxelAccessor::voxelLength + 1; ++group)
+        {
+            setReuseToGroup(scratch, group);
+        }
+        scratch.vertices.clear();
+
+        const int8 isoLevel(0);
+
+        typedef vector3int32 v3i;
+        const vector3int32 voxelLookups[][9] = {
+            {v3i(0, 0, 0),v3i(0, 1, 0),v3i(0, 2, 0),v3i(0, 2, 1),v3i(0, 2, 2),v3i(0, 1, 2),v3i(0, 0, 2),v3i(0, 0, 1),v3i(0, 1, 1)},
+            {v3i(0, 0, 0),v3i(1, 0, 0),v3i(2, 0, 0),v3i(2, 0, 1),v3i(2, 0, 2),v3i(1, 0, 2),v3i(0, 0, 2),v3i(0, 0, 1),v3i(1, 0, 1)},
+            {v3i(0, 0, 0),v3i(1, 0, 0),v3i(2, 0, 0),v3i(2, 1, 0),v3i(2, 2, 0),v3i(1, 2, 0),v3i(0, 2, 0),v3i(0, 1, 0),v3i(1, 1, 0)},
+            };
+        const int32 voxelLengthLodStart(t_voxelAccessor::voxelLengthLod-2);
+        const int32 voxelLengthLodEnd(t_voxelAccessor::voxelLengthLod-1);
+        const vector3int32 toIterate[][2] = {
+            {v3i(0, 0, 0),                     v3i(1, voxelLengthLodStart, voxelLengthLodStart)},
+            {v3i(voxelLengthLodStart, 0, 0),   v3i(voxelLengthLodEnd, voxelLengthLodStart, voxelLengthLodStart)},
+            {v3i(0, 0, 0),                     v3i(voxelLengthLodStart, 1, voxelLengthLodStart)},
+            {v3i(0, voxelLengthLodStart, 0),   v3i(voxelLengthLodStart, voxelLengthLodEnd, voxelLengthLodStart)},
+            {v3i(0, 0, 0),                     v3i(voxelLengthLodStart, voxelLengthLodStart, 1)},
+            {v3i(0, 0, voxelLengthLodStart),   v3i(voxelLengthLodStart, voxelLengthLodStart, voxelLengthLodEnd)}
+            };
+        const vector3int32 reuseCorrection[] = {
+            v3i(1, 0, 0),
+            v3i(1, 0, 0),
+            v3i(0, 1, 0),
+            v3i(0, 1, 0),
+            v3i(0, 0, 1),
+            v3i(0, 0, 1)
+            };
+
+        const bool toInvertTriangles[] = {
+            false, true,
+            true, false, // data from Eric Lengyel seems to have different axis-desc
+            false, true
+            };
+
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            const int32 coord(lod/2);
+            const vector3int32& start(toIterate[lod][0]);
+            const vector3int32& end  (toIterate[lod][1]);
+            const bool invertTriangles(toInvertTriangles[lod]);
+            vector<int32> &indicesLod(scratch.indicesLod[lod]);
+            indicesLod.clear();
+            if (!m_voxel->getCalculateLodFace(lod))
+            {
+                continue;
+            }
+
+            // the indexer for the vertices. *3 because gets saved with edge-id
+            const int32 vertexIndicesReuseLodSize(((t_voxelAccessor::voxelLength+1)*4)*
+                                                  ((t_voxelAccessor::voxelLength+1)*4));
+            vector<int32> vertexIndicesReuseLod(vertexIndicesReuseLodSize, -1);
+
+            for (uint32 x = start.x; x < (unsigned)end.x; x+=2)
+            {
+                for (uint32 y = start.y; y < (unsigned)end.y; y+=2)
+                {
+                    for (uint32 z = start.z; z < (unsigned)end.z; z+=2)
+                    {
+                        const vector3int32 voxelPos(x, y, z);
+                        {
+                            uint32 tableIndex(0);
+                            uint32 add(1);
+                            t_calcVoxelLod voxelCalc;
+                            for (uint16 ind = 0; ind < 9; ++ind)
+                            {
+                                const vector3int32 lookUp((voxelPos-start)+voxelLookups[coord][ind]);
+                                voxelCalc[ind] = getVoxelLod(lookUp, lod);
+                                if (voxelCalc[ind].getInterpolation() < isoLevel)
+                                {
+                                    tableIndex |= add;
+                                }
+                                add*=2;
+                            }
+                            if (tableIndex == 0 || tableIndex == 511) // no triangles
+                            {
+                                continue;
+                            }
+
+                            uint32 classIndex = transitionCellClass[tableIndex];
+                            const TransitionCellData *data = &transitionCellData[classIndex & 0x7F]; // only the last 7 bit count
+                            int32 ids[12];
+
+                            vector3 normalsForTransvoxel[4];
+
+                            for (uint16 ind = 0; ind < data->GetVertexCount(); ++ind)
+                            {
+                                const uint16 data2 = transitionVertexData[tableIndex][ind];
+                                const uint16 edge = data2 >> 8;
+                                const uint16 edgeId = edge & 0x0F;
+                                const uint16 edgeBetween(data2 & 0xFF);
+
+                                if (edgeId == 0x9 || edgeId == 0x8)
+                                {
+                                    BASSERT(edge == 0x88 || edge == 0x28 || edge == 0x89 || edge == 0x19);
+
+                                    const uint16 owner((edge & 0xF0) >> 4);
+                                    BASSERT(owner == 1 || owner == 2 || owner == 8);
+
+                                    uint16 newEdgeId(0);
+                                    uint16 newOwner(0);
+
+                                    if (coord == 0)
+                                    {
+                                        if (edgeId == 0x8)
+                                        {
+                                            newEdgeId = 0x3;
+                                        }
+                                        else
+                                        {
+                                            newEdgeId = 0x1;
+                                        }
+                                        if (owner == 0x1)
+                                        {
+                                            newOwner = 0x4;
+                                        }
+                                        if (owner == 0x2)
+                                        {
+                                            newOwner = 0x2;
+                                        }
+                                    }
+                                    if (coord == 1)
+                                    {
+                                        if (edgeId == 0x8)
+                                        {
+                                            newEdgeId = 0x2;
+                                        }
+                                        else
+                                        {
+                                            newEdgeId = 0x1;
+                                        }
+                                        newOwner = owner;
+                                    }
+                                    if (coord == 2)
+                                    {
+                                        newEdgeId = edgeId - 6;
+                                        if (owner == 0x1)
+                                        {
+                                            newOwner = 0x1;
+                                        }
+                                        if (owner == 0x2)
+                                        {
+                                            newOwner = 0x4;
+                                        }
+                                    }
 
-        // transvoxel
-        if (m_lod > 0)// && false)
-        {
-			typedef vector3int32 v3i;
-            const vector3int32 voxelLookups[][9] = {
-                {v3i(0, 0, 0),v3i(0, 1, 0),v3i(0, 2, 0),v3i(0, 2, 1),v3i(0, 2, 2),v3i(0, 1, 2),v3i(0, 0, 2),v3i(0, 0, 1),v3i(0, 1, 1)},
-                {v3i(0, 0, 0),v3i(1, 0, 0),v3i(2, 0, 0),v3i(2, 0, 1),v3i(2, 0, 2),v3i(1, 0, 2),v3i(0, 0, 2),v3i(0, 0, 1),v3i(1, 0, 1)},
-                {v3i(0, 0, 0),v3i(1, 0, 0),v3i(2, 0, 0),v3i(2, 1, 0),v3i(2, 2, 0),v3i(1, 2, 0),v3i(0, 2, 0),v3i(0, 1, 0),v3i(1, 1, 0)},
-                };
-            const int32 voxelLengthLodStart(t_voxelAccessor::voxelLengthLod-2);
-            const int32 voxelLengthLodEnd(t_voxelAccessor::voxelLengthLod-1);
-            const vector3int32 toIterate[][2] = {
-                {v3i(0, 0, 0),                     v3i(1, voxelLengthLodStart, voxelLengthLodStart)},
-                {v3i(voxelLengthLodStart, 0, 0),   v3i(voxelLengthLodEnd, voxelLengthLodStart, voxelLengthLodStart)},
-                {v3i(0, 0, 0),                     v3i(voxelLengthLodStart, 1, voxelLengthLodStart)},
-                {v3i(0, voxelLengthLodStart, 0),   v3i(voxelLengthLodStart, voxelLengthLodEnd, voxelLengthLodStart)},
-                {v3i(0, 0, 0),                     v3i(voxelLengthLodStart, voxelLengthLodStart, 1)},
-                {v3i(0, 0, voxelLengthLodStart),   v3i(voxelLengthLodStart, voxelLengthLodStart, voxelLengthLodEnd)}
-                };
-            const vector3int32 reuseCorrection[] = {
-                v3i(1, 0, 0),
-                v3i(1, 0, 0),
-                v3i(0, 1, 0),
-                v3i(0, 1, 0),
-                v3i(0, 0, 1),
-                v3i(0, 0, 1)
-                };
-
-            const bool toInvertTriangles[] = {
-                false, true,
-                true, false, // data from Eric Lengyel seems to have different axis-desc
-                false, true
-                };
-
-            for (int32 lod = 0; lod < 6; ++lod)
-            {
-                const int32 coord(lod/2);
-                const vector3int32& start(toIterate[lod][0]);
-                const vector3int32& end  (toIterate[lod][1]);
-                const bool invertTriangles(toInvertTriangles[lod]);
 
-                // the indexer for the vertices. *3 because gets saved with edge-id
-                const int32 vertexIndicesReuseLodSize(((t_voxelAccessor::voxelLength+1)*4)*
-                                                      ((t_voxelAccessor::voxelLength+1)*4));
-                vector<int32> vertexIndicesReuseLod(vertexIndicesReuseLodSize, -1);
+                                    uint16 newEdge((newOwner << 4) | newEdgeId);
+                                    const int32 id = calculateEdgeId((voxelPos / 2) - reuseCorrection[lod], newEdge);
 
-                for (uint32 x = start.x; x < (unsigned)end.x; x+=2)
-                {
-                    for (uint32 y = start.y; y < (unsigned)end.y; y+=2)
-                    {
-                        for (uint32 z = start.z; z < (unsigned)end.z; z+=2)
-                        {
-                            const vector3int32 voxelPos(x, y, z);
-                            {
-                                uint32 tableIndex(0);
-                                uint32 add(1);
-                                t_calcVoxelLod voxelCalc;
-                                for (uint16 ind = 0; ind < 9; ++ind)
-                                {
-                                    const vector3int32 lookUp((voxelPos-start)+voxelLookups[coord][ind]);
-                                    voxelCalc[ind] = getVoxelLod(lookUp, lod);
-                                    if (voxelCalc[ind].getInterpolation() < isoLevel)
+                                    if (scratch.reuse[id] == -1)
                                     {
-                                        tableIndex |= add;
+                                        resetReuse(scratch);
+                                        return false;
                                     }
-                                    add*=2;
-                                }
-                                if (tableIndex == 0 || tableIndex == 511) // no triangles
-                                {
-                                    continue;
-                                }
 
-                                uint32 classIndex = transitionCellClass[tableIndex];
-                                const TransitionCellData *data = &transitionCellData[classIndex & 0x7F]; // only the last 7 bit count
-                                uint32 ids[12];
+                                    ids[ind] = scratch.reuse[id];
 
-                                vector3 normalsForTransvoxel[4];
+                                    // the transvoxel-normals get summed up from the not normalised ones
+                                    const vector3& normal(m_vertexNormals[ids[ind]]);
+                                    switch (edgeBetween)
+                                    {
+                                    case 0x9A:
+                                        normalsForTransvoxel[0] = normal;
+                                        break;
+                                    case 0xAC:
+                                        normalsForTransvoxel[1] = normal;
+                                        break;
+                                    case 0xBC:
+                                        normalsForTransvoxel[2] = normal;
+                                        break;
+                                    case 0x9B:
+                                        normalsForTransvoxel[3] = normal;
+                                        break;
+                                    default:
+                                        BASSERT(false);
+                                    }
+                                }
+                            }
+                            for (uint16 ind = 0; ind < data->GetVertexCount(); ++ind)
+                            {
+                                const uint16 data2 = transitionVertexData[tableIndex][ind];
+                                const uint16 edge = data2 >> 8;
+                                const uint16 edgeId = edge & 0x0F;
+                                const uint16 edgeBetween(data2 & 0xFF);
 
-                                for (uint16 ind = 0; ind < data->GetVertexCount(); ++ind)
+                                if (edgeId != 0x9 && edgeId != 0x8)
                                 {
-                                    const uint16 data2 = transitionVertexData[tableIndex][ind];
-                                    const uint16 edge = data2 >> 8;
-                                    const uint16 edgeId = edge & 0x0F;
-                                    const uint16 edgeBetween(data2 & 0xFF);
+                                    const uint16 corner0 = data2 & 0x0F;
+                                    const uint16 corner1 = (data2 & 0xF0) >> 4;
 
-                                    if (edgeId == 0x9 || edgeId == 0x8)
-                                    {
-                                        BASSERT(edge == 0x88 || edge == 0x28 || edge == 0x89 || edge == 0x19);
-
-                                        const uint16 owner((edge & 0xF0) >> 4);
-                                        BASSERT(owner == 1 || owner == 2 || owner == 8);
 
-                                        uint16 newEdgeId(0);
-                                        uint16 newOwner(0);
+                                    const int32 id = calculateEdgeIdTransvoxel(voxelPos/2, edge, coord);
 
-                                        if (coord == 0)
-                                        {
-                                            if (edgeId == 0x8)
-                                            {
-                                                newEdgeId = 0x3;
-                                            }
-                                            else
-                                            {
-                                                newEdgeId = 0x1;
-                                            }
-                                            if (owner == 0x1)
-                                            {
-                                                newOwner = 0x4;
-                                            }
-                                            if (owner == 0x2)
-                                            {
-                                                newOwner = 0x2;
-                                            }
-                                        }
-                                        if (coord == 1)
-                                        {
-                                            if (edgeId == 0x8)
-                                            {
-                                                newEdgeId = 0x2;
-                                            }
-                                            else
-                                            {
-                                                newEdgeId = 0x1;
-                                            }
-                                            newOwner = owner;
-                                        }
-                                        if (coord == 2)
-                                        {
-                                            newEdgeId = edgeId - 6;
-                                            if (owner == 0x1)
-                                            {
-                                                newOwner = 0x1;
-                                            }
-                                            if (owner == 0x2)
-                                            {
-                                                newOwner = 0x4;
-                                            }
-                                        }
+                                    //blub::BOUT("edge:" + blub::string::number(edge, 16) + " id:" + blub::string::number(id));
 
+                                    bool calculateVertexPosition(id == -1);
+                                    if (!calculateVertexPosition)
+                                    {
+                                        calculateVertexPosition = vertexIndicesReuseLod[id] == -1;
+                                    }
 
-                                        uint16 newEdge((newOwner << 4) | newEdgeId);
-                                        const int32 id = calculateEdgeId((voxelPos / 2) - reuseCorrection[lod], newEdge);
+                                    if (calculateVertexPosition)
+                                    {
+                                        vector3 point = calculateIntersectionPositionTransvoxel(voxelPos-start, corner0, corner1, voxelLookups[coord], lod);
+                                        point+=vector3(start)/2.;
 
-                                        BASSERT(vertexIndicesReuse[id] != -1);
+                                        point *= m_voxelSize;
 
-                                        ids[ind]=vertexIndicesReuse[id];
+                                        vector3 normal;
 
-                                        const vector3& normal(m_vertices.at(ids[ind]).normal);
                                         switch (edgeBetween)
                                         {
-                                        case 0x9A:
-                                            normalsForTransvoxel[0] = normal;
+                                        case 0x01:
+                                        case 0x12:
+                                            normal = normalsForTransvoxel[0];
+                                            break;
+                                        case 0x03:
+                                        case 0x36:
+                                            normal = normalsForTransvoxel[3];
                                             break;
-                                        case 0xAC:
-                                            normalsForTransvoxel[1] = normal;
+                                        case 0x25:
+                                        case 0x58:
+                                            normal = normalsForTransvoxel[1];
                                             break;
-                                        case 0xBC:
-                                            normalsForTransvoxel[2] = normal;
+                                        case 0x67:
+                                        case 0x78:
+                                            normal = normalsForTransvoxel[2];
                                             break;
-                                        case 0x9B:
-                                            normalsForTransvoxel[3] = normal;
+                                        case 0x34:
+                                        case 0x14:
+                                        case 0x45:
+                                        case 0x47:
+                                            normal = normalsForTransvoxel[0] + normalsForTransvoxel[1] + normalsForTransvoxel[2] + normalsForTransvoxel[3];
                                             break;
                                         default:
                                             BASSERT(false);
                                         }
-                                    }
-                                }
-                                for (uint16 ind = 0; ind < data->GetVertexCount(); ++ind)
-                                {
-                                    const uint16 data2 = transitionVertexData[tableIndex][ind];
-                                    const uint16 edge = data2 >> 8;
-                                    const uint16 edgeId = edge & 0x0F;
-                                    const uint16 edgeBetween(data2 & 0xFF);
-
-                                    if (edgeId != 0x9 && edgeId != 0x8)
-                                    {
-                                        const uint16 corner0 = data2 & 0x0F;
-                                        const uint16 corner1 = (data2 & 0xF0) >> 4;
-
-
-                                        const int32 id = calculateEdgeIdTransvoxel(voxelPos/2, edge, coord);
-
-                                        //blub::BOUT("edge:" + blub::string::number(edge, 16) + " id:" + blub::string::number(id));
 
-                                        bool calculateVertexPosition(id == -1);
-                                        if (!calculateVertexPosition)
-                                        {
-                                            calculateVertexPosition = vertexIndicesReuseLod[id] == -1;
-                                        }
+                                        t_voxel voxel0 = getVoxelLod(voxelPos-start + calculateCornerTransvoxel(corner0, voxelLookups[coord]), lod); // OPTIMISE so dirty - use voxelCalc!
+                                        t_voxel voxel1 = getVoxelLod(voxelPos-start + calculateCornerTransvoxel(corner1, voxelLookups[coord]), lod);
+                                        const t_vertex vertex(static_cast<t_thiz>(this)->createVertexLod(voxelPos, voxel0, voxel1, point, normal));
+                                        scratch.vertices.push_back(vertex);
 
-                                        if (calculateVertexPosition)
-                                        {
-                                            vector3 point = calculateIntersectionPositionTransvoxel(voxelPos-start, corner0, corner1, voxelLookups[coord], lod);
-                                            point+=vector3(start)/2.;
-
-                                            point *= voxelSize;
-
-                                            vector3 normal;
-
-                                            switch (edgeBetween)
-                                            {
-                                            case 0x01:
-                                            case 0x12:
-                                                normal = normalsForTransvoxel[0];
-                                                break;
-                                            case 0x03:
-                                            case 0x36:
-                                                normal = normalsForTransvoxel[3];
-                                                break;
-                                            case 0x25:
-                                            case 0x58:
-                                                normal = normalsForTransvoxel[1];
-                                                break;
-                                            case 0x67:
-                                            case 0x78:
-                                                normal = normalsForTransvoxel[2];
-                                                break;
-                                            case 0x34:
-                                            case 0x14:
-                                            case 0x45:
-                                            case 0x47:
-                                                normal = normalsForTransvoxel[0] + normalsForTransvoxel[1] + normalsForTransvoxel[2] + normalsForTransvoxel[3];
-                                                break;
-                                            default:
-                                                BASSERT(false);
-                                            }
-
-                                            t_voxel voxel0 = getVoxelLod(voxelPos-start + calculateCornerTransvoxel(corner0, voxelLookups[coord]), lod); // OPTIMISE so dirty - use voxelCalc!
-                                            t_voxel voxel1 = getVoxelLod(voxelPos-start + calculateCornerTransvoxel(corner1, voxelLookups[coord]), lod);
-                                            const t_vertex vertex(static_cast<t_thiz>(this)->createVertexLod(voxelPos, voxel0, voxel1, point, normal));
-                                            m_vertices.push_back(vertex);
-
-                                            if (id == -1)
-                                            {
-                                                ids[ind] = m_vertices.size()-1;
-                                            }
-                                            else
-                                            {
-                                                ids[ind] = vertexIndicesReuseLod[id] = m_vertices.size()-1;
-                                            }
-                                        }
-                                        else
+                                        ids[ind] = createdToReference(scratch.vertices.size()-1);
+                                        if (id != -1)
                                         {
-                                            ids[ind] = vertexIndicesReuseLod[id];
+                                            vertexIndicesReuseLod[id] = ids[ind];
                                         }
                                     }
-                                }
-                                for (uint16 ind = 0; ind < data->GetTriangleCount()*3; ind+=3)
-                                {
-                                    // calc triangle
-                                    const int32 vertexIndex0(ids[data->vertexIndex[ind+0]]);
-                                    const int32 vertexIndex1(ids[data->vertexIndex[ind+1]]);
-                                    const int32 vertexIndex2(ids[data->vertexIndex[ind+2]]);
-                                    const vector3 vertex0(m_vertices.at(vertexIndex0).position);
-                                    const vector3 vertex1(m_vertices.at(vertexIndex1).position);
-                                    const vector3 vertex2(m_vertices.at(vertexIndex2).position);
-                                    if (vertex0 == vertex1 || vertex1 == vertex2 || vertex0 == vertex2)
-                                    {
-                                        continue; // triangle with zero space
-                                    }
-                                    // insert new triangle
-                                    uint16 invert(1);
-                                    if (invertTriangles)
-                                    {
-                                        invert = 0;
-                                    }
-                                    m_indicesLod[lod].push_back(vertexIndex0);
-                                    if ((classIndex >> 7) % 2 == invert)
-                                    {
-                                        m_indicesLod[lod].push_back(vertexIndex1);
-                                        m_indicesLod[lod].push_back(vertexIndex2);
-                                    }
                                     else
                                     {
-                                        m_indicesLod[lod].push_back(vertexIndex2);
-                                        m_indicesLod[lod].push_back(vertexIndex1);
+                                        ids[ind] = vertexIndicesReuseLod[id];
                                     }
                                 }
                             }
+                            for (uint16 ind = 0; ind < data->GetTriangleCount()*3; ind+=3)
+                            {
+                                // calc triangle
+                                const int32 vertexIndex0(ids[data->vertexIndex[ind+0]]);
+                                const int32 vertexIndex1(ids[data->vertexIndex[ind+1]]);
+                                const int32 vertexIndex2(ids[data->vertexIndex[ind+2]]);
+                                const vector3 vertex0(getVertexByReference(scratch, vertexIndex0).position);
+                                const vector3 vertex1(getVertexByReference(scratch, vertexIndex1).position);
+                                const vector3 vertex2(getVertexByReference(scratch, vertexIndex2).position);
+                                if (vertex0 == vertex1 || vertex1 == vertex2 || vertex0 == vertex2)
+                                {
+                                    continue; // triangle with zero space
+                                }
+                                // insert new triangle
+                                uint16 invert(1);
+                                if (invertTriangles)
+                                {
+                                    invert = 0;
+                                }
+                                indicesLod.push_back(vertexIndex0);
+                                if ((classIndex >> 7) % 2 == invert)
+                                {
+                                    indicesLod.push_back(vertexIndex1);
+                                    indicesLod.push_back(vertexIndex2);
+                                }
+                                else
+                                {
+                                    indicesLod.push_back(vertexIndex2);
+                                    indicesLod.push_back(vertexIndex1);
+                                }
+                            }
                         }
                     }
                 }
             }
         }
+        resetReuse(scratch);
 
-        delete [] vertexIndicesReuse;
-
-        // normalise normals
-        for (t_vertex& workVertex : m_vertices)
+        // splice the transvoxel group
+        slab &work(m_vertexSlabs[getNumVertexSlabs()-1]);
+        if (scratch.vertices.size() > work.capacity && m_vertices.size() + scratch.vertices.size() > indexBuffer::getMaxNumVertices(m_indices.getWidth()))
+        {
+            compactScratch(scratch.indicesLod);
+        }
+        uint32 numVertices(m_vertices.size());
+        uint32 offset(allocateSlab(work, scratch.vertices.size(), numVertices));
+        extendRange(m_dirtyVertices, work.offset, work.offset + work.count);
+        resizeVertexLists(numVertices);
+        updateIndexWidth();
+        scratch.verticesFinal.resize(scratch.vertices.size());
+        for (uint32 ind = 0; ind < scratch.vertices.size(); ++ind)
+        {
+            scratch.verticesFinal[ind] = offset;
+            setVertex(offset++, scratch.vertices[ind], -1);
+        }
+        m_indicesLodCalculated = 0;
+        for (int32 lod = 0; lod < 6; ++lod)
         {
-            workVertex.normal.normalise();
+            if (m_voxel->getCalculateLodFace(lod))
+            {
+                m_indicesLodCalculated |= (1 << lod);
+            }
+            const vector<int32> &indicesLod(scratch.indicesLod[lod]);
+            m_indicesLod[lod].resize(indicesLod.size());
+            for (uint32 ind = 0; ind < indicesLod.size(); ++ind)
+            {
+                m_indicesLod[lod].set(ind, referenceToIndex(scratch, indicesLod[ind]));
+            }
         }
 
-#ifdef BLUB_LOG_VOXEL_SURFACE
-        blub::BOUT("surface::calculateSurface(..) end");
-#endif
+        return true;
     }
 
     /**
-     * @brief clear erases all buffer/results.
+     * @brief compactScratch compacts the lists while a calculation is in progress.
+     * @param references The references to vertices of the lists get corrected.
      */
-    void clear()
+    template <class referencesType>
+    void compactScratch(referencesType& references)
     {
-        m_vertices.clear();
-        m_indices.clear();
-        for (int32 lod = 0; lod < 6; ++lod)
+        vector<uint32> newIndex;
+        compact(newIndex);
+        for (vector<int32>& work : references)
         {
-            m_indicesLod[lod].clear();
+            for (int32& reference : work)
+            {
+                if (reference >= 0)
+                {
+                    reference = newIndex[reference];
+                }
+            }
         }
     }
 
     /**
-     * @brief does the transvoxel algo get applied.
-     * @return
+     * @brief compact removes the unused parts of the vertex- and index-list, left by recalculateSurface(). Marks the lists as dirty.
+     * @param newIndex Gets the new index of every vertex.
      */
-    bool getCaluculateTransvoxel() const
+    void compact(vector<uint32>& newIndex)
     {
-        return m_lod > 0;
+        t_vertices vertices;
+        vector<int32> vertexEdgeIds;
+        vector<vector3> vertexNormals;
+        newIndex.assign(m_vertices.size(), 0);
+
+        uint32 numVertices(0);
+        for (const slab& work : m_vertexSlabs)
+        {
+            numVertices += work.count;
+        }
+        vertices.reserve(numVertices);
+        vertexEdgeIds.reserve(numVertices);
+        vertexNormals.reserve(numVertices);
+        for (slab& work : m_vertexSlabs)
+        {
+            const uint32 offset(vertices.size());
+            for (uint32 ind = work.offset; ind < work.offset + work.count; ++ind)
+            {
+                newIndex[ind] = vertices.size();
+                vertices.push_back(m_vertices[ind]);
+                vertexEdgeIds.push_back(m_vertexEdgeIds[ind]);
+                vertexNormals.push_back(m_vertexNormals[ind]);
+            }
+            work.offset = offset;
+            work.capacity = work.count;
+        }
+        m_vertices.swap(vertices);
+        m_vertexEdgeIds.swap(vertexEdgeIds);
+        m_vertexNormals.swap(vertexNormals);
+
+        // the compacted vertices may fit 16 bit again
+        const indexBuffer::width indexWidth(indexBuffer::calculateWidth(m_vertices.size()));
+        t_indices indices;
+        indices.setWidth(indexWidth);
+        uint32 numIndices(0);
+        for (const slab& work : m_indexSlabs)
+        {
+            numIndices += work.count;
+        }
+        indices.reserve(numIndices);
+        for (slab& work : m_indexSlabs)
+        {
+            const uint32 offset(indices.size());
+            for (uint32 ind = work.offset; ind < work.offset + work.count; ++ind)
+            {
+                indices.push_back(newIndex[m_indices[ind]]);
+            }
+            work.offset = offset;
+            work.capacity = work.count;
+        }
+        m_indices.swap(indices);
+
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            remapIndices(m_indicesLod[lod], newIndex);
+            m_indicesLod[lod].setWidth(indexWidth);
+        }
+
+        m_dirtyVertices = range(0, m_vertices.size());
+        m_dirtyIndices = range(0, m_indices.size());
     }
 
-    /**
-     * @brief same as getCaluculateTransvoxel()
-     * @see getCaluculateTransvoxel()
-     */
-    bool getCaluculateLod() const
+private:
+    static t_scratch &getScratch()
     {
-        return getCaluculateTransvoxel();
+        static thread_local t_scratch result;
+        if (result.reuse.empty())
+        {
+            const int32 reuseLength(t_voxelAccessor::voxelLengthWithNormalCorrection*3);
+            result.reuse.resize(reuseLength*reuseLength*reuseLength, -1);
+            result.indices.resize(getNumIndexSlabs());
+        }
+        return result;
     }
-
-    /**
-     * @brief getPositions returns resulting position-list.
-     * @return
-     */
-    const t_vertices& getVertices() const
+    static void resetReuse(t_scratch &scratch)
     {
-        return m_vertices;
+        for (const int32& id : scratch.reuseSet)
+        {
+            scratch.reuse[id] = -1;
+        }
+        scratch.reuseSet.clear();
+        for (const int32& id : scratch.vertexEdgeIds)
+        {
+            scratch.reuse[id] = -1;
+        }
     }
-    /**
-     * @brief getIndices returns resulting index-list.
-     * @return
-     */
-    const t_indices& getIndices() const
+    void setReuseToGroup(t_scratch &scratch, const int32& group) const
     {
-        return m_indices;
+        const slab &work(m_vertexSlabs[group+1]);
+        for (uint32 index = work.offset; index < work.offset + work.count; ++index)
+        {
+            const int32 id(m_vertexEdgeIds[index]);
+            scratch.reuse[id] = index;
+            scratch.reuseSet.push_back(id);
+        }
+    }
+    static int32 createdToReference(const uint32& created)
+    {
+        return -2 - (int32)created;
+    }
+    static uint32 referenceToCreated(const int32& reference)
+    {
+        BASSERT(reference < -1);
+        return -2 - reference;
+    }
+    static uint32 referenceToIndex(const t_scratch &scratch, const int32& reference)
+    {
+        if (reference >= 0)
+        {
+            return reference;
+        }
+        return scratch.verticesFinal[referenceToCreated(reference)];
+    }
+    const t_vertex &getVertexByReference(const t_scratch &scratch, const int32& reference) const
+    {
+        if (reference >= 0)
+        {
+            return m_vertices[reference];
+        }
+        return scratch.vertices[referenceToCreated(reference)];
+    }
+    static uint32 allocateSlab(slab &toAllocate, const uint32& count, uint32 &listSize)
+    {
+        if (count > toAllocate.capacity)
+        {
+            // doesn't fit, append
+            toAllocate.offset = listSize;
+            toAllocate.capacity = count;
+            listSize += count;
+        }
+        toAllocate.count = count;
+        return toAllocate.offset;
+    }
+    static void extendRange(range &toExtend, const uint32& begin, const uint32& end)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        if (toExtend.isEmpty())
+        {
+            toExtend = range(begin, end);
+            return;
+        }
+        toExtend.begin = math::min(toExtend.begin, begin);
+        toExtend.end = math::max(toExtend.end, end);
+    }
+    void resizeVertexLists(const uint32& size)
+    {
+        m_vertices.resize(size);
+        m_vertexEdgeIds.resize(size, -1);
+        m_vertexNormals.resize(size);
     }
     /**
-     * @brief getPositions returns resulting transvoxel-list. Vertices for these indices are in getPositions() and getNormals().
-     * @return
+     * @brief updateIndexWidth switches the index-lists to 32 bit if the vertices don't fit 16 bit anymore. Marks the index-list as dirty if so.
+     * Only compact() switches back.
      */
-    const t_indices& getIndicesLod(const uint16& lod) const
+    void updateIndexWidth()
     {
-        BASSERT(lod < 6);
-        return m_indicesLod[lod];
+        if (m_vertices.size() <= indexBuffer::getMaxNumVertices(m_indices.getWidth()))
+        {
+            return;
+        }
+        const indexBuffer::width indexWidth(indexBuffer::calculateWidth(m_vertices.size()));
+        m_indices.setWidth(indexWidth);
+        for (int32 lod = 0; lod < 6; ++lod)
+        {
+            m_indicesLod[lod].setWidth(indexWidth);
+        }
+        m_dirtyIndices = range(0, m_indices.size());
+    }
+    static void remapIndices(t_indices& indices, const vector<uint32>& newIndex)
+    {
+        for (uint32 ind = 0; ind < indices.size(); ++ind)
+        {
+            indices.set(ind, newIndex[indices[ind]]);
+        }
+    }
+    void setVertex(const uint32& index, const t_vertex& vertex, const int32& edgeId)
+    {
+        m_vertices[index] = vertex;
+        m_vertices[index].normal.normalise();
+        m_vertexEdgeIds[index] = edgeId;
+        m_vertexNormals[index] = vertex.normal;
     }
-
-protected:
     /**
-     * @brief surface constructor
+     * @brief calculateCellBricksWithoutSurface looks up for every brick of cells if all its voxel lie on the same side of the surface, so its cells create no triangles.
+     * The cells of a brick read the voxel of the same brick and of the next one.
+     * @param result Per brick, see tile::accessor::calculateBrickIndex().
      */
-    surface()
+    void calculateCellBricksWithoutSurface(vector<uint8>& result) const
     {
+        const vector3int32 lastBrick(t_voxelAccessor::brickLengthPerTile-1);
+        result.resize(t_voxelAccessor::brickCount);
+        for (int32 indX = 0; indX <= lastBrick.x; ++indX)
+        {
+            for (int32 indY = 0; indY <= lastBrick.y; ++indY)
+            {
+                for (int32 indZ = 0; indZ <= lastBrick.z; ++indZ)
+                {
+                    const vector3int32 brick(indX, indY, indZ);
+                    bool empty(true);
+                    bool full(true);
+                    for (int32 ind = 0; ind < 8; ++ind)
+                    {
+                        const vector3int32 toCheck((brick + vector3int32(ind & 1, (ind >> 1) & 1, (ind >> 2) & 1)).getMinimum(lastBrick));
+                        empty &= m_voxel->isBrickEmpty(toCheck);
+                        full &= m_voxel->isBrickFull(toCheck);
+                    }
+                    result[t_voxelAccessor::calculateBrickIndex(brick)] = empty || full;
+                }
+            }
+        }
     }
-
     /**
-     * @brief Creates a vertex
+     * @brief calculateConnectivity flood fills the voxel 0 to voxelLength with an interpolation lower zero, starting at the sides.
+     * Two sides are connected if a filled region touches both. Voxel are neighbours if they share a side.
+     * Thin diagonal gaps in the surface don't connect, so a tile behind one may get hidden although a pixel of it would be visible.
+     * @see getConnectivity()
      */
-    t_vertex createVertex(const vector3int32& /*voxelPos*/, const t_voxel &/*voxel0*/, const t_voxel &/*voxel1*/, const vector3 &position, const vector3 &normal)
+    void calculateConnectivity()
     {
-        t_vertex result;
-        result.position = position;
-        result.normal = normal;
-        return result;
+        const int32 length(t_voxelAccessor::voxelLengthSurface);
+        const uint16 allConnected((1 << 15) - 1);
+
+        m_connectivity = 0;
+        if (m_voxel->isEmpty())
+        {
+            m_connectivity = allConnected;
+            return;
+        }
+        if (m_voxel->isFull())
+        {
+            return;
+        }
+
+        t_scratch &scratch(getScratch());
+        vector<uint8> &visited(scratch.connectivityVisited);
+        vector<int32> &toVisit(scratch.connectivityToVisit);
+        visited.assign(length*length*length, 0);
+
+        const vector3int32 neighbours[] = {vector3int32(-1, 0, 0),
+                                           vector3int32(1, 0, 0),
+                                           vector3int32(0, -1, 0),
+                                           vector3int32(0, 1, 0),
+                                           vector3int32(0, 0, -1),
+                                           vector3int32(0, 0, 1)
+                                          };
+        for (int32 indStart = 0; indStart < length*length*length && m_connectivity != allConnected; ++indStart)
+        {
+            const vector3int32 start(indStart / (length*length), (indStart / length) % length, indStart % length);
+            const bool onSide(start.x == 0 || start.y == 0 || start.z == 0 ||
+                              start.x == length-1 || start.y == length-1 || start.z == length-1);
+            if (!onSide || visited[indStart] != 0)
+            {
+                continue;
+            }
+            visited[indStart] = 1;
+            if (m_voxel->getVoxel(start).getInterpolation() >= 0)
+            {
+                continue;
+            }
+
+            uint8 sides(0);
+            toVisit.push_back(indStart);
+            while (!toVisit.empty())
+            {
+                const int32 index(toVisit.back());
+                toVisit.pop_back();
+                const vector3int32 work(index / (length*length), (index / length) % length, index % length);
+                for (int32 side = 0; side < 6; ++side)
+                {
+                    const vector3int32 pos(work + neighbours[side]);
+                    if (!(pos >= vector3int32(0) && pos < vector3int32(length)))
+                    {
+                        sides |= 1 << side;
+                        continue;
+                    }
+                    const int32 neighbour(pos.x*length*length + pos.y*length + pos.z);
+                    if (visited[neighbour] != 0)
+                    {
+                        continue;
+                    }
+                    visited[neighbour] = 1;
+                    if (m_voxel->getVoxel(pos).getInterpolation() < 0)
+                    {
+                        toVisit.push_back(neighbour);
+                    }
+                }
+            }
+            for (int32 side0 = 0; side0 < 6; ++side0)
+            {
+                for (int32 side1 = side0+1; side1 < 6; ++side1)
+                {
+                    if ((sides & (1 << side0)) != 0 && (sides & (1 << side1)) != 0)
+                    {
+                        m_connectivity |= calculateConnectivityBit(side0, side1);
+                    }
+                }
+            }
+        }
     }
 
-    /**
-     * @brief Creates a vertex for lod
-     */
-    t_vertex createVertexLod(const vector3int32& /*voxelPos*/, const t_voxel &/*voxel0*/, const t_voxel &/*voxel1*/, const vector3 &position, const vector3 &normal)
+    int32 getFirstCell() const
     {
-        t_vertex result;
-        result.position = position;
-        result.normal = normal;
-        return result;
+        if (m_normalCalculation == normalCalculation::gradient)
+        {
+            return 0;
+        }
+        return -1;
+    }
+    int32 getLastCell() const
+    {
+        if (m_normalCalculation == normalCalculation::gradient)
+        {
+            return t_voxelAccessor::voxelLength-1;
+        }
+        return t_voxelAccessor::voxelLength;
+    }
+    static int32 getNumVertexSlabs()
+    {
+        // groups -1 to voxelLength+1 and the transvoxel vertices
+        return t_voxelAccessor::voxelLength+4;
+    }
+    static int32 getNumIndexSlabs()
+    {
+        return t_voxelAccessor::voxelLength+2;
     }
 
-private:
     const t_voxel &getVoxel(const vector3int32& pos) const
     {
         return m_voxel->getVoxel(pos);
@@ -760,6 +1852,25 @@ private:
         BASSERT(false);
         return vector3(0.);
     }
+    vector3 calculateGradient(const vector3int32& pos) const
+    {
+        return vector3(getVoxelInterpolation(pos + vector3int32(1, 0, 0)) - getVoxelInterpolation(pos - vector3int32(1, 0, 0)),
+                       getVoxelInterpolation(pos + vector3int32(0, 1, 0)) - getVoxelInterpolation(pos - vector3int32(0, 1, 0)),
+                       getVoxelInterpolation(pos + vector3int32(0, 0, 1)) - getVoxelInterpolation(pos - vector3int32(0, 0, 1)));
+    }
+    vector3 calculateGradientNormal(const vector3int32& pos, const int32& corner0, const int32& corner1) const
+    {
+        const vector3int32 corn0(pos + calculateCorner(corner0));
+        const vector3int32 corn1(pos + calculateCorner(corner1));
+
+        const int8 interpolation0 = getVoxelInterpolation(corn0);
+        const int8 interpolation1 = getVoxelInterpolation(corn1);
+        BASSERT(interpolation0 != interpolation1);
+
+        const real mu((0.0 - ((real)interpolation0)) / ((real)(interpolation1 - interpolation0)));
+        // the interpolation rises into the solid, the normal points out of it
+        return -(calculateGradient(corn0)*(1.-mu) + calculateGradient(corn1)*mu);
+    }
     static vector3 getInterpolatedPosition(const vector3& positionFrom, const vector3& positionTo, const int8& interpolationFrom, const int8& interpolationTo)
     {
         BASSERT(interpolationTo != interpolationFrom);
@@ -773,10 +1884,26 @@ private:
 protected:
     t_voxelAccessorPtr m_voxel;
     int32 m_lod;
+    real m_voxelSize;
+    normalCalculation m_normalCalculation;
 
     t_vertices m_vertices;
     t_indices m_indices;
     t_indices m_indicesLod[6];
+    uint8 m_indicesLodCalculated;
+
+    // per vertex the edge-id for reuse and the not normalised normal for transvoxel
+    vector<int32> m_vertexEdgeIds;
+    vector<vector3> m_vertexNormals;
+    t_slabs m_vertexSlabs;
+    t_slabs m_indexSlabs;
+    range m_dirtyVertices;
+    range m_dirtyIndices;
+    real m_maxFragmentation;
+    // see calculateConnectivity()
+    uint16 m_connectivity;
+    bvh m_bvh;
+    meshlets m_meshlets;
 };
 
 
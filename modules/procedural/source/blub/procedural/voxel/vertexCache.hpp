@@ -0,0 +1,309 @@
+#ifndef BLUB_PROCEDURAL_VOXEL_VERTEXCACHE
+#define BLUB_PROCEDURAL_VOXEL_VERTEXCACHE
+
+#include "blub/core/globals.hpp"
+#include "blub/core/vector.hpp"
+#include "blub/math/math.hpp"
+#include "blub/procedural/voxel/indexBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace blub
+{
+namespace procedural
+{
+namespace voxel
+{
+
+
+/**
+ * @brief The vertexCache class reorders triangles for the post-transform vertex-cache of a gpu,
+ * by Tom Forsyth "Linear-Speed Vertex Cache Optimisation". Models a least recently used cache of cacheSize vertices.
+ * Keeps its lists between calls, so reuse an instance per thread.
+ */
+class vertexCache
+{
+public:
+    static const int32 cacheSize = 32;
+
+    vertexCache()
+    {
+        for (int32 position = 0; position < cacheSize; ++position)
+        {
+            // the last triangle's vertices get used again by the next one in any case, so they score the same
+            m_scoreCache[position] = position < 3 ? 0.75 : std::pow(1. - (real)(position - 3) / (real)(cacheSize - 3), (real)1.5);
+        }
+        for (int32 numTriangles = 0; numTriangles < maxValence; ++numTriangles)
+        {
+            // vertices with few triangles left get finished first
+            m_scoreValence[numTriangles] = numTriangles == 0 ? 0. : 2. / std::sqrt((real)numTriangles);
+        }
+    }
+
+    /**
+     * @brief optimizeTriangleOrder reorders the triangles of an index-list, the order of the vertices inside a triangle stays.
+     * @param indices Triangle list, 3 per triangle.
+     * @param numIndices
+     */
+    template <typename indexType>
+    void optimizeTriangleOrder(indexType* indices, const uint32& numIndices)
+    {
+        const uint32 numTriangles(numIndices / 3);
+        if (numTriangles < 2)
+        {
+            return;
+        }
+        // local vertices, numbered by first use
+        m_triangleVertices.resize(numTriangles*3);
+        m_vertices.clear();
+        for (uint32 ind = 0; ind < numTriangles*3; ++ind)
+        {
+            const uint32 index(indices[ind]);
+            if (index >= m_localOfIndex.size())
+            {
+                m_localOfIndex.resize(index + 1, -1);
+            }
+            if (m_localOfIndex[index] < 0)
+            {
+                m_localOfIndex[index] = m_vertices.size();
+                m_vertices.push_back(t_vertex());
+                m_vertices.back().index = index;
+            }
+            m_triangleVertices[ind] = m_localOfIndex[index];
+            ++m_vertices[m_localOfIndex[index]].numTriangles;
+        }
+        for (const t_vertex& vertex : m_vertices)
+        {
+            m_localOfIndex[vertex.index] = -1;
+        }
+        // triangles per vertex
+        uint32 offset(0);
+        for (t_vertex& vertex : m_vertices)
+        {
+            vertex.trianglesOffset = offset;
+            offset += vertex.numTriangles;
+            vertex.numTriangles = 0;
+        }
+        m_vertexTriangles.resize(offset);
+        for (uint32 ind = 0; ind < numTriangles*3; ++ind)
+        {
+            t_vertex& vertex(m_vertices[m_triangleVertices[ind]]);
+            m_vertexTriangles[vertex.trianglesOffset + vertex.numTriangles++] = ind / 3;
+        }
+        for (t_vertex& vertex : m_vertices)
+        {
+            vertex.score = calculateScore(vertex);
+        }
+        m_triangleEmitted.assign(numTriangles, 0);
+
+        m_result.resize(numTriangles*3);
+        int32 cache[cacheSize + 3];
+        int32 numCached(0);
+        uint32 nextInOrder(0);
+        int32 best(0);
+        for (uint32 numEmitted = 0; numEmitted < numTriangles; ++numEmitted)
+        {
+            if (best < 0)
+            {
+                // no triangle in the cache left, continue with the first one not emitted in the original order
+                while (m_triangleEmitted[nextInOrder])
+                {
+                    ++nextInOrder;
+                }
+                best = nextInOrder;
+            }
+            m_triangleEmitted[best] = 1;
+            // the vertices of the triangle move to the front of the cache
+            int32 newCache[cacheSize + 3];
+            int32 numNewCached(0);
+            for (int32 corner = 0; corner < 3; ++corner)
+            {
+                const int32 local(m_triangleVertices[best*3 + corner]);
+                t_vertex& vertex(m_vertices[local]);
+                m_result[numEmitted*3 + corner] = vertex.index;
+                removeTriangle(vertex, best);
+                if (vertex.lastEmitted != numEmitted + 1)
+                {
+                    vertex.lastEmitted = numEmitted + 1;
+                    newCache[numNewCached++] = local;
+                }
+            }
+            for (int32 ind = 0; ind < numCached; ++ind)
+            {
+                if (m_vertices[cache[ind]].lastEmitted != numEmitted + 1)
+                {
+                    newCache[numNewCached++] = cache[ind];
+                }
+            }
+            // evicted vertices lose their cache-score
+            for (int32 ind = cacheSize; ind < numNewCached; ++ind)
+            {
+                t_vertex& vertex(m_vertices[newCache[ind]]);
+                vertex.cachePosition = -1;
+                vertex.score = calculateScore(vertex);
+            }
+            numCached = numNewCached < cacheSize ? numNewCached : (int32)cacheSize;
+            std::copy(newCache, newCache + numCached, cache);
+            for (int32 ind = 0; ind < numCached; ++ind)
+            {
+                t_vertex& vertex(m_vertices[cache[ind]]);
+                vertex.cachePosition = ind;
+                vertex.score = calculateScore(vertex);
+            }
+            // the best triangle uses a cached vertex, else it would score lower
+            best = -1;
+            real bestScore(-1.);
+            for (int32 ind = 0; ind < numCached; ++ind)
+            {
+                const t_vertex& vertex(m_vertices[cache[ind]]);
+                for (uint32 work = vertex.trianglesOffset; work < vertex.trianglesOffset + vertex.numTriangles; ++work)
+                {
+                    const uint32 triangle(m_vertexTriangles[work]);
+                    const real score(m_vertices[m_triangleVertices[triangle*3]].score +
+                                     m_vertices[m_triangleVertices[triangle*3 + 1]].score +
+                                     m_vertices[m_triangleVertices[triangle*3 + 2]].score);
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        best = triangle;
+                    }
+                }
+            }
+        }
+        std::copy(m_result.cbegin(), m_result.cend(), indices);
+    }
+    /**
+     * @brief optimizeTriangleOrder reorders the triangles of an indexBuffer of any width.
+     * @param indices
+     */
+    void optimizeTriangleOrder(indexBuffer& indices)
+    {
+        if (indices.getWidth() == indexBuffer::width::bits16)
+        {
+            optimizeTriangleOrder(indices.getData16(), indices.size());
+        }
+        else
+        {
+            optimizeTriangleOrder(indices.getData32(), indices.size());
+        }
+    }
+
+    /**
+     * @brief calculateAcmr simulates a first in first out cache, like the one of most gpus, and returns the average cache miss ratio.
+     * @param indices Triangle list, 3 per triangle.
+     * @param numIndices
+     * @param numCached Size of the simulated cache.
+     * @return Vertices transformed per triangle. 0.5 is the optimum for large regular grids, 3 the worst case.
+     */
+    template <typename indexType>
+    real calculateAcmr(const indexType* indices, const uint32& numIndices, const uint32& numCached)
+    {
+        if (numIndices < 3)
+        {
+            return 0.;
+        }
+        // time a vertex got into the cache, 0 if never
+        m_timestamps.clear();
+        uint32 time(numCached + 1);
+        uint32 numMisses(0);
+        for (uint32 ind = 0; ind < numIndices; ++ind)
+        {
+            const uint32 index(indices[ind]);
+            if (index >= m_timestamps.size())
+            {
+                m_timestamps.resize(index + 1, 0);
+            }
+            if (time - m_timestamps[index] > numCached)
+            {
+                m_timestamps[index] = time++;
+                ++numMisses;
+            }
+        }
+        return (real)numMisses / (real)(numIndices / 3);
+    }
+    /**
+     * @brief calculateAcmr simulates a first in first out cache for an indexBuffer of any width.
+     * @param indices
+     * @param numCached
+     * @return
+     */
+    real calculateAcmr(const indexBuffer& indices, const uint32& numCached)
+    {
+        if (indices.getWidth() == indexBuffer::width::bits16)
+        {
+            return calculateAcmr(indices.getData16(), indices.size(), numCached);
+        }
+        return calculateAcmr(indices.getData32(), indices.size(), numCached);
+    }
+
+protected:
+    static const int32 maxValence = 32;
+
+    struct t_vertex
+    {
+        t_vertex()
+            : index(0)
+            , numTriangles(0)
+            , trianglesOffset(0)
+            , cachePosition(-1)
+            , lastEmitted(0)
+            , score(0.)
+        {
+            ;
+        }
+
+        uint32 index;
+        // not emitted triangles, at the beginning of the vertex' part of m_vertexTriangles
+        uint32 numTriangles;
+        uint32 trianglesOffset;
+        int32 cachePosition;
+        // number of the last emitted triangle that used the vertex, plus one
+        uint32 lastEmitted;
+        real score;
+    };
+
+    real calculateScore(const t_vertex& vertex) const
+    {
+        if (vertex.numTriangles == 0)
+        {
+            return -1.;
+        }
+        real result(m_scoreValence[math::min<uint32>(vertex.numTriangles, maxValence - 1)]);
+        if (vertex.cachePosition >= 0)
+        {
+            result += m_scoreCache[vertex.cachePosition];
+        }
+        return result;
+    }
+    void removeTriangle(t_vertex& vertex, const uint32& triangle)
+    {
+        uint32* begin(&m_vertexTriangles[vertex.trianglesOffset]);
+        uint32* found(std::find(begin, begin + vertex.numTriangles, triangle));
+        BASSERT(found != begin + vertex.numTriangles);
+        std::swap(*found, begin[vertex.numTriangles - 1]);
+        --vertex.numTriangles;
+    }
+
+    real m_scoreCache[cacheSize];
+    real m_scoreValence[maxValence];
+
+    vector<t_vertex> m_vertices;
+    // index to local vertex, -1 if none
+    vector<int32> m_localOfIndex;
+    vector<int32> m_triangleVertices;
+    vector<uint32> m_vertexTriangles;
+    vector<uint8> m_triangleEmitted;
+    vector<uint32> m_result;
+    vector<uint32> m_timestamps;
+
+};
+
+
+}
+}
+}
+
+
+#endif // BLUB_PROCEDURAL_VOXEL_VERTEXCACHE
@@ -5,7 +5,9 @@
 #include "blub/core/byteArray.hpp"
 #include "blub/core/hashList.hpp"
 #include "blub/core/hashMap.hpp"
+#include "blub/core/metrics.hpp"
 #include "blub/core/signal.hpp"
+#include "blub/core/trace.hpp"
 #include "blub/log/global.hpp"
 #include "blub/math/axisAlignedBox.hpp"
 #include "blub/math/octree/search.hpp"
@@ -69,6 +71,7 @@ public:
         , m_searchFunction(octreeSearch)
         , m_voxelSize(voxelSize)
         , m_numtilesInWork(0)
+        , m_numTilesCancelled(0)
     {
         BASSERT(tiles != nullptr);
 
@@ -80,13 +83,12 @@ public:
     }
 
     // to "send sync"
+    // the accessor replaces changed tiles by copies, so the change-list gets kept without read-locking it
     void tileEditDone()
     {
         BASSERT(m_voxels != nullptr);
 
-        m_voxels->lockForRead();
-
-        t_base::m_master.post(boost::bind(&sender::tileEditDoneMaster, this));
+        t_base::m_master.post(boost::bind(&sender::tileEditDoneMaster, this, m_voxels->getTilesThatGotEdited()));
     }
 
     // add/update/remove sync-reveiver
@@ -116,12 +118,35 @@ public:
         return &m_sigSendTileData;
     }
 
+    /**
+     * @brief getNumTilesCancelled returns the number of tiles whose compression got skipped, because the tile changed again before.
+     * Call after all work got done.
+     * @return
+     */
+    const uint64& getNumTilesCancelled() const
+    {
+        return m_numTilesCancelled;
+    }
+
 protected:
-    void tileEditDoneMaster()
+    void tileEditDoneMaster(const t_tileAccessorChangeList& changeList)
+    {
+        // a tile reported several times gets compressed once, by its newest version
+        for (auto change : changeList)
+        {
+            m_tilesPending.insert(change.first, change.second);
+        }
+        compressPendingMaster();
+    }
+    void compressPendingMaster()
     {
-        const t_tileAccessorChangeList& changeList(m_voxels->getTilesThatGotEdited());
+        if (m_numtilesInWork > 0 || m_tilesPending.empty())
+        {
+            return;
+        }
+        t_tileAccessorChangeList changeList;
+        changeList.swap(m_tilesPending);
 
-        BASSERT(m_numtilesInWork == 0);
         m_numtilesInWork = changeList.size();
 
         for (auto change : changeList)
@@ -139,10 +164,10 @@ protected:
             {
                 BASSERT(!workTile->isEmpty());
                 BASSERT(!workTile->isFull());
-                m_worker.post(boost::bind(&sender::compressTileWorker, this, id, workTile, nullptr));
+                m_worker.post(boost::bind(&sender::compressTileWorker, this, id, workTile, nullptr, workTile->getVersion()));
                 continue;
             }
-            m_worker.post(boost::bind(&sender::compressTileWorker, this, id, workTile, it->second));
+            m_worker.post(boost::bind(&sender::compressTileWorker, this, id, workTile, it->second, workTile->getVersion()));
         }
     }
 
@@ -191,6 +216,7 @@ protected:
             }
         } // flush happens here
         t_tileDataPtr send(new byteArray(result.str().c_str(), result.str().size()));
+        getMetrics().bytesSent.add(send->size());
 
         m_sigSendTileData(receiver, send);
     }
@@ -208,6 +234,7 @@ protected:
             format << typeToSend;
         } // flush happens here
         t_tileDataPtr send(new byteArray(result.str().c_str(), result.str().size()));
+        getMetrics().bytesSent.add(send->size());
 
         m_sigSendTileData(receiver, send);
     }
@@ -220,10 +247,45 @@ protected:
         sendLockUnlockForEditMaster(receiver, false);
     }
 
-    void compressTileWorker(const t_tileId& id, const t_tileAccessorPtr &tile, t_tileDataPtr toSave)
+    /**
+     * @brief The t_metrics struct contains the metrics all senders record to, see metrics::registry::getGlobal().
+     */
+    struct t_metrics
+    {
+        t_metrics()
+            : bytesSent(metrics::registry::getGlobal().getCounter("blub_sync_voxel_sender_sent_bytes_total", "Bytes handed to signalSendTileData()."))
+            , bytesUncompressed(metrics::registry::getGlobal().getCounter("blub_sync_voxel_sender_uncompressed_bytes_total", "Bytes of the serialized accessor-tiles before compression."))
+            , bytesCompressed(metrics::registry::getGlobal().getCounter("blub_sync_voxel_sender_compressed_bytes_total", "Bytes of the serialized accessor-tiles after compression."))
+            , compressTime(metrics::registry::getGlobal().getHistogram("blub_sync_voxel_sender_compress_microseconds", "Time to serialize and compress an accessor-tile."))
+        {
+            ;
+        }
+
+        metrics::counter& bytesSent;
+        metrics::counter& bytesUncompressed;
+        metrics::counter& bytesCompressed;
+        metrics::histogram& compressTime;
+    };
+    static t_metrics& getMetrics()
+    {
+        static t_metrics result;
+        return result;
+    }
+
+    void compressTileWorker(const t_tileId& id, const t_tileAccessorPtr &tile, t_tileDataPtr toSave, const uint32& version)
     {
+        BLUB_TRACE_SCOPE_TILE("compressTileWorker", "sync", id, -1);
         BASSERT(!tile.isNull());
 
+        if (tile->getVersion() != version)
+        {
+            // tile changes again and gets reported again, see procedural::voxel::tile::accessor::getVersion()
+            t_base::m_master.post(boost::bind(&sender::compressTileCancelledMaster, this, id));
+            return;
+        }
+
+        metrics::scopedTimer timer(getMetrics().compressTime);
+
         std::stringstream toCompress;
         {
             blub::serialization::format::binary::output format(toCompress);
@@ -241,6 +303,8 @@ protected:
         }
 
         const int32 sizeCompressed = dataContainerCompressed.str().size();
+        getMetrics().bytesUncompressed.add(toCompress.str().size());
+        getMetrics().bytesCompressed.add(sizeCompressed);
 
         if (toSave.isNull())
         {
@@ -284,18 +348,27 @@ protected:
             const vector3int32 pos(id*t_base::m_syncTree.getMinNodeSize() + t_base::m_syncTree.getMinNodeSize()/2);
             t_base::addSyncMaster(id, vector3(pos));
         }
-        else
-        {
-			BLUB_SYNC_LOG_ERROR() << "compressTileAfterMaster: invalid case";
-        }
+        // else removing a tile that didn't get added is valid, its adding got cancelled or it turned from empty to full, see simple::base::getTilesThatGotFull()
+        m_tilesCancelled.erase(id);
+
+        afterCompressTileMaster();
+    }
+    void compressTileCancelledMaster(const t_tileId& id)
+    {
+        m_tilesCancelled.insert(id);
+        ++m_numTilesCancelled;
 
+        afterCompressTileMaster();
+    }
+    void afterCompressTileMaster()
+    {
         --m_numtilesInWork;
         BASSERT(m_numtilesInWork >= 0);
         if (m_numtilesInWork == 0)
         {
-            m_voxels->unlockRead();
-
             unlockAllReceiver();
+
+            compressPendingMaster();
         }
     }
 
@@ -354,7 +427,11 @@ protected:
     t_tileDataMap m_tileData;
 
     int32 m_numtilesInWork;
+    // tiles reported while tiles were in work
+    t_tileAccessorChangeList m_tilesPending;
     t_lockedReceiverList m_lockedReceiverList;
+    hashList<t_tileId> m_tilesCancelled;
+    uint64 m_numTilesCancelled;
 
     t_sigSendTileData m_sigSendTileData;
 